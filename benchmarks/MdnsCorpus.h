@@ -0,0 +1,288 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// mDNS packets for the message benchmarks, modeled on captures from a home network:
+// announcements and responses from AirPlay, IPP, Google Cast, HomeKit and Spotify devices,
+// a browse query with known answers, a probe, a goodbye and a service type enumeration.
+// Names are compressed the way the devices compress them.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mdns_corpus
+{
+    struct CorpusPacket
+    {
+        const char* name;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    static const uint8_t k_airplay_announcement[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x05, 0x08, 0x5f, 0x61, 0x69,
+        0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c,
+        0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0e, 0x0b, 0x4c, 0x69, 0x76, 0x69,
+        0x6e, 0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0xc0, 0x0c, 0xc0, 0x2b, 0x00, 0x21, 0x80, 0x01, 0x00,
+        0x00, 0x00, 0x78, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x1b, 0x58, 0x0b, 0x4c, 0x69, 0x76, 0x69,
+        0x6e, 0x67, 0x2d, 0x52, 0x6f, 0x6f, 0x6d, 0xc0, 0x1a, 0xc0, 0x2b, 0x00, 0x10, 0x80, 0x01, 0x00,
+        0x00, 0x11, 0x94, 0x01, 0x52, 0x05, 0x61, 0x63, 0x6c, 0x3d, 0x30, 0x1a, 0x64, 0x65, 0x76, 0x69,
+        0x63, 0x65, 0x69, 0x64, 0x3d, 0x35, 0x38, 0x3a, 0x35, 0x35, 0x3a, 0x43, 0x41, 0x3a, 0x31, 0x41,
+        0x3a, 0x45, 0x32, 0x3a, 0x38, 0x38, 0x18, 0x66, 0x65, 0x61, 0x74, 0x75, 0x72, 0x65, 0x73, 0x3d,
+        0x30, 0x78, 0x35, 0x41, 0x37, 0x46, 0x46, 0x46, 0x46, 0x37, 0x2c, 0x30, 0x78, 0x31, 0x45, 0x0b,
+        0x66, 0x6c, 0x61, 0x67, 0x73, 0x3d, 0x30, 0x78, 0x32, 0x34, 0x34, 0x28, 0x67, 0x69, 0x64, 0x3d,
+        0x46, 0x30, 0x44, 0x31, 0x44, 0x34, 0x41, 0x38, 0x2d, 0x33, 0x41, 0x31, 0x45, 0x2d, 0x34, 0x45,
+        0x36, 0x42, 0x2d, 0x39, 0x46, 0x32, 0x43, 0x2d, 0x30, 0x45, 0x34, 0x42, 0x35, 0x41, 0x32, 0x44,
+        0x33, 0x43, 0x31, 0x31, 0x05, 0x69, 0x67, 0x6c, 0x3d, 0x31, 0x06, 0x67, 0x63, 0x67, 0x6c, 0x3d,
+        0x31, 0x10, 0x6d, 0x6f, 0x64, 0x65, 0x6c, 0x3d, 0x41, 0x70, 0x70, 0x6c, 0x65, 0x54, 0x56, 0x36,
+        0x2c, 0x32, 0x0d, 0x70, 0x72, 0x6f, 0x74, 0x6f, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31, 0x2e, 0x31,
+        0x27, 0x70, 0x69, 0x3d, 0x32, 0x65, 0x33, 0x38, 0x38, 0x30, 0x30, 0x36, 0x2d, 0x31, 0x33, 0x62,
+        0x61, 0x2d, 0x34, 0x30, 0x34, 0x31, 0x2d, 0x39, 0x61, 0x36, 0x37, 0x2d, 0x32, 0x35, 0x64, 0x64,
+        0x34, 0x61, 0x34, 0x33, 0x64, 0x35, 0x33, 0x36, 0x28, 0x70, 0x73, 0x69, 0x3d, 0x42, 0x45, 0x33,
+        0x45, 0x37, 0x46, 0x34, 0x34, 0x2d, 0x30, 0x45, 0x30, 0x44, 0x2d, 0x34, 0x43, 0x33, 0x41, 0x2d,
+        0x38, 0x44, 0x46, 0x30, 0x2d, 0x35, 0x45, 0x30, 0x41, 0x38, 0x33, 0x44, 0x39, 0x44, 0x33, 0x45,
+        0x34, 0x43, 0x70, 0x6b, 0x3d, 0x62, 0x30, 0x37, 0x37, 0x32, 0x37, 0x64, 0x36, 0x66, 0x36, 0x63,
+        0x64, 0x36, 0x65, 0x30, 0x38, 0x62, 0x35, 0x38, 0x65, 0x64, 0x65, 0x35, 0x32, 0x35, 0x65, 0x63,
+        0x33, 0x63, 0x64, 0x65, 0x61, 0x61, 0x32, 0x35, 0x32, 0x61, 0x64, 0x39, 0x66, 0x36, 0x38, 0x33,
+        0x66, 0x65, 0x62, 0x32, 0x31, 0x32, 0x65, 0x66, 0x38, 0x61, 0x32, 0x30, 0x35, 0x32, 0x34, 0x36,
+        0x35, 0x35, 0x34, 0x65, 0x37, 0x10, 0x73, 0x72, 0x63, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x35, 0x39,
+        0x35, 0x2e, 0x31, 0x33, 0x2e, 0x31, 0x0b, 0x6f, 0x73, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31, 0x35,
+        0x2e, 0x34, 0x04, 0x76, 0x76, 0x3d, 0x32, 0x05, 0x5f, 0x72, 0x61, 0x6f, 0x70, 0xc0, 0x15, 0x00,
+        0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x1b, 0x18, 0x35, 0x38, 0x35, 0x35, 0x43, 0x41,
+        0x31, 0x41, 0x45, 0x32, 0x38, 0x38, 0x40, 0x4c, 0x69, 0x76, 0x69, 0x6e, 0x67, 0x20, 0x52, 0x6f,
+        0x6f, 0x6d, 0xc1, 0xb7, 0xc1, 0xc9, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08,
+        0x00, 0x00, 0x00, 0x00, 0x1b, 0x58, 0xc0, 0x4b, 0xc1, 0xc9, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00,
+        0x11, 0x94, 0x00, 0xbc, 0x0a, 0x63, 0x6e, 0x3d, 0x30, 0x2c, 0x31, 0x2c, 0x32, 0x2c, 0x33, 0x07,
+        0x64, 0x61, 0x3d, 0x74, 0x72, 0x75, 0x65, 0x08, 0x65, 0x74, 0x3d, 0x30, 0x2c, 0x33, 0x2c, 0x35,
+        0x12, 0x66, 0x74, 0x3d, 0x30, 0x78, 0x35, 0x41, 0x37, 0x46, 0x46, 0x46, 0x46, 0x37, 0x2c, 0x30,
+        0x78, 0x31, 0x45, 0x08, 0x6d, 0x64, 0x3d, 0x30, 0x2c, 0x31, 0x2c, 0x32, 0x0d, 0x61, 0x6d, 0x3d,
+        0x41, 0x70, 0x70, 0x6c, 0x65, 0x54, 0x56, 0x36, 0x2c, 0x32, 0x43, 0x70, 0x6b, 0x3d, 0x62, 0x30,
+        0x37, 0x37, 0x32, 0x37, 0x64, 0x36, 0x66, 0x36, 0x63, 0x64, 0x36, 0x65, 0x30, 0x38, 0x62, 0x35,
+        0x38, 0x65, 0x64, 0x65, 0x35, 0x32, 0x35, 0x65, 0x63, 0x33, 0x63, 0x64, 0x65, 0x61, 0x61, 0x32,
+        0x35, 0x32, 0x61, 0x64, 0x39, 0x66, 0x36, 0x38, 0x33, 0x66, 0x65, 0x62, 0x32, 0x31, 0x32, 0x65,
+        0x66, 0x38, 0x61, 0x32, 0x30, 0x35, 0x32, 0x34, 0x36, 0x35, 0x35, 0x34, 0x65, 0x37, 0x08, 0x73,
+        0x66, 0x3d, 0x30, 0x78, 0x32, 0x34, 0x34, 0x06, 0x74, 0x70, 0x3d, 0x55, 0x44, 0x50, 0x08, 0x76,
+        0x6e, 0x3d, 0x36, 0x35, 0x35, 0x33, 0x37, 0x0b, 0x76, 0x73, 0x3d, 0x35, 0x39, 0x35, 0x2e, 0x31,
+        0x33, 0x2e, 0x31, 0x07, 0x6f, 0x76, 0x3d, 0x31, 0x35, 0x2e, 0x34, 0x04, 0x76, 0x76, 0x3d, 0x32,
+        0xc0, 0x4b, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x17,
+        0xc0, 0x4b, 0x00, 0x1c, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x1c, 0x4a, 0x9b, 0xff, 0xfe, 0x3e, 0x21, 0xa0, 0xc0, 0x4b, 0x00, 0x1c,
+        0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xfd, 0x12, 0x34, 0x56, 0x78, 0x9a, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x23, 0xc0, 0x2b, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00,
+        0x00, 0x78, 0x00, 0x09, 0xc0, 0x2b, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xc0, 0x4b, 0x00,
+        0x2f, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0xc0, 0x4b, 0x00, 0x04, 0x40, 0x00, 0x00,
+        0x08,
+    };
+
+    static const uint8_t k_printer_response[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x04, 0x5f, 0x69, 0x70,
+        0x70, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00,
+        0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x20, 0x1d, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72,
+        0x4a, 0x65, 0x74, 0x20, 0x50, 0x72, 0x6f, 0x20, 0x4d, 0x34, 0x30, 0x34, 0x20, 0x5b, 0x33, 0x42,
+        0x35, 0x46, 0x31, 0x45, 0x5d, 0xc0, 0x0c, 0x0a, 0x5f, 0x75, 0x6e, 0x69, 0x76, 0x65, 0x72, 0x73,
+        0x61, 0x6c, 0x04, 0x5f, 0x73, 0x75, 0x62, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11,
+        0x94, 0x00, 0x02, 0xc0, 0x27, 0xc0, 0x27, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+        0x11, 0x00, 0x00, 0x00, 0x00, 0x02, 0x77, 0x08, 0x48, 0x50, 0x33, 0x42, 0x35, 0x46, 0x31, 0x45,
+        0xc0, 0x16, 0xc0, 0x27, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x01, 0xed, 0x09, 0x74,
+        0x78, 0x74, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31, 0x08, 0x71, 0x74, 0x6f, 0x74, 0x61, 0x6c, 0x3d,
+        0x31, 0x0c, 0x72, 0x70, 0x3d, 0x69, 0x70, 0x70, 0x2f, 0x70, 0x72, 0x69, 0x6e, 0x74, 0x1c, 0x74,
+        0x79, 0x3d, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72, 0x4a, 0x65, 0x74, 0x20, 0x50, 0x72,
+        0x6f, 0x20, 0x4d, 0x34, 0x30, 0x34, 0x2d, 0x4d, 0x34, 0x30, 0x35, 0x2f, 0x61, 0x64, 0x6d, 0x69,
+        0x6e, 0x75, 0x72, 0x6c, 0x3d, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x48, 0x50, 0x33, 0x42,
+        0x35, 0x46, 0x31, 0x45, 0x2e, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x2e, 0x2f, 0x23, 0x68, 0x49, 0x64,
+        0x2d, 0x70, 0x67, 0x41, 0x69, 0x72, 0x50, 0x72, 0x69, 0x6e, 0x74, 0x05, 0x6e, 0x6f, 0x74, 0x65,
+        0x3d, 0x0b, 0x70, 0x72, 0x69, 0x6f, 0x72, 0x69, 0x74, 0x79, 0x3d, 0x31, 0x30, 0x23, 0x70, 0x72,
+        0x6f, 0x64, 0x75, 0x63, 0x74, 0x3d, 0x28, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72, 0x4a,
+        0x65, 0x74, 0x20, 0x50, 0x72, 0x6f, 0x20, 0x4d, 0x34, 0x30, 0x34, 0x2d, 0x4d, 0x34, 0x30, 0x35,
+        0x29, 0x51, 0x70, 0x64, 0x6c, 0x3d, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f,
+        0x6e, 0x2f, 0x76, 0x6e, 0x64, 0x2e, 0x68, 0x70, 0x2d, 0x50, 0x43, 0x4c, 0x2c, 0x69, 0x6d, 0x61,
+        0x67, 0x65, 0x2f, 0x6a, 0x70, 0x65, 0x67, 0x2c, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74,
+        0x69, 0x6f, 0x6e, 0x2f, 0x50, 0x43, 0x4c, 0x6d, 0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x75,
+        0x72, 0x66, 0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x70, 0x77, 0x67, 0x2d, 0x72, 0x61, 0x73,
+        0x74, 0x65, 0x72, 0x29, 0x55, 0x55, 0x49, 0x44, 0x3d, 0x35, 0x36, 0x34, 0x65, 0x34, 0x33, 0x33,
+        0x33, 0x2d, 0x34, 0x65, 0x33, 0x38, 0x2d, 0x33, 0x37, 0x34, 0x36, 0x2d, 0x34, 0x62, 0x33, 0x31,
+        0x2d, 0x33, 0x63, 0x32, 0x35, 0x61, 0x37, 0x33, 0x62, 0x35, 0x66, 0x31, 0x65, 0x3a, 0x55, 0x52,
+        0x46, 0x3d, 0x56, 0x31, 0x2e, 0x34, 0x2c, 0x43, 0x50, 0x31, 0x2c, 0x44, 0x4d, 0x31, 0x2c, 0x49,
+        0x53, 0x31, 0x2c, 0x4d, 0x54, 0x31, 0x2d, 0x32, 0x2d, 0x33, 0x2d, 0x35, 0x2d, 0x31, 0x32, 0x2c,
+        0x4f, 0x42, 0x31, 0x30, 0x2c, 0x50, 0x51, 0x34, 0x2c, 0x52, 0x53, 0x36, 0x30, 0x30, 0x2c, 0x53,
+        0x52, 0x47, 0x42, 0x32, 0x34, 0x2c, 0x57, 0x38, 0x07, 0x43, 0x6f, 0x6c, 0x6f, 0x72, 0x3d, 0x46,
+        0x08, 0x44, 0x75, 0x70, 0x6c, 0x65, 0x78, 0x3d, 0x54, 0x0a, 0x75, 0x73, 0x62, 0x5f, 0x4d, 0x46,
+        0x47, 0x3d, 0x48, 0x50, 0x21, 0x75, 0x73, 0x62, 0x5f, 0x4d, 0x44, 0x4c, 0x3d, 0x48, 0x50, 0x20,
+        0x4c, 0x61, 0x73, 0x65, 0x72, 0x4a, 0x65, 0x74, 0x20, 0x50, 0x72, 0x6f, 0x20, 0x4d, 0x34, 0x30,
+        0x34, 0x2d, 0x4d, 0x34, 0x30, 0x35, 0x25, 0x6b, 0x69, 0x6e, 0x64, 0x3d, 0x64, 0x6f, 0x63, 0x75,
+        0x6d, 0x65, 0x6e, 0x74, 0x2c, 0x65, 0x6e, 0x76, 0x65, 0x6c, 0x6f, 0x70, 0x65, 0x2c, 0x6c, 0x61,
+        0x62, 0x65, 0x6c, 0x2c, 0x70, 0x6f, 0x73, 0x74, 0x63, 0x61, 0x72, 0x64, 0x11, 0x50, 0x61, 0x70,
+        0x65, 0x72, 0x4d, 0x61, 0x78, 0x3d, 0x6c, 0x65, 0x67, 0x61, 0x6c, 0x2d, 0x41, 0x34, 0x14, 0x6d,
+        0x6f, 0x70, 0x72, 0x69, 0x61, 0x2d, 0x63, 0x65, 0x72, 0x74, 0x69, 0x66, 0x69, 0x65, 0x64, 0x3d,
+        0x32, 0x2e, 0x30, 0x07, 0x54, 0x4c, 0x53, 0x3d, 0x31, 0x2e, 0x32, 0xc0, 0x77, 0x00, 0x01, 0x80,
+        0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x29, 0xc0, 0x77, 0x00, 0x1c, 0x80,
+        0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e,
+        0x2a, 0xf4, 0xff, 0xfe, 0x3b, 0x5f, 0x1e, 0xc0, 0x27, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00, 0x00,
+        0x78, 0x00, 0x09, 0xc0, 0x27, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40,
+    };
+
+    static const uint8_t k_googlecast_response[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x0b, 0x5f, 0x67, 0x6f,
+        0x6f, 0x67, 0x6c, 0x65, 0x63, 0x61, 0x73, 0x74, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+        0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x34, 0x31, 0x43,
+        0x68, 0x72, 0x6f, 0x6d, 0x65, 0x63, 0x61, 0x73, 0x74, 0x2d, 0x55, 0x6c, 0x74, 0x72, 0x61, 0x2d,
+        0x36, 0x66, 0x31, 0x62, 0x30, 0x61, 0x32, 0x65, 0x39, 0x63, 0x34, 0x64, 0x38, 0x65, 0x37, 0x66,
+        0x31, 0x61, 0x32, 0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66, 0x37, 0x61, 0x38, 0x62,
+        0xc0, 0x0c, 0xc0, 0x2e, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x9f, 0x23, 0x69,
+        0x64, 0x3d, 0x36, 0x66, 0x31, 0x62, 0x30, 0x61, 0x32, 0x65, 0x39, 0x63, 0x34, 0x64, 0x38, 0x65,
+        0x37, 0x66, 0x31, 0x61, 0x32, 0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66, 0x37, 0x61,
+        0x38, 0x62, 0x13, 0x63, 0x64, 0x3d, 0x37, 0x41, 0x31, 0x43, 0x30, 0x46, 0x33, 0x45, 0x35, 0x44,
+        0x32, 0x42, 0x34, 0x41, 0x36, 0x39, 0x03, 0x72, 0x6d, 0x3d, 0x05, 0x76, 0x65, 0x3d, 0x30, 0x35,
+        0x13, 0x6d, 0x64, 0x3d, 0x43, 0x68, 0x72, 0x6f, 0x6d, 0x65, 0x63, 0x61, 0x73, 0x74, 0x20, 0x55,
+        0x6c, 0x74, 0x72, 0x61, 0x12, 0x69, 0x63, 0x3d, 0x2f, 0x73, 0x65, 0x74, 0x75, 0x70, 0x2f, 0x69,
+        0x63, 0x6f, 0x6e, 0x2e, 0x70, 0x6e, 0x67, 0x0d, 0x66, 0x6e, 0x3d, 0x4b, 0x69, 0x74, 0x63, 0x68,
+        0x65, 0x6e, 0x20, 0x54, 0x56, 0x09, 0x63, 0x61, 0x3d, 0x32, 0x30, 0x31, 0x32, 0x32, 0x31, 0x04,
+        0x73, 0x74, 0x3d, 0x30, 0x0f, 0x62, 0x73, 0x3d, 0x46, 0x41, 0x38, 0x46, 0x43, 0x41, 0x35, 0x43,
+        0x37, 0x45, 0x32, 0x31, 0x04, 0x6e, 0x66, 0x3d, 0x31, 0x03, 0x72, 0x73, 0x3d, 0xc0, 0x2e, 0x00,
+        0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x2d, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x49, 0x24,
+        0x36, 0x66, 0x31, 0x62, 0x30, 0x61, 0x32, 0x65, 0x2d, 0x39, 0x63, 0x34, 0x64, 0x2d, 0x38, 0x65,
+        0x37, 0x66, 0x2d, 0x31, 0x61, 0x32, 0x62, 0x2d, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66,
+        0x37, 0x61, 0x38, 0x62, 0xc0, 0x1d, 0xc1, 0x1f, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78,
+        0x00, 0x04, 0xc0, 0xa8, 0x01, 0x39,
+    };
+
+    static const uint8_t k_browse_query_known_answers[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x08, 0x5f, 0x61, 0x69,
+        0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c,
+        0x00, 0x00, 0x0c, 0x00, 0x01, 0x05, 0x5f, 0x72, 0x61, 0x6f, 0x70, 0xc0, 0x15, 0x00, 0x0c, 0x00,
+        0x01, 0x0f, 0x5f, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x6e, 0x69, 0x6f, 0x6e, 0x2d, 0x6c, 0x69, 0x6e,
+        0x6b, 0xc0, 0x15, 0x00, 0x0c, 0x00, 0x01, 0x0c, 0x5f, 0x73, 0x6c, 0x65, 0x65, 0x70, 0x2d, 0x70,
+        0x72, 0x6f, 0x78, 0x79, 0x04, 0x5f, 0x75, 0x64, 0x70, 0xc0, 0x1a, 0x00, 0x0c, 0x00, 0x01, 0x08,
+        0x5f, 0x68, 0x6f, 0x6d, 0x65, 0x6b, 0x69, 0x74, 0xc0, 0x15, 0x00, 0x0c, 0x00, 0x01, 0xc0, 0x0c,
+        0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x10, 0xcc, 0x00, 0x0e, 0x0b, 0x4c, 0x69, 0x76, 0x69, 0x6e,
+        0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0xc0, 0x0c, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+        0x0f, 0x3c, 0x00, 0x0a, 0x07, 0x42, 0x65, 0x64, 0x72, 0x6f, 0x6f, 0x6d, 0xc0, 0x0c, 0xc0, 0x25,
+        0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x10, 0xcc, 0x00, 0x1b, 0x18, 0x35, 0x38, 0x35, 0x35, 0x43,
+        0x41, 0x31, 0x41, 0x45, 0x32, 0x38, 0x38, 0x40, 0x4c, 0x69, 0x76, 0x69, 0x6e, 0x67, 0x20, 0x52,
+        0x6f, 0x6f, 0x6d, 0xc0, 0x25, 0xc0, 0x31, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x10, 0x04, 0x00,
+        0x0e, 0x0b, 0x4f, 0x66, 0x66, 0x69, 0x63, 0x65, 0x20, 0x69, 0x4d, 0x61, 0x63, 0xc0, 0x31, 0xc0,
+        0x31, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x30, 0x00, 0x0e, 0x0b, 0x4c, 0x69, 0x76, 0x69,
+        0x6e, 0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0xc0, 0x31,
+    };
+
+    static const uint8_t k_probe[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x0b, 0x4f, 0x66, 0x66,
+        0x69, 0x63, 0x65, 0x20, 0x69, 0x4d, 0x61, 0x63, 0x0f, 0x5f, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x6e,
+        0x69, 0x6f, 0x6e, 0x2d, 0x6c, 0x69, 0x6e, 0x6b, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+        0x63, 0x61, 0x6c, 0x00, 0x00, 0xff, 0x80, 0x01, 0x0b, 0x4f, 0x66, 0x66, 0x69, 0x63, 0x65, 0x2d,
+        0x69, 0x4d, 0x61, 0x63, 0xc0, 0x2d, 0x00, 0xff, 0x80, 0x01, 0xc0, 0x0c, 0x00, 0x21, 0x80, 0x01,
+        0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x01, 0xc0, 0x38, 0xc0, 0x0c,
+        0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x7f, 0x07, 0x72, 0x70, 0x4d, 0x61, 0x63,
+        0x3d, 0x30, 0x11, 0x72, 0x70, 0x48, 0x4e, 0x3d, 0x35, 0x66, 0x33, 0x64, 0x39, 0x63, 0x31, 0x61,
+        0x32, 0x62, 0x34, 0x65, 0x0c, 0x72, 0x70, 0x46, 0x6c, 0x3d, 0x30, 0x78, 0x32, 0x30, 0x30, 0x30,
+        0x30, 0x11, 0x72, 0x70, 0x48, 0x41, 0x3d, 0x39, 0x61, 0x38, 0x62, 0x37, 0x63, 0x36, 0x64, 0x35,
+        0x65, 0x34, 0x66, 0x0a, 0x72, 0x70, 0x56, 0x72, 0x3d, 0x31, 0x39, 0x35, 0x2e, 0x32, 0x11, 0x72,
+        0x70, 0x41, 0x44, 0x3d, 0x31, 0x61, 0x32, 0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66,
+        0x11, 0x72, 0x70, 0x48, 0x49, 0x3d, 0x30, 0x66, 0x31, 0x65, 0x32, 0x64, 0x33, 0x63, 0x34, 0x62,
+        0x35, 0x61, 0x16, 0x72, 0x70, 0x42, 0x41, 0x3d, 0x33, 0x43, 0x3a, 0x32, 0x32, 0x3a, 0x46, 0x42,
+        0x3a, 0x31, 0x31, 0x3a, 0x32, 0x32, 0x3a, 0x33, 0x33, 0xc0, 0x38, 0x00, 0x01, 0x80, 0x01, 0x00,
+        0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x0c, 0xc0, 0x38, 0x00, 0x1c, 0x80, 0x01, 0x00,
+        0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0xd5, 0x3a,
+        0x2f, 0x7c, 0x11, 0x9b, 0x4e,
+    };
+
+    static const uint8_t k_homekit_announcement[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x04, 0x5f, 0x68, 0x61,
+        0x70, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00,
+        0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x16, 0x13, 0x48, 0x75, 0x65, 0x20, 0x42, 0x72, 0x69, 0x64,
+        0x67, 0x65, 0x20, 0x2d, 0x20, 0x32, 0x41, 0x39, 0x46, 0x33, 0x43, 0xc0, 0x0c, 0xc0, 0x27, 0x00,
+        0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x90, 0x0b,
+        0x50, 0x68, 0x69, 0x6c, 0x69, 0x70, 0x73, 0x2d, 0x68, 0x75, 0x65, 0xc0, 0x16, 0xc0, 0x27, 0x00,
+        0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x4d, 0x06, 0x63, 0x23, 0x3d, 0x31, 0x31, 0x32,
+        0x04, 0x66, 0x66, 0x3d, 0x31, 0x14, 0x69, 0x64, 0x3d, 0x39, 0x41, 0x3a, 0x33, 0x43, 0x3a, 0x32,
+        0x46, 0x3a, 0x31, 0x42, 0x3a, 0x37, 0x37, 0x3a, 0x44, 0x30, 0x09, 0x6d, 0x64, 0x3d, 0x42, 0x53,
+        0x42, 0x30, 0x30, 0x32, 0x06, 0x70, 0x76, 0x3d, 0x31, 0x2e, 0x31, 0x04, 0x73, 0x23, 0x3d, 0x31,
+        0x04, 0x73, 0x66, 0x3d, 0x30, 0x04, 0x63, 0x69, 0x3d, 0x32, 0x0b, 0x73, 0x68, 0x3d, 0x78, 0x46,
+        0x71, 0x33, 0x72, 0x41, 0x3d, 0x3d, 0xc0, 0x4f, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78,
+        0x00, 0x04, 0xc0, 0xa8, 0x01, 0x07,
+    };
+
+    static const uint8_t k_goodbye[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x08, 0x5f, 0x61, 0x69,
+        0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c,
+        0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x07, 0x42, 0x65, 0x64, 0x72,
+        0x6f, 0x6f, 0x6d, 0xc0, 0x0c, 0xc0, 0x2b, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x10, 0x00, 0x00, 0x00, 0x00, 0x1b, 0x58, 0x07, 0x42, 0x65, 0x64, 0x72, 0x6f, 0x6f, 0x6d, 0xc0,
+        0x1a, 0xc0, 0x2b, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x1a, 0x64, 0x65,
+        0x76, 0x69, 0x63, 0x65, 0x69, 0x64, 0x3d, 0x41, 0x34, 0x3a, 0x38, 0x33, 0x3a, 0x45, 0x37, 0x3a,
+        0x31, 0x30, 0x3a, 0x32, 0x32, 0x3a, 0x33, 0x31, 0x17, 0x6d, 0x6f, 0x64, 0x65, 0x6c, 0x3d, 0x41,
+        0x75, 0x64, 0x69, 0x6f, 0x41, 0x63, 0x63, 0x65, 0x73, 0x73, 0x6f, 0x72, 0x79, 0x35, 0x2c, 0x31,
+    };
+
+    static const uint8_t k_service_enumeration[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x09, 0x5f, 0x73, 0x65,
+        0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5f, 0x64, 0x6e, 0x73, 0x2d, 0x73, 0x64, 0x04, 0x5f,
+        0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+        0x11, 0x94, 0x00, 0x10, 0x08, 0x5f, 0x61, 0x69, 0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74,
+        0x63, 0x70, 0xc0, 0x23, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08,
+        0x05, 0x5f, 0x72, 0x61, 0x6f, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+        0x11, 0x94, 0x00, 0x12, 0x0f, 0x5f, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x6e, 0x69, 0x6f, 0x6e, 0x2d,
+        0x6c, 0x69, 0x6e, 0x6b, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94,
+        0x00, 0x0b, 0x08, 0x5f, 0x68, 0x6f, 0x6d, 0x65, 0x6b, 0x69, 0x74, 0xc0, 0x3d, 0xc0, 0x0c, 0x00,
+        0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0f, 0x0c, 0x5f, 0x73, 0x6c, 0x65, 0x65, 0x70,
+        0x2d, 0x70, 0x72, 0x6f, 0x78, 0x79, 0xc0, 0x1e, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+        0x11, 0x94, 0x00, 0x07, 0x04, 0x5f, 0x68, 0x61, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00,
+        0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0e, 0x0b, 0x5f, 0x67, 0x6f, 0x6f, 0x67, 0x6c, 0x65, 0x63,
+        0x61, 0x73, 0x74, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00,
+        0x13, 0x10, 0x5f, 0x73, 0x70, 0x6f, 0x74, 0x69, 0x66, 0x79, 0x2d, 0x63, 0x6f, 0x6e, 0x6e, 0x65,
+        0x63, 0x74, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07,
+        0x04, 0x5f, 0x69, 0x70, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11,
+        0x94, 0x00, 0x0b, 0x08, 0x5f, 0x70, 0x72, 0x69, 0x6e, 0x74, 0x65, 0x72, 0xc0, 0x3d, 0xc0, 0x0c,
+        0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x12, 0x0f, 0x5f, 0x70, 0x64, 0x6c, 0x2d,
+        0x64, 0x61, 0x74, 0x61, 0x73, 0x74, 0x72, 0x65, 0x61, 0x6d, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c,
+        0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08, 0x05, 0x5f, 0x68, 0x74, 0x74, 0x70, 0xc0, 0x3d,
+        0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07, 0x04, 0x5f, 0x73, 0x6d,
+        0x62, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0f, 0x0c,
+        0x5f, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x2d, 0x69, 0x6e, 0x66, 0x6f, 0xc0, 0x3d,
+    };
+
+    static const uint8_t k_spotify_response[] = {
+        0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x04, 0x10, 0x5f, 0x73, 0x70,
+        0x6f, 0x74, 0x69, 0x66, 0x79, 0x2d, 0x63, 0x6f, 0x6e, 0x6e, 0x65, 0x63, 0x74, 0x04, 0x5f, 0x74,
+        0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11,
+        0x94, 0x00, 0x12, 0x0f, 0x4b, 0x69, 0x74, 0x63, 0x68, 0x65, 0x6e, 0x20, 0x53, 0x70, 0x65, 0x61,
+        0x6b, 0x65, 0x72, 0xc0, 0x0c, 0xc0, 0x33, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+        0x1b, 0x00, 0x00, 0x00, 0x00, 0x05, 0x78, 0x12, 0x73, 0x6f, 0x6e, 0x6f, 0x73, 0x2d, 0x6b, 0x69,
+        0x74, 0x63, 0x68, 0x65, 0x6e, 0x2d, 0x35, 0x63, 0x34, 0x38, 0xc0, 0x22, 0xc0, 0x33, 0x00, 0x10,
+        0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x1d, 0x0b, 0x56, 0x45, 0x52, 0x53, 0x49, 0x4f, 0x4e,
+        0x3d, 0x31, 0x2e, 0x30, 0x10, 0x43, 0x50, 0x61, 0x74, 0x68, 0x3d, 0x2f, 0x73, 0x70, 0x6f, 0x74,
+        0x69, 0x66, 0x79, 0x7a, 0x63, 0xc0, 0x57, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+        0x04, 0xc0, 0xa8, 0x01, 0x42, 0xc0, 0x57, 0x00, 0x1c, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+        0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb6, 0xe6, 0x2d, 0xff, 0xfe, 0x5c, 0x48,
+        0x01,
+    };
+
+    static const uint8_t k_daap_query[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x5f, 0x64, 0x61,
+        0x61, 0x70, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c,
+        0x00, 0x01,
+    };
+
+    static const CorpusPacket kCorpus[] = {
+        { "airplay_announcement", k_airplay_announcement, sizeof(k_airplay_announcement) },
+        { "printer_response", k_printer_response, sizeof(k_printer_response) },
+        { "googlecast_response", k_googlecast_response, sizeof(k_googlecast_response) },
+        { "browse_query_known_answers", k_browse_query_known_answers, sizeof(k_browse_query_known_answers) },
+        { "probe", k_probe, sizeof(k_probe) },
+        { "homekit_announcement", k_homekit_announcement, sizeof(k_homekit_announcement) },
+        { "goodbye", k_goodbye, sizeof(k_goodbye) },
+        { "service_enumeration", k_service_enumeration, sizeof(k_service_enumeration) },
+        { "spotify_response", k_spotify_response, sizeof(k_spotify_response) },
+        { "daap_query", k_daap_query, sizeof(k_daap_query) },
+    };
+}
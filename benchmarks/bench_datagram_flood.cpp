@@ -0,0 +1,205 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Loopback datagram flood through MdnsSocket, one packet per system call against batches. Bursts of packets are
+// multicast from one socket to another on the loopback interface, with Send() per packet or Queue() and one
+// Flush() (sendmmsg) per burst, then drained with Receive() (recvfrom) per packet or ReceiveBatch() (recvmmsg)
+// into an MdnsReceiveRing, parsing every packet where it landed. Reports packets per second and system calls
+// per packet of each path, from the socket counters.
+//
+//     bench_datagram_flood [packets] [burst]
+
+#include "MdnsMessage.h"
+#include "MdnsSocket.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+    double sendSeconds;
+    double receiveSeconds;
+    uint64_t sendCalls;
+    uint64_t receiveCalls;
+    uint64_t sent;
+    uint64_t received;
+    uint64_t questions;
+};
+
+static size_t CountQuestions(const uint8_t* data, size_t size)
+{
+    MdnsMessageReader reader(data, size);
+    size_t count = 0;
+    MdnsQuestionView question;
+    while (reader.IsValid() && reader.NextQuestion(question))
+    {
+        count++;
+    }
+    return count;
+}
+
+static Result Run(MdnsSocket& sender, MdnsSocket& receiver, const std::vector<std::vector<uint8_t>>& packets, size_t count, size_t burst, bool batched)
+{
+    Result result = { 0, 0, 0, 0, 0, 0, 0 };
+    uint64_t sendCallsBefore = sender.GetCounters().sendCalls;
+    uint64_t sentBefore = sender.GetCounters().packetsSent;
+    uint64_t receiveCallsBefore = receiver.GetCounters().receiveCalls;
+    uint64_t receivedBefore = receiver.GetCounters().packetsReceived;
+
+    MdnsReceiveRing ring;
+    std::vector<uint8_t> buffer(MDNS_MAX_PACKET_SIZE);
+    uint8_t discard[MDNS_MAX_PACKET_SIZE];
+    sockaddr_in from;
+    for (size_t done = 0; done < count; done += burst)
+    {
+        size_t n = std::min(burst, count - done);
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const std::vector<uint8_t>& packet = packets[(done + i) % packets.size()];
+            if (batched)
+            {
+                sender.Queue(packet.data(), packet.size());
+            }
+            else
+            {
+                sender.Send(packet.data(), packet.size());
+            }
+        }
+        if (batched)
+        {
+            sender.Flush();
+        }
+        auto sent = Clock::now();
+
+        if (batched)
+        {
+            while (receiver.ReceiveBatch(ring) > 0)
+            {
+                for (size_t i = 0; i < ring.GetCount(); ++i)
+                {
+                    MdnsReceivedPacket packet = ring.Get(i);
+                    result.questions += CountQuestions(packet.data, packet.size);
+                }
+                if (!ring.IsFull())
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            int size;
+            while ((size = receiver.Receive(buffer.data(), buffer.size(), &from)) > 0)
+            {
+                result.questions += CountQuestions(buffer.data(), static_cast<size_t>(size));
+            }
+        }
+        auto received = Clock::now();
+
+        // the sender hears its own packets too: out of the way, untimed
+        while (sender.Receive(discard, sizeof(discard), &from) > 0)
+        {
+        }
+
+        result.sendSeconds += std::chrono::duration<double>(sent - start).count();
+        result.receiveSeconds += std::chrono::duration<double>(received - sent).count();
+    }
+
+    result.sendCalls = sender.GetCounters().sendCalls - sendCallsBefore;
+    result.sent = sender.GetCounters().packetsSent - sentBefore;
+    result.receiveCalls = receiver.GetCounters().receiveCalls - receiveCallsBefore;
+    result.received = receiver.GetCounters().packetsReceived - receivedBefore;
+    return result;
+}
+
+static void Report(const char* name, const Result& result)
+{
+    printf("%s_send_packets_per_s %.0f packets/s\n", name, result.sent / result.sendSeconds);
+    printf("%s_send_syscalls_per_packet %.3f calls\n", name, double(result.sendCalls) / result.sent);
+    printf("%s_receive_packets_per_s %.0f packets/s\n", name, result.received / result.receiveSeconds);
+    printf("%s_receive_syscalls_per_packet %.3f calls\n", name, double(result.receiveCalls) / result.received);
+    printf("%s_packets_lost %llu packets\n", name, static_cast<unsigned long long>(result.sent - result.received));
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    const size_t burst = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+    if (count == 0 || burst == 0)
+    {
+        fprintf(stderr, "usage: bench_datagram_flood [packets] [burst]\n");
+        return 1;
+    }
+
+    MdnsSocket sender;
+    MdnsSocket receiver;
+    if (sender.Open() != DNSSD_NO_ERROR || receiver.Open() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to open mDNS sockets\n");
+        return 1;
+    }
+
+    // the queries of a query storm: one to three questions each
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        uint8_t packet[MDNS_MAX_PACKET_SIZE];
+        MdnsMessageWriter query(packet, sizeof(packet));
+        for (size_t q = 0; q <= i % 3; ++q)
+        {
+            query.AddQuestion(MdnsMakeName("_flood" + std::to_string(i * 3 + q) + "._tcp.local"), MDNS_TYPE_PTR);
+        }
+        packets.push_back(std::vector<uint8_t>(query.Data(), query.Data() + query.Size()));
+    }
+    size_t questions = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        questions += i % packets.size() % 3 + 1;
+    }
+
+    // other mDNS traffic on the host would land in the receiver too: warm up, then drain it before each run
+    uint8_t discard[MDNS_MAX_PACKET_SIZE];
+    sockaddr_in from;
+    while (receiver.Receive(discard, sizeof(discard), &from) > 0)
+    {
+    }
+    Result single = Run(sender, receiver, packets, count, burst, false);
+    while (receiver.Receive(discard, sizeof(discard), &from) > 0)
+    {
+    }
+    Result batched = Run(sender, receiver, packets, count, burst, true);
+
+    printf("packets %zu packets\n", count);
+    printf("burst %zu packets\n", burst);
+    Report("single", single);
+    Report("batched", batched);
+    printf("send_speedup %.2f x\n", (batched.sent / batched.sendSeconds) / (single.sent / single.sendSeconds));
+    printf("receive_speedup %.2f x\n", (batched.received / batched.receiveSeconds) / (single.received / single.receiveSeconds));
+
+    // every packet sent, received and parsed whole, either way
+    if (single.sent != count || batched.sent != count || single.received < count || batched.received < count
+        || single.questions < questions || batched.questions < questions)
+    {
+        fprintf(stderr, "flood error: %llu and %llu of %zu packets received\n", static_cast<unsigned long long>(single.received),
+            static_cast<unsigned long long>(batched.received), count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// The discovery numbers tracked from release to release, through the dnssd.h C API, over loopback or an
+// MdnsSimulatedNetwork (on virtual time: its latencies are virtual milliseconds, its CPU figures real):
+//  - registration to ServiceAdded and goodbye to ServiceRemoved, one instance at a time
+//  - ServiceAdded and ServiceRemoved callbacks per second when instances instances come and go at once
+//  - packets, bytes and CPU per second in steady state, with the instances found and kept fresh
+//  - heap per instance cached by a watcher
+//  - some of what dnssd_get_stats counted meanwhile, receive-to-callback latency percentiles included
+// The event loop runs on the main thread (dnssd_use_caller_thread) on both transports, so that every allocation
+// is made where mallinfo2 sees it. Prints "name value unit" lines, or with json one JSON object for the
+// regression tracking scripts.
+//
+//     bench_discovery [loopback|simulated] [instances] [json]
+
+#include "dnssd.h"
+#include "MdnsQueryEngine.h"
+#include "MdnsService.h"
+#include "MdnsSimulatedNetwork.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <malloc.h>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kLatencyServiceName = "_dnssdlatency._tcp";
+static const char* kBurstServiceName = "_dnssdburst._tcp";
+static const int kLatencyRounds = 5;
+static const auto kTimeout = std::chrono::seconds(30);
+
+// what a watcher saw. MdnsClock times are virtual on the simulated network, Clock times always real
+struct Seen
+{
+    size_t added;
+    size_t removed;
+    MdnsClock::time_point addedAt;
+    MdnsClock::time_point removedAt;
+    Clock::time_point firstAdded;
+    Clock::time_point lastAdded;
+    Clock::time_point lastRemoved;
+};
+
+struct Measurement
+{
+    std::string name;
+    double value;
+    const char* unit;
+    int decimals;
+};
+
+// the callbacks run on the main thread, inside dnssd_run_events or a registration
+static DnssdServiceWatcherPtr gLatencyWatcher = nullptr;
+static Seen gLatency = {};
+static Seen gBurst = {};
+static std::vector<Measurement> gResults;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    Seen& seen = serviceWatcher == gLatencyWatcher ? gLatency : gBurst;
+    if (update == ServiceAdded)
+    {
+        seen.firstAdded = seen.added == 0 ? Clock::now() : seen.firstAdded;
+        seen.lastAdded = Clock::now();
+        seen.addedAt = MdnsClock::now();
+        seen.added++;
+    }
+    else if (update == ServiceRemoved)
+    {
+        seen.lastRemoved = Clock::now();
+        seen.removedAt = MdnsClock::now();
+        seen.removed++;
+    }
+}
+
+static void report(const std::string& name, double value, const char* unit, int decimals)
+{
+    gResults.push_back(Measurement{ name, value, unit, decimals });
+}
+
+static double elapsedMs(MdnsClock::time_point start, MdnsClock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static double elapsedSeconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static double cpuMs()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+static size_t heapInUse()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// run the event loop until done() or for timeout, whichever comes first
+static bool runUntil(const std::function<bool()>& done, MdnsClock::duration timeout)
+{
+    MdnsClock::time_point deadline = MdnsClock::now() + timeout;
+    while (!done() && MdnsClock::now() < deadline)
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - MdnsClock::now()).count();
+        dnssd_run_events(static_cast<int>(left < 100 ? left : 100) + 1);
+    }
+    return done();
+}
+
+// everything the process sent and received over mDNS
+static void countPackets(DnssdServicePtr service, uint64_t& packets, uint64_t& bytes)
+{
+    const MdnsQuerierCounters& querier = MdnsQueryEngine::GetShared()->GetCounters();
+    const MdnsResponderCounters& responder = static_cast<MdnsService*>(service)->GetCounters();
+    packets = querier.packetsSent + querier.packetsReceived + responder.responsesSent + responder.queriesReceived;
+    bytes = querier.bytesSent + responder.bytesSent;
+}
+
+static void printResults(const char* transport, size_t instances, bool json)
+{
+    if (!json)
+    {
+        for (const Measurement& m : gResults)
+        {
+            printf("%s %.*f %s\n", m.name.c_str(), m.decimals, m.value, m.unit);
+        }
+        return;
+    }
+
+    printf("{\"benchmark\": \"bench_discovery\", \"transport\": \"%s\", \"instances\": %zu, \"results\": [", transport, instances);
+    for (size_t i = 0; i < gResults.size(); ++i)
+    {
+        const Measurement& m = gResults[i];
+        printf("%s\n  {\"name\": \"%s\", \"value\": %.*f, \"unit\": \"%s\"}", i == 0 ? "" : ",", m.name.c_str(), m.decimals, m.value, m.unit);
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* transport = argc > 1 ? argv[1] : "loopback";
+    const size_t instances = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+    const bool json = argc > 3 && strcmp(argv[3], "json") == 0;
+    const bool simulated = strcmp(transport, "simulated") == 0;
+    if ((!simulated && strcmp(transport, "loopback") != 0) || instances == 0 || (argc > 3 && !json))
+    {
+        fprintf(stderr, "usage: bench_discovery [loopback|simulated] [instances] [json]\n");
+        return 1;
+    }
+
+    // steady state long enough for a few continuous queries: on virtual time it costs next to nothing
+    const MdnsClock::duration steady = simulated ? std::chrono::seconds(300) : std::chrono::seconds(5);
+
+    if (simulated && MdnsSimulatedNetwork::Install(MdnsSimulationConfig()) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to install the simulated network\n");
+        return 1;
+    }
+    if ((!simulated && dnssd_use_caller_thread() != DNSSD_NO_ERROR) || dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    if (dnssd_create_service_watcher(kLatencyServiceName, dnssdServiceChangedCallback, &gLatencyWatcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    // one instance at a time: registration, probing and announcement until the watcher sees it, then its goodbye
+    double addedMs = 0;
+    double addedMaxMs = 0;
+    double removedMs = 0;
+    double removedMaxMs = 0;
+    for (int i = 0; i < kLatencyRounds; ++i)
+    {
+        std::string instanceName = "latency " + std::to_string(i);
+        std::string port = std::to_string(40000 + i);
+        DnssdServiceRegistration registration = { kLatencyServiceName, instanceName.c_str(), port.c_str() };
+        DnssdServicePtr service = nullptr;
+
+        MdnsClock::time_point start = MdnsClock::now();
+        if (dnssd_register_services(&registration, 1, &service) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        if (!runUntil([&] { return gLatency.added == size_t(i) + 1; }, kTimeout))
+        {
+            fprintf(stderr, "timed out waiting for ServiceAdded\n");
+            return 1;
+        }
+        double ms = elapsedMs(start, gLatency.addedAt);
+        addedMs += ms / kLatencyRounds;
+        addedMaxMs = ms > addedMaxMs ? ms : addedMaxMs;
+
+        MdnsClock::time_point freed = MdnsClock::now();
+        dnssd_free_service(service);
+        if (!runUntil([&] { return gLatency.removed == size_t(i) + 1; }, kTimeout))
+        {
+            fprintf(stderr, "timed out waiting for ServiceRemoved\n");
+            return 1;
+        }
+        ms = elapsedMs(freed, gLatency.removedAt);
+        removedMs += ms / kLatencyRounds;
+        removedMaxMs = ms > removedMaxMs ? ms : removedMaxMs;
+    }
+    report("registered_to_added_ms", addedMs, "ms", 3);
+    report("registered_to_added_max_ms", addedMaxMs, "ms", 3);
+    report("goodbye_to_removed_ms", removedMs, "ms", 3);
+    report("goodbye_to_removed_max_ms", removedMaxMs, "ms", 3);
+
+    // instances instances at once, found by a watcher created once they are announced
+    std::vector<std::string> names(instances);
+    std::vector<DnssdServiceRegistration> registrations(instances);
+    for (size_t i = 0; i < instances; ++i)
+    {
+        names[i] = "device " + std::to_string(i);
+        registrations[i] = { kBurstServiceName, names[i].c_str(), "42400" };
+    }
+    DnssdServicePtr service = nullptr;
+    if (dnssd_register_services(registrations.data(), instances, &service) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service\n");
+        return 1;
+    }
+    runUntil([] { return false; }, std::chrono::seconds(1));
+
+    size_t heapBefore = heapInUse();
+    DnssdServiceWatcherPtr watcher = nullptr;
+    if (dnssd_create_service_watcher(kBurstServiceName, dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+    bool found = runUntil([&] { return gBurst.added == instances; }, kTimeout);
+    size_t heapAfter = heapInUse();
+
+    // from the first callback to the last: the responses arrive back to back, this is the callback path
+    double addedSeconds = elapsedSeconds(gBurst.firstAdded, gBurst.lastAdded);
+    report("added_events_per_s", found && addedSeconds > 0 ? (instances - 1) / addedSeconds : 0, "events/s", 0);
+    report("heap_per_cached_instance", heapAfter > heapBefore ? double(heapAfter - heapBefore) / instances : 0, "bytes", 0);
+
+    // steady state: continuous queries with their known answers, and whatever they still get answered
+    uint64_t packetsBefore;
+    uint64_t bytesBefore;
+    countPackets(service, packetsBefore, bytesBefore);
+    double cpuBefore = cpuMs();
+    MdnsClock::time_point steadyStart = MdnsClock::now();
+    runUntil([] { return false; }, steady);
+    double steadySeconds = std::chrono::duration<double>(MdnsClock::now() - steadyStart).count();
+    uint64_t packetsAfter;
+    uint64_t bytesAfter;
+    countPackets(service, packetsAfter, bytesAfter);
+    report("steady_packets_per_s", (packetsAfter - packetsBefore) / steadySeconds, "packets/s", 2);
+    report("steady_bytes_per_s", (bytesAfter - bytesBefore) / steadySeconds, "bytes/s", 0);
+    report("steady_cpu_ms_per_s", (cpuMs() - cpuBefore) / steadySeconds, "ms/s", 3);
+
+    // all of them say goodbye at once
+    Clock::time_point freed = Clock::now();
+    dnssd_free_service(service);
+    bool removed = runUntil([&] { return gBurst.removed == instances; }, kTimeout);
+    report("removed_events_per_s", removed ? instances / elapsedSeconds(freed, gBurst.lastRemoved) : 0, "events/s", 0);
+
+    dnssd_free_service_watcher(watcher);
+    dnssd_free_service_watcher(gLatencyWatcher);
+
+    // what the library counted itself on the way
+    DnssdStats stats;
+    stats.size = sizeof(stats);
+    if (dnssd_get_stats(&stats) == DNSSD_NO_ERROR)
+    {
+        report("stats_packets_received", double(stats.packetsReceived), "packets", 0);
+        report("stats_packets_timestamped", double(stats.packetsTimestamped), "packets", 0);
+        report("stats_cache_hit_ratio", stats.cacheHits + stats.cacheMisses != 0 ? double(stats.cacheHits) / (stats.cacheHits + stats.cacheMisses) : 0, "ratio", 3);
+        report("stats_callbacks_delivered", double(stats.callbacksDelivered), "callbacks", 0);
+        report("receive_to_callback_p50_us", double(stats.receiveToCallback.p50), "us", 0);
+        report("receive_to_callback_p99_us", double(stats.receiveToCallback.p99), "us", 0);
+        report("receive_to_callback_max_us", double(stats.receiveToCallback.max), "us", 0);
+    }
+    printResults(transport, instances, json);
+
+    if (!found || !removed)
+    {
+        fprintf(stderr, "discovery error: %zu of %zu instances added, %zu removed\n", gBurst.added, instances, gBurst.removed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Service changes per second handed from producer threads to one consumer thread. DnssdEventQueue
+// (lock-free ring, the consumer waits on its eventfd and drains in batches) against a std::mutex
+// protected std::deque of copied changes with a std::condition_variable, what an application
+// typically builds around DnssdServiceChangedCallback. Producers push as fast as they can; the ring is
+// sized so nothing is dropped and the numbers count delivered changes only.
+//
+//     bench_event_queue [changes per producer] [max producer threads]
+
+#include "DnssdEventQueue.h"
+#include <poll.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile size_t gSink = 0;
+
+static void Consume(const DnssdServiceInfo& info)
+{
+    gSink = gSink + info.port[0] + info.instanceName[0];
+}
+
+static void Report(const char* name, unsigned producers, size_t changes, double seconds)
+{
+    printf("%s_changes_per_s_%up %.0f changes/s\n", name, producers, changes / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t perProducer = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    unsigned maxProducers = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : std::max(4u, std::thread::hardware_concurrency());
+    if (perProducer == 0 || maxProducers == 0)
+    {
+        fprintf(stderr, "usage: bench_event_queue [changes per producer] [max producer threads]\n");
+        return 1;
+    }
+
+    DnssdServiceFields fields;
+    fields.Set(DnssdServiceFields::Id, "Music Library._daap._tcp.local");
+    fields.Set(DnssdServiceFields::InstanceName, "Music Library");
+    fields.Set(DnssdServiceFields::Host, "192.168.1.20");
+    fields.Set(DnssdServiceFields::Port, "3689");
+
+    size_t errors = 0;
+    for (unsigned producers = 1; producers <= maxProducers; producers *= 2)
+    {
+        const size_t total = perProducer * producers;
+
+        {
+            DnssdEventQueue queue(4096);
+            auto start = Clock::now();
+            std::vector<std::thread> threads;
+            for (unsigned p = 0; p < producers; ++p)
+            {
+                threads.emplace_back([&]
+                {
+                    for (size_t i = 0; i < perProducer; ++i)
+                    {
+                        // full: wait for the consumer rather than drop, so both variants deliver everything
+                        while (!queue.Push(ServiceUpdated, fields))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            size_t received = 0;
+            DnssdServiceChange events[256];
+            while (received < total)
+            {
+                pollfd fd = { queue.GetWaitHandle(), POLLIN, 0 };
+                poll(&fd, 1, 1);
+                size_t count = queue.Drain(events, 256);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    Consume(events[i].info);
+                }
+                received += count;
+            }
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+            Report("queue", producers, total, std::chrono::duration<double>(Clock::now() - start).count());
+            errors += queue.Drain(events, 256) != 0 ? 1 : 0;
+        }
+
+        {
+            struct Change
+            {
+                DnssdServiceUpdateType update;
+                std::string id;
+                std::string instanceName;
+                std::string host;
+                std::string port;
+            };
+            std::mutex lock;
+            std::condition_variable ready;
+            std::deque<Change> changes;
+
+            auto start = Clock::now();
+            std::vector<std::thread> threads;
+            for (unsigned p = 0; p < producers; ++p)
+            {
+                threads.emplace_back([&]
+                {
+                    DnssdServiceInfo info;
+                    fields.Fill(info);
+                    for (size_t i = 0; i < perProducer; ++i)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        changes.push_back(Change{ ServiceUpdated, info.id, info.instanceName, info.host, info.port });
+                        ready.notify_one();
+                    }
+                });
+            }
+
+            size_t received = 0;
+            std::deque<Change> batch;
+            while (received < total)
+            {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    ready.wait(guard, [&] { return !changes.empty(); });
+                    batch.swap(changes);
+                }
+                for (const Change& change : batch)
+                {
+                    DnssdServiceInfo info;
+                    info.id = change.id.c_str();
+                    info.instanceName = change.instanceName.c_str();
+                    info.host = change.host.c_str();
+                    info.port = change.port.c_str();
+                    Consume(info);
+                }
+                received += batch.size();
+                batch.clear();
+            }
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+            Report("mutex", producers, total, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+    }
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "event queue error: changes left after draining everything\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,257 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Services and watchers restricted to a set of interfaces with dnssd_register_services_on_interfaces and
+// dnssd_create_service_watcher_on_interfaces. One service is registered on loopback and on a second multicast
+// interface; watchers on loopback, on the second interface and on both check that each interface answers with
+// its own address only. Instances of another type are then registered on the second interface alone: a loopback
+// watcher must not find them and its engine reads only the loopback traffic, while the engine on both interfaces
+// reads the second interface's probes, announcements and answers too. Without a second multicast interface only
+// the loopback checks run.
+//
+//     bench_interfaces [instances on the second interface]
+
+#include "dnssd.h"
+#include "MdnsQueryEngine.h"
+#include "MdnsSocket.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdiface._tcp";
+static const char* kOtherServiceName = "_dnssdifaceother._tcp";
+
+// what one watcher saw
+struct Seen
+{
+    size_t added;
+    std::set<uint32_t> addresses;   // IPv4, network byte order
+};
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static std::vector<DnssdServiceWatcherPtr> gWatchers;
+static std::vector<Seen> gSeen;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    DnssdAddress addresses[8];
+    size_t count = update != ServiceRemoved ? dnssd_get_service_addresses(info, addresses, 8) : 0;
+
+    std::lock_guard<std::mutex> lock(gMutex);
+    for (size_t w = 0; w < gWatchers.size(); ++w)
+    {
+        if (gWatchers[w] == serviceWatcher)
+        {
+            gSeen[w].added += update == ServiceAdded ? 1 : 0;
+            for (size_t i = 0; i < count && i < 8; ++i)
+            {
+                if (addresses[i].family == AF_INET)
+                {
+                    uint32_t address;
+                    memcpy(&address, addresses[i].v4.address, sizeof(address));
+                    gSeen[w].addresses.insert(address);
+                }
+            }
+        }
+    }
+    gCondition.notify_all();
+}
+
+// until watcher w has seen addresses addresses
+static bool waitFor(size_t w, size_t addresses)
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    return gCondition.wait_for(lock, std::chrono::seconds(10), [&] { return gSeen[w].addresses.size() >= addresses; });
+}
+
+static DnssdServiceWatcherPtr createWatcher(const char* serviceName, const std::vector<uint32_t>& interfaces)
+{
+    DnssdServiceWatcherPtr watcher = nullptr;
+    std::lock_guard<std::mutex> lock(gMutex);
+    if (dnssd_create_service_watcher_on_interfaces(serviceName, dnssdServiceChangedCallback, interfaces.data(), interfaces.size(), &watcher) != DNSSD_NO_ERROR)
+    {
+        return nullptr;
+    }
+    gWatchers.push_back(watcher);
+    gSeen.push_back(Seen());
+    gSeen.back().added = 0;
+    return watcher;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t instances = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20;
+    if (instances == 0)
+    {
+        fprintf(stderr, "usage: bench_interfaces [instances on the second interface]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    // loopback and the first other interface that does multicast
+    MdnsInterface loopback = { 0, "", 0 };
+    MdnsInterface other = { 0, "", 0 };
+    for (const MdnsInterface& iface : MdnsGetInterfaces())
+    {
+        if (iface.address == htonl(INADDR_LOOPBACK))
+        {
+            loopback = loopback.index == 0 ? iface : loopback;
+        }
+        else if (other.index == 0)
+        {
+            other = iface;
+        }
+    }
+    if (loopback.index == 0)
+    {
+        fprintf(stderr, "No loopback interface\n");
+        return 1;
+    }
+
+    std::vector<uint32_t> lo = { loopback.index };
+    std::vector<uint32_t> both = { loopback.index };
+    std::vector<uint32_t> second;
+    if (other.index != 0)
+    {
+        both.push_back(other.index);
+        second.push_back(other.index);
+    }
+
+    uint32_t bogus = 0xfffffff0;
+    DnssdServiceWatcherPtr rejected = nullptr;
+    bool invalidRejected = dnssd_create_service_watcher_on_interfaces(kServiceName, dnssdServiceChangedCallback, &bogus, 1, &rejected) == DNSSD_INVALID_PARAMETER_ERROR;
+
+    DnssdServiceWatcherPtr loWatcher = createWatcher(kServiceName, lo);
+    DnssdServiceWatcherPtr otherWatcher = second.empty() ? nullptr : createWatcher(kServiceName, second);
+    DnssdServiceWatcherPtr bothWatcher = second.empty() ? nullptr : createWatcher(kServiceName, both);
+    if (loWatcher == nullptr || (!second.empty() && (otherWatcher == nullptr || bothWatcher == nullptr)))
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    // one service, answered on each interface with that interface's address
+    DnssdServiceRegistration registration = { kServiceName, "multi", "42300" };
+    DnssdServicePtr service = nullptr;
+    auto start = Clock::now();
+    if (dnssd_register_services_on_interfaces(&registration, 1, both.data(), both.size(), &service) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service\n");
+        return 1;
+    }
+    double registrationMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    bool found = waitFor(0, 1) && (second.empty() || (waitFor(1, 1) && waitFor(2, 2)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // the second interface alone: the loopback engine does not even read it
+    size_t loPackets = 0;
+    size_t bothPackets = 0;
+    size_t loOtherAdded = 0;
+    size_t bothOtherAdded = 0;
+    if (!second.empty())
+    {
+        std::shared_ptr<MdnsQueryEngine> loEngine = MdnsQueryEngine::GetShared(lo);
+        std::shared_ptr<MdnsQueryEngine> bothEngine = MdnsQueryEngine::GetShared(both);
+        DnssdServiceWatcherPtr loOtherWatcher = createWatcher(kOtherServiceName, lo);
+        DnssdServiceWatcherPtr bothOtherWatcher = createWatcher(kOtherServiceName, both);
+        uint64_t loBefore = loEngine->GetCounters().packetsReceived;
+        uint64_t bothBefore = bothEngine->GetCounters().packetsReceived;
+
+        std::vector<std::string> names(instances);
+        std::vector<DnssdServiceRegistration> registrations(instances);
+        for (size_t i = 0; i < instances; ++i)
+        {
+            names[i] = "device " + std::to_string(i);
+            registrations[i] = { kOtherServiceName, names[i].c_str(), "42301" };
+        }
+        DnssdServicePtr otherService = nullptr;
+        if (loOtherWatcher == nullptr || bothOtherWatcher == nullptr || dnssd_register_services_on_interfaces(registrations.data(), instances, second.data(), second.size(), &otherService) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        loPackets = loEngine->GetCounters().packetsReceived - loBefore;
+        bothPackets = bothEngine->GetCounters().packetsReceived - bothBefore;
+        dnssd_free_service(otherService);
+
+        std::lock_guard<std::mutex> lock(gMutex);
+        loOtherAdded = gSeen[3].added;
+        bothOtherAdded = gSeen[4].added;
+    }
+
+    size_t foreign = 0;
+    size_t bothAdded = 0;
+    size_t bothAddresses = 0;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        for (uint32_t address : gSeen[0].addresses)
+        {
+            foreign += address != loopback.address ? 1 : 0;
+        }
+        if (!second.empty())
+        {
+            for (uint32_t address : gSeen[1].addresses)
+            {
+                foreign += address != other.address ? 1 : 0;
+            }
+            bothAdded = gSeen[2].added;
+            bothAddresses = gSeen[2].addresses.size();
+        }
+    }
+
+    printf("interfaces %zu interfaces\n", both.size());
+    printf("registration_ms %.3f ms\n", registrationMs);
+    printf("foreign_addresses_answered %zu addresses\n", foreign);
+    if (!second.empty())
+    {
+        printf("both_watcher_services_added %zu services\n", bothAdded);
+        printf("both_watcher_addresses %zu addresses\n", bothAddresses);
+        printf("lo_watcher_%s_services_found %zu services\n", other.name.c_str(), loOtherAdded);
+        printf("both_watcher_%s_services_found %zu services\n", other.name.c_str(), bothOtherAdded);
+        printf("lo_engine_packets_parsed %zu packets\n", loPackets);
+        printf("both_engine_packets_parsed %zu packets\n", bothPackets);
+    }
+
+    dnssd_free_service(service);
+    for (DnssdServiceWatcherPtr watcher : gWatchers)
+    {
+        dnssd_free_service_watcher(watcher);
+    }
+
+    if (!invalidRejected || !found || foreign != 0 || (!second.empty() && (bothAdded != 1 || bothAddresses != 2 || loOtherAdded != 0 || bothOtherAdded != instances)))
+    {
+        fprintf(stderr, "interfaces error: %s, %s, %zu foreign addresses\n", invalidRejected ? "invalid index rejected" : "invalid index accepted",
+            found ? "found" : "not found", foreign);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Traffic on a simulated network of 1000 responders advertising _daap._tcp when one querier browses,
+// with and without known-answer suppression (RFC 6762 section 7.1). The querier builds its query with
+// MdnsQueryBuilder, listing the PTR records it has cached; every responder reads all the query packets
+// into an MdnsKnownAnswerList, like MdnsService does for a truncated query, and answers with
+// MdnsMessageWriter unless its PTR record is already known. The network is simulated at message level,
+// so the numbers are packets and bytes on the wire plus the CPU time spent building and reading them.
+//
+//     bench_known_answers [responders]
+
+#include "MdnsMessage.h"
+#include "MdnsQuery.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Responder
+{
+    MdnsRecord ptr;
+    MdnsRecord srv;
+    MdnsRecord txt;
+    MdnsRecord address;
+};
+
+struct Traffic
+{
+    size_t queryPackets = 0;
+    size_t queryBytes = 0;
+    size_t truncatedPackets = 0;
+    size_t knownAnswers = 0;
+    size_t responses = 0;
+    size_t responseBytes = 0;
+    size_t suppressed = 0;
+    double cpuMs = 0;
+};
+
+static std::vector<Responder> MakeResponders(size_t count)
+{
+    std::string type = MdnsMakeName("_daap._tcp.local");
+    std::vector<Responder> responders(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string instance = MdnsMakeName("Music Library " + std::to_string(i), type);
+        std::string host = MdnsMakeName("host-" + std::to_string(i) + ".local");
+        Responder& r = responders[i];
+        r.ptr = MdnsRecord::MakePtr(type, instance, MDNS_OTHER_RECORD_TTL);
+        r.srv = MdnsRecord::MakeSrv(instance, host, 3689, MDNS_HOST_RECORD_TTL);
+        r.txt = MdnsRecord::MakeTxt(instance, MDNS_OTHER_RECORD_TTL);
+        r.address = MdnsRecord::MakeA(host, htonl(0x0a000000 | static_cast<uint32_t>(i + 1)), MDNS_HOST_RECORD_TTL);
+    }
+    return responders;
+}
+
+// one browse query from a querier that has cached the PTR records of the first cached responders
+static Traffic Browse(const std::vector<Responder>& responders, size_t cached)
+{
+    Traffic traffic;
+    auto start = Clock::now();
+
+    MdnsQueryBuilder query;
+    query.AddQuestion(responders[0].ptr.name, MDNS_TYPE_PTR);
+    for (size_t i = 0; i < cached; ++i)
+    {
+        // received a while ago: more than half the TTL is left
+        MdnsRecord known = responders[i].ptr;
+        known.ttl = MDNS_OTHER_RECORD_TTL * 3 / 4;
+        query.AddKnownAnswer(known);
+    }
+
+    std::vector<std::vector<uint8_t>> packets;
+    query.Build([&](const uint8_t* data, size_t size, bool truncated)
+    {
+        packets.emplace_back(data, data + size);
+        traffic.queryPackets++;
+        traffic.queryBytes += size;
+        traffic.truncatedPackets += truncated ? 1 : 0;
+    });
+    traffic.knownAnswers = query.KnownAnswerCount();
+
+    uint8_t packet[MDNS_MAX_PACKET_SIZE];
+    for (const Responder& responder : responders)
+    {
+        MdnsKnownAnswerList knownAnswers;
+        bool asked = false;
+        for (const auto& p : packets)
+        {
+            MdnsMessageReader reader(p.data(), p.size());
+            MdnsQuestionView question;
+            while (reader.NextQuestion(question))
+            {
+                asked |= question.type == MDNS_TYPE_PTR && question.name.Equals(responder.ptr.name);
+            }
+            knownAnswers.Add(reader);
+        }
+
+        if (!asked || knownAnswers.Suppresses(responder.ptr))
+        {
+            traffic.suppressed += asked ? 1 : 0;
+            continue;
+        }
+
+        MdnsMessageWriter response(packet, sizeof(packet), 0, MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE);
+        response.AddRecord(MdnsAnswerSection, responder.ptr);
+        response.AddRecord(MdnsAdditionalSection, responder.srv);
+        response.AddRecord(MdnsAdditionalSection, responder.txt);
+        response.AddRecord(MdnsAdditionalSection, responder.address);
+        traffic.responses++;
+        traffic.responseBytes += response.Size();
+    }
+
+    traffic.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return traffic;
+}
+
+static void Report(const char* name, const Traffic& traffic, const Traffic& baseline)
+{
+    size_t total = traffic.queryBytes + traffic.responseBytes;
+    size_t baselineTotal = baseline.queryBytes + baseline.responseBytes;
+    printf("%s_query_packets %zu packets\n", name, traffic.queryPackets);
+    printf("%s_truncated_packets %zu packets\n", name, traffic.truncatedPackets);
+    printf("%s_known_answers %zu records\n", name, traffic.knownAnswers);
+    printf("%s_query_bytes %zu bytes\n", name, traffic.queryBytes);
+    printf("%s_responses %zu packets\n", name, traffic.responses);
+    printf("%s_responses_suppressed %zu packets\n", name, traffic.suppressed);
+    printf("%s_response_bytes %zu bytes\n", name, traffic.responseBytes);
+    printf("%s_total_bytes %zu bytes\n", name, total);
+    printf("%s_bytes_saved %.1f %%\n", name, baselineTotal ? 100.0 * (1.0 - double(total) / baselineTotal) : 0.0);
+    printf("%s_cpu_time %.2f ms\n", name, traffic.cpuMs);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    if (count == 0)
+    {
+        fprintf(stderr, "usage: bench_known_answers [responders]\n");
+        return 1;
+    }
+    std::vector<Responder> responders = MakeResponders(count);
+
+    // first browse: nothing cached, everybody answers
+    Traffic cold = Browse(responders, 0);
+
+    // continuous querying with a warm cache: one new responder appeared since the last query
+    Traffic warm = Browse(responders, count - 1);
+
+    // every responder is known: nobody answers
+    Traffic full = Browse(responders, count);
+
+    Report("cold", cold, cold);
+    Report("warm", warm, cold);
+    Report("full", full, cold);
+
+    if (cold.responses != count || warm.responses != 1 || full.responses != 0)
+    {
+        fprintf(stderr, "known-answer suppression error: %zu, %zu and %zu responses\n", cold.responses, warm.responses, full.responses);
+        return 1;
+    }
+    return 0;
+}
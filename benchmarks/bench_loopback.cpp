@@ -0,0 +1,119 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Measures responder-to-watcher latency over the loopback interface using only the dnssd.h C API.
+
+#include "dnssd.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static int gAdded = 0;
+static int gRemoved = 0;
+static Clock::time_point gRemovedAt;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    if (update == ServiceAdded)
+    {
+        gAdded++;
+    }
+    else if (update == ServiceRemoved)
+    {
+        gRemoved++;
+        gRemovedAt = Clock::now();
+    }
+    gCondition.notify_all();
+}
+
+static bool waitFor(int& counter, int value, std::chrono::seconds timeout)
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    return gCondition.wait_for(lock, timeout, [&] { return counter >= value; });
+}
+
+static double elapsedMs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 3;
+    const char* serviceName = "_dnssdbench._tcp";
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    DnssdServiceWatcherPtr watcher = nullptr;
+    if (dnssd_create_service_watcher(serviceName, dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        DnssdServicePtr service = nullptr;
+        std::string port = std::to_string(40000 + i);
+
+        auto start = Clock::now();
+        if (dnssd_create_service(serviceName, port.c_str(), &service) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        auto registered = Clock::now();
+
+        if (!waitFor(gAdded, i + 1, std::chrono::seconds(10)))
+        {
+            fprintf(stderr, "timed out waiting for ServiceAdded\n");
+            return 1;
+        }
+        auto added = Clock::now();
+
+        // the responder sends its goodbye packet while dnssd_free_service stops it,
+        // so the callback may run before the call returns
+        auto freed = Clock::now();
+        dnssd_free_service(service);
+
+        if (!waitFor(gRemoved, i + 1, std::chrono::seconds(10)))
+        {
+            fprintf(stderr, "timed out waiting for ServiceRemoved\n");
+            return 1;
+        }
+        Clock::time_point removed;
+        {
+            std::lock_guard<std::mutex> lock(gMutex);
+            removed = gRemovedAt;
+        }
+
+        printf("registration_ms %.3f ms\n", elapsedMs(start, registered));
+        printf("registered_to_added_ms %.3f ms\n", elapsedMs(registered, added));
+        printf("freed_to_removed_ms %.3f ms\n", elapsedMs(freed, removed));
+    }
+
+    dnssd_free_service_watcher(watcher);
+    return 0;
+}
@@ -0,0 +1,362 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Parse and write throughput of MdnsMessageReader / MdnsMessageWriter over a corpus of mDNS packets.
+// The built-in corpus (MdnsCorpus.h) is used unless a pcap capture is given on the command line:
+//
+//     bench_message [seconds] [capture.pcap]
+//
+// Only IPv4/UDP packets to or from port 5353 are taken from the capture (Ethernet or Linux cooked link types).
+
+#include "MdnsMessage.h"
+#include "MdnsCorpus.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Packet
+{
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+static uint32_t ReadU32(const uint8_t* p, bool swap)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static bool LoadPcap(const char* path, std::vector<Packet>& packets)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t header[24];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header))
+    {
+        fclose(file);
+        return false;
+    }
+
+    uint32_t magic = ReadU32(header, false);
+    bool swap = false;
+    if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1)
+    {
+        swap = true;
+    }
+    else if (magic != 0xa1b2c3d4 && magic != 0xa1b23c4d)
+    {
+        fclose(file);
+        return false;
+    }
+
+    uint32_t linkType = ReadU32(header + 20, swap);
+    size_t linkHeader = 0;
+    if (linkType == 1)          // Ethernet
+    {
+        linkHeader = 14;
+    }
+    else if (linkType == 113)   // Linux cooked capture
+    {
+        linkHeader = 16;
+    }
+    else
+    {
+        fclose(file);
+        return false;
+    }
+
+    uint8_t recordHeader[16];
+    std::vector<uint8_t> frame;
+    while (fread(recordHeader, 1, sizeof(recordHeader), file) == sizeof(recordHeader))
+    {
+        uint32_t captured = ReadU32(recordHeader + 8, swap);
+        if (captured > 65536)
+        {
+            break;
+        }
+        frame.resize(captured);
+        if (fread(frame.data(), 1, captured, file) != captured)
+        {
+            break;
+        }
+
+        if (captured < linkHeader + 20 + 8)
+        {
+            continue;
+        }
+
+        const uint8_t* ip = frame.data() + linkHeader;
+        size_t ipHeader = (ip[0] & 0x0f) * 4;
+        if ((ip[0] >> 4) != 4 || ip[9] != 17 || captured < linkHeader + ipHeader + 8)
+        {
+            continue;
+        }
+
+        const uint8_t* udp = ip + ipHeader;
+        uint16_t sourcePort = (udp[0] << 8) | udp[1];
+        uint16_t destinationPort = (udp[2] << 8) | udp[3];
+        if (sourcePort != MDNS_PORT && destinationPort != MDNS_PORT)
+        {
+            continue;
+        }
+
+        const uint8_t* payload = udp + 8;
+        size_t size = captured - (payload - frame.data());
+        Packet packet;
+        packet.name = "pcap" + std::to_string(packets.size());
+        packet.data.assign(payload, payload + size);
+        packets.push_back(packet);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// touch everything a watcher or responder would look at so the reader cannot skip work
+static size_t ParsePacket(const uint8_t* data, size_t size, uint32_t& checksum)
+{
+    MdnsMessageReader reader(data, size);
+    if (!reader.IsValid())
+    {
+        return 0;
+    }
+
+    size_t records = 0;
+    MdnsQuestionView question;
+    while (reader.NextQuestion(question))
+    {
+        checksum += question.name.Hash() + question.type;
+        records++;
+    }
+
+    MdnsRecordView record;
+    while (reader.NextRecord(record))
+    {
+        checksum += record.name.Hash() + record.type + record.ttl;
+
+        MdnsNameView target;
+        uint16_t priority, weight, port;
+        in_addr_t address;
+        in6_addr address6;
+        switch (record.type)
+        {
+        case MDNS_TYPE_PTR:
+            if (record.GetPtr(target))
+            {
+                checksum += target.Hash();
+            }
+            break;
+        case MDNS_TYPE_SRV:
+            if (record.GetSrv(priority, weight, port, target))
+            {
+                checksum += target.Hash() + port;
+            }
+            break;
+        case MDNS_TYPE_A:
+            if (record.GetA(address))
+            {
+                checksum += address;
+            }
+            break;
+        case MDNS_TYPE_AAAA:
+            if (record.GetAaaa(address6))
+            {
+                checksum += address6.s6_addr[15];
+            }
+            break;
+        default:
+            checksum += record.rdlength;
+            break;
+        }
+        records++;
+    }
+
+    return reader.Failed() ? 0 : records;
+}
+
+// a copy of each packet's questions and records as owned MdnsRecords, used to measure the writer
+struct WriteInput
+{
+    std::vector<std::string> questions;
+    std::vector<uint16_t> questionTypes;
+    std::vector<MdnsSection> sections;
+    std::vector<MdnsRecord> records;
+    uint16_t flags;
+};
+
+static WriteInput MakeWriteInput(const uint8_t* data, size_t size)
+{
+    WriteInput input;
+    MdnsMessageReader reader(data, size);
+    input.flags = reader.IsValid() ? reader.Flags() : 0;
+
+    MdnsQuestionView question;
+    while (reader.NextQuestion(question))
+    {
+        input.questions.push_back(question.name.ToName());
+        input.questionTypes.push_back(question.type);
+    }
+
+    MdnsRecordView view;
+    while (reader.NextRecord(view))
+    {
+        uint8_t rdata[MDNS_MAX_PACKET_SIZE];
+        size_t rdlength = view.CopyCanonicalRdata(rdata, sizeof(rdata));
+        if (rdlength == 0 && view.rdlength != 0)
+        {
+            continue;
+        }
+
+        MdnsRecord record;
+        record.name = view.name.ToName();
+        record.type = view.type;
+        record.rclass = view.rclass;
+        record.cacheFlush = view.cacheFlush;
+        record.ttl = view.ttl;
+        record.rdata.assign(reinterpret_cast<const char*>(rdata), rdlength);
+        input.sections.push_back(view.section);
+        input.records.push_back(record);
+    }
+
+    return input;
+}
+
+static size_t WritePacket(const WriteInput& input, MdnsMessageWriter& writer)
+{
+    writer.Reset(0, input.flags);
+    for (size_t i = 0; i < input.questions.size(); ++i)
+    {
+        writer.AddQuestion(input.questions[i], input.questionTypes[i]);
+    }
+    for (size_t i = 0; i < input.records.size(); ++i)
+    {
+        writer.AddRecord(input.sections[i], input.records[i]);
+    }
+    return writer.Size();
+}
+
+static double ElapsedSeconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+    std::vector<Packet> packets;
+    if (argc > 2)
+    {
+        if (!LoadPcap(argv[2], packets) || packets.empty())
+        {
+            fprintf(stderr, "Unable to read mDNS packets from %s\n", argv[2]);
+            return 1;
+        }
+    }
+    else
+    {
+        for (const auto& entry : mdns_corpus::kCorpus)
+        {
+            Packet packet;
+            packet.name = entry.name;
+            packet.data.assign(entry.data, entry.data + entry.size);
+            packets.push_back(packet);
+        }
+    }
+
+    // every corpus packet must parse cleanly, otherwise the numbers below mean nothing
+    size_t corpusRecords = 0;
+    size_t corpusBytes = 0;
+    for (const auto& packet : packets)
+    {
+        uint32_t checksum = 0;
+        size_t records = ParsePacket(packet.data.data(), packet.data.size(), checksum);
+        if (records == 0)
+        {
+            fprintf(stderr, "packet %s failed to parse\n", packet.name.c_str());
+            return 1;
+        }
+        corpusRecords += records;
+        corpusBytes += packet.data.size();
+    }
+
+    // parse
+    uint32_t checksum = 0;
+    size_t parsedPackets = 0;
+    size_t parsedRecords = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do
+    {
+        for (int round = 0; round < 100; ++round)
+        {
+            for (const auto& packet : packets)
+            {
+                parsedRecords += ParsePacket(packet.data.data(), packet.data.size(), checksum);
+            }
+            parsedPackets += packets.size();
+        }
+        elapsed = ElapsedSeconds(start);
+    } while (elapsed < seconds);
+
+    printf("corpus_packets %zu packets\n", packets.size());
+    printf("corpus_records %zu records\n", corpusRecords);
+    printf("corpus_bytes %zu bytes\n", corpusBytes);
+    printf("parse_packets_per_sec %.0f packets/s\n", parsedPackets / elapsed);
+    printf("parse_ns_per_record %.2f ns\n", elapsed * 1e9 / parsedRecords);
+    printf("parse_mb_per_sec %.1f MB/s\n", (double)parsedPackets / packets.size() * corpusBytes / elapsed / 1e6);
+
+    // write
+    std::vector<WriteInput> inputs;
+    for (const auto& packet : packets)
+    {
+        inputs.push_back(MakeWriteInput(packet.data.data(), packet.data.size()));
+    }
+
+    uint8_t buffer[MDNS_MAX_PACKET_SIZE];
+    MdnsMessageWriter writer(buffer, sizeof(buffer));
+    size_t writtenPackets = 0;
+    size_t writtenRecords = 0;
+    size_t writtenBytes = 0;
+    start = Clock::now();
+    do
+    {
+        for (int round = 0; round < 100; ++round)
+        {
+            for (const auto& input : inputs)
+            {
+                writtenBytes += WritePacket(input, writer);
+                writtenRecords += input.questions.size() + input.records.size();
+            }
+            writtenPackets += inputs.size();
+        }
+        elapsed = ElapsedSeconds(start);
+    } while (elapsed < seconds);
+
+    printf("write_packets_per_sec %.0f packets/s\n", writtenPackets / elapsed);
+    printf("write_ns_per_record %.2f ns\n", elapsed * 1e9 / writtenRecords);
+    printf("write_mb_per_sec %.1f MB/s\n", writtenBytes / elapsed / 1e6);
+    printf("checksum %u\n", checksum);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Query traffic and CPU time of an application watching eight service types over loopback,
+// with one watcher and with 50 (several plugins watching the same types independently).
+// "shared" is what dnssd_create_service_watcher does: every watcher subscribes to the process-wide
+// MdnsQueryEngine. "separate" gives each watcher a private engine with its own socket, thread, cache and
+// query schedule, which is how every watcher used to work. One responder per type answers; the CPU time is
+// the whole process, responders included, over the measured interval.
+//
+//     bench_query_engine [seconds] [watchers]
+
+#include "MdnsQueryEngine.h"
+#include "MdnsService.h"
+#include "MdnsServiceWatcher.h"
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+static const int kTypes = 8;
+
+static std::atomic<size_t> gAdded(0);
+
+static void OnServiceChanged(const DnssdServiceWatcherPtr, DnssdServiceUpdateType update, DnssdServiceInfoPtr)
+{
+    if (update == ServiceAdded)
+    {
+        gAdded++;
+    }
+}
+
+static std::string TypeName(int type)
+{
+    return "_enginebench" + std::to_string(type) + "._tcp";
+}
+
+static double CpuMs()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+struct Result
+{
+    uint64_t queriesSent = 0;
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    size_t added = 0;
+    double cpuMs = 0;
+};
+
+static Result Run(size_t watchers, bool shared, double seconds)
+{
+    gAdded = 0;
+    double cpu = CpuMs();
+
+    std::vector<std::shared_ptr<MdnsQueryEngine>> engines;
+    std::vector<std::unique_ptr<MdnsServiceWatcher>> list;
+    for (size_t i = 0; i < watchers; ++i)
+    {
+        std::shared_ptr<MdnsQueryEngine> engine;
+        if (shared)
+        {
+            engine = engines.empty() ? MdnsQueryEngine::GetShared() : engines[0];
+        }
+        else
+        {
+            engine = std::make_shared<MdnsQueryEngine>();
+            if (engine->Start() != DNSSD_NO_ERROR)
+            {
+                engine = nullptr;
+            }
+        }
+        if (!engine)
+        {
+            fprintf(stderr, "Unable to start a query engine\n");
+            exit(1);
+        }
+        if (engines.empty() || !shared)
+        {
+            engines.push_back(engine);
+        }
+
+        std::unique_ptr<MdnsServiceWatcher> watcher(new MdnsServiceWatcher(TypeName(static_cast<int>(i % kTypes)).c_str(), OnServiceChanged));
+        watcher->Initialize(engine);
+        list.push_back(std::move(watcher));
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+    Result result;
+    result.cpuMs = CpuMs() - cpu;
+    result.added = gAdded;
+    for (const auto& engine : engines)
+    {
+        const MdnsQuerierCounters& counters = engine->GetCounters();
+        result.queriesSent += counters.queriesSent;
+        result.packetsSent += counters.packetsSent;
+        result.packetsReceived += counters.packetsReceived;
+    }
+    return result;
+}
+
+static void Report(const char* name, size_t watchers, const Result& result)
+{
+    printf("%s_%zuw_queries %llu queries\n", name, watchers, static_cast<unsigned long long>(result.queriesSent));
+    printf("%s_%zuw_query_packets %llu packets\n", name, watchers, static_cast<unsigned long long>(result.packetsSent));
+    printf("%s_%zuw_packets_parsed %llu packets\n", name, watchers, static_cast<unsigned long long>(result.packetsReceived));
+    printf("%s_%zuw_cpu_time %.1f ms\n", name, watchers, result.cpuMs);
+}
+
+int main(int argc, char* argv[])
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    const size_t watchers = argc > 2 ? strtoul(argv[2], nullptr, 10) : 50;
+    if (seconds <= 0 || watchers == 0)
+    {
+        fprintf(stderr, "usage: bench_query_engine [seconds] [watchers]\n");
+        return 1;
+    }
+
+    // MdnsService::Start blocks while it probes: start the responders together
+    std::vector<std::unique_ptr<MdnsService>> services;
+    std::vector<std::thread> starting;
+    for (int type = 0; type < kTypes; ++type)
+    {
+        services.emplace_back(new MdnsService(TypeName(type), std::to_string(41000 + type)));
+    }
+    for (auto& service : services)
+    {
+        starting.emplace_back([&service] { service->Start(); });
+    }
+    for (auto& t : starting)
+    {
+        t.join();
+    }
+
+    // let the second announcement go out so only query traffic is measured
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    Result one = Run(1, true, seconds);
+    Result shared = Run(watchers, true, seconds);
+    Result separate = Run(watchers, false, seconds);
+
+    Report("shared", 1, one);
+    Report("shared", watchers, shared);
+    Report("separate", watchers, separate);
+
+    // every watcher finds the responder of its type
+    if (one.added != 1 || shared.added != watchers || separate.added != watchers)
+    {
+        fprintf(stderr, "query engine error: %zu, %zu and %zu services found\n", one.added, shared.added, separate.added);
+        return 1;
+    }
+    return 0;
+}
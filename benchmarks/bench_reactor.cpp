@@ -0,0 +1,222 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Threads and CPU of a process with many watchers and services, all served by the one MdnsReactor event loop.
+// Registers services instances of as many types with dnssd_create_service_async and creates watchers watchers
+// spread over those types, then waits until every watcher has found its service. The thread count is read from
+// /proc/self/task before, while everything runs and after it is freed: the loop adds one thread, whatever the
+// number of watchers, and none in caller thread mode, where the main thread runs it with dnssd_run_events.
+// CPU time and context switches are then measured for a few seconds of steady state, and must stay bounded.
+//
+//     bench_reactor [watchers] [services] [caller]
+
+#include "dnssd.h"
+#include "MdnsReactor.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kSteadySeconds = 3;
+static const double kMaxSteadyCpuMsPerSecond = 100;    // a tenth of a core, far above what continuous queries cost
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static std::unordered_map<DnssdServiceWatcherPtr, size_t> gAdded;
+static size_t gStarted = 0;
+static size_t gFailed = 0;
+static bool gCallerThread = false;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gAdded[serviceWatcher] += update == ServiceAdded ? 1 : 0;
+    gCondition.notify_all();
+}
+
+static void dnssdServiceStartedCallback(const DnssdServicePtr service, DnssdServiceStartStatus status, DnssdErrorType error, const char* instanceName)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gStarted += error == DNSSD_NO_ERROR ? 1 : 0;
+    gFailed += error != DNSSD_NO_ERROR ? 1 : 0;
+    gCondition.notify_all();
+}
+
+static size_t countThreads()
+{
+    size_t count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+    while (dirent* entry = readdir(dir))
+    {
+        count += entry->d_name[0] != '.' ? 1 : 0;
+    }
+    closedir(dir);
+    return count;
+}
+
+// until done() holds or timeout: runs the loop in caller thread mode, waits for a callback otherwise
+template <typename Done>
+static bool waitUntil(Done done, std::chrono::milliseconds timeout)
+{
+    auto deadline = Clock::now() + timeout;
+    while (Clock::now() < deadline)
+    {
+        if (gCallerThread)
+        {
+            dnssd_run_events(10);
+        }
+        std::unique_lock<std::mutex> lock(gMutex);
+        if (done())
+        {
+            return true;
+        }
+        if (!gCallerThread)
+        {
+            gCondition.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+    std::lock_guard<std::mutex> lock(gMutex);
+    return done();
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t watcherCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t serviceCount = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+    gCallerThread = argc > 3 && strcmp(argv[3], "caller") == 0;
+    if (watcherCount == 0 || serviceCount == 0 || (argc > 3 && !gCallerThread))
+    {
+        fprintf(stderr, "usage: bench_reactor [watchers] [services] [caller]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR || (gCallerThread && dnssd_use_caller_thread() != DNSSD_NO_ERROR))
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+    const size_t threadsBefore = countThreads();
+
+    std::vector<std::string> names(serviceCount);
+    std::vector<DnssdServicePtr> services;
+    for (size_t i = 0; i < serviceCount; ++i)
+    {
+        names[i] = "_dnssdreactor" + std::to_string(i) + "._tcp";
+        DnssdServicePtr service = nullptr;
+        if (dnssd_create_service_async(names[i].c_str(), std::to_string(42400 + i).c_str(), dnssdServiceStartedCallback, &service) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        services.push_back(service);
+    }
+
+    auto start = Clock::now();
+    std::vector<DnssdServiceWatcherPtr> watchers;
+    for (size_t i = 0; i < watcherCount; ++i)
+    {
+        DnssdServiceWatcherPtr watcher = nullptr;
+        if (dnssd_create_service_watcher(names[i % serviceCount].c_str(), dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+            return 1;
+        }
+        watchers.push_back(watcher);
+    }
+
+    bool started = waitUntil([&] { return gStarted + gFailed == serviceCount; }, std::chrono::seconds(20));
+    bool found = waitUntil([&]
+    {
+        size_t count = 0;
+        for (DnssdServiceWatcherPtr watcher : watchers)
+        {
+            auto it = gAdded.find(watcher);
+            count += it != gAdded.end() && it->second != 0 ? 1 : 0;
+        }
+        return count == watcherCount;
+    }, std::chrono::seconds(20));
+    double foundMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    const size_t threadsRunning = countThreads();
+    const size_t clients = MdnsReactor::GetShared()->GetClientCount();
+
+    // steady state: continuous queries and their answers only
+    rusage before;
+    rusage after;
+    getrusage(RUSAGE_SELF, &before);
+    auto steadyStart = Clock::now();
+    if (gCallerThread)
+    {
+        // the loop sleeps until its next deadline, at most until the end of the measurement
+        auto end = steadyStart + std::chrono::seconds(kSteadySeconds);
+        for (auto now = Clock::now(); now < end; now = Clock::now())
+        {
+            dnssd_run_events(static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(end - now).count()) + 1);
+        }
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(kSteadySeconds));
+    }
+    getrusage(RUSAGE_SELF, &after);
+    double seconds = std::chrono::duration<double>(Clock::now() - steadyStart).count();
+    double cpuMs = (after.ru_utime.tv_sec - before.ru_utime.tv_sec + after.ru_stime.tv_sec - before.ru_stime.tv_sec) * 1000.0
+        + (after.ru_utime.tv_usec - before.ru_utime.tv_usec + after.ru_stime.tv_usec - before.ru_stime.tv_usec) / 1000.0;
+    long switches = after.ru_nvcsw - before.ru_nvcsw + after.ru_nivcsw - before.ru_nivcsw;
+
+    for (DnssdServiceWatcherPtr watcher : watchers)
+    {
+        dnssd_free_service_watcher(watcher);
+    }
+    for (DnssdServicePtr service : services)
+    {
+        dnssd_free_service(service);
+    }
+    const size_t threadsAfter = countThreads();
+
+    printf("mode %s\n", gCallerThread ? "caller_thread" : "library_thread");
+    printf("watchers %zu watchers\n", watcherCount);
+    printf("services %zu services\n", serviceCount);
+    printf("reactor_clients %zu clients\n", clients);
+    printf("threads_before %zu threads\n", threadsBefore);
+    printf("threads_running %zu threads\n", threadsRunning);
+    printf("threads_after_free %zu threads\n", threadsAfter);
+    printf("all_found_ms %.1f ms\n", foundMs);
+    printf("steady_cpu_ms_per_s %.2f ms/s\n", cpuMs / seconds);
+    printf("steady_context_switches_per_s %.1f switches/s\n", switches / seconds);
+
+    // the loop's thread, if it has one, and nothing per watcher or service
+    const size_t loopThreads = gCallerThread ? 0 : 1;
+    if (!started || gFailed != 0 || !found || threadsRunning > threadsBefore + loopThreads || threadsAfter > threadsRunning
+        || cpuMs / seconds > kMaxSteadyCpuMsPerSecond)
+    {
+        fprintf(stderr, "reactor error: %zu of %zu services started, %s, %zu threads before, %zu running\n", gStarted, serviceCount,
+            found ? "all found" : "not all found", threadsBefore, threadsRunning);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Wall time of registering many service instances on the loopback interface: dnssd_create_service for one
+// instance against dnssd_register_services for all of them at once, which probes and announces them in shared
+// packets. A watcher checks that every instance is found, and a second group under the same names checks that
+// conflicts rename each instance. Only uses the dnssd.h C API.
+//
+//     bench_register [instances]
+
+#include "dnssd.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdregister._tcp";
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static size_t gAdded = 0;
+static size_t gExpected = 0;
+static Clock::time_point gAllAddedAt;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    if (update == ServiceAdded)
+    {
+        if (++gAdded == gExpected)
+        {
+            gAllAddedAt = Clock::now();
+            gCondition.notify_all();
+        }
+    }
+}
+
+static bool waitForAdded()
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    return gCondition.wait_for(lock, std::chrono::seconds(10), [] { return gAdded >= gExpected; });
+}
+
+static double elapsedMs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    if (count == 0)
+    {
+        fprintf(stderr, "usage: bench_register [instances]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    DnssdServicePtr single = nullptr;
+    auto start = Clock::now();
+    if (dnssd_create_service(kServiceName, "42000", &single) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service\n");
+        return 1;
+    }
+    double singleMs = elapsedMs(start, Clock::now());
+    dnssd_free_service(single);
+
+    DnssdServiceWatcherPtr watcher = nullptr;
+    if (dnssd_create_service_watcher(kServiceName, dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    std::vector<std::string> names(count);
+    std::vector<std::string> ports(count);
+    std::vector<DnssdServiceRegistration> registrations(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        names[i] = "Device " + std::to_string(i);
+        ports[i] = std::to_string(43000 + i % 20000);
+        registrations[i].serviceName = kServiceName;
+        registrations[i].instanceName = names[i].c_str();
+        registrations[i].port = ports[i].c_str();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        gExpected = count;
+    }
+    DnssdServicePtr group = nullptr;
+    start = Clock::now();
+    if (dnssd_register_services(registrations.data(), count, &group) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to register dnssd services\n");
+        return 1;
+    }
+    auto registered = Clock::now();
+    double bulkMs = elapsedMs(start, registered);
+    bool found = waitForAdded();
+    size_t foundCount;
+    Clock::time_point added;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        foundCount = gAdded;
+        added = found ? gAllAddedAt : Clock::now();
+    }
+
+    // the same names again, on other ports: every instance of the second group must be renamed
+    for (size_t i = 0; i < count; ++i)
+    {
+        ports[i] = std::to_string(23000 + i % 20000);
+        registrations[i].port = ports[i].c_str();
+    }
+    DnssdServicePtr conflicting = nullptr;
+    start = Clock::now();
+    if (dnssd_register_services(registrations.data(), count, &conflicting) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to register dnssd services\n");
+        return 1;
+    }
+    double conflictingMs = elapsedMs(start, Clock::now());
+
+    size_t renamed = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char* name = dnssd_service_get_instance_name(conflicting, i);
+        renamed += name != nullptr && names[i] != name ? 1 : 0;
+    }
+
+    printf("single_registration_ms %.3f ms\n", singleMs);
+    printf("bulk_registration_ms %.3f ms\n", bulkMs);
+    printf("bulk_registered_to_all_added_ms %.3f ms\n", elapsedMs(registered, added));
+    printf("bulk_instances_found %zu instances\n", foundCount);
+    printf("conflicting_registration_ms %.3f ms\n", conflictingMs);
+    printf("conflicting_instances_renamed %zu instances\n", renamed);
+
+    dnssd_free_service(conflicting);
+    dnssd_free_service(group);
+    dnssd_free_service_watcher(watcher);
+
+    if (!found || renamed != count)
+    {
+        fprintf(stderr, "bulk registration error: %zu of %zu instances found, %zu renamed\n", foundCount, count, renamed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,244 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Queries answered per second on one core by a responder with many registered instances, before and after
+// MdnsService answered from an MdnsAnswerIndex. "before" does what the responder did per query: compare every
+// question against every instance's service type, look instance names up through a lower cased copy and build
+// the response out of MdnsRecords with MdnsMessageWriter, which searches the packet for each name suffix.
+// "after" finds the records with one index lookup per question and copies their prebuilt wire format into
+// the packet with MdnsResponseWriter. Both read the query with MdnsMessageReader and answer the same records.
+//
+//     bench_responder [instances] [queries per run]
+
+#include "MdnsAnswerIndex.h"
+#include "MdnsMessage.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kTypes = 50;
+
+struct Instance
+{
+    std::string serviceType;
+    MdnsRecord ptr;
+    MdnsRecord srv;
+    MdnsRecord txt;
+    MdnsAnswerIndex::RecordId ptrId;
+    MdnsAnswerIndex::RecordId srvId;
+    MdnsAnswerIndex::RecordId txtId;
+};
+
+struct Result
+{
+    double queriesPerSecond;
+    size_t answers;
+    size_t bytes;
+};
+
+static std::vector<uint8_t> MakeQuery(const std::string& name, uint16_t type)
+{
+    uint8_t packet[MDNS_MAX_PACKET_SIZE];
+    MdnsMessageWriter query(packet, sizeof(packet));
+    query.AddQuestion(MdnsMakeName(name), type);
+    return std::vector<uint8_t>(query.Data(), query.Data() + query.Size());
+}
+
+template <typename Answer>
+static Result Run(const std::vector<std::vector<uint8_t>>& queries, size_t count, Answer answer)
+{
+    Result result = { 0, 0, 0 };
+    auto start = Clock::now();
+    for (size_t q = 0; q < count; ++q)
+    {
+        const std::vector<uint8_t>& query = queries[q % queries.size()];
+        MdnsMessageReader reader(query.data(), query.size());
+        answer(reader, result);
+    }
+    result.queriesPerSecond = count / std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+static void Report(const char* scenario, const char* name, const Result& result, size_t count)
+{
+    printf("%s_%s_queries_per_s_per_core %.0f queries/s\n", scenario, name, result.queriesPerSecond);
+    printf("%s_%s_bytes_per_query %.1f bytes\n", scenario, name, double(result.bytes) / count);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t queryCount = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+    if (count == 0 || queryCount == 0)
+    {
+        fprintf(stderr, "usage: bench_responder [instances] [queries per run]\n");
+        return 1;
+    }
+
+    const std::string host = MdnsMakeName("responder.local");
+    const MdnsRecord address = MdnsRecord::MakeA(host, htonl(0x0a000001), MDNS_HOST_RECORD_TTL);
+
+    MdnsAnswerIndex index;
+    MdnsAnswerIndex::RecordId addressId = index.Add(address, 0);
+    std::vector<Instance> instances(count);
+    std::unordered_map<std::string, size_t> byName;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Instance& instance = instances[i];
+        instance.serviceType = MdnsMakeName("_bench" + std::to_string(i % kTypes) + "._tcp.local");
+        std::string name = MdnsMakeName("Device " + std::to_string(i), instance.serviceType);
+        instance.ptr = MdnsRecord::MakePtr(instance.serviceType, name, MDNS_OTHER_RECORD_TTL);
+        instance.srv = MdnsRecord::MakeSrv(name, host, static_cast<uint16_t>(40000 + i), MDNS_HOST_RECORD_TTL);
+        instance.txt = MdnsRecord::MakeTxt(name, MDNS_OTHER_RECORD_TTL);
+        instance.ptrId = index.Add(instance.ptr, static_cast<uint32_t>(i));
+        instance.srvId = index.Add(instance.srv, static_cast<uint32_t>(i));
+        instance.txtId = index.Add(instance.txt, static_cast<uint32_t>(i));
+        byName[MdnsLowerCase(name)] = i;
+    }
+
+    // what a busy network sends a responder: questions about single instances, browses of a type,
+    // and mostly questions for other hosts' names, which every responder on the link reads too
+    struct Scenario
+    {
+        const char* name;
+        std::vector<std::vector<uint8_t>> queries;
+    };
+    std::vector<Scenario> scenarios(3);
+    scenarios[0].name = "instance";
+    scenarios[1].name = "browse";
+    scenarios[2].name = "miss";
+    for (size_t i = 0; i < 64; ++i)
+    {
+        scenarios[0].queries.push_back(MakeQuery("device " + std::to_string(i * 7919 % count) + "._bench" + std::to_string(i * 7919 % count % kTypes) + "._tcp.local", MDNS_TYPE_ANY));
+        scenarios[1].queries.push_back(MakeQuery("_bench" + std::to_string(i % kTypes) + "._tcp.local", MDNS_TYPE_PTR));
+        scenarios[2].queries.push_back(MakeQuery("Printer " + std::to_string(i) + "._ipp._tcp.local", MDNS_TYPE_ANY));
+    }
+
+    uint8_t packet[MDNS_MAX_PACKET_SIZE];
+    const uint16_t flags = MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE;
+    MdnsResponseWriter response(index, packet, sizeof(packet));
+    std::vector<size_t> ptrAnswers;
+    std::vector<size_t> instanceAnswers;
+
+    size_t errors = 0;
+    for (const Scenario& scenario : scenarios)
+    {
+        Result before = Run(scenario.queries, queryCount, [&](MdnsMessageReader& query, Result& result)
+        {
+            ptrAnswers.clear();
+            instanceAnswers.clear();
+            MdnsQuestionView question;
+            while (query.NextQuestion(question))
+            {
+                for (size_t i = 0; i < instances.size(); ++i)
+                {
+                    if ((question.type == MDNS_TYPE_PTR || question.type == MDNS_TYPE_ANY) && question.name.Equals(instances[i].serviceType))
+                    {
+                        ptrAnswers.push_back(i);
+                    }
+                }
+                auto found = byName.find(MdnsLowerCase(question.name.ToName()));
+                if (found != byName.end())
+                {
+                    instanceAnswers.push_back(found->second);
+                }
+            }
+            if (ptrAnswers.empty() && instanceAnswers.empty())
+            {
+                return;
+            }
+
+            MdnsMessageWriter writer(packet, sizeof(packet), 0, flags);
+            for (size_t i : ptrAnswers)
+            {
+                writer.AddRecord(MdnsAnswerSection, instances[i].ptr);
+            }
+            for (size_t i : instanceAnswers)
+            {
+                writer.AddRecord(MdnsAnswerSection, instances[i].srv);
+                writer.AddRecord(MdnsAnswerSection, instances[i].txt);
+            }
+            for (size_t i : ptrAnswers)
+            {
+                writer.AddRecord(MdnsAdditionalSection, instances[i].srv);
+                writer.AddRecord(MdnsAdditionalSection, instances[i].txt);
+            }
+            writer.AddRecord(MdnsAdditionalSection, address);
+            result.answers += writer.Count(MdnsAnswerSection) + writer.Count(MdnsAdditionalSection);
+            result.bytes += writer.Size();
+        });
+
+        Result after = Run(scenario.queries, queryCount, [&](MdnsMessageReader& query, Result& result)
+        {
+            ptrAnswers.clear();
+            instanceAnswers.clear();
+            MdnsQuestionView question;
+            while (query.NextQuestion(question))
+            {
+                index.Find(question.name, question.type, question.qclass, [&](MdnsAnswerIndex::RecordId id)
+                {
+                    const MdnsRecord& record = index.GetRecord(id);
+                    if (record.type == MDNS_TYPE_PTR)
+                    {
+                        ptrAnswers.push_back(index.GetTag(id));
+                    }
+                    else if (record.type == MDNS_TYPE_SRV)
+                    {
+                        instanceAnswers.push_back(index.GetTag(id));
+                    }
+                });
+            }
+            if (ptrAnswers.empty() && instanceAnswers.empty())
+            {
+                return;
+            }
+
+            response.Reset(0, flags);
+            for (size_t i : ptrAnswers)
+            {
+                response.AddRecord(MdnsAnswerSection, instances[i].ptrId);
+            }
+            for (size_t i : instanceAnswers)
+            {
+                response.AddRecord(MdnsAnswerSection, instances[i].srvId);
+                response.AddRecord(MdnsAnswerSection, instances[i].txtId);
+            }
+            for (size_t i : ptrAnswers)
+            {
+                response.AddRecord(MdnsAdditionalSection, instances[i].srvId);
+                response.AddRecord(MdnsAdditionalSection, instances[i].txtId);
+            }
+            response.AddRecord(MdnsAdditionalSection, addressId);
+            result.answers += response.Count(MdnsAnswerSection) + response.Count(MdnsAdditionalSection);
+            result.bytes += response.Size();
+        });
+
+        Report(scenario.name, "before", before, queryCount);
+        Report(scenario.name, "after", after, queryCount);
+        printf("%s_speedup %.2f x\n", scenario.name, after.queriesPerSecond / before.queriesPerSecond);
+        errors += before.answers != after.answers ? 1 : 0;
+    }
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "responder error: %zu scenarios answered differently\n", errors);
+        return 1;
+    }
+    return 0;
+}
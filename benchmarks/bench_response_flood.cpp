@@ -0,0 +1,173 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Traffic a responder and a set of queriers put on the loopback link when many hosts ask the same question at once.
+// Responder: an MdnsService with one service type receives a burst of browse queries from many queriers, in
+// rounds. It answers the whole burst with one aggregated response sent after a random 20-120 ms delay, and
+// multicasts no record more than once a second (RFC 6762 section 6). "baseline" is what answering every query
+// on its own sends: every answer once per query. Querier: several query engines (one per application on a host,
+// or one per host) browse the same type; an engine about to ask a question another one just asked, with no
+// known answer it lacks, skips its own query (section 7.3).
+//
+//     bench_response_flood [queriers per round] [rounds] [instances] [engines] [seconds]
+
+#include "MdnsMessage.h"
+#include "MdnsQueryEngine.h"
+#include "MdnsService.h"
+#include "MdnsServiceWatcher.h"
+#include "MdnsSocket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+static const char* kServiceName = "_floodbench._tcp";
+
+static std::atomic<size_t> gAdded(0);
+
+static void OnServiceChanged(const DnssdServiceWatcherPtr, DnssdServiceUpdateType update, DnssdServiceInfoPtr)
+{
+    if (update == ServiceAdded)
+    {
+        gAdded++;
+    }
+}
+
+static unsigned long long Count(const std::atomic<uint64_t>& counter)
+{
+    return static_cast<unsigned long long>(counter.load());
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t queriers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+    const size_t rounds = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+    const size_t instances = argc > 3 ? strtoul(argv[3], nullptr, 10) : 10;
+    const size_t engineCount = argc > 4 ? strtoul(argv[4], nullptr, 10) : 8;
+    const double seconds = argc > 5 ? atof(argv[5]) : 8.0;
+    if (queriers == 0 || rounds == 0 || instances == 0 || engineCount == 0 || seconds <= 0)
+    {
+        fprintf(stderr, "usage: bench_response_flood [queriers per round] [rounds] [instances] [engines] [seconds]\n");
+        return 1;
+    }
+
+    std::vector<MdnsServiceRegistration> registrations(instances);
+    for (size_t i = 0; i < instances; ++i)
+    {
+        registrations[i].serviceName = kServiceName;
+        registrations[i].instanceName = "Device " + std::to_string(i);
+        registrations[i].port = std::to_string(44000 + i);
+    }
+    MdnsService service(registrations);
+    MdnsSocket socket;
+    if (service.Start() != DNSSD_NO_ERROR || socket.Open() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to start the responder\n");
+        return 1;
+    }
+
+    // let the announcements go out and their records leave the one second rate limit
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    const MdnsResponderCounters& counters = service.GetCounters();
+    const uint64_t queriesBefore = counters.queriesReceived;
+    const uint64_t responsesBefore = counters.responsesSent;
+    const uint64_t answersBefore = counters.answersSent;
+    const uint64_t bytesBefore = counters.bytesSent;
+
+    // every querier asks the same browse question within a millisecond or two. Rounds 600 ms apart:
+    // every other one comes back within a second of the response to the one before
+    const std::string question = MdnsMakeName(std::string(kServiceName) + ".local");
+    uint8_t packet[MDNS_MAX_PACKET_SIZE];
+    uint64_t firstResponseBytes = 0;
+    uint64_t firstResponseAnswers = 0;
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        for (size_t q = 0; q < queriers; ++q)
+        {
+            MdnsMessageWriter query(packet, sizeof(packet), static_cast<uint16_t>(q));
+            query.AddQuestion(question, MDNS_TYPE_PTR);
+            socket.Send(query.Data(), query.Size());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(600));
+        if (round == 0)
+        {
+            firstResponseBytes = counters.bytesSent - bytesBefore;
+            firstResponseAnswers = counters.answersSent - answersBefore;
+        }
+    }
+
+    const uint64_t queries = counters.queriesReceived - queriesBefore;
+    const uint64_t responses = counters.responsesSent - responsesBefore;
+    const uint64_t answers = counters.answersSent - answersBefore;
+    const uint64_t bytes = counters.bytesSent - bytesBefore;
+    printf("responder_queries_received %llu queries\n", static_cast<unsigned long long>(queries));
+    printf("responder_responses_sent %llu packets\n", static_cast<unsigned long long>(responses));
+    printf("responder_answers_sent %llu records\n", static_cast<unsigned long long>(answers));
+    printf("responder_bytes_sent %llu bytes\n", static_cast<unsigned long long>(bytes));
+    printf("responder_queries_aggregated %llu queries\n", Count(counters.queriesAggregated));
+    printf("responder_answers_deduplicated %llu records\n", Count(counters.answersDeduplicated));
+    printf("responder_duplicate_answers_suppressed %llu records\n", Count(counters.duplicateAnswersSuppressed));
+    printf("responder_answers_rate_limited %llu records\n", Count(counters.answersRateLimited));
+    printf("baseline_answers_sent %llu records\n", static_cast<unsigned long long>(queries * firstResponseAnswers));
+    printf("baseline_bytes_sent %llu bytes\n", static_cast<unsigned long long>(queries * firstResponseBytes));
+    printf("responder_bytes_saved %.1f %%\n", queries * firstResponseBytes == 0 ? 0.0 : 100.0 * (1.0 - double(bytes) / double(queries * firstResponseBytes)));
+
+    // engines of their own, as separate applications or hosts would have, all browsing the same type
+    gAdded = 0;
+    std::vector<std::shared_ptr<MdnsQueryEngine>> engines;
+    std::vector<std::unique_ptr<MdnsServiceWatcher>> watchers;
+    for (size_t i = 0; i < engineCount; ++i)
+    {
+        auto engine = std::make_shared<MdnsQueryEngine>();
+        if (engine->Start() != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to start a query engine\n");
+            return 1;
+        }
+        std::unique_ptr<MdnsServiceWatcher> watcher(new MdnsServiceWatcher(kServiceName, OnServiceChanged));
+        watcher->Initialize(engine);
+        engines.push_back(engine);
+        watchers.push_back(std::move(watcher));
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+    uint64_t queriesSent = 0;
+    uint64_t questionsSuppressed = 0;
+    for (const auto& engine : engines)
+    {
+        queriesSent += engine->GetCounters().queriesSent;
+        questionsSuppressed += engine->GetCounters().questionsSuppressed;
+    }
+    size_t added = gAdded;
+    watchers.clear();
+    engines.clear();
+
+    printf("querier_%zue_queries_sent %llu queries\n", engineCount, static_cast<unsigned long long>(queriesSent));
+    printf("querier_%zue_questions_suppressed %llu questions\n", engineCount, static_cast<unsigned long long>(questionsSuppressed));
+    printf("querier_%zue_services_found %zu services\n", engineCount, added);
+
+    // every query got its answers at least once a round, and every engine found every instance
+    if (firstResponseAnswers == 0 || responses == 0 || added != engineCount * instances)
+    {
+        fprintf(stderr, "response flood error: %llu answers to the first round, %zu of %zu services found\n",
+            static_cast<unsigned long long>(firstResponseAnswers), added, engineCount * instances);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Service change events per second delivered to a DnssdServiceChangedCallback, before and after the
+// service strings were kept as UTF-8 in a DnssdServiceFields block. "before" repeats what the Windows Runtime
+// watcher did per event: convert the four UTF-16 strings with a sizing pass, a heap buffer and a
+// copy into a std::string. "after" converts only the field that changed and points the callback into the block.
+// UTF-16 to UTF-8 conversion stands in for WideCharToMultiByte.
+//
+//     bench_service_events [events]
+
+#include "DnssdServiceFields.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static size_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+    gAllocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+// UTF-16 to UTF-8 without surrogate validation. Returns the UTF-8 length; writes nothing when out is nullptr
+static size_t ToUtf8(const std::u16string& s, char* out)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        uint32_t c = s[i];
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < s.size())
+        {
+            c = 0x10000 + ((c - 0xd800) << 10) + (s[++i] - 0xdc00);
+        }
+
+        char bytes[4];
+        size_t n;
+        if (c < 0x80)
+        {
+            bytes[0] = static_cast<char>(c);
+            n = 1;
+        }
+        else if (c < 0x800)
+        {
+            bytes[0] = static_cast<char>(0xc0 | (c >> 6));
+            bytes[1] = static_cast<char>(0x80 | (c & 0x3f));
+            n = 2;
+        }
+        else if (c < 0x10000)
+        {
+            bytes[0] = static_cast<char>(0xe0 | (c >> 12));
+            bytes[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            bytes[2] = static_cast<char>(0x80 | (c & 0x3f));
+            n = 3;
+        }
+        else
+        {
+            bytes[0] = static_cast<char>(0xf0 | (c >> 18));
+            bytes[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+            bytes[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            bytes[3] = static_cast<char>(0x80 | (c & 0x3f));
+            n = 4;
+        }
+
+        if (out != nullptr)
+        {
+            for (size_t b = 0; b < n; ++b)
+            {
+                out[length + b] = bytes[b];
+            }
+        }
+        length += n;
+    }
+    return length;
+}
+
+// the old PlatformStringToString: size, allocate, convert, copy
+static std::string ToString(const std::u16string& s)
+{
+    size_t size = ToUtf8(s, nullptr) + 1;
+    auto utf8 = std::make_unique<char[]>(size);
+    utf8[ToUtf8(s, utf8.get())] = '\0';
+    return std::string(utf8.get());
+}
+
+static bool SetField(DnssdServiceFields& fields, DnssdServiceFields::Field field, const std::u16string& s)
+{
+    char buffer[1024];
+    return fields.Set(field, buffer, ToUtf8(s, buffer));
+}
+
+struct Service
+{
+    std::u16string id;
+    std::u16string instanceName;
+    std::u16string host;
+    std::u16string port;
+    DnssdServiceFields fields;
+};
+
+static volatile size_t gSink = 0;
+
+static void OnServiceChanged(const DnssdServiceWatcherPtr, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    gSink = gSink + update + info->id[0] + info->instanceName[0] + info->host[0] + info->port[0];
+}
+
+static void Report(const char* name, Clock::time_point start, size_t events, size_t allocations)
+{
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%s_events_per_s %.0f events/s\n", name, events / seconds);
+    printf("%s_allocations_per_event %.2f allocations\n", name, double(allocations) / events);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t events = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+    const size_t serviceCount = 500;
+    if (events == 0)
+    {
+        fprintf(stderr, "usage: bench_service_events [events]\n");
+        return 1;
+    }
+
+    std::vector<Service> services(serviceCount);
+    for (size_t i = 0; i < serviceCount; ++i)
+    {
+        std::u16string n;
+        for (char c : std::to_string(i))
+        {
+            n.push_back(static_cast<char16_t>(c));
+        }
+        Service& s = services[i];
+        s.instanceName = u"Wohnzimmer Lautsprecher \u00fc " + n;
+        s.id = s.instanceName + u"._daap._tcp.local";
+        s.host = u"192.168.1." + n;
+        s.port = u"3689";
+        SetField(s.fields, DnssdServiceFields::Id, s.id);
+        SetField(s.fields, DnssdServiceFields::InstanceName, s.instanceName);
+        SetField(s.fields, DnssdServiceFields::Host, s.host);
+        SetField(s.fields, DnssdServiceFields::Port, s.port);
+    }
+
+    const std::u16string ports[2] = { u"3689", u"3690" };
+
+    // before: every event converts all four strings
+    size_t allocations = gAllocations;
+    auto start = Clock::now();
+    for (size_t e = 0; e < events; ++e)
+    {
+        Service& s = services[e % serviceCount];
+        s.port = ports[(e / serviceCount) & 1];
+
+        std::string host = ToString(s.host);
+        std::string port = ToString(s.port);
+        std::string instanceName = ToString(s.instanceName);
+        std::string id = ToString(s.id);
+
+        DnssdServiceInfo info;
+        info.host = host.c_str();
+        info.port = port.c_str();
+        info.id = id.c_str();
+        info.instanceName = instanceName.c_str();
+        OnServiceChanged(nullptr, ServiceUpdated, &info);
+    }
+    Report("before", start, events, gAllocations - allocations);
+
+    // after: the port changed, only the port is converted into the block
+    allocations = gAllocations;
+    start = Clock::now();
+    for (size_t e = 0; e < events; ++e)
+    {
+        Service& s = services[e % serviceCount];
+        s.port = ports[(e / serviceCount) & 1];
+        SetField(s.fields, DnssdServiceFields::Port, s.port);
+
+        DnssdServiceInfo info;
+        s.fields.Fill(info);
+        OnServiceChanged(nullptr, ServiceUpdated, &info);
+    }
+    Report("after", start, events, gAllocations - allocations);
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Discovery at scale on an MdnsSimulatedNetwork: responders single-instance responders spread over types service
+// types register at once, while queriers query engines, each with a watcher per type, browse for all of them.
+// Everything runs in this process on virtual time, with the network's latency, jitter, loss and reordering.
+// Reports the virtual time until every responder is registered and until every watcher has found every instance
+// of its type, the packets and bytes on the network, and the real CPU time per instance. The run is made twice,
+// in two child processes with the same seed, and must come out the same packet for packet.
+//
+//     bench_simulated_network [responders] [types] [queriers] [loss %]
+
+#include "MdnsQueryEngine.h"
+#include "MdnsService.h"
+#include "MdnsServiceWatcher.h"
+#include "MdnsSimulatedNetwork.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint64_t kSeed = 20261017;
+static const auto kDeadline = std::chrono::seconds(300);   // virtual
+
+struct Result
+{
+    bool converged;
+    double registeredMs;            // virtual
+    double convergedMs;             // virtual
+    uint64_t renamed;
+    uint64_t packetsSent;
+    uint64_t bytesSent;
+    uint64_t packetsDelivered;
+    uint64_t packetsLost;
+    uint64_t packetsReordered;
+    double wallMs;
+    double cpuMs;
+};
+
+static size_t gTarget = 0;                                      // instances of each type
+static std::unordered_map<const void*, size_t> gFound;         // by watcher
+static size_t gComplete = 0;                                   // watchers that found all of their type
+static size_t gStarted = 0;
+static size_t gRenamed = 0;
+
+static void OnServiceChanged(const DnssdServiceWatcherPtr watcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr)
+{
+    if (update == ServiceAdded && ++gFound[watcher] == gTarget)
+    {
+        gComplete++;
+    }
+}
+
+static void OnServiceStarted(const DnssdServicePtr, DnssdServiceStartStatus status, DnssdErrorType error, const char*)
+{
+    gStarted += error == DNSSD_NO_ERROR ? 1 : 0;
+    gRenamed += status == ServiceStartedRenamed ? 1 : 0;
+}
+
+static double CpuMs()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+static Result Simulate(size_t responderCount, size_t typeCount, size_t querierCount, double loss)
+{
+    Result result = {};
+    MdnsSimulationConfig config;
+    config.seed = kSeed;
+    config.latency = std::chrono::milliseconds(1);
+    config.jitter = std::chrono::milliseconds(4);
+    config.loss = loss;
+    config.reorder = 0.05;
+    config.reorderDelay = std::chrono::milliseconds(20);
+    if (MdnsSimulatedNetwork::Install(config) != DNSSD_NO_ERROR)
+    {
+        return result;
+    }
+    MdnsSimulatedNetwork* network = MdnsSimulatedNetwork::GetInstalled();
+
+    std::vector<std::string> types(typeCount);
+    for (size_t t = 0; t < typeCount; ++t)
+    {
+        types[t] = "_sim" + std::to_string(t) + "._tcp";
+    }
+    gTarget = responderCount / typeCount;
+
+    double cpuStart = CpuMs();
+    auto wallStart = Clock::now();
+    MdnsClock::time_point start = MdnsClock::now();
+
+    // the queriers first, so that they hear the announcements
+    std::vector<std::shared_ptr<MdnsQueryEngine>> engines;
+    std::vector<std::unique_ptr<MdnsServiceWatcher>> watchers;
+    for (size_t q = 0; q < querierCount; ++q)
+    {
+        auto engine = std::make_shared<MdnsQueryEngine>();
+        if (engine->Start() != DNSSD_NO_ERROR)
+        {
+            return result;
+        }
+        for (size_t t = 0; t < typeCount; ++t)
+        {
+            std::unique_ptr<MdnsServiceWatcher> watcher(new MdnsServiceWatcher(types[t].c_str(), OnServiceChanged));
+            watcher->Initialize(engine);
+            watchers.push_back(std::move(watcher));
+        }
+        engines.push_back(engine);
+    }
+
+    std::vector<std::unique_ptr<MdnsService>> responders;
+    for (size_t r = 0; r < responderCount; ++r)
+    {
+        std::vector<MdnsServiceRegistration> registration = { MdnsServiceRegistration{ types[r % typeCount], "device " + std::to_string(r), std::to_string(40000 + r % 20000) } };
+        std::unique_ptr<MdnsService> responder(new MdnsService(registration));
+        if (responder->StartAsync(OnServiceStarted) != DNSSD_NO_ERROR)
+        {
+            return result;
+        }
+        responders.push_back(std::move(responder));
+    }
+
+    // the event loop moves virtual time along as fast as the work allows
+    bool registered = false;
+    while (gComplete < watchers.size() && MdnsClock::now() - start < kDeadline)
+    {
+        dnssd_run_events(1000);
+        if (!registered && gStarted == responderCount)
+        {
+            registered = true;
+            result.registeredMs = std::chrono::duration<double, std::milli>(MdnsClock::now() - start).count();
+        }
+    }
+
+    result.converged = gComplete == watchers.size();
+    result.convergedMs = std::chrono::duration<double, std::milli>(MdnsClock::now() - start).count();
+    result.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - wallStart).count();
+    result.cpuMs = CpuMs() - cpuStart;
+    result.renamed = gRenamed;
+
+    MdnsSimulationCounters counters = network->GetCounters();
+    result.packetsSent = counters.packetsSent;
+    result.bytesSent = counters.bytesSent;
+    result.packetsDelivered = counters.packetsDelivered;
+    result.packetsLost = counters.packetsLost;
+    result.packetsReordered = counters.packetsReordered;
+    return result;
+}
+
+// one run in a child process: the network, the clock and the event loop are set up once per process
+static bool RunChild(size_t responders, size_t types, size_t queriers, double loss, Result& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(fds[0]);
+        Result run = Simulate(responders, types, queriers, loss);
+        ssize_t written = write(fds[1], &run, sizeof(run));
+        _exit(written == sizeof(run) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = child > 0 ? read(fds[0], &result, sizeof(result)) : -1;
+    close(fds[0]);
+    int status = 0;
+    if (child > 0)
+    {
+        waitpid(child, &status, 0);
+    }
+    return n == sizeof(result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t responders = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t types = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+    const size_t queriers = argc > 3 ? strtoul(argv[3], nullptr, 10) : 5;
+    const double loss = argc > 4 ? strtod(argv[4], nullptr) / 100 : 0.01;
+    if (responders == 0 || types == 0 || responders % types != 0 || queriers == 0 || loss < 0 || loss >= 1)
+    {
+        fprintf(stderr, "usage: bench_simulated_network [responders] [types] [queriers] [loss %%]\n");
+        return 1;
+    }
+
+    Result first;
+    Result second;
+    if (!RunChild(responders, types, queriers, loss, first) || !RunChild(responders, types, queriers, loss, second))
+    {
+        fprintf(stderr, "Unable to run the simulation\n");
+        return 1;
+    }
+    bool same = first.converged == second.converged && first.registeredMs == second.registeredMs && first.convergedMs == second.convergedMs
+        && first.packetsSent == second.packetsSent && first.bytesSent == second.bytesSent && first.packetsDelivered == second.packetsDelivered
+        && first.packetsLost == second.packetsLost;
+
+    printf("responders %zu responders\n", responders);
+    printf("types %zu types\n", types);
+    printf("queriers %zu queriers\n", queriers);
+    printf("loss %.1f %%\n", loss * 100);
+    printf("all_registered_virtual_ms %.0f ms\n", first.registeredMs);
+    printf("converged_virtual_ms %.0f ms\n", first.convergedMs);
+    printf("instances_renamed %llu instances\n", static_cast<unsigned long long>(first.renamed));
+    printf("packets_sent %llu packets\n", static_cast<unsigned long long>(first.packetsSent));
+    printf("packets_sent_per_instance %.2f packets\n", double(first.packetsSent) / responders);
+    printf("bytes_sent %llu bytes\n", static_cast<unsigned long long>(first.bytesSent));
+    printf("packets_delivered %llu packets\n", static_cast<unsigned long long>(first.packetsDelivered));
+    printf("packets_lost %llu packets\n", static_cast<unsigned long long>(first.packetsLost));
+    printf("packets_reordered %llu packets\n", static_cast<unsigned long long>(first.packetsReordered));
+    printf("cpu_ms_per_instance %.3f ms\n", first.cpuMs / responders);
+    printf("wall_ms %.0f ms\n", first.wallMs);
+    printf("virtual_time_speedup %.1f x\n", first.convergedMs / first.wallMs);
+    printf("reproducible %s\n", same ? "yes" : "no");
+
+    if (!first.converged || !second.converged || !same || first.renamed != 0)
+    {
+        fprintf(stderr, "simulation error: %s, %s, %llu instances renamed\n", first.converged && second.converged ? "converged" : "not converged",
+            same ? "reproducible" : "not reproducible", static_cast<unsigned long long>(first.renamed));
+        return 1;
+    }
+    return 0;
+}
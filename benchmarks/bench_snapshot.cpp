@@ -0,0 +1,202 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Cost of reading a watcher's service table from several threads while the discovery thread keeps
+// publishing new ones. DnssdSnapshotPublisher (acquire and release a snapshot) against the usual
+// alternative: a std::mutex around a std::shared_ptr to the current table. The writer publishes a
+// 500 service table every millisecond; every reader checks that each table it gets is consistent.
+//
+//     bench_snapshot [seconds per run] [max reader threads]
+
+#include "DnssdServiceSnapshot.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kServices = 500;
+static const std::chrono::milliseconds kPublishInterval(1);
+
+// a table where every service carries the same port, so a torn read shows up as a mismatch
+static std::vector<DnssdServiceFields> MakeTable(unsigned generation)
+{
+    std::vector<DnssdServiceFields> table(kServices);
+    std::string port = std::to_string(1024 + generation % 60000);
+    for (size_t i = 0; i < kServices; ++i)
+    {
+        std::string instance = "Music Library " + std::to_string(i);
+        table[i].Set(DnssdServiceFields::Id, instance + "._daap._tcp.local");
+        table[i].Set(DnssdServiceFields::InstanceName, instance);
+        table[i].Set(DnssdServiceFields::Host, "10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256));
+        table[i].Set(DnssdServiceFields::Port, port);
+    }
+    return table;
+}
+
+static bool IsConsistent(size_t count, const DnssdServiceInfo* services)
+{
+    return count == kServices && strcmp(services[0].port, services[count - 1].port) == 0;
+}
+
+struct Result
+{
+    double nsPerRead;
+    double readsPerSecond;
+    size_t errors;
+};
+
+template <typename Publish, typename Read>
+static Result Run(unsigned readers, double seconds, Publish publish, Read read)
+{
+    std::atomic<bool> running(true);
+    std::atomic<size_t> reads(0);
+    std::atomic<size_t> errors(0);
+
+    publish(0);
+    std::thread writer([&]
+    {
+        unsigned generation = 0;
+        while (running)
+        {
+            publish(++generation);
+            std::this_thread::sleep_for(kPublishInterval);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (unsigned r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&]
+        {
+            size_t n = 0;
+            size_t bad = 0;
+            while (running)
+            {
+                bad += read() ? 0 : 1;
+                n++;
+            }
+            reads += n;
+            errors += bad;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    writer.join();
+
+    Result result;
+    result.readsPerSecond = reads / elapsed;
+    result.nsPerRead = elapsed * 1e9 * readers / std::max<size_t>(reads, 1);
+    result.errors = errors;
+    return result;
+}
+
+static void Report(const char* name, unsigned readers, const Result& result)
+{
+    printf("%s_read_ns_%ut %.1f ns\n", name, readers, result.nsPerRead);
+    printf("%s_reads_per_s_%ut %.0f reads/s\n", name, readers, result.readsPerSecond);
+}
+
+int main(int argc, char* argv[])
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    unsigned maxReaders = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : std::max(4u, std::thread::hardware_concurrency());
+    if (seconds <= 0 || maxReaders == 0)
+    {
+        fprintf(stderr, "usage: bench_snapshot [seconds per run] [max reader threads]\n");
+        return 1;
+    }
+
+    // tables are built up front so both variants publish at the same cost
+    std::vector<std::vector<DnssdServiceFields>> tables;
+    for (unsigned g = 0; g < 16; ++g)
+    {
+        tables.push_back(MakeTable(g));
+    }
+
+    size_t errors = 0;
+    for (unsigned readers = 1; readers <= maxReaders; readers *= 2)
+    {
+        Result rcu;
+        {
+            DnssdSnapshotPublisher publisher;
+            rcu = Run(readers, seconds, [&](unsigned generation)
+            {
+                DnssdSnapshot* snapshot = new DnssdSnapshot();
+                for (const auto& fields : tables[generation % tables.size()])
+                {
+                    snapshot->Add(fields);
+                }
+                snapshot->Seal();
+                publisher.Publish(snapshot);
+            },
+            [&]
+            {
+                const DnssdServiceSnapshot* snapshot = publisher.Acquire();
+                bool ok = snapshot != nullptr && IsConsistent(snapshot->count, snapshot->services);
+                DnssdSnapshotPublisher::Release(snapshot);
+                return ok;
+            });
+        }
+        Report("snapshot", readers, rcu);
+
+        typedef std::vector<DnssdServiceInfo> Table;
+        std::mutex lock;
+        std::shared_ptr<const Table> current;
+        Result locked = Run(readers, seconds, [&](unsigned generation)
+        {
+            const auto& fields = tables[generation % tables.size()];
+            std::shared_ptr<Table> table = std::make_shared<Table>(fields.size());
+            for (size_t i = 0; i < fields.size(); ++i)
+            {
+                fields[i].Fill((*table)[i]);
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            current = table;
+        },
+        [&]
+        {
+            std::shared_ptr<const Table> table;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                table = current;
+            }
+            return table && IsConsistent(table->size(), table->data());
+        });
+        Report("mutex", readers, locked);
+
+        errors += rcu.errors + locked.errors;
+    }
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "snapshot error: %zu inconsistent reads\n", errors);
+        return 1;
+    }
+    return 0;
+}
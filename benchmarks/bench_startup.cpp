@@ -0,0 +1,168 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Time an application's startup thread spends creating a service and a service watcher, with the blocking
+// dnssd_create_service / dnssd_create_service_watcher and with their _async variants, and how long the
+// asynchronous ones take to report through their started callbacks. Only uses the dnssd.h C API.
+//
+//     bench_startup [iterations]
+
+#include "dnssd.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdstartup._tcp";
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static bool gStarted = false;
+static DnssdErrorType gError = DNSSD_NO_ERROR;
+static Clock::time_point gStartedAt;
+
+static void dnssdServiceStartedCallback(const DnssdServicePtr service, DnssdServiceStartStatus status, DnssdErrorType error, const char* instanceName)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gStarted = true;
+    gError = status == ServiceStartFailed ? error : DNSSD_NO_ERROR;
+    gStartedAt = Clock::now();
+    gCondition.notify_all();
+}
+
+static void dnssdServiceWatcherStartedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdErrorType error)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gStarted = true;
+    gError = error;
+    gStartedAt = Clock::now();
+    gCondition.notify_all();
+}
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+}
+
+static void resetStarted()
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gStarted = false;
+}
+
+// time the started callback ran, or time_point::max() on timeout or error
+static Clock::time_point waitForStarted()
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    if (!gCondition.wait_for(lock, std::chrono::seconds(10), [] { return gStarted; }) || gError != DNSSD_NO_ERROR)
+    {
+        return Clock::time_point::max();
+    }
+    return gStartedAt;
+}
+
+static double elapsedMs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 3;
+    if (iterations <= 0)
+    {
+        fprintf(stderr, "usage: bench_startup [iterations]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    double service[3] = { 0, 0, 0 };    // blocking call, asynchronous call, asynchronous call to started callback
+    double watcher[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::string port = std::to_string(41000 + i);
+
+        // every watcher is freed before the next one is created, so each starts the shared query engine again
+        DnssdServiceWatcherPtr w = nullptr;
+        auto start = Clock::now();
+        if (dnssd_create_service_watcher(kServiceName, dnssdServiceChangedCallback, &w) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+            return 1;
+        }
+        watcher[0] += elapsedMs(start, Clock::now());
+        dnssd_free_service_watcher(w);
+
+        resetStarted();
+        start = Clock::now();
+        if (dnssd_create_service_watcher_async(kServiceName, dnssdServiceChangedCallback, dnssdServiceWatcherStartedCallback, &w) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+            return 1;
+        }
+        watcher[1] += elapsedMs(start, Clock::now());
+        Clock::time_point started = waitForStarted();
+        if (started == Clock::time_point::max())
+        {
+            fprintf(stderr, "dnssd service watcher did not start\n");
+            return 1;
+        }
+        watcher[2] += elapsedMs(start, started);
+        dnssd_free_service_watcher(w);
+
+        DnssdServicePtr s = nullptr;
+        start = Clock::now();
+        if (dnssd_create_service(kServiceName, port.c_str(), &s) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        service[0] += elapsedMs(start, Clock::now());
+        dnssd_free_service(s);
+
+        resetStarted();
+        start = Clock::now();
+        if (dnssd_create_service_async(kServiceName, port.c_str(), dnssdServiceStartedCallback, &s) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        service[1] += elapsedMs(start, Clock::now());
+        started = waitForStarted();
+        if (started == Clock::time_point::max())
+        {
+            fprintf(stderr, "dnssd service did not start\n");
+            return 1;
+        }
+        service[2] += elapsedMs(start, started);
+        dnssd_free_service(s);
+    }
+
+    printf("service_blocking_call_ms %.3f ms\n", service[0] / iterations);
+    printf("service_async_call_ms %.3f ms\n", service[1] / iterations);
+    printf("service_async_started_ms %.3f ms\n", service[2] / iterations);
+    printf("watcher_blocking_call_ms %.3f ms\n", watcher[0] / iterations);
+    printf("watcher_async_call_ms %.3f ms\n", watcher[1] / iterations);
+    printf("watcher_async_started_ms %.3f ms\n", watcher[2] / iterations);
+    return 0;
+}
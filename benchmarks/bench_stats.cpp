@@ -0,0 +1,144 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// What it costs to count for dnssd_get_stats. Each thread counts into its own MdnsThreadStats with a relaxed load
+// and store: the cost of a counter and of a latency histogram sample is measured on one thread, then the CPU time
+// per count of threads threads counting at once, against one std::atomic counter shared by all of them. The threads then exit and
+// dnssd_get_stats must still have every count and every sample.
+//
+//     bench_stats [threads] [million counts per thread]
+
+#include "dnssd.h"
+#include "MdnsStats.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static std::atomic<uint64_t> gShared(0);
+
+static double nsPerCount(Clock::time_point start, uint64_t counts)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / counts;
+}
+
+static double threadCpuNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// CPU ns per count of each thread, with threads threads running count at once
+template <typename F>
+static double runThreads(size_t threads, uint64_t counts, F count)
+{
+    std::vector<std::thread> running;
+    std::vector<double> cpuNs(threads);
+    for (size_t t = 0; t < threads; ++t)
+    {
+        running.emplace_back([&, t]
+        {
+            double start = threadCpuNs();
+            count(counts);
+            cpuNs[t] = threadCpuNs() - start;
+        });
+    }
+    double total = 0;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        running[t].join();
+        total += cpuNs[t];
+    }
+    return total / (counts * threads);
+}
+
+static void countPackets(uint64_t counts)
+{
+    for (uint64_t i = 0; i < counts; ++i)
+    {
+        MdnsCount(MdnsStatPacketsSent);
+    }
+}
+
+static void countShared(uint64_t counts)
+{
+    for (uint64_t i = 0; i < counts; ++i)
+    {
+        gShared.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+    const uint64_t counts = (argc > 2 ? strtoull(argv[2], nullptr, 10) : 20) * 1000000;
+    if (threads == 0 || counts == 0)
+    {
+        fprintf(stderr, "usage: bench_stats [threads] [million counts per thread]\n");
+        return 1;
+    }
+
+    auto start = Clock::now();
+    countPackets(counts);
+    double countNs = nsPerCount(start, counts);
+
+    // latencies of 1 us to about 4 ms, spread over the buckets
+    const uint64_t samples = counts / 10;
+    start = Clock::now();
+    for (uint64_t i = 0; i < samples; ++i)
+    {
+        MdnsThreadStats::Get().receiveToCallback.Record(1 + (i * 2654435761u) % 4096);
+    }
+    double sampleNs = nsPerCount(start, samples);
+
+    double threadedNs = runThreads(threads, counts, countPackets);
+    double sharedNs = runThreads(threads, counts, countShared);
+
+    DnssdStats stats;
+    stats.size = sizeof(stats);
+    if (dnssd_get_stats(&stats) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to get the stats\n");
+        return 1;
+    }
+    uint64_t expected = counts * (threads + 1);
+
+    printf("count_ns %.2f ns\n", countNs);
+    printf("histogram_sample_ns %.2f ns\n", sampleNs);
+    printf("threads %zu threads\n", threads);
+    printf("threaded_count_cpu_ns %.2f ns\n", threadedNs);
+    printf("shared_atomic_count_cpu_ns %.2f ns\n", sharedNs);
+    printf("packets_sent_counted %llu counts\n", static_cast<unsigned long long>(stats.packetsSent));
+    printf("samples_counted %llu samples\n", static_cast<unsigned long long>(stats.receiveToCallback.count));
+    printf("sample_p50 %llu us\n", static_cast<unsigned long long>(stats.receiveToCallback.p50));
+    printf("sample_p99 %llu us\n", static_cast<unsigned long long>(stats.receiveToCallback.p99));
+
+    // uniform over 1..4096: the percentiles are known, to within a bucket
+    bool percentiles = stats.receiveToCallback.p50 >= 1980 && stats.receiveToCallback.p50 <= 2180
+        && stats.receiveToCallback.p99 >= 3930 && stats.receiveToCallback.p99 <= 4180 && stats.receiveToCallback.max == 4096;
+    if (stats.packetsSent != expected || stats.receiveToCallback.count != samples || !percentiles)
+    {
+        fprintf(stderr, "stats error: %llu of %llu counts, %llu of %llu samples, percentiles %s\n", static_cast<unsigned long long>(stats.packetsSent),
+            static_cast<unsigned long long>(expected), static_cast<unsigned long long>(stats.receiveToCallback.count),
+            static_cast<unsigned long long>(samples), percentiles ? "right" : "wrong");
+        return 1;
+    }
+    return 0;
+}
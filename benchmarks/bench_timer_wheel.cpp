@@ -0,0 +1,207 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Cost per timer of MdnsTimerWheel with 10k, 100k and 1M outstanding timers, against a std::multimap
+// ordered by deadline. Deadlines are spread over 1 s to 75 minutes like cache record TTLs and
+// time is virtual, so the numbers are the data structure cost only.
+//
+//     bench_timer_wheel [max timers]
+
+#include "MdnsTimerWheel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const std::chrono::milliseconds kMinDeadline(1000);
+static const std::chrono::milliseconds kMaxDeadline(4500 * 1000);
+
+static double NsPer(Clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+}
+
+struct BenchTimer
+{
+    MdnsTimer timer;
+    MdnsClock::time_point deadline;
+};
+
+static bool BenchWheel(size_t count, std::mt19937& random)
+{
+    std::uniform_int_distribution<int64_t> spread(kMinDeadline.count(), kMaxDeadline.count());
+    MdnsClock::time_point origin = MdnsClock::now();
+    MdnsTimerWheel wheel(origin);
+
+    MdnsClock::time_point now = origin;
+    MdnsClock::time_point previous = origin;
+    size_t fired = 0;
+    size_t early = 0;
+    size_t late = 0;
+
+    std::vector<std::unique_ptr<BenchTimer>> timers(count);
+    for (auto& t : timers)
+    {
+        t.reset(new BenchTimer());
+        BenchTimer* p = t.get();
+        p->timer.SetCallback([&, p]
+        {
+            fired++;
+            early += now < p->deadline;
+            late += p->deadline + std::chrono::milliseconds(1) <= previous;
+        });
+    }
+
+    std::vector<MdnsClock::time_point> deadlines(count);
+    for (auto& d : deadlines)
+    {
+        d = origin + std::chrono::milliseconds(spread(random));
+    }
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        timers[i]->deadline = deadlines[i];
+        wheel.Schedule(timers[i]->timer, deadlines[i]);
+    }
+    double schedule = NsPer(start, count);
+
+    // refreshed records: every timer moves to a new deadline
+    for (auto& d : deadlines)
+    {
+        d = origin + std::chrono::milliseconds(spread(random));
+    }
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        timers[i]->deadline = deadlines[i];
+        wheel.Schedule(timers[i]->timer, deadlines[i]);
+    }
+    double reschedule = NsPer(start, count);
+
+    // removed records: every other timer is cancelled
+    start = Clock::now();
+    for (size_t i = 0; i < count; i += 2)
+    {
+        wheel.Cancel(timers[i]->timer);
+    }
+    double cancel = NsPer(start, (count + 1) / 2);
+    size_t remaining = wheel.Size();
+
+    // run until everything has fired, sleeping until the next deadline like the watcher and responder loops
+    size_t steps = 0;
+    start = Clock::now();
+    while (wheel.Size() > 0)
+    {
+        previous = now;
+        now = wheel.NextDeadline();
+        wheel.Advance(now);
+        steps++;
+    }
+    double expire = NsPer(start, remaining);
+
+    printf("wheel_schedule_ns_%zu %.1f ns\n", count, schedule);
+    printf("wheel_reschedule_ns_%zu %.1f ns\n", count, reschedule);
+    printf("wheel_cancel_ns_%zu %.1f ns\n", count, cancel);
+    printf("wheel_expire_ns_%zu %.1f ns\n", count, expire);
+    printf("wheel_advance_steps_%zu %zu steps\n", count, steps);
+
+    if (fired != remaining || early != 0 || late != 0)
+    {
+        fprintf(stderr, "timer wheel error: fired %zu of %zu, %zu early, %zu late\n", fired, remaining, early, late);
+        return false;
+    }
+    return true;
+}
+
+static void BenchMultimap(size_t count, std::mt19937& random)
+{
+    typedef std::multimap<MdnsClock::time_point, size_t> TimerMap;
+    std::uniform_int_distribution<int64_t> spread(kMinDeadline.count(), kMaxDeadline.count());
+    MdnsClock::time_point origin = MdnsClock::now();
+
+    TimerMap timers;
+    std::vector<TimerMap::iterator> handles(count);
+    std::vector<MdnsClock::time_point> deadlines(count);
+    for (auto& d : deadlines)
+    {
+        d = origin + std::chrono::milliseconds(spread(random));
+    }
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        handles[i] = timers.emplace(deadlines[i], i);
+    }
+    double schedule = NsPer(start, count);
+
+    for (auto& d : deadlines)
+    {
+        d = origin + std::chrono::milliseconds(spread(random));
+    }
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        timers.erase(handles[i]);
+        handles[i] = timers.emplace(deadlines[i], i);
+    }
+    double reschedule = NsPer(start, count);
+
+    start = Clock::now();
+    for (size_t i = 0; i < count; i += 2)
+    {
+        timers.erase(handles[i]);
+    }
+    double cancel = NsPer(start, (count + 1) / 2);
+    size_t remaining = timers.size();
+
+    volatile size_t fired = 0;
+    start = Clock::now();
+    while (!timers.empty())
+    {
+        MdnsClock::time_point now = timers.begin()->first;
+        while (!timers.empty() && timers.begin()->first <= now)
+        {
+            fired = fired + timers.begin()->second;
+            timers.erase(timers.begin());
+        }
+    }
+    double expire = NsPer(start, remaining);
+
+    printf("multimap_schedule_ns_%zu %.1f ns\n", count, schedule);
+    printf("multimap_reschedule_ns_%zu %.1f ns\n", count, reschedule);
+    printf("multimap_cancel_ns_%zu %.1f ns\n", count, cancel);
+    printf("multimap_expire_ns_%zu %.1f ns\n", count, expire);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t maxTimers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    std::mt19937 random(5353);
+
+    for (size_t count = 10000; count <= maxTimers; count *= 10)
+    {
+        if (!BenchWheel(count, random))
+        {
+            return 1;
+        }
+        BenchMultimap(count, random);
+    }
+    return 0;
+}
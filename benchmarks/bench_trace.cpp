@@ -0,0 +1,152 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// The trace points, in a library built with -DDNSSD_TRACING=ON. A watcher finds instances instances registered over
+// loopback, with the event loop on its library thread, then dnssd_write_trace writes what every thread recorded as
+// Chrome trace event JSON to path (open it in chrome://tracing or ui.perfetto.dev). Reports the spans written for
+// each stage between a packet and its callback, all of which must be there. Without tracing built in,
+// dnssd_write_trace must refuse, and there is nothing else to check.
+//
+//     bench_trace [instances] [path]
+
+#include "dnssd.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdtrace._tcp";
+
+// the way from a packet to its callback, and back out to the network
+static const char* kStages[] = { "receive batch", "packet waiting", "packet", "parse", "insert", "update services", "report change",
+    "send query", "send probes", "send announcements", "send batch", "fire", "client readable", "client due" };
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static size_t gAdded = 0;
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gAdded += update == ServiceAdded ? 1 : 0;
+    gCondition.notify_all();
+}
+
+// occurrences of a span name in the JSON
+static size_t countSpans(const std::string& json, const char* name)
+{
+    std::string key = std::string("\"name\": \"") + name + "\"";
+    size_t count = 0;
+    for (size_t at = json.find(key); at != std::string::npos; at = json.find(key, at + key.size()))
+    {
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t instances = argc > 1 ? strtoul(argv[1], nullptr, 10) : 50;
+    const char* path = argc > 2 ? argv[2] : "dnssd_trace.json";
+    if (instances == 0)
+    {
+        fprintf(stderr, "usage: bench_trace [instances] [path]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    DnssdServiceWatcherPtr watcher = nullptr;
+    if (dnssd_create_service_watcher(kServiceName, dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    std::vector<std::string> names(instances);
+    std::vector<DnssdServiceRegistration> registrations(instances);
+    for (size_t i = 0; i < instances; ++i)
+    {
+        names[i] = "traced " + std::to_string(i);
+        registrations[i] = { kServiceName, names[i].c_str(), "42500" };
+    }
+    DnssdServicePtr service = nullptr;
+    if (dnssd_register_services(registrations.data(), instances, &service) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service\n");
+        return 1;
+    }
+
+    bool found;
+    {
+        std::unique_lock<std::mutex> lock(gMutex);
+        found = gCondition.wait_for(lock, std::chrono::seconds(10), [&] { return gAdded >= instances; });
+    }
+
+    auto start = Clock::now();
+    DnssdErrorType written = dnssd_write_trace(path);
+    double writeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    dnssd_free_service(service);
+    dnssd_free_service_watcher(watcher);
+
+    if (!found)
+    {
+        fprintf(stderr, "timed out waiting for ServiceAdded\n");
+        return 1;
+    }
+    if (written != DNSSD_NO_ERROR)
+    {
+        // nothing to trace: the trace points are not compiled in
+        printf("trace_enabled no\n");
+        return written == DNSSD_UNSPECIFIED_ERROR ? 0 : 1;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    bool complete = json.compare(0, 17, "{\"displayTimeUnit") == 0 && json.size() > 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0;
+
+    printf("trace_enabled yes\n");
+    printf("trace_bytes %zu bytes\n", json.size());
+    printf("trace_write_ms %.3f ms\n", writeMs);
+    size_t missing = 0;
+    for (const char* stage : kStages)
+    {
+        size_t spans = countSpans(json, stage);
+        std::string name = stage;
+        std::replace(name.begin(), name.end(), ' ', '_');
+        printf("spans_%s %zu spans\n", name.c_str(), spans);
+        missing += spans == 0 ? 1 : 0;
+    }
+
+    if (!complete || missing != 0)
+    {
+        fprintf(stderr, "trace error: %s, %zu stages missing\n", complete ? "complete" : "incomplete", missing);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Time for a change of a registered service's TXT data or port to reach a watcher: dnssd_service_update, which
+// announces the changed record once, against freeing the service and creating it again with the new data, which
+// probes and announces from scratch and shows up as a removal and an addition. Only uses the dnssd.h C API.
+//
+//     bench_update [updates]
+
+#include "dnssd.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdupdate._tcp";
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static size_t gAdded = 0;
+static size_t gUpdated = 0;
+static size_t gRemoved = 0;
+static std::string gVersion;    // the "v" TXT value last seen
+static std::string gPort;       // the port last seen
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    const char* value = nullptr;
+    size_t length = 0;
+    if (update != ServiceRemoved)
+    {
+        gVersion = dnssd_txt_get(info->txt, "v", &value, &length) ? std::string(value, length) : std::string();
+        gPort = info->port;
+    }
+    gAdded += update == ServiceAdded ? 1 : 0;
+    gUpdated += update == ServiceUpdated ? 1 : 0;
+    gRemoved += update == ServiceRemoved ? 1 : 0;
+    gCondition.notify_all();
+}
+
+// until the watcher reports this TXT version and port
+static bool waitFor(const std::string& version, const std::string& port)
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    return gCondition.wait_for(lock, std::chrono::seconds(10), [&] { return gVersion == version && gPort == port; });
+}
+
+static double elapsedMs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t updates = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20;
+    if (updates == 0)
+    {
+        fprintf(stderr, "usage: bench_update [updates]\n");
+        return 1;
+    }
+
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd\n");
+        return 1;
+    }
+
+    DnssdServiceWatcherPtr watcher = nullptr;
+    if (dnssd_create_service_watcher(kServiceName, dnssdServiceChangedCallback, &watcher) != DNSSD_NO_ERROR)
+    {
+        fprintf(stderr, "Unable to initialize dnssd service watcher\n");
+        return 1;
+    }
+
+    DnssdServicePtr service = nullptr;
+    if (dnssd_create_service(kServiceName, "42100", &service) != DNSSD_NO_ERROR || !waitFor("", "42100"))
+    {
+        fprintf(stderr, "Unable to initialize dnssd service\n");
+        return 1;
+    }
+
+    // in place: a new TXT version every time, a new port every other time
+    double updateMs = 0;
+    double updateMaxMs = 0;
+    size_t seen = 0;
+    std::string port = "42100";
+    for (size_t i = 0; i < updates; ++i)
+    {
+        std::string version = std::to_string(i + 1);
+        DnssdTxtEntry txt[2] = { { "v", version.data(), version.size() }, { "path", "/bench", 6 } };
+        port = i % 2 ? std::to_string(42100 + i) : port;
+        auto start = Clock::now();
+        if (dnssd_service_update(service, 0, port.c_str(), txt, 2) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to update dnssd service\n");
+            return 1;
+        }
+        if (waitFor(version, port))
+        {
+            double ms = elapsedMs(start, Clock::now());
+            updateMs += ms;
+            updateMaxMs = ms > updateMaxMs ? ms : updateMaxMs;
+            seen++;
+        }
+    }
+    size_t updateEvents;
+    size_t updateRemovals;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        updateEvents = gUpdated;
+        updateRemovals = gRemoved;
+    }
+
+    // what it took before: free the service and register it again with the new port
+    double reregisterMs = 0;
+    size_t reregistered = 0;
+    const size_t cycles = updates < 3 ? updates : 3;
+    for (size_t i = 0; i < cycles; ++i)
+    {
+        port = std::to_string(42200 + i);
+        auto start = Clock::now();
+        dnssd_free_service(service);
+        service = nullptr;
+        if (dnssd_create_service(kServiceName, port.c_str(), &service) != DNSSD_NO_ERROR)
+        {
+            fprintf(stderr, "Unable to initialize dnssd service\n");
+            return 1;
+        }
+        if (waitFor("", port))
+        {
+            reregisterMs += elapsedMs(start, Clock::now());
+            reregistered++;
+        }
+    }
+    size_t reregisterEvents;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        reregisterEvents = gAdded - 1 + gRemoved - updateRemovals + gUpdated - updateEvents;
+    }
+
+    printf("update_to_updated_ms %.3f ms\n", seen ? updateMs / seen : 0.0);
+    printf("update_to_updated_max_ms %.3f ms\n", updateMaxMs);
+    printf("update_events_per_change %.2f events\n", double(updateEvents) / updates);
+    printf("reregister_to_added_ms %.3f ms\n", reregistered ? reregisterMs / reregistered : 0.0);
+    printf("reregister_events_per_change %.2f events\n", cycles ? double(reregisterEvents) / cycles : 0.0);
+
+    dnssd_free_service(service);
+    dnssd_free_service_watcher(watcher);
+
+    if (seen != updates || updateRemovals != 0 || reregistered != cycles)
+    {
+        fprintf(stderr, "update error: %zu of %zu updates seen, %zu removals\n", seen, updates, updateRemovals);
+        return 1;
+    }
+    return 0;
+}
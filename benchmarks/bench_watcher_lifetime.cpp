@@ -0,0 +1,216 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Freeing a watcher from inside its own callback, which the query engine allows for the last watcher of an engine
+// too: a DnssdServiceChangedCallback and a batched DnssdServiceChangesCallback each free their watcher when the
+// first instance registered over loopback shows up. In the "exit" case the callback then keeps its reactor call
+// going until the application has returned from main and the process is exiting, so that the engine is released
+// last by the loop thread while the static destructors run. Each case runs in a child process that exits normally,
+// so a crash, or an abort while the process exits, shows up as its exit status. Reports how long
+// dnssd_free_service_watcher takes inside the callback.
+//
+//     bench_watcher_lifetime [instances]
+
+#include "dnssd.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace dnssd_uwp;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* kServiceName = "_dnssdlifetime._tcp";
+
+enum Case { FreedByCallback, FreedByBatchedCallback, ExitDuringCall, CaseCount };
+
+static const char* kCaseNames[CaseCount] = { "single", "batched", "exit" };
+
+static std::mutex gMutex;
+static std::condition_variable gCondition;
+static Case gCase = FreedByCallback;
+static bool gFreed = false;
+static double gFreeUs = 0;
+static bool gExiting = false;
+
+// Destroyed with the statics, after main has returned: tells a callback still running that the process is
+// exiting, and gives it time to end its call. Declared after gMutex and gCondition, which outlive it
+static struct ExitWatch
+{
+    ~ExitWatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(gMutex);
+            if (gCase != ExitDuringCall || !gFreed)
+            {
+                return;
+            }
+            gExiting = true;
+        }
+        gCondition.notify_all();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+} gExitWatch;
+
+// frees the watcher once, from its own callback
+static void freeWatcher(DnssdServiceWatcherPtr serviceWatcher)
+{
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (gFreed)
+        {
+            return;
+        }
+    }
+
+    auto start = Clock::now();
+    dnssd_free_service_watcher(serviceWatcher);
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    std::unique_lock<std::mutex> lock(gMutex);
+    gFreed = true;
+    gFreeUs = us;
+    gCondition.notify_all();
+
+    if (gCase == ExitDuringCall)
+    {
+        // the engine is only held by the reactor call this callback runs in: keep it going while the process exits
+        gCondition.wait_for(lock, std::chrono::seconds(5), [] { return gExiting; });
+    }
+}
+
+static void dnssdServiceChangedCallback(const DnssdServiceWatcherPtr serviceWatcher, DnssdServiceUpdateType update, DnssdServiceInfoPtr info)
+{
+    if (update == ServiceAdded)
+    {
+        freeWatcher(serviceWatcher);
+    }
+}
+
+static void dnssdServiceChangesCallback(const DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceChange* changes, size_t count)
+{
+    freeWatcher(serviceWatcher);
+}
+
+// in the child: 0 once the watcher freed itself and everything else was freed
+static int runCase(Case run, size_t instances, double& freeUs)
+{
+    gCase = run;
+    if (dnssd_initialize() != DNSSD_NO_ERROR)
+    {
+        return 1;
+    }
+
+    DnssdServiceWatcherPtr watcher = nullptr;
+    DnssdErrorType created = run == FreedByBatchedCallback
+        ? dnssd_create_service_watcher_batched(kServiceName, dnssdServiceChangesCallback, &watcher)
+        : dnssd_create_service_watcher(kServiceName, dnssdServiceChangedCallback, &watcher);
+    if (created != DNSSD_NO_ERROR)
+    {
+        return 1;
+    }
+
+    std::vector<std::string> names(instances);
+    std::vector<DnssdServiceRegistration> registrations(instances);
+    for (size_t i = 0; i < instances; ++i)
+    {
+        names[i] = "lifetime " + std::to_string(i);
+        registrations[i] = { kServiceName, names[i].c_str(), "42600" };
+    }
+    DnssdServicePtr service = nullptr;
+    if (dnssd_register_services(registrations.data(), instances, &service) != DNSSD_NO_ERROR)
+    {
+        return 1;
+    }
+
+    bool freed;
+    {
+        std::unique_lock<std::mutex> lock(gMutex);
+        freed = gCondition.wait_for(lock, std::chrono::seconds(10), [] { return gFreed; });
+        freeUs = gFreeUs;
+    }
+
+    // the rest of the pass the watcher was freed in, and the packets still coming in for it
+    if (run != ExitDuringCall)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    dnssd_free_service(service);
+    return freed ? 0 : 1;
+}
+
+// runs a case in a child process, which exits through the static destructors like any application
+static bool runChild(Case run, size_t instances, double& freeUs)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    // the child exits through exit(): it must not write what is buffered here a second time
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(fds[0]);
+        double us = 0;
+        int result = runCase(run, instances, us);
+        ssize_t written = write(fds[1], &us, sizeof(us));
+        close(fds[1]);
+        exit(written == sizeof(us) ? result : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = child > 0 ? read(fds[0], &freeUs, sizeof(freeUs)) : -1;
+    close(fds[0]);
+    int status = 0;
+    if (child > 0)
+    {
+        waitpid(child, &status, 0);
+    }
+    return n == sizeof(freeUs) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t instances = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20;
+    if (instances == 0)
+    {
+        fprintf(stderr, "usage: bench_watcher_lifetime [instances]\n");
+        return 1;
+    }
+
+    size_t failed = 0;
+    for (int run = 0; run < CaseCount; ++run)
+    {
+        double freeUs = 0;
+        bool ok = runChild(static_cast<Case>(run), instances, freeUs);
+        printf("%s_free_in_callback_us %.1f us\n", kCaseNames[run], freeUs);
+        printf("%s_ok %s\n", kCaseNames[run], ok ? "yes" : "no");
+        failed += ok ? 0 : 1;
+    }
+
+    if (failed != 0)
+    {
+        fprintf(stderr, "lifetime error: %zu of %d cases failed\n", failed, static_cast<int>(CaseCount));
+        return 1;
+    }
+    return 0;
+}
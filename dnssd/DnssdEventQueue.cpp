@@ -0,0 +1,181 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DnssdEventQueue.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace dnssd_uwp
+{
+    static const size_t kDefaultCapacity = 1024;
+
+    DnssdEventQueue::DnssdEventQueue(size_t capacity)
+        : mEnqueue(0)
+        , mDequeue(0)
+        , mHeld(0)
+        , mSignaled(false)
+        , mDropped(0)
+    {
+        // a power of two so positions map to slots with a mask
+        size_t size = 2;
+        while (size < (capacity ? capacity : kDefaultCapacity))
+        {
+            size <<= 1;
+        }
+        mSlots.reset(new Slot[size]);
+        mMask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+        {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+            mSlots[i].update = ServiceAdded;
+        }
+
+#if defined(_WIN32)
+        mWaitHandle = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#else
+        mWaitHandle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    }
+
+    DnssdEventQueue::~DnssdEventQueue()
+    {
+#if defined(_WIN32)
+        if (mWaitHandle != nullptr)
+        {
+            CloseHandle(mWaitHandle);
+        }
+#else
+        if (mWaitHandle >= 0)
+        {
+            close(mWaitHandle);
+        }
+#endif
+    }
+
+    bool DnssdEventQueue::IsValid() const
+    {
+#if defined(_WIN32)
+        return mWaitHandle != nullptr;
+#else
+        return mWaitHandle >= 0;
+#endif
+    }
+
+    void DnssdEventQueue::Signal()
+    {
+        // only the first push after a drain pays for the system call
+        if (mSignaled.exchange(true))
+        {
+            return;
+        }
+#if defined(_WIN32)
+        SetEvent(mWaitHandle);
+#else
+        uint64_t one = 1;
+        (void)write(mWaitHandle, &one, sizeof(one));
+#endif
+    }
+
+    void DnssdEventQueue::ClearSignal()
+    {
+        // the handle first: a push between the two then either finds mSignaled still set and its event is seen by
+        // the scan that follows, or finds it clear and signals the handle again. The other way round, the read
+        // could take the signal of a push that saw mSignaled clear, leaving it set over an unsignaled handle
+#if defined(_WIN32)
+        ResetEvent(mWaitHandle);
+#else
+        uint64_t value;
+        (void)read(mWaitHandle, &value, sizeof(value));
+#endif
+        mSignaled.store(false);
+    }
+
+    bool DnssdEventQueue::Push(DnssdServiceUpdateType update, const DnssdServiceFields& fields)
+    {
+        size_t position = mEnqueue.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;)
+        {
+            slot = &mSlots[position & mMask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                // the slot is free: claim the position
+                if (mEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // still held by the consumer: full
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                // another producer took it first
+                position = mEnqueue.load(std::memory_order_relaxed);
+            }
+        }
+
+        // the slot's buffer keeps its capacity, so a warm queue copies without allocating
+        slot->update = update;
+        slot->fields = fields;
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        Signal();
+        return true;
+    }
+
+    size_t DnssdEventQueue::Drain(DnssdServiceChange* events, size_t max)
+    {
+        // the caller is done with the strings of the last drain: give those slots back
+        for (size_t i = 0; i < mHeld; ++i)
+        {
+            size_t position = mDequeue - mHeld + i;
+            mSlots[position & mMask].sequence.store(position + mMask + 1, std::memory_order_release);
+        }
+        mHeld = 0;
+
+        ClearSignal();
+
+        size_t count = 0;
+        while (count < max)
+        {
+            Slot& slot = mSlots[mDequeue & mMask];
+            if (slot.sequence.load(std::memory_order_acquire) != mDequeue + 1)
+            {
+                break;
+            }
+            events[count].update = slot.update;
+            slot.fields.Fill(events[count].info);
+            count++;
+            mDequeue++;
+        }
+        mHeld = count;
+
+        if (count == max && max > 0)
+        {
+            // more may be waiting: keep the handle signaled
+            Signal();
+        }
+        return count;
+    }
+}
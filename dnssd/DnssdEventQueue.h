@@ -0,0 +1,76 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "dnssd.h"
+#include "DnssdServiceFields.h"
+
+namespace dnssd_uwp
+{
+    // Bounded lock-free queue of service changes for dnssd_watcher_drain.
+    // Any number of threads may Push (the threads DeviceWatcher events arrive on, or the native discovery thread);
+    // one consumer thread calls Drain. The wait handle is signaled when the queue goes from empty to non-empty
+    // so consumers can wait for it in their own poll/epoll loop or WaitForMultipleObjects.
+    // When the ring is full a change is dropped and counted; dnssd_watcher_acquire_snapshot then gives the full table.
+    class DnssdEventQueue
+    {
+    public:
+        explicit DnssdEventQueue(size_t capacity);
+        ~DnssdEventQueue();
+
+        // false if the wait handle could not be created
+        bool IsValid() const;
+
+        DnssdWaitHandle GetWaitHandle() const {
+            return mWaitHandle;
+        }
+
+        // copies the fields into the next free slot. Returns false if the queue is full
+        bool Push(DnssdServiceUpdateType update, const DnssdServiceFields& fields);
+
+        // Returns up to max changes. Their strings point into the queue and stay valid until the next Drain,
+        // which hands the slots back to the producers
+        size_t Drain(DnssdServiceChange* events, size_t max);
+
+        uint64_t Dropped() const {
+            return mDropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        DnssdEventQueue(const DnssdEventQueue&) = delete;
+        DnssdEventQueue& operator=(const DnssdEventQueue&) = delete;
+
+        struct alignas(64) Slot
+        {
+            std::atomic<size_t> sequence;   // position the slot can be written at, or that position + 1 once written
+            DnssdServiceUpdateType update;
+            DnssdServiceFields fields;
+        };
+
+        void Signal();
+        void ClearSignal();
+
+        std::unique_ptr<Slot[]> mSlots;
+        size_t mMask;
+        alignas(64) std::atomic<size_t> mEnqueue;
+        alignas(64) size_t mDequeue;            // consumer only
+        size_t mHeld;                           // slots returned by the last Drain, released by the next one
+        std::atomic<bool> mSignaled;
+        std::atomic<uint64_t> mDropped;
+        DnssdWaitHandle mWaitHandle;
+    };
+};
@@ -18,6 +18,7 @@
 
 using namespace dnssd_uwp;
 using namespace concurrency;
+using namespace Platform;
 using namespace Windows::Foundation;
 using namespace Windows::Networking;
 using namespace Windows::Networking::Connectivity;
@@ -25,9 +26,32 @@ using namespace Windows::Networking::Sockets;
 using namespace Windows::Networking::ServiceDiscovery::Dnssd;
 
 DnssdService::DnssdService(const std::string& name, const std::string& port)
+    : mStarted(false)
+    , mStartedCallback(nullptr)
 {
-    mServiceName = StringToPlatformString(name);
-    mPort = StringToPlatformString(port);
+    Instance instance;
+    instance.serviceName = StringToPlatformString(name);
+    instance.instanceName = L"dnssd";
+    instance.port = StringToPlatformString(port);
+    instance.registeredName = "dnssd";
+    instance.nameChanged = false;
+    mInstances.push_back(instance);
+}
+
+DnssdService::DnssdService(const DnssdServiceRegistration* registrations, size_t count)
+    : mStarted(false)
+    , mStartedCallback(nullptr)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        Instance instance;
+        instance.serviceName = StringToPlatformString(registrations[i].serviceName);
+        instance.instanceName = StringToPlatformString(registrations[i].instanceName);
+        instance.port = StringToPlatformString(registrations[i].port);
+        instance.registeredName = registrations[i].instanceName;
+        instance.nameChanged = false;
+        mInstances.push_back(instance);
+    }
 }
 
 DnssdService::~DnssdService()
@@ -37,15 +61,61 @@ DnssdService::~DnssdService()
 
 DnssdErrorType DnssdService::Start()
 {
-    DnssdErrorType result = DNSSD_NO_ERROR;
+    if (mStarted)
+    {
+        return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
+    }
+    mStarted = true;
 
-    if (mService != nullptr)
+    // wait for dnssd service to start
+    return Register().get();
+}
+
+DnssdErrorType DnssdService::StartAsync(DnssdServiceStartedCallback callback, DnssdServicePtr handle)
+{
+    if (mStarted)
     {
         return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
     }
+    mStarted = true;
+
+    mStartedCallback = callback;
+    DnssdService^ service = this;
+    mRegistration = std::make_unique<task<void>>(Register().then([service, handle](DnssdErrorType result)
+    {
+        service->OnStarted(result, handle);
+    }));
+    return DNSSD_NO_ERROR;
+}
+
+void DnssdService::OnStarted(DnssdErrorType result, DnssdServicePtr handle)
+{
+    DnssdServiceStartedCallback callback;
+    {
+        // cleared by Stop(): a service freed while registering is not reported
+        std::lock_guard<std::mutex> guard(mLock);
+        callback = mStartedCallback;
+        mStartedCallback = nullptr;
+    }
+    if (callback == nullptr)
+    {
+        return;
+    }
 
+    // a group is reported through its first instance, see dnssd_service_get_instance_name for the others
+    DnssdServiceStartStatus status = ServiceStartFailed;
+    const char* name = "";
+    if (result == DNSSD_NO_ERROR)
+    {
+        status = mInstances[0].nameChanged ? ServiceStartedRenamed : ServiceStarted;
+        name = mInstances[0].registeredName.c_str();
+    }
+    callback(handle, status, result, name);
+}
+
+HostName^ DnssdService::FindLocalHostName()
+{
     auto hostNames = NetworkInformation::GetHostNames();
-    HostName^ hostName = nullptr;
 
     // find first HostName of Type == HostNameType.DomainName && RawName contains "local"
     for (unsigned int i = 0; i < hostNames->Size; ++i)
@@ -57,74 +127,262 @@ DnssdErrorType DnssdService::Start()
             auto found = temp.find(L"local");
             if (found != std::string::npos)
             {
-                hostName = n;
+                return n;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool DnssdService::FindNetworkAdapters()
+{
+    // an adapter is known by the host names it has addresses for: one without any cannot answer
+    auto hostNames = NetworkInformation::GetHostNames();
+    mAdapters.clear();
+    for (const Guid& id : mAdapterIds)
+    {
+        for (unsigned int i = 0; i < hostNames->Size; ++i)
+        {
+            HostName^ n = hostNames->GetAt(i);
+            if (n->IPInformation != nullptr && n->IPInformation->NetworkAdapter->NetworkAdapterId == id)
+            {
+                mAdapters.push_back(n->IPInformation->NetworkAdapter);
                 break;
             }
         }
     }
+    return mAdapters.size() == mAdapterIds.size();
+}
 
-    if (hostName == nullptr)
+DnssdErrorType DnssdService::ToErrorType(DnssdRegistrationStatus status)
+{
+    switch (status)
     {
-        return DNSSD_LOCAL_HOSTNAME_NOT_FOUND_ERROR;
+        case DnssdRegistrationStatus::Success:
+            return DNSSD_NO_ERROR;
+        case DnssdRegistrationStatus::InvalidServiceName:
+            return DNSSD_INVALID_SERVICE_NAME_ERROR;
+        case DnssdRegistrationStatus::SecurityError:
+            return DNSSD_SERVICE_SECURITY_ERROR;
+        case DnssdRegistrationStatus::ServerError:
+            return DNSSD_SERVICE_SERVER_ERROR;
+        default:
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
     }
+}
+
+DnssdService::Listener& DnssdService::AddListener(String^ port)
+{
+    Listener listener;
+    listener.port = port;
+    listener.socket = ref new StreamSocketListener();
+    listener.token = listener.socket->ConnectionReceived += ref new TypedEventHandler<StreamSocketListener^, StreamSocketListenerConnectionReceivedEventArgs ^>(this, &DnssdService::OnConnect);
+    mListeners.push_back(listener);
+    return mListeners.back();
+}
 
-    auto task = create_task(create_async([this, hostName]
+DnssdService::Listener* DnssdService::FindListener(String^ port)
+{
+    for (auto& listener : mListeners)
     {
-        mSocket = ref new StreamSocketListener();
-        mSocketToken = mSocket->ConnectionReceived += ref new TypedEventHandler<StreamSocketListener^, StreamSocketListenerConnectionReceivedEventArgs ^>(this, &DnssdService::OnConnect);
-        create_task(mSocket->BindServiceNameAsync(mPort)).get();
-        unsigned short port = static_cast<unsigned short>(_wtoi(mSocket->Information->LocalPort->Data()));
-        mService = ref new DnssdServiceInstance(L"dnssd." + mServiceName + L".local", hostName, port);
-        return create_task(mService->RegisterStreamSocketListenerAsync(mSocket));
-    }));
+        if (listener.port == port)
+        {
+            return &listener;
+        }
+    }
+    return nullptr;
+}
+
+task<DnssdErrorType> DnssdService::RegisterInstance(size_t index, HostName^ hostName)
+{
+    DnssdService^ service = this;
+    Instance& instance = mInstances[index];
+    Listener* listener = FindListener(instance.port);
+    unsigned short port = static_cast<unsigned short>(_wtoi(listener->socket->Information->LocalPort->Data()));
+    instance.service = ref new DnssdServiceInstance(instance.instanceName + L"." + instance.serviceName + L".local", hostName, port);
+    for (const auto& entry : instance.txt)
+    {
+        instance.service->TextAttributes->Insert(entry.first, entry.second);
+    }
 
-    try
+    // on every adapter, or once per chosen adapter: Windows then answers there with that adapter's addresses only
+    std::vector<task<DnssdRegistrationResult^>> registrations;
+    if (mAdapters.empty())
     {
-        // wait for dnssd service to start
-        DnssdRegistrationResult^ reg = task.get(); // will also rethrow any exceptions from above task
-        auto ip = reg->IPAddress; // this always seems to be NULL
-        auto status = reg->Status;
-        bool hasInstanceChanged = reg->HasInstanceNameChanged;
+        registrations.push_back(create_task(instance.service->RegisterStreamSocketListenerAsync(listener->socket)));
+    }
+    for (NetworkAdapter^ adapter : mAdapters)
+    {
+        registrations.push_back(create_task(instance.service->RegisterStreamSocketListenerAsync(listener->socket, adapter)));
+    }
 
-        if (status != DnssdRegistrationStatus::Success)
+    return when_all(registrations.begin(), registrations.end()).then([service, index](std::vector<DnssdRegistrationResult^> results)
+    {
+        // reg->IPAddress always seems to be NULL
+        Instance& instance = service->mInstances[index];
+        DnssdErrorType result = DNSSD_NO_ERROR;
+        for (DnssdRegistrationResult^ reg : results)
         {
-            switch (status)
+            instance.nameChanged |= reg->HasInstanceNameChanged;
+            if (result == DNSSD_NO_ERROR)
             {
-                case DnssdRegistrationStatus::InvalidServiceName:
-                    result = DNSSD_INVALID_SERVICE_NAME_ERROR;
-                    break;
-                case DnssdRegistrationStatus::SecurityError:
-                    result = DNSSD_SERVICE_SECURITY_ERROR;
-                    break;
-                case DnssdRegistrationStatus::ServerError:
-                    result = DNSSD_SERVICE_SERVER_ERROR;
-                    break;
-                default:
-                    result = DNSSD_SERVICE_INITIALIZATION_ERROR;
-                    break;
+                result = ToErrorType(reg->Status);
             }
-
+        }
+        if (instance.nameChanged)
+        {
+            std::string fullName = PlatformStringToString(instance.service->DnssdServiceInstanceName);
+            instance.registeredName = fullName.substr(0, fullName.find('.'));
         }
         return result;
+    });
+}
+
+task<DnssdErrorType> DnssdService::Register()
+{
+    // everything runs on the thread pool, the host name lookup included: Start() blocks on the result, StartAsync() does not.
+    // The listeners are bound, then the instances registered, all at once rather than one after the other
+    DnssdService^ service = this;
+    return create_task([service]() -> task<DnssdErrorType>
+    {
+        HostName^ hostName = FindLocalHostName();
+        if (hostName == nullptr)
+        {
+            return task_from_result(DNSSD_LOCAL_HOSTNAME_NOT_FOUND_ERROR);
+        }
+        service->mHostName = hostName;
+        if (!service->FindNetworkAdapters())
+        {
+            return task_from_result(DNSSD_SERVICE_INITIALIZATION_ERROR);
+        }
+
+        std::vector<task<void>> binds;
+        for (const auto& instance : service->mInstances)
+        {
+            if (service->FindListener(instance.port) == nullptr)
+            {
+                Listener& listener = service->AddListener(instance.port);
+                binds.push_back(create_task(listener.socket->BindServiceNameAsync(listener.port)));
+            }
+        }
+
+        return when_all(binds.begin(), binds.end()).then([service, hostName]
+        {
+            std::vector<task<DnssdErrorType>> registrations;
+            for (size_t i = 0; i < service->mInstances.size(); ++i)
+            {
+                registrations.push_back(service->RegisterInstance(i, hostName));
+            }
+            return when_all(registrations.begin(), registrations.end());
+        }).then([](std::vector<DnssdErrorType> results)
+        {
+            for (DnssdErrorType result : results)
+            {
+                if (result != DNSSD_NO_ERROR)
+                {
+                    return result;
+                }
+            }
+            return DNSSD_NO_ERROR;
+        });
+    }).then([](task<DnssdErrorType> registered)
+    {
+        try
+        {
+            return registered.get(); // will also rethrow any exceptions from above tasks
+        }
+        catch (Platform::Exception^ ex)
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+    });
+}
+
+DnssdErrorType DnssdService::Update(size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount)
+{
+    if (index >= mInstances.size())
+    {
+        return DNSSD_INVALID_PARAMETER_ERROR;
     }
-    catch (Platform::Exception^ ex)
+
+    Instance& instance = mInstances[index];
+    if (port != nullptr)
+    {
+        instance.port = StringToPlatformString(port);
+    }
+    if (txt != nullptr)
+    {
+        instance.txt.clear();
+        for (size_t i = 0; i < txtCount; ++i)
+        {
+            std::string value = txt[i].value != nullptr ? std::string(txt[i].value, txt[i].valueLength) : std::string();
+            instance.txt.emplace_back(StringToPlatformString(txt[i].key != nullptr ? txt[i].key : ""), StringToPlatformString(value));
+        }
+    }
+
+    // not registered yet: Register() uses the new data
+    if (instance.service == nullptr || mHostName == nullptr)
     {
-        result =  DNSSD_SERVICE_INITIALIZATION_ERROR;
+        return DNSSD_NO_ERROR;
     }
 
-    return result;
+    DnssdService^ service = this;
+    return create_task([service, index]() -> task<DnssdErrorType>
+    {
+        Listener* listener = service->FindListener(service->mInstances[index].port);
+        if (listener != nullptr)
+        {
+            return service->RegisterInstance(index, service->mHostName);
+        }
+        Listener& added = service->AddListener(service->mInstances[index].port);
+        return create_task(added.socket->BindServiceNameAsync(added.port)).then([service, index]
+        {
+            return service->RegisterInstance(index, service->mHostName);
+        });
+    }).then([](task<DnssdErrorType> registered)
+    {
+        try
+        {
+            return registered.get();
+        }
+        catch (Platform::Exception^ ex)
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+    }).get();
 }
 
 void DnssdService::Stop()
 {
-    if (mSocket != nullptr)
     {
-        mSocket->ConnectionReceived -= mSocketToken;
-        delete mSocket;
-        mSocket = nullptr;
+        std::lock_guard<std::mutex> guard(mLock);
+        mStartedCallback = nullptr;
+    }
+
+    // an asynchronous registration still uses the socket and the service instance
+    if (mRegistration)
+    {
+        try
+        {
+            mRegistration->wait();
+        }
+        catch (...)
+        {
+        }
+        mRegistration.reset();
+    }
+
+    for (auto& listener : mListeners)
+    {
+        listener.socket->ConnectionReceived -= listener.token;
+        delete listener.socket;
     }
+    mListeners.clear();
 
-    mService = nullptr;
+    for (auto& instance : mInstances)
+    {
+        instance.service = nullptr;
+    }
 }
 
 void DnssdService::OnConnect(StreamSocketListener^ sender, StreamSocketListenerConnectionReceivedEventArgs ^ args)
@@ -13,7 +13,11 @@
 #pragma once
 
 #include "dnssd.h"
+#include <memory>
+#include <mutex>
+#include <ppltasks.h>
 #include <string>
+#include <vector>
 
 namespace dnssd_uwp
 {
@@ -24,16 +28,66 @@ namespace dnssd_uwp
 
     internal:
         DnssdService(const std::string& name, const std::string& port);
+        DnssdService(const DnssdServiceRegistration* registrations, size_t count);
         DnssdErrorType Start();
+        DnssdErrorType StartAsync(DnssdServiceStartedCallback callback, DnssdServicePtr handle);
         void Stop();
 
+        // register on these network adapters only, by NetworkAdapterId, instead of all of them. Call before Start()
+        void SetNetworkAdapters(const std::vector<Platform::Guid>& adapters) {
+            mAdapterIds = adapters;
+        }
+
+        // the registered instances, in registration order. Names are final once started
+        size_t GetInstanceCount() const {
+            return mInstances.size();
+        }
+        const std::string& GetInstanceName(size_t index) const {
+            return mInstances[index].registeredName;
+        }
+
+        // a new port or TXT data for an instance, nullptr to keep it. Windows has no call to change a registered
+        // DnssdServiceInstance: a registered instance is registered again with the new data under the same name
+        DnssdErrorType Update(size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount);
+
     private:
+        struct Instance
+        {
+            Platform::String^ serviceName;
+            Platform::String^ instanceName;
+            Platform::String^ port;
+            std::vector<std::pair<Platform::String^, Platform::String^>> txt;  // TextAttributes keys and values
+            Windows::Networking::ServiceDiscovery::Dnssd::DnssdServiceInstance^ service;
+            std::string registeredName;     // instanceName, or the name Windows picked on a conflict
+            bool nameChanged;
+        };
+
+        // instances on the same port share one listener
+        struct Listener
+        {
+            Platform::String^ port;
+            Windows::Networking::Sockets::StreamSocketListener^ socket;
+            Windows::Foundation::EventRegistrationToken token;
+        };
+
+        static Windows::Networking::HostName^ FindLocalHostName();
+        bool FindNetworkAdapters();
+        static DnssdErrorType ToErrorType(Windows::Networking::ServiceDiscovery::Dnssd::DnssdRegistrationStatus status);
+        concurrency::task<DnssdErrorType> Register();
+        concurrency::task<DnssdErrorType> RegisterInstance(size_t index, Windows::Networking::HostName^ hostName);
+        Listener* FindListener(Platform::String^ port);
+        Listener& AddListener(Platform::String^ port);
+        void OnStarted(DnssdErrorType result, DnssdServicePtr handle);
         void OnConnect(Windows::Networking::Sockets::StreamSocketListener^ sender, Windows::Networking::Sockets::StreamSocketListenerConnectionReceivedEventArgs ^ args);
-        Platform::String^ mServiceName;
-        Platform::String^ mPort;
-        Windows::Networking::ServiceDiscovery::Dnssd::DnssdServiceInstance^ mService;
-        Windows::Networking::Sockets::StreamSocketListener^ mSocket;
-        Windows::Foundation::EventRegistrationToken mSocketToken;
+        std::vector<Instance> mInstances;
+        std::vector<Listener> mListeners;
+        Windows::Networking::HostName^ mHostName;   // the host the instances are registered on, once started
+        std::vector<Platform::Guid> mAdapterIds;    // adapters to register on, empty for all
+        std::vector<Windows::Networking::Connectivity::NetworkAdapter^> mAdapters;  // mAdapterIds, once started
+        bool mStarted;
+        std::mutex mLock;
+        DnssdServiceStartedCallback mStartedCallback;   // StartAsync() only, until called or stopped
+        std::unique_ptr<concurrency::task<void>> mRegistration; // StartAsync() registration, waited for by Stop()
     };
 
     class DnssdServiceWrapper
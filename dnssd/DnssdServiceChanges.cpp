@@ -0,0 +1,58 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DnssdServiceChanges.h"
+
+namespace dnssd_uwp
+{
+    void DnssdServiceChanges::Add(DnssdServiceUpdateType update, const DnssdServiceFields& fields)
+    {
+        size_t base = mStrings.size();
+        mStrings.insert(mStrings.end(), fields.Data(), fields.Data() + fields.Size());
+
+        PendingChange change;
+        change.update = update;
+        change.block = base;
+        mPending.push_back(change);
+    }
+
+    void DnssdServiceChanges::Deliver(DnssdServiceWatcherPtr watcher, DnssdServiceChangesCallback callback)
+    {
+        if (mPending.empty())
+        {
+            return;
+        }
+
+        std::vector<char> strings;
+        std::vector<PendingChange> pending;
+        strings.swap(mStrings);
+        pending.swap(mPending);
+        if (callback == nullptr)
+        {
+            return;
+        }
+
+        std::vector<DnssdServiceChange> changes(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            changes[i].update = pending[i].update;
+            DnssdServiceFields::Fill(strings.data() + pending[i].block, changes[i].info);
+        }
+        callback(watcher, changes.data(), changes.size());
+    }
+
+    void DnssdServiceChanges::Clear()
+    {
+        mStrings.clear();
+        mPending.clear();
+    }
+}
@@ -0,0 +1,56 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <vector>
+
+#include "dnssd.h"
+#include "DnssdServiceFields.h"
+
+namespace dnssd_uwp
+{
+    // Collects the service changes of one update pass for a DnssdServiceChangesCallback.
+    // The field blocks of all changes are copied into one arena and the DnssdServiceChange array
+    // is built when the batch is delivered, so a pass costs one callback however many services changed.
+    class DnssdServiceChanges
+    {
+    public:
+        // copies the whole field block of the service at once
+        void Add(DnssdServiceUpdateType update, const DnssdServiceFields& fields);
+
+        bool IsEmpty() const {
+            return mPending.empty();
+        }
+
+        size_t Size() const {
+            return mPending.size();
+        }
+
+        // calls callback once with every change added since the last delivery. The batch is taken out first and
+        // nothing here is touched once the callback runs: the callback may free the watcher that owns this
+        void Deliver(DnssdServiceWatcherPtr watcher, DnssdServiceChangesCallback callback);
+
+        void Clear();
+
+    private:
+        // offset of the change's field block in mStrings. The arena may move while changes are added
+        struct PendingChange
+        {
+            DnssdServiceUpdateType update;
+            size_t block;
+        };
+
+        std::vector<char> mStrings;
+        std::vector<PendingChange> mPending;
+    };
+};
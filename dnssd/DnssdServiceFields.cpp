@@ -0,0 +1,158 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DnssdServiceFields.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    DnssdServiceFields::DnssdServiceFields()
+    {
+        // every field starts out empty: a zero length and the NUL
+        mBlock.assign(FieldCount * (kLengthSize + 1), '\0');
+        for (int field = 0; field < FieldCount; ++field)
+        {
+            mOffsets[field] = static_cast<uint32_t>(field * (kLengthSize + 1) + kLengthSize);
+        }
+    }
+
+    size_t DnssdServiceFields::Length(Field field) const
+    {
+        uint32_t length;
+        memcpy(&length, mBlock.data() + mOffsets[field] - kLengthSize, kLengthSize);
+        return length;
+    }
+
+    // finds a field of a block by walking the length prefixes from the first one
+    static const char* FindField(const char* block, int field, uint32_t& length)
+    {
+        for (int i = 0;; ++i)
+        {
+            memcpy(&length, block, sizeof(length));
+            if (i == field)
+            {
+                return block + sizeof(length);
+            }
+            block += sizeof(length) + length + 1;
+        }
+    }
+
+    bool DnssdServiceFields::SetAddresses(DnssdAddress* addresses, size_t count)
+    {
+        std::sort(addresses, addresses + count, [](const DnssdAddress& a, const DnssdAddress& b)
+        {
+            // IPv4 (the smaller family value on every platform) first, then by address.
+            // Callers zero the whole union, so the unused bytes of an IPv4 address compare equal
+            if (a.family != b.family)
+            {
+                return a.family < b.family;
+            }
+            return memcmp(&a, &b, sizeof(DnssdAddress)) < 0;
+        });
+        return Set(Addresses, reinterpret_cast<const char*>(addresses), count * sizeof(DnssdAddress));
+    }
+
+    bool DnssdServiceFields::Set(Field field, const char* value, size_t length)
+    {
+        size_t current = Length(field);
+        char* data = mBlock.data() + mOffsets[field];
+        if (current == length && memcmp(data, value, length) == 0)
+        {
+            return false;
+        }
+
+        if (current != length)
+        {
+            // resize the field in place and shift the fields after it
+            auto position = mBlock.begin() + mOffsets[field];
+            if (length > current)
+            {
+                mBlock.insert(position, length - current, '\0');
+            }
+            else
+            {
+                mBlock.erase(position, position + (current - length));
+            }
+
+            for (int next = field + 1; next < FieldCount; ++next)
+            {
+                mOffsets[next] = static_cast<uint32_t>(mOffsets[next] + length - current);
+            }
+
+            uint32_t prefix = static_cast<uint32_t>(length);
+            memcpy(mBlock.data() + mOffsets[field] - kLengthSize, &prefix, kLengthSize);
+            data = mBlock.data() + mOffsets[field];
+        }
+
+        memcpy(data, value, length);
+        data[length] = '\0';
+        return true;
+    }
+
+    void DnssdServiceFields::Fill(DnssdServiceInfo& info) const
+    {
+        info.id = Get(Id);
+        info.instanceName = Get(InstanceName);
+        info.host = Get(Host);
+        info.port = Get(Port);
+        info.txt = reinterpret_cast<DnssdTxtRecordPtr>(Get(Txt) - kLengthSize);
+    }
+
+    void DnssdServiceFields::Fill(const char* block, DnssdServiceInfo& info)
+    {
+        const char* fields[FieldCount];
+        for (int field = 0; field < FieldCount; ++field)
+        {
+            uint32_t length;
+            memcpy(&length, block, kLengthSize);
+            fields[field] = block;
+            block += kLengthSize + length + 1;
+        }
+
+        info.id = fields[Id] + kLengthSize;
+        info.instanceName = fields[InstanceName] + kLengthSize;
+        info.host = fields[Host] + kLengthSize;
+        info.port = fields[Port] + kLengthSize;
+        info.txt = reinterpret_cast<DnssdTxtRecordPtr>(fields[Txt]);
+    }
+
+    void DnssdServiceFields::Fill2(const DnssdServiceInfo& info, DnssdServiceInfo2& info2)
+    {
+        const char* block = info.id - kLengthSize;
+
+        info2.id = info.id;
+        info2.instanceName = info.instanceName;
+        info2.txt = info.txt;
+
+        uint32_t length;
+        const char* port = FindField(block, PortNumber, length);
+        info2.port = 0;
+        if (length == sizeof(info2.port))
+        {
+            memcpy(&info2.port, port, sizeof(info2.port));
+        }
+
+        info2.addressCount = GetAddresses(info, info2.addresses, DNSSD_INLINE_ADDRESS_COUNT);
+    }
+
+    size_t DnssdServiceFields::GetAddresses(const DnssdServiceInfo& info, DnssdAddress* addresses, size_t max)
+    {
+        uint32_t length;
+        const char* data = FindField(info.id - kLengthSize, Addresses, length);
+        size_t count = length / sizeof(DnssdAddress);
+
+        // the block has no alignment: copy rather than point into it
+        memcpy(addresses, data, std::min(count, max) * sizeof(DnssdAddress));
+        return count;
+    }
+}
@@ -0,0 +1,85 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dnssd.h"
+
+namespace dnssd_uwp
+{
+    // The UTF-8 id, instance name, host and port of a service, its raw TXT rdata, and its port number and
+    // sorted DnssdAddress set in binary, in one contiguous block.
+    // Each field is stored as a 32 bit length followed by the bytes and a terminating NUL, so
+    // Fill() only points a DnssdServiceInfo into the block and a callback needs no allocation or conversion.
+    // The TXT handle is the address of the Txt field's length (see DnssdTxtRecordReader).
+    // Set() leaves the block untouched when the value is unchanged and otherwise only moves the fields after it.
+    class DnssdServiceFields
+    {
+    public:
+        enum Field { Id, InstanceName, Host, Port, Txt, PortNumber, Addresses, FieldCount };
+
+        DnssdServiceFields();
+
+        // returns true if the field changed
+        bool Set(Field field, const char* value, size_t length);
+
+        bool Set(Field field, const std::string& value) {
+            return Set(field, value.data(), value.size());
+        }
+
+        const char* Get(Field field) const {
+            return mBlock.data() + mOffsets[field];
+        }
+
+        size_t Length(Field field) const;
+
+        // sorts addresses, IPv4 first, so the same set always has the same bytes. Returns true if the set changed
+        bool SetAddresses(DnssdAddress* addresses, size_t count);
+
+        // returns true if the port changed
+        bool SetPortNumber(uint16_t port) {
+            return Set(PortNumber, reinterpret_cast<const char*>(&port), sizeof(port));
+        }
+
+        void Fill(DnssdServiceInfo& info) const;
+
+        // points info into a copy of a block taken with Data() and Size(), which describes itself field by field
+        static void Fill(const char* block, DnssdServiceInfo& info);
+
+        // the binary fields of the block info points into (it starts just before info.id)
+        static void Fill2(const DnssdServiceInfo& info, DnssdServiceInfo2& info2);
+        static size_t GetAddresses(const DnssdServiceInfo& info, DnssdAddress* addresses, size_t max);
+
+        // the whole block, for copying every field at once. Field offsets are relative to Data()
+        const char* Data() const {
+            return mBlock.data();
+        }
+
+        size_t Size() const {
+            return mBlock.size();
+        }
+
+        size_t Offset(Field field) const {
+            return mOffsets[field];
+        }
+
+    private:
+        static const size_t kLengthSize = sizeof(uint32_t);
+
+        std::vector<char> mBlock;
+        uint32_t mOffsets[FieldCount];  // offset of each field's first byte, just after its length
+    };
+};
@@ -0,0 +1,268 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DnssdServiceSnapshot.h"
+#include <thread>
+
+namespace dnssd_uwp
+{
+    static const int kMaxReaders = 256;
+
+    // keeps the folded count of a replaced snapshot from reaching zero before the shards are added in
+    static const int64_t kReferenceBias = int64_t(1) << 62;
+
+    // One per reader thread. active holds the generation a thread saw when it entered Acquire or Release
+    // and is 0 outside them; a snapshot replaced in generation T is safe to fold once no slot is active below T.
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<uint64_t> active;
+        std::atomic<bool> owned;
+    };
+
+    static ReaderSlot gSlots[kMaxReaders];
+    static std::atomic<uint64_t> gGeneration(1);
+
+    // threads beyond kMaxReaders share one slot under a spin lock
+    static ReaderSlot gOverflowSlot;
+    static std::atomic_flag gOverflowLock = ATOMIC_FLAG_INIT;
+
+    // the calling thread's slot, claimed on first use and given back when the thread exits
+    struct ThreadSlot
+    {
+        ThreadSlot()
+            : index(-1)
+        {
+            for (int i = 0; i < kMaxReaders; ++i)
+            {
+                bool expected = false;
+                if (!gSlots[i].owned.load(std::memory_order_relaxed) && gSlots[i].owned.compare_exchange_strong(expected, true))
+                {
+                    index = i;
+                    break;
+                }
+            }
+        }
+
+        ~ThreadSlot()
+        {
+            if (index >= 0)
+            {
+                gSlots[index].owned.store(false, std::memory_order_release);
+            }
+        }
+
+        int index;
+    };
+
+    // marks the calling thread as reading snapshots for the lifetime of the object
+    class ReadSection
+    {
+    public:
+        ReadSection()
+        {
+            static thread_local ThreadSlot thread;
+            if (thread.index >= 0)
+            {
+                mSlot = &gSlots[thread.index];
+                mIndex = thread.index;
+            }
+            else
+            {
+                while (gOverflowLock.test_and_set(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+                mSlot = &gOverflowSlot;
+                mIndex = kMaxReaders;
+            }
+            mSlot->active.store(gGeneration.load());
+        }
+
+        ~ReadSection()
+        {
+            mSlot->active.store(0, std::memory_order_release);
+            if (mSlot == &gOverflowSlot)
+            {
+                gOverflowLock.clear(std::memory_order_release);
+            }
+        }
+
+        int Index() const {
+            return mIndex;
+        }
+
+    private:
+        ReaderSlot* mSlot;
+        int mIndex;
+    };
+
+    static bool IsGracePeriodOver(uint64_t generation)
+    {
+        for (int i = 0; i < kMaxReaders; ++i)
+        {
+            uint64_t active = gSlots[i].active.load();
+            if (active != 0 && active < generation)
+            {
+                return false;
+            }
+        }
+        uint64_t active = gOverflowSlot.active.load();
+        return active == 0 || active >= generation;
+    }
+
+    //
+    // DnssdSnapshot
+    //
+
+    DnssdSnapshot::DnssdSnapshot()
+        : mShared(true)
+        , mReferences(kReferenceBias)
+        , mRetired(0)
+    {
+        count = 0;
+        services = nullptr;
+        for (auto& shard : mShards)
+        {
+            shard.references.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void DnssdSnapshot::Add(const DnssdServiceFields& fields)
+    {
+        size_t base = mStrings.size();
+        mStrings.insert(mStrings.end(), fields.Data(), fields.Data() + fields.Size());
+        mOffsets.push_back(base);
+    }
+
+    void DnssdSnapshot::Seal()
+    {
+        // the arena no longer moves: point the service infos into it
+        const char* strings = mStrings.data();
+        mServices.resize(mOffsets.size());
+        for (size_t i = 0; i < mServices.size(); ++i)
+        {
+            DnssdServiceFields::Fill(strings + mOffsets[i], mServices[i]);
+        }
+        count = mServices.size();
+        services = mServices.data();
+    }
+
+    //
+    // DnssdSnapshotPublisher
+    //
+
+    DnssdSnapshotPublisher::DnssdSnapshotPublisher()
+        : mCurrent(nullptr)
+    {
+    }
+
+    DnssdSnapshotPublisher::~DnssdSnapshotPublisher()
+    {
+        // snapshots still held by readers outlive the publisher and are freed by their last release
+        DnssdSnapshot* current = mCurrent.exchange(nullptr);
+        if (current != nullptr)
+        {
+            Retire(current);
+        }
+        Reclaim(true);
+    }
+
+    void DnssdSnapshotPublisher::Publish(DnssdSnapshot* snapshot)
+    {
+        DnssdSnapshot* previous = mCurrent.exchange(snapshot);
+        if (previous != nullptr)
+        {
+            Retire(previous);
+        }
+        Reclaim(false);
+    }
+
+    void DnssdSnapshotPublisher::Retire(DnssdSnapshot* snapshot)
+    {
+        // readers entering after the generation bump see the new snapshot and count the old one centrally
+        snapshot->mShared.store(false);
+        snapshot->mRetired = gGeneration.fetch_add(1) + 1;
+        mRetired.push_back(snapshot);
+    }
+
+    void DnssdSnapshotPublisher::Reclaim(bool wait)
+    {
+        for (auto it = mRetired.begin(); it != mRetired.end();)
+        {
+            DnssdSnapshot* snapshot = *it;
+            if (!IsGracePeriodOver(snapshot->mRetired))
+            {
+                if (wait)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++it;
+                continue;
+            }
+
+            // nobody touches the shards any more: fold them into the central count and drop the bias
+            int64_t shared = 0;
+            for (auto& shard : snapshot->mShards)
+            {
+                shared += shard.references.load(std::memory_order_acquire);
+            }
+            int64_t delta = shared - kReferenceBias;
+            if (snapshot->mReferences.fetch_add(delta, std::memory_order_acq_rel) + delta == 0)
+            {
+                delete snapshot;
+            }
+            it = mRetired.erase(it);
+        }
+    }
+
+    const DnssdServiceSnapshot* DnssdSnapshotPublisher::Acquire()
+    {
+        ReadSection section;
+        DnssdSnapshot* snapshot = mCurrent.load();
+        if (snapshot != nullptr)
+        {
+            if (snapshot->mShared.load())
+            {
+                snapshot->mShards[section.Index() % DnssdSnapshot::kShards].references.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                snapshot->mReferences.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return snapshot;
+    }
+
+    void DnssdSnapshotPublisher::Release(const DnssdServiceSnapshot* released)
+    {
+        if (released == nullptr)
+        {
+            return;
+        }
+
+        DnssdSnapshot* snapshot = static_cast<DnssdSnapshot*>(const_cast<DnssdServiceSnapshot*>(released));
+        {
+            ReadSection section;
+            if (snapshot->mShared.load())
+            {
+                snapshot->mShards[section.Index() % DnssdSnapshot::kShards].references.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+        }
+
+        if (snapshot->mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete snapshot;
+        }
+    }
+}
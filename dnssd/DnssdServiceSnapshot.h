@@ -0,0 +1,87 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "dnssd.h"
+#include "DnssdServiceFields.h"
+
+namespace dnssd_uwp
+{
+    // An immutable copy of a watcher's service table, handed out by dnssd_watcher_acquire_snapshot.
+    // The strings of all services live in one arena. References are counted in per-thread shards so readers
+    // on different threads never write the same cache line; once the snapshot has been replaced and every
+    // reader that could have seen it has left DnssdSnapshotPublisher::Acquire, the shards are folded into one
+    // counter and the last dnssd_snapshot_release frees it.
+    class DnssdSnapshot : public DnssdServiceSnapshot
+    {
+    public:
+        DnssdSnapshot();
+
+        // copies the strings of one service. Call Seal() after the last Add
+        void Add(const DnssdServiceFields& fields);
+        void Seal();
+
+    private:
+        DnssdSnapshot(const DnssdSnapshot&) = delete;
+        DnssdSnapshot& operator=(const DnssdSnapshot&) = delete;
+
+        friend class DnssdSnapshotPublisher;
+
+        static const int kShards = 32;
+
+        struct alignas(64) Shard
+        {
+            std::atomic<int64_t> references;
+        };
+
+        std::vector<char> mStrings;
+        std::vector<size_t> mOffsets;               // offset of each service's field block in mStrings
+        std::vector<DnssdServiceInfo> mServices;
+
+        Shard mShards[kShards];
+        std::atomic<bool> mShared;                  // false once replaced: references go to mReferences
+        std::atomic<int64_t> mReferences;           // biased until the shards are folded in
+        uint64_t mRetired;                          // generation the snapshot was replaced in
+    };
+
+    // Publishes the snapshots of one watcher, RCU style. Publish() runs on the discovery thread;
+    // Acquire() and Release() run on any thread, take no lock and wait for nobody.
+    // A reader marks its thread's slot while it loads the current snapshot and takes a reference;
+    // a replaced snapshot keeps its sharded counts until no slot can still be using them.
+    class DnssdSnapshotPublisher
+    {
+    public:
+        DnssdSnapshotPublisher();
+        ~DnssdSnapshotPublisher();
+
+        // replaces the current snapshot. snapshot must be sealed; the publisher takes ownership
+        void Publish(DnssdSnapshot* snapshot);
+
+        const DnssdServiceSnapshot* Acquire();
+        static void Release(const DnssdServiceSnapshot* snapshot);
+
+    private:
+        DnssdSnapshotPublisher(const DnssdSnapshotPublisher&) = delete;
+        DnssdSnapshotPublisher& operator=(const DnssdSnapshotPublisher&) = delete;
+
+        void Retire(DnssdSnapshot* snapshot);
+        void Reclaim(bool wait);
+
+        std::atomic<DnssdSnapshot*> mCurrent;
+        std::vector<DnssdSnapshot*> mRetired;       // replaced, waiting for readers to leave Acquire
+    };
+};
@@ -13,6 +13,7 @@
 #include "DnssdServiceWatcher.h"
 #include "DnssdUtils.h"
 #include <algorithm>
+#include <new>
 #include <vector>
 #include <collection.h>
 #include <cvt/wstring>
@@ -35,9 +36,13 @@ namespace dnssd_uwp
 
     DnssdServiceWatcher::DnssdServiceWatcher(const char* serviceName, DnssdServiceChangedCallback callback)
         : mDnssdServiceChangedCallback(callback)
+        , mDnssdServiceChangesCallback(nullptr)
+        , mStartedCallback(nullptr)
         , mRunning(false)
+        , mSnapshotChanged(false)
     {
         mServiceName = StringToPlatformString(serviceName);
+        PublishSnapshot();
     }
 
     DnssdServiceWatcher::~DnssdServiceWatcher()
@@ -52,7 +57,67 @@ namespace dnssd_uwp
 
     DnssdErrorType DnssdServiceWatcher::Initialize()
     {
-        auto task = create_task(create_async([this]
+        try
+        {
+            // wait for port enumeration to complete
+            CreateWatcher().get(); // will throw any exceptions from the task
+            return DNSSD_NO_ERROR;
+        }
+        catch (Platform::Exception^ ex)
+        {
+            return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+        }
+    }
+
+    DnssdErrorType DnssdServiceWatcher::InitializeAsync(DnssdServiceWatcherStartedCallback callback, DnssdServiceWatcherPtr handle)
+    {
+        mStartedCallback = callback;
+        DnssdServiceWatcher^ watcher = this;
+        mStarting = std::make_unique<task<void>>(CreateWatcher().then([watcher, handle](task<void> created)
+        {
+            DnssdErrorType result = DNSSD_NO_ERROR;
+            try
+            {
+                created.get();
+            }
+            catch (Platform::Exception^ ex)
+            {
+                result = DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+            }
+
+            DnssdServiceWatcherStartedCallback startedCallback;
+            {
+                // cleared by CancelStart(): a freed watcher is not reported
+                std::lock_guard<std::mutex> guard(watcher->mLock);
+                startedCallback = watcher->mStartedCallback;
+                watcher->mStartedCallback = nullptr;
+            }
+            if (startedCallback != nullptr)
+            {
+                startedCallback(handle, result);
+            }
+        }));
+        return DNSSD_NO_ERROR;
+    }
+
+    void DnssdServiceWatcher::CancelStart()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            mStartedCallback = nullptr;
+        }
+
+        if (mStarting)
+        {
+            mStarting->wait();
+            mStarting.reset();
+        }
+    }
+
+    task<void> DnssdServiceWatcher::CreateWatcher()
+    {
+        // on the thread pool: CreateWatcher and Start may take a while
+        return create_task(create_async([this]
         {
             /// <summary>
             /// All of the properties that will be returned when a DNS-SD instance has been found. 
@@ -64,10 +129,25 @@ namespace dnssd_uwp
             propertyKeys->Append(L"System.Devices.Dnssd.InstanceName");
             propertyKeys->Append(L"System.Devices.IpAddress");
             propertyKeys->Append(L"System.Devices.Dnssd.PortNumber");
+            propertyKeys->Append(L"System.Devices.Dnssd.TextAttributes");
 
             Platform::String^ aqsQueryString;
             aqsQueryString = L"System.Devices.AepService.ProtocolId:={4526e8c1-8aac-4153-9b16-55e86ada0e54} AND " +
                 "System.Devices.Dnssd.Domain:=\"local\" AND System.Devices.Dnssd.ServiceName:=\"" + mServiceName + "\"";
+            if (!mAdapters.empty())
+            {
+                // only the services found through the chosen adapters
+                Platform::String^ adapters = L"";
+                for (size_t i = 0; i < mAdapters.size(); ++i)
+                {
+                    if (i != 0)
+                    {
+                        adapters += L" OR ";
+                    }
+                    adapters += L"System.Devices.Dnssd.NetworkAdapterId:=\"" + mAdapters[i].ToString() + L"\"";
+                }
+                aqsQueryString += L" AND (" + adapters + L")";
+            }
 
             mServiceWatcher = DeviceInformation::CreateWatcher(aqsQueryString, propertyKeys, DeviceInformationKind::AssociationEndpointService);
 
@@ -83,86 +163,134 @@ namespace dnssd_uwp
             mRunning = true;
             auto status = mServiceWatcher->Status;
         }));
+    }
 
-        try
-        {
-            // wait for port enumeration to complete
-            task.get(); // will throw any exceptions from above task
-            return DNSSD_NO_ERROR;
-        }
-        catch (Platform::Exception^ ex)
+    DnssdErrorType DnssdServiceWatcher::EnableEventQueue(size_t capacity)
+    {
+        mEventQueue.reset(new (std::nothrow) DnssdEventQueue(capacity));
+        if (!mEventQueue || !mEventQueue->IsValid())
         {
+            mEventQueue.reset();
             return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
         }
+        return DNSSD_NO_ERROR;
     }
 
     void DnssdServiceWatcher::UpdateDnssdService(DnssdServiceUpdateType type, Windows::Foundation::Collections::IMapView<Platform::String^, Platform::Object^>^ props, Platform::String^ serviceId)
     {
+        // every address, not just the first: multi-homed and dual-stack hosts have several
         auto box = safe_cast<Platform::IBoxArray<Platform::String^>^>(props->Lookup("System.Devices.IpAddress"));
-        Platform::String^ host = box->Value->get(0);
         Platform::String^ port = props->Lookup("System.Devices.Dnssd.PortNumber")->ToString();
+        uint16_t portNumber = static_cast<uint16_t>(_wtoi(port->Data()));
+        ParseServiceAddresses(box->Value, portNumber, mAddresses);
         Platform::String^ name = props->Lookup("System.Devices.Dnssd.InstanceName")->ToString();
+        Platform::Object^ txt = props->HasKey("System.Devices.Dnssd.TextAttributes") ? props->Lookup("System.Devices.Dnssd.TextAttributes") : nullptr;
 
         auto it = mServices.find(serviceId);
         if (it != mServices.end()) // service was previously found. Update the info and report change if necessary
         {
             auto info = it->second;
-            if (info->mHost != host)
+
+            // compared in binary: the host and port strings are only converted again when they changed
+            if (info->mFields.SetAddresses(mAddresses.data(), mAddresses.size()))
             {
-                info->mHost = host;
                 info->mChanged = true;
+                if (!mAddresses.empty())
+                {
+                    SetServiceHost(info->mFields, mAddresses[0]);
+                }
             }
-            if (info->mPort != port)
+            if (info->mFields.SetPortNumber(portNumber))
             {
-                info->mPort = port;
                 info->mChanged = true;
+                SetServiceField(info->mFields, DnssdServiceFields::Port, port);
             }
             if (info->mInstanceName != name)
             {
                 info->mInstanceName = name;
-                info->mChanged = true;
+                info->mChanged |= SetServiceField(info->mFields, DnssdServiceFields::InstanceName, name);
             }
+
+            // compared as TXT rdata: only a real TXT change is reported
+            info->mChanged |= SetServiceTxt(info->mFields, txt);
             info->mType = DnssdServiceUpdateType::ServiceUpdated;
 
             if (info->mChanged)
             {
                 // report the updated service
                 OnDnssdServiceUpdated(info);
+                mSnapshotChanged = true;
             }
         }
         else // add it to the service map
         {
             DnssdServiceInstance^ info = ref new DnssdServiceInstance;
             info->mId = serviceId;
-            info->mHost = host;
-            info->mPort = port;
             info->mInstanceName = name;
+            SetServiceField(info->mFields, DnssdServiceFields::Id, serviceId);
+            info->mFields.SetAddresses(mAddresses.data(), mAddresses.size());
+            if (!mAddresses.empty())
+            {
+                SetServiceHost(info->mFields, mAddresses[0]);
+            }
+            info->mFields.SetPortNumber(portNumber);
+            SetServiceField(info->mFields, DnssdServiceFields::Port, port);
+            SetServiceField(info->mFields, DnssdServiceFields::InstanceName, name);
+            SetServiceTxt(info->mFields, txt);
             info->mType = DnssdServiceUpdateType::ServiceAdded;
             mServices[serviceId] = info;
 
             // report the new service
             OnDnssdServiceUpdated(info);
+            mSnapshotChanged = true;
+        }
+    }
+
+    void DnssdServiceWatcher::RemoveDnssdService(Platform::String^ serviceId)
+    {
+        auto it = mServices.find(serviceId);
+        if (it == mServices.end())
+        {
+            return;
+        }
+
+        auto info = it->second;
+        info->mType = DnssdServiceUpdateType::ServiceRemoved;
+        OnDnssdServiceUpdated(info);
+        mServices.erase(it);
+        mSnapshotChanged = true;
+
+        if (mDnssdServiceChangesCallback != nullptr && !mEventQueue)
+        {
+            // a removal does not wait for the end of the scan, and the snapshot goes with it:
+            // published first, as the callback may free the watcher
+            PublishSnapshot();
+            DnssdServiceWatcherWrapper wrapper(this);
+            mChanges.Deliver(&wrapper, mDnssdServiceChangesCallback);
         }
     }
 
     void DnssdServiceWatcher::OnDnssdServiceUpdated(DnssdServiceInstance^ info)
     {
-        DnssdServiceWatcherWrapper wrapper(this);
-        DnssdServiceInfo serviceInfo;
+        if (mEventQueue)
+        {
+            // the consumer drains on its own thread; nothing runs on the DeviceWatcher thread
+            mEventQueue->Push(info->mType, info->mFields);
+            return;
+        }
 
-        // convert Platform::Strings to std::strings 
-        std::string host = PlatformStringToString(info->mHost);
-        std::string  port = PlatformStringToString(info->mPort);
-        std::string instanceName = PlatformStringToString(info->mInstanceName);
-        std::string id = PlatformStringToString(info->mId);
+        if (mDnssdServiceChangesCallback != nullptr)
+        {
+            // delivered with the rest of the scan in OnServiceEnumerationStopped
+            mChanges.Add(info->mType, info->mFields);
+            return;
+        }
 
-        serviceInfo.host = host.c_str();
-        serviceInfo.port = port.c_str();
-        serviceInfo.id = id.c_str();
-        //serviceInfo.instanceName = instanceName.c_str();
-        serviceInfo.instanceName = instanceName.c_str();
+        DnssdServiceWatcherWrapper wrapper(this);
+        DnssdServiceInfo serviceInfo;
 
-        auto foo = info->mId->Data();
+        // the UTF-8 strings were converted when the service info last changed
+        info->mFields.Fill(serviceInfo);
 
         if (mDnssdServiceChangedCallback != nullptr)
         {
@@ -170,6 +298,18 @@ namespace dnssd_uwp
         }
     }
 
+    void DnssdServiceWatcher::PublishSnapshot()
+    {
+        DnssdSnapshot* snapshot = new DnssdSnapshot();
+        for (auto it = mServices.begin(); it != mServices.end(); ++it)
+        {
+            snapshot->Add(it->second->mFields);
+        }
+        snapshot->Seal();
+        mSnapshots.Publish(snapshot);
+        mSnapshotChanged = false;
+    }
+
     void DnssdServiceWatcher::OnServiceAdded(DeviceWatcher^ sender, DeviceInformation^ args)
     {
         UpdateDnssdService(DnssdServiceUpdateType::ServiceAdded, args->Properties, args->Id);
@@ -182,11 +322,18 @@ namespace dnssd_uwp
 
     void DnssdServiceWatcher::OnServiceRemoved(DeviceWatcher^ sender, DeviceInformationUpdate^ args)
     {
-        UpdateDnssdService(DnssdServiceUpdateType::ServiceUpdated, args->Properties, args->Id);
+        // the service sent its goodbye: report it now rather than after the next scan misses it
+        RemoveDnssdService(args->Id);
     }
 
     void DnssdServiceWatcher::OnServiceEnumerationCompleted(DeviceWatcher^ sender, Platform::Object^ args)
     {
+        // the services found by this scan, in one snapshot rather than one per DeviceWatcher event
+        if (mSnapshotChanged)
+        {
+            PublishSnapshot();
+        }
+
         // stop the service scanning. Service scanning will be restarted when OnServiceEnumerationStopped event is received
         mServiceWatcher->Stop();
     }
@@ -230,6 +377,16 @@ namespace dnssd_uwp
             }
         });
 
+        // the stale services go in one snapshot, with any removal reported since the scan completed
+        if (mSnapshotChanged || !removedServices.empty())
+        {
+            PublishSnapshot();
+        }
+
+        // report the changes of this scan in one batched callback
+        DnssdServiceWatcherWrapper wrapper(this);
+        mChanges.Deliver(&wrapper, mDnssdServiceChangesCallback);
+
         // restart the service scan
         mServiceWatcher->Start();
     }
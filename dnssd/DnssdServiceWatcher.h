@@ -15,8 +15,16 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ppltasks.h>
+#include <vector>
 
 #include "dnssd.h"
+#include "DnssdEventQueue.h"
+#include "DnssdServiceChanges.h"
+#include "DnssdServiceFields.h"
+#include "DnssdServiceSnapshot.h"
 
 namespace dnssd_uwp
 {
@@ -38,10 +46,10 @@ namespace dnssd_uwp
         }
 
     internal:
-        Platform::String^ mHost;
-        Platform::String^ mPort;
         Platform::String^ mInstanceName;
         Platform::String^ mId;
+        DnssdServiceFields mFields;     // the strings above as UTF-8, converted only when they change,
+                                        // and the binary port and address set the host and port strings are made from
         DnssdServiceUpdateType mType;
         bool mChanged;
     };
@@ -54,6 +62,12 @@ namespace dnssd_uwp
     internal:
         DnssdErrorType Initialize();
 
+        // returns at once and reports the outcome to callback, with handle, from the thread pool
+        DnssdErrorType InitializeAsync(DnssdServiceWatcherStartedCallback callback, DnssdServiceWatcherPtr handle);
+
+        // no started callback after this returns. Waits for InitializeAsync() to finish
+        void CancelStart();
+
         void RemoveDnssdServiceChangedCallback() {
             mDnssdServiceChangedCallback = nullptr;
         };
@@ -64,6 +78,28 @@ namespace dnssd_uwp
         void SetDnssdServiceChangedCallback(const DnssdServiceChangedCallback callback) {
             mDnssdServiceChangedCallback = callback;
         };
+
+        // report the changes of each scan in one call instead of one call per service
+        void SetDnssdServiceChangesCallback(const DnssdServiceChangesCallback callback) {
+            mDnssdServiceChangesCallback = callback;
+        };
+
+        // queue changes for dnssd_watcher_drain instead of calling back. Call before Initialize()
+        DnssdErrorType EnableEventQueue(size_t capacity);
+
+        // browse through these network adapters only, by NetworkAdapterId, instead of all of them. Call before Initialize()
+        void SetNetworkAdapters(const std::vector<Platform::Guid>& adapters) {
+            mAdapters = adapters;
+        };
+
+        DnssdEventQueue* GetEventQueue() {
+            return mEventQueue.get();
+        };
+
+        // the services found so far, from any thread
+        const DnssdServiceSnapshot* AcquireSnapshot() {
+            return mSnapshots.Acquire();
+        };
        
         // Constructor needs to be internal as this is an unsealed ref base class
         DnssdServiceWatcher(const char* serviceType, DnssdServiceChangedCallback callback = nullptr);
@@ -75,15 +111,28 @@ namespace dnssd_uwp
         void OnServiceEnumerationCompleted(Windows::Devices::Enumeration::DeviceWatcher^ sender, Platform::Object^ args);
         void OnServiceEnumerationStopped(Windows::Devices::Enumeration::DeviceWatcher^ sender, Platform::Object^ args);
         void UpdateDnssdService(DnssdServiceUpdateType type, Windows::Foundation::Collections::IMapView<Platform::String^, Platform::Object^>^ props, Platform::String^ serviceId);
+        void RemoveDnssdService(Platform::String^ serviceId);
         void OnDnssdServiceUpdated(DnssdServiceInstance^ info);
+        void PublishSnapshot();
+        concurrency::task<void> CreateWatcher();
 
         Windows::Devices::Enumeration::DeviceWatcher^ mServiceWatcher;
 
         DnssdServiceChangedCallback mDnssdServiceChangedCallback;
+        DnssdServiceChangesCallback mDnssdServiceChangesCallback;
+        DnssdServiceChanges mChanges;   // changes of the current scan for the batched callback
+        std::unique_ptr<DnssdEventQueue> mEventQueue;   // changes for dnssd_watcher_drain, nullptr when calling back
+        DnssdSnapshotPublisher mSnapshots;
 
         std::map<Platform::String^, DnssdServiceInstance^> mServices;
+        std::vector<DnssdAddress> mAddresses;   // addresses of the service being updated, reused
         Platform::String^ mServiceName;
+        std::vector<Platform::Guid> mAdapters;  // NetworkAdapterIds to browse through, empty for all
+        std::mutex mLock;
+        DnssdServiceWatcherStartedCallback mStartedCallback;    // InitializeAsync() only, until called or cancelled
+        std::unique_ptr<concurrency::task<void>> mStarting;    // InitializeAsync() task
         bool mRunning;
+        bool mSnapshotChanged;  // mServices changed since the last PublishSnapshot()
     };
 
 
@@ -0,0 +1,128 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "DnssdTxtRecord.h"
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    static char ToLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    DnssdTxtRecordReader::DnssdTxtRecordReader(DnssdTxtRecordPtr txt)
+        : mData(nullptr)
+        , mSize(0)
+    {
+        if (txt != nullptr)
+        {
+            uint32_t length;
+            memcpy(&length, txt, sizeof(length));
+            mData = reinterpret_cast<const uint8_t*>(txt) + sizeof(length);
+            mSize = length;
+        }
+    }
+
+    bool DnssdTxtRecordReader::Next(size_t& position, const char*& key, size_t& keyLength, const char*& value, size_t& valueLength) const
+    {
+        while (position < mSize)
+        {
+            size_t length = mData[position];
+            const char* entry = reinterpret_cast<const char*>(mData + position + 1);
+            if (position + 1 + length > mSize)
+            {
+                // truncated rdata: stop at the last complete string
+                position = mSize;
+                return false;
+            }
+            position += 1 + length;
+
+            const char* equals = static_cast<const char*>(memchr(entry, '=', length));
+            keyLength = equals != nullptr ? static_cast<size_t>(equals - entry) : length;
+            if (keyLength == 0)
+            {
+                // section 6.4: an empty string or a missing key is ignored
+                continue;
+            }
+
+            key = entry;
+            if (equals != nullptr)
+            {
+                value = equals + 1;
+                valueLength = length - keyLength - 1;
+            }
+            else
+            {
+                // a boolean attribute
+                value = nullptr;
+                valueLength = 0;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool DnssdTxtRecordReader::Find(const char* key, const char*& value, size_t& valueLength) const
+    {
+        size_t length = strlen(key);
+        size_t position = 0;
+        const char* entryKey;
+        size_t entryKeyLength;
+        while (Next(position, entryKey, entryKeyLength, value, valueLength))
+        {
+            if (entryKeyLength != length)
+            {
+                continue;
+            }
+
+            size_t i = 0;
+            while (i < length && ToLower(entryKey[i]) == ToLower(key[i]))
+            {
+                ++i;
+            }
+
+            // section 6.4: only the first occurrence of a key counts
+            if (i == length)
+            {
+                return true;
+            }
+        }
+        value = nullptr;
+        valueLength = 0;
+        return false;
+    }
+
+    void DnssdTxtRecordReader::Append(std::string& rdata, const char* entry, size_t length)
+    {
+        length = length > 255 ? 255 : length;
+        rdata.push_back(static_cast<char>(length));
+        rdata.append(entry, length);
+    }
+
+    std::string DnssdTxtRecordReader::MakeRdata(const DnssdTxtEntry* entries, size_t count)
+    {
+        std::string rdata;
+        std::string entry;
+        for (size_t i = 0; i < count; ++i)
+        {
+            entry = entries[i].key != nullptr ? entries[i].key : "";
+            if (entries[i].value != nullptr)
+            {
+                entry.push_back('=');
+                entry.append(entries[i].value, entries[i].valueLength);
+            }
+            Append(rdata, entry.data(), entry.size());
+        }
+        return rdata;
+    }
+}
@@ -0,0 +1,55 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "dnssd.h"
+
+namespace dnssd_uwp
+{
+    // Reads the key/value strings of a TXT record (RFC 6763 section 6) where they are.
+    // A DnssdTxtRecordPtr points at the 32 bit length of the Txt field of a DnssdServiceFields block,
+    // which is followed by the raw rdata as received: nothing is parsed until a key is asked for,
+    // and a lookup walks the length-prefixed strings without copying or allocating.
+    class DnssdTxtRecordReader
+    {
+    public:
+        DnssdTxtRecordReader(const uint8_t* data, size_t size)
+            : mData(data)
+            , mSize(size)
+        {
+        }
+
+        explicit DnssdTxtRecordReader(DnssdTxtRecordPtr txt);
+
+        // the entry at position (a byte offset, 0 for the first), then moves position past it.
+        // Empty strings and strings without a key are skipped. Returns false after the last entry
+        bool Next(size_t& position, const char*& key, size_t& keyLength, const char*& value, size_t& valueLength) const;
+
+        // the first entry with this key, compared case-insensitively. A key without '=' has a null value
+        bool Find(const char* key, const char*& value, size_t& valueLength) const;
+
+        // appends one "key=value" string to TXT rdata. Strings over 255 bytes are truncated
+        static void Append(std::string& rdata, const char* entry, size_t length);
+
+        // TXT rdata holding the entries in order. No entries give an empty string: the record needs a single empty one
+        static std::string MakeRdata(const DnssdTxtEntry* entries, size_t count);
+
+    private:
+        const uint8_t* mData;
+        size_t mSize;
+    };
+};
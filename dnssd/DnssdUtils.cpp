@@ -11,14 +11,22 @@
 // ******************************************************************
 
 #include "DnssdServiceWatcher.h"
+#include "DnssdTxtRecord.h"
 #include <algorithm>
 #include <cvt/wstring>
 #include <codecvt>
+#include <cstring>
 #include <memory>
 
 #define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
 #include <Windows.h>
 
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Iphlpapi.lib")
+
 namespace dnssd_uwp
 {
     Platform::String^ StringToPlatformString(const std::string& s)
@@ -44,6 +52,85 @@ namespace dnssd_uwp
         std::string stringUtf8 = convert.to_bytes(s->Data());
         return stringUtf8;
     }
-}
 
+    bool SetServiceField(DnssdServiceFields& fields, DnssdServiceFields::Field field, Platform::String^ s)
+    {
+        // host names, instance names and ports fit on the stack. Only longer strings need the heap
+        char buffer[1024];
+        int length = WideCharToMultiByte(CP_UTF8, 0, s->Data(), static_cast<int>(s->Length()), buffer, sizeof(buffer), NULL, NULL);
+        if (length > 0 || s->Length() == 0)
+        {
+            return fields.Set(field, buffer, static_cast<size_t>(length));
+        }
+
+        int bufferSize = WideCharToMultiByte(CP_UTF8, 0, s->Data(), static_cast<int>(s->Length()), nullptr, 0, NULL, NULL);
+        auto utf8 = std::make_unique<char[]>(bufferSize);
+        if (0 == WideCharToMultiByte(CP_UTF8, 0, s->Data(), static_cast<int>(s->Length()), utf8.get(), bufferSize, NULL, NULL))
+            throw std::exception("Can't convert string to UTF8");
+
+        return fields.Set(field, utf8.get(), static_cast<size_t>(bufferSize));
+    }
+
+    bool SetServiceTxt(DnssdServiceFields& fields, Platform::Object^ attributes)
+    {
+        std::string rdata;
+        auto box = dynamic_cast<Platform::IBoxArray<Platform::String^>^>(attributes);
+        if (box != nullptr)
+        {
+            char buffer[256];
+            for (Platform::String^ attribute : box->Value)
+            {
+                // a TXT string holds at most 255 bytes: longer attributes are cut there
+                int length = WideCharToMultiByte(CP_UTF8, 0, attribute->Data(), static_cast<int>(attribute->Length()), buffer, sizeof(buffer), NULL, NULL);
+                DnssdTxtRecordReader::Append(rdata, buffer, length > 0 ? static_cast<size_t>(length) : 0);
+            }
+        }
+        return fields.Set(DnssdServiceFields::Txt, rdata);
+    }
 
+    void ParseServiceAddresses(Platform::Array<Platform::String^>^ strings, uint16_t port, std::vector<DnssdAddress>& addresses)
+    {
+        addresses.clear();
+
+        DnssdAddress address;
+        for (Platform::String^ s : strings)
+        {
+            memset(&address, 0, sizeof(address));
+            if (InetPtonW(AF_INET, s->Data(), address.v4.address) == 1)
+            {
+                address.v4.family = AF_INET;
+                address.v4.port = htons(port);
+                addresses.push_back(address);
+            }
+            else if (InetPtonW(AF_INET6, s->Data(), address.v6.address) == 1)
+            {
+                address.v6.family = AF_INET6;
+                address.v6.port = htons(port);
+                addresses.push_back(address);
+            }
+        }
+    }
+
+    bool SetServiceHost(DnssdServiceFields& fields, const DnssdAddress& address)
+    {
+        char host[INET6_ADDRSTRLEN];
+        const void* bytes = address.family == AF_INET ? static_cast<const void*>(address.v4.address) : address.v6.address;
+        if (InetNtopA(address.family, bytes, host, sizeof(host)) == nullptr)
+        {
+            return false;
+        }
+        return fields.Set(DnssdServiceFields::Host, host, strlen(host));
+    }
+
+    bool GetNetworkAdapterId(uint32_t index, Platform::Guid& id)
+    {
+        NET_LUID luid;
+        GUID guid;
+        if (ConvertInterfaceIndexToLuid(index, &luid) != NO_ERROR || ConvertInterfaceLuidToGuid(&luid, &guid) != NO_ERROR)
+        {
+            return false;
+        }
+        id = Platform::Guid(guid);
+        return true;
+    }
+}
@@ -17,12 +17,30 @@
 #include <string>
 
 #include "dnssd.h"
+#include "DnssdServiceFields.h"
 
 namespace dnssd_uwp
 {
     Platform::String^ StringToPlatformString(const std::string& s);
     std::string PlatformStringToString(Platform::String^ s);
     std::string PlatformStringToString2(Platform::String^ s);
+
+    // converts s to UTF-8 straight into a field of fields. Returns true if the field changed
+    bool SetServiceField(DnssdServiceFields& fields, DnssdServiceFields::Field field, Platform::String^ s);
+
+    // rebuilds TXT rdata from the System.Devices.Dnssd.TextAttributes strings ("key=value") into the Txt field.
+    // attributes may be nullptr for a service without TXT data. Returns true if the field changed
+    bool SetServiceTxt(DnssdServiceFields& fields, Platform::Object^ attributes);
+
+    // parses the System.Devices.IpAddress strings into addresses with port filled in, replacing the contents of addresses
+    void ParseServiceAddresses(Platform::Array<Platform::String^>^ strings, uint16_t port, std::vector<DnssdAddress>& addresses);
+
+    // formats address into the Host field. Returns true if the field changed
+    bool SetServiceHost(DnssdServiceFields& fields, const DnssdAddress& address);
+
+    // the NetworkAdapterId of the interface with IfIndex index, as NetworkAdapter and the Dnssd properties have it.
+    // Returns false if there is no such interface
+    bool GetNetworkAdapterId(uint32_t index, Platform::Guid& id);
 };
 
 
@@ -13,6 +13,9 @@
 #include "dnssd.h"
 #include "DnssdService.h"
 #include "DnssdServiceWatcher.h"
+#include "DnssdTxtRecord.h"
+#include "DnssdUtils.h"
+#include <vector>
 #include <wrl\wrappers\corewrappers.h>
 
 
@@ -42,6 +45,32 @@ namespace dnssd_uwp
         return result;
     }
 
+    // the Windows Runtime delivers watcher and service events on its own thread pool: there is no loop to run
+    DNSSD_API DnssdErrorType dnssd_use_caller_thread()
+    {
+        return DNSSD_UNSPECIFIED_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_get_events_wait_handle(DnssdWaitHandle *handle)
+    {
+        return DNSSD_UNSPECIFIED_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_run_events(int timeoutMs)
+    {
+        return DNSSD_UNSPECIFIED_ERROR;
+    }
+
+    // the Windows Runtime does the networking: there is nothing of it to count
+    DNSSD_API DnssdErrorType dnssd_get_stats(DnssdStats *stats)
+    {
+        return DNSSD_UNSPECIFIED_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_write_trace(const char* path)
+    {
+        return DNSSD_UNSPECIFIED_ERROR;
+    }
 
     DNSSD_API DnssdErrorType dnssd_create_service_watcher(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherPtr *serviceWatcher)
     {
@@ -66,15 +95,255 @@ namespace dnssd_uwp
         return result;
     }
 
+    // interface indexes from the caller as the NetworkAdapterIds Windows knows them by
+    static bool GetNetworkAdapterIds(const uint32_t* interfaces, size_t interfaceCount, std::vector<Platform::Guid>& ids)
+    {
+        if (interfaces == nullptr && interfaceCount != 0)
+        {
+            return false;
+        }
+
+        ids.resize(interfaceCount);
+        for (size_t i = 0; i < interfaceCount; ++i)
+        {
+            if (!GetNetworkAdapterId(interfaces[i], ids[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_on_interfaces(const char* serviceName, DnssdServiceChangedCallback callback, const uint32_t* interfaces, size_t interfaceCount, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+        std::vector<Platform::Guid> adapters;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr || !GetNetworkAdapterIds(interfaces, interfaceCount, adapters))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = ref new DnssdServiceWatcher(serviceName, callback);
+        watcher->SetNetworkAdapters(adapters);
+        result = watcher->Initialize();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            *serviceWatcher = nullptr;
+            watcher = nullptr;
+        }
+        else
+        {
+            auto wrapper = new DnssdServiceWatcherWrapper(watcher);
+            *serviceWatcher = (DnssdServiceWatcherPtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_batched(const char* serviceName, DnssdServiceChangesCallback callback, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = ref new DnssdServiceWatcher(serviceName);
+        watcher->SetDnssdServiceChangesCallback(callback);
+        result = watcher->Initialize();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            *serviceWatcher = nullptr;
+            watcher = nullptr;
+        }
+        else
+        {
+            auto wrapper = new DnssdServiceWatcherWrapper(watcher);
+            *serviceWatcher = (DnssdServiceWatcherPtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_async(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherStartedCallback startedCallback, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        if (serviceWatcher == nullptr || serviceName == nullptr || startedCallback == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = ref new DnssdServiceWatcher(serviceName, callback);
+        auto wrapper = new DnssdServiceWatcherWrapper(watcher);
+        DnssdErrorType result = watcher->InitializeAsync(startedCallback, (DnssdServiceWatcherPtr)wrapper);
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete wrapper;
+        }
+        else
+        {
+            *serviceWatcher = (DnssdServiceWatcherPtr)wrapper;
+        }
+
+        return result;
+    }
+
     DNSSD_API void dnssd_free_service_watcher(DnssdServiceWatcherPtr serviceWatcher)
     {
         if (serviceWatcher)
         {
             DnssdServiceWatcherWrapper* watcher = (DnssdServiceWatcherWrapper*)serviceWatcher;
+            // an asynchronous start holds a reference: make sure it no longer reports to the freed handle
+            watcher->GetWatcher()->CancelStart();
             delete watcher;
         }
     }
 
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_queued(const char* serviceName, size_t capacity, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = ref new DnssdServiceWatcher(serviceName);
+        result = watcher->EnableEventQueue(capacity);
+        if (result == DNSSD_NO_ERROR)
+        {
+            result = watcher->Initialize();
+        }
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            *serviceWatcher = nullptr;
+            watcher = nullptr;
+        }
+        else
+        {
+            auto wrapper = new DnssdServiceWatcherWrapper(watcher);
+            *serviceWatcher = (DnssdServiceWatcherPtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_watcher_get_wait_handle(DnssdServiceWatcherPtr serviceWatcher, DnssdWaitHandle *handle)
+    {
+        if (serviceWatcher == nullptr || handle == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        DnssdServiceWatcherWrapper* wrapper = (DnssdServiceWatcherWrapper*)serviceWatcher;
+        DnssdEventQueue* queue = wrapper->GetWatcher()->GetEventQueue();
+        if (queue == nullptr)
+        {
+            // not created with dnssd_create_service_watcher_queued
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *handle = queue->GetWaitHandle();
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API size_t dnssd_watcher_drain(DnssdServiceWatcherPtr serviceWatcher, DnssdServiceChange* events, size_t max)
+    {
+        if (serviceWatcher == nullptr || events == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdServiceWatcherWrapper* wrapper = (DnssdServiceWatcherWrapper*)serviceWatcher;
+        DnssdEventQueue* queue = wrapper->GetWatcher()->GetEventQueue();
+        return queue != nullptr ? queue->Drain(events, max) : 0;
+    }
+
+    DNSSD_API size_t dnssd_watcher_dropped_events(DnssdServiceWatcherPtr serviceWatcher)
+    {
+        if (serviceWatcher == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdServiceWatcherWrapper* wrapper = (DnssdServiceWatcherWrapper*)serviceWatcher;
+        DnssdEventQueue* queue = wrapper->GetWatcher()->GetEventQueue();
+        return queue != nullptr ? static_cast<size_t>(queue->Dropped()) : 0;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_watcher_acquire_snapshot(DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceSnapshot** snapshot)
+    {
+        if (serviceWatcher == nullptr || snapshot == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        DnssdServiceWatcherWrapper* wrapper = (DnssdServiceWatcherWrapper*)serviceWatcher;
+        *snapshot = wrapper->GetWatcher()->AcquireSnapshot();
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API void dnssd_snapshot_release(const DnssdServiceSnapshot* snapshot)
+    {
+        DnssdSnapshotPublisher::Release(snapshot);
+    }
+
+    DNSSD_API DnssdErrorType dnssd_get_service_info2(const DnssdServiceInfo* info, DnssdServiceInfo2* info2)
+    {
+        if (info == nullptr || info->id == nullptr || info2 == nullptr || info2->size < sizeof(DnssdServiceInfo2))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        DnssdServiceFields::Fill2(*info, *info2);
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API size_t dnssd_get_service_addresses(const DnssdServiceInfo* info, DnssdAddress* addresses, size_t max)
+    {
+        if (info == nullptr || info->id == nullptr || (addresses == nullptr && max != 0))
+        {
+            return 0;
+        }
+
+        return DnssdServiceFields::GetAddresses(*info, addresses, max);
+    }
+
+    DNSSD_API int dnssd_txt_get(DnssdTxtRecordPtr txt, const char* key, const char** value, size_t* valueLength)
+    {
+        if (key == nullptr || value == nullptr || valueLength == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdTxtRecordReader reader(txt);
+        return reader.Find(key, *value, *valueLength) ? 1 : 0;
+    }
+
+    DNSSD_API int dnssd_txt_next(DnssdTxtRecordPtr txt, size_t* position, const char** key, size_t* keyLength, const char** value, size_t* valueLength)
+    {
+        if (position == nullptr || key == nullptr || keyLength == nullptr || value == nullptr || valueLength == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdTxtRecordReader reader(txt);
+        return reader.Next(*position, *key, *keyLength, *value, *valueLength) ? 1 : 0;
+    }
+
     DNSSD_API DnssdErrorType dnssd_create_service(const char* serviceName, const char* port, DnssdServicePtr *service)
     {
         DnssdErrorType result = DNSSD_NO_ERROR;
@@ -98,11 +367,130 @@ namespace dnssd_uwp
         return result;
     }
 
+    DNSSD_API DnssdErrorType dnssd_create_service_async(const char* serviceName, const char* port, DnssdServiceStartedCallback callback, DnssdServicePtr *service)
+    {
+        if (service == nullptr || serviceName == nullptr || port == nullptr || callback == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        auto s = ref new DnssdService(serviceName, port);
+        auto wrapper = new DnssdServiceWrapper(s);
+        DnssdErrorType result = s->StartAsync(callback, (DnssdServicePtr)wrapper);
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete wrapper;
+        }
+        else
+        {
+            *service = (DnssdServicePtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_register_services(const DnssdServiceRegistration* services, size_t count, DnssdServicePtr *service)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (service == nullptr || services == nullptr || count == 0)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (services[i].serviceName == nullptr || services[i].instanceName == nullptr || services[i].port == nullptr)
+            {
+                return DNSSD_INVALID_PARAMETER_ERROR;
+            }
+        }
+
+        auto s = ref new DnssdService(services, count);
+        result = s->Start();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            s = nullptr;
+        }
+        else
+        {
+            auto wrapper = new DnssdServiceWrapper(s);
+            *service = (DnssdServicePtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_register_services_on_interfaces(const DnssdServiceRegistration* services, size_t count, const uint32_t* interfaces, size_t interfaceCount, DnssdServicePtr *service)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+        std::vector<Platform::Guid> adapters;
+
+        if (service == nullptr || services == nullptr || count == 0 || !GetNetworkAdapterIds(interfaces, interfaceCount, adapters))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (services[i].serviceName == nullptr || services[i].instanceName == nullptr || services[i].port == nullptr)
+            {
+                return DNSSD_INVALID_PARAMETER_ERROR;
+            }
+        }
+
+        auto s = ref new DnssdService(services, count);
+        s->SetNetworkAdapters(adapters);
+        result = s->Start();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            s = nullptr;
+        }
+        else
+        {
+            auto wrapper = new DnssdServiceWrapper(s);
+            *service = (DnssdServicePtr)wrapper;
+        }
+
+        return result;
+    }
+
+    DNSSD_API const char* dnssd_service_get_instance_name(DnssdServicePtr service, size_t index)
+    {
+        DnssdServiceWrapper* wrapper = (DnssdServiceWrapper*)service;
+        if (wrapper == nullptr || index >= wrapper->GetService()->GetInstanceCount())
+        {
+            return nullptr;
+        }
+        return wrapper->GetService()->GetInstanceName(index).c_str();
+    }
+
+    DNSSD_API DnssdErrorType dnssd_service_update(DnssdServicePtr service, size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount)
+    {
+        DnssdServiceWrapper* wrapper = (DnssdServiceWrapper*)service;
+        if (wrapper == nullptr || (txt == nullptr && txtCount != 0))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+        return wrapper->GetService()->Update(index, port, txt, txtCount);
+    }
+
     DNSSD_API void dnssd_free_service(DnssdServicePtr service)
     {
         if (service)
         {
             DnssdServiceWrapper* wrapper = (DnssdServiceWrapper*)service;
+            // an asynchronous registration holds a reference: stop it reporting to the freed handle
+            wrapper->GetService()->Stop();
             delete wrapper;
         }
     }
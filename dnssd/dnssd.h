@@ -12,16 +12,31 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
 #if defined(DNSSD_EXPORT)
 #define DNSSD_API extern "C" __declspec(dllexport)
 #else
 #define DNSSD_API extern "C" __declspec(dllimport)
 #endif
+#else
+// native mDNS backend (see dnssd/native). __cdecl is the only calling convention on these platforms
+#define DNSSD_API extern "C" __attribute__((visibility("default")))
+#ifndef __cdecl
+#define __cdecl
+#endif
+#endif
 
 namespace dnssd_uwp
 {
     enum DnssdServiceUpdateType { ServiceAdded, ServiceUpdated, ServiceRemoved };
 
+    // outcome of an asynchronous service registration: under the requested instance name, under a new one after
+    // a name conflict, or not at all
+    enum DnssdServiceStartStatus { ServiceStarted, ServiceStartedRenamed, ServiceStartFailed };
+
     enum DnssdErrorType {
         DNSSD_NO_ERROR = 0,                         // no error
         DNSSD_WINDOWS_RUNTIME_INITIALIZATION_ERROR, // unable to initialize Windows Runtime
@@ -30,7 +45,7 @@ namespace dnssd_uwp
         DNSSD_LOCAL_HOSTNAME_NOT_FOUND_ERROR,       // dns service was not able to find a local hostname
         DNSSD_SERVICE_ALREADY_EXISTS_ERROR,         // dns service has already been started
         DNSSD_SERVICE_INITIALIZATION_ERROR,         // error starting dnssd service 
-        DNSSD_INVALID_SERVICE_NAME_ERROR,           // Invalid service name during registration
+        DNSSD_INVALID_SERVICE_NAME_ERROR,           // Invalid service name during registration or watcher creation
         DNSSD_SERVICE_SERVER_ERROR,                 // Dnssd server error during registration
         DNSSD_SERVICE_SECURITY_ERROR,               // Dnssd security error during registration
         DNSSD_INVALID_PARAMETER_ERROR,
@@ -42,6 +57,35 @@ namespace dnssd_uwp
     typedef void* DnssdServiceWatcherPtr;
     typedef void* DnssdServicePtr;
 
+    // waitable handle of a queued service watcher: an event HANDLE on Windows, an eventfd elsewhere
+#if defined(_WIN32)
+    typedef void* DnssdWaitHandle;
+#else
+    typedef int DnssdWaitHandle;
+#endif
+
+    // TXT record of a service, read with dnssd_txt_get and dnssd_txt_next. Valid as long as the strings of the
+    // DnssdServiceInfo it came from. A service without TXT data has a record with no entries
+    typedef struct DnssdTxtRecord DnssdTxtRecord;
+    typedef const DnssdTxtRecord* DnssdTxtRecordPtr;
+
+    // one service instance for dnssd_register_services
+    typedef struct
+    {
+        const char* serviceName;        // e.g. "_daap._tcp"
+        const char* instanceName;       // e.g. "Living Room". Registered as "Living Room (2)" if the name is taken
+        const char* port;
+    } DnssdServiceRegistration;
+
+    // one TXT entry for dnssd_service_update: "key=value", or just "key" if value is nullptr. value may be binary.
+    // An entry longer than 255 bytes is cut there
+    typedef struct
+    {
+        const char* key;
+        const char* value;
+        size_t valueLength;
+    } DnssdTxtEntry;
+
     // dnssd service info
     typedef struct 
     {
@@ -49,14 +93,124 @@ namespace dnssd_uwp
         const char* instanceName;
         const char* host;
         const char* port;
+        DnssdTxtRecordPtr txt;
     } DnssdServiceInfo;
 
     typedef DnssdServiceInfo* DnssdServiceInfoPtr;
 
+    // An address of a service together with its port, laid out like sockaddr_in or sockaddr_in6 (family is the
+    // platform's AF_INET or AF_INET6), so it can be passed to connect() as a sockaddr
+    typedef union
+    {
+        uint16_t family;
+        struct
+        {
+            uint16_t family;
+            uint16_t port;              // network byte order
+            uint8_t address[4];
+            uint8_t zero[8];
+        } v4;
+        struct
+        {
+            uint16_t family;
+            uint16_t port;              // network byte order
+            uint32_t flowInfo;
+            uint8_t address[16];
+            uint32_t scopeId;
+        } v6;
+    } DnssdAddress;
+
+    #define DNSSD_INLINE_ADDRESS_COUNT 4
+
+    // Service info with the port as a number and the addresses in binary form, filled in from a DnssdServiceInfo
+    // by dnssd_get_service_info2. Set size to sizeof(DnssdServiceInfo2) first: later versions only add fields at the end
+    typedef struct
+    {
+        uint32_t size;
+        const char* id;
+        const char* instanceName;
+        uint16_t port;                  // host byte order
+        DnssdTxtRecordPtr txt;
+        size_t addressCount;            // every IPv4 and IPv6 address of the service, IPv4 first
+        DnssdAddress addresses[DNSSD_INLINE_ADDRESS_COUNT];  // the first of them. Use dnssd_get_service_addresses for more
+    } DnssdServiceInfo2;
+
+    // one entry of a batched service change notification
+    typedef struct
+    {
+        DnssdServiceUpdateType update;
+        DnssdServiceInfo info;
+    } DnssdServiceChange;
+
+    // immutable view of the services a watcher currently sees. Valid until released with dnssd_snapshot_release
+    typedef struct
+    {
+        size_t count;
+        const DnssdServiceInfo* services;
+    } DnssdServiceSnapshot;
+
+    // latency in microseconds, from a histogram that knows every value to within 3%
+    typedef struct
+    {
+        uint64_t count;
+        uint64_t min;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
+    } DnssdLatencyStats;
+
+    typedef struct
+    {
+        uint32_t size;
+        uint64_t packetsReceived;
+        uint64_t packetsSent;
+        uint64_t packetsTimestamped;    // received packets whose receive time the kernel gave
+        uint64_t socketErrors;          // sockets that could not be opened, packets that could not be sent or received
+        uint64_t recordsParsed;         // response records read by watchers
+        uint64_t cacheHits;             // records received again while cached
+        uint64_t cacheMisses;           // records received for the first time
+        uint64_t cacheEvictions;        // records that left the cache: expired, said goodbye, flushed or no longer needed
+        uint64_t queriesSent;
+        uint64_t answersSuppressed;     // answers left out of responses because the querier listed them
+        uint64_t callbacksDelivered;    // changes reported to the application: callbacks, batched changes and queued events
+        DnssdLatencyStats receiveToCallback;    // from a packet's receive time, the kernel's where it timestamps
+                                                // packets, to the report of a change it brought
+    } DnssdStats;
+
     // dnssd functions
     typedef DnssdErrorType(__cdecl *DnssdInitializeFunc)();
     DNSSD_API DnssdErrorType __cdecl dnssd_initialize();
 
+    // dnssd event loop functions. Every watcher and service of the process is served by one event loop, on a library
+    // thread by default. dnssd_use_caller_thread, called before the first watcher or service is created, runs it on
+    // the application's threads instead: callbacks then only happen inside dnssd_run_events, and the blocking create
+    // functions run the loop themselves while they wait. DNSSD_SERVICE_ALREADY_EXISTS_ERROR if the loop already runs
+    typedef DnssdErrorType(__cdecl *DnssdUseCallerThreadFunc)();
+    DNSSD_API DnssdErrorType __cdecl dnssd_use_caller_thread();
+
+    // handle that is signaled while the event loop has work, for dnssd_run_events. Caller thread mode only
+    typedef DnssdErrorType(__cdecl *DnssdGetEventsWaitHandleFunc)(DnssdWaitHandle *handle);
+    DNSSD_API DnssdErrorType __cdecl dnssd_get_events_wait_handle(DnssdWaitHandle *handle);
+
+    // waits up to timeoutMs (-1 for ever, 0 not at all) for work and does it, callbacks included. One thread at a time,
+    // caller thread mode only, not from a callback
+    typedef DnssdErrorType(__cdecl *DnssdRunEventsFunc)(int timeoutMs);
+    DNSSD_API DnssdErrorType __cdecl dnssd_run_events(int timeoutMs);
+
+    // what the library has done since the process started, for dnssd_get_stats. Counting is per thread and always on.
+    // Set size to sizeof(DnssdStats) first: later versions only add fields at the end
+    typedef DnssdErrorType(__cdecl *DnssdGetStatsFunc)(DnssdStats *stats);
+    DNSSD_API DnssdErrorType __cdecl dnssd_get_stats(DnssdStats *stats);
+
+    // writes the spans recorded by the trace points (socket reads and writes, parsing, cache updates, timers, queries,
+    // callbacks) to path as Chrome trace event JSON, for chrome://tracing or ui.perfetto.dev. Each thread keeps its
+    // newest 65536 spans. DNSSD_UNSPECIFIED_ERROR unless the library was built with DNSSD_TRACING, or if path
+    // cannot be written
+    typedef DnssdErrorType(__cdecl *DnssdWriteTraceFunc)(const char* path);
+    DNSSD_API DnssdErrorType __cdecl dnssd_write_trace(const char* path);
+
     // dnssd service watcher functions
 
     // dnssd service watcher changed callback
@@ -66,13 +220,110 @@ namespace dnssd_uwp
     typedef  DnssdErrorType(__cdecl *DnssdCreateServiceWatcherFunc)(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherPtr *serviceWatcher);
     DNSSD_API DnssdErrorType __cdecl dnssd_create_service_watcher(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherPtr * serviceWatcher);
 
+    // dnssd service watcher batched changed callback. Called once per update pass with every service that changed.
+    // The array and the strings it points to are only valid for the duration of the callback
+    typedef void(*DnssdServiceChangesCallback) (const DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceChange* changes, size_t count);
+
+    // dnssd service watcher batched create function. Free the watcher with dnssd_free_service_watcher
+    typedef  DnssdErrorType(__cdecl *DnssdCreateServiceWatcherBatchedFunc)(const char* serviceName, DnssdServiceChangesCallback callback, DnssdServiceWatcherPtr *serviceWatcher);
+    DNSSD_API DnssdErrorType __cdecl dnssd_create_service_watcher_batched(const char* serviceName, DnssdServiceChangesCallback callback, DnssdServiceWatcherPtr * serviceWatcher);
+
+    // dnssd service watcher queued create function. Changes are queued instead of reported with a callback:
+    // wait for the watcher's wait handle, then collect them with dnssd_watcher_drain. capacity 0 uses the default
+    typedef  DnssdErrorType(__cdecl *DnssdCreateServiceWatcherQueuedFunc)(const char* serviceName, size_t capacity, DnssdServiceWatcherPtr *serviceWatcher);
+    DNSSD_API DnssdErrorType __cdecl dnssd_create_service_watcher_queued(const char* serviceName, size_t capacity, DnssdServiceWatcherPtr * serviceWatcher);
+
+    // handle that is signaled while changes are waiting in a queued watcher
+    typedef  DnssdErrorType(__cdecl *DnssdWatcherGetWaitHandleFunc)(DnssdServiceWatcherPtr serviceWatcher, DnssdWaitHandle *handle);
+    DNSSD_API DnssdErrorType __cdecl dnssd_watcher_get_wait_handle(DnssdServiceWatcherPtr serviceWatcher, DnssdWaitHandle *handle);
+
+    // copies up to max queued changes into events and returns how many. The strings stay valid until the next
+    // dnssd_watcher_drain call. Call from one thread at a time
+    typedef size_t(__cdecl *DnssdWatcherDrainFunc)(DnssdServiceWatcherPtr serviceWatcher, DnssdServiceChange* events, size_t max);
+    DNSSD_API size_t __cdecl dnssd_watcher_drain(DnssdServiceWatcherPtr serviceWatcher, DnssdServiceChange* events, size_t max);
+
+    // changes dropped because the queue was full. Resynchronize with dnssd_watcher_acquire_snapshot when it grows
+    typedef size_t(__cdecl *DnssdWatcherDroppedEventsFunc)(DnssdServiceWatcherPtr serviceWatcher);
+    DNSSD_API size_t __cdecl dnssd_watcher_dropped_events(DnssdServiceWatcherPtr serviceWatcher);
+
+    // dnssd service watcher started callback: the outcome of dnssd_create_service_watcher_async.
+    // Free the watcher with dnssd_free_service_watcher whatever the outcome, but not from inside the callback
+    typedef void(*DnssdServiceWatcherStartedCallback) (const DnssdServiceWatcherPtr serviceWatcher, DnssdErrorType error);
+
+    // dnssd service watcher asynchronous create function. Returns without waiting for the watcher to start.
+    // If it returns DNSSD_NO_ERROR, startedCallback is called exactly once, from the event loop, unless the watcher is freed first
+    typedef  DnssdErrorType(__cdecl *DnssdCreateServiceWatcherAsyncFunc)(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherStartedCallback startedCallback, DnssdServiceWatcherPtr *serviceWatcher);
+    DNSSD_API DnssdErrorType __cdecl dnssd_create_service_watcher_async(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherStartedCallback startedCallback, DnssdServiceWatcherPtr * serviceWatcher);
+
+    // dnssd service watcher create function restricted to interfaceCount network interfaces, by index
+    // (if_nametoindex, or IfIndex of GetAdaptersAddresses). Services are reported once whichever interfaces they are found on.
+    // interfaceCount 0 browses where dnssd_create_service_watcher does. An index that is not a usable interface is an invalid parameter
+    typedef  DnssdErrorType(__cdecl *DnssdCreateServiceWatcherOnInterfacesFunc)(const char* serviceName, DnssdServiceChangedCallback callback, const uint32_t* interfaces, size_t interfaceCount, DnssdServiceWatcherPtr *serviceWatcher);
+    DNSSD_API DnssdErrorType __cdecl dnssd_create_service_watcher_on_interfaces(const char* serviceName, DnssdServiceChangedCallback callback, const uint32_t* interfaces, size_t interfaceCount, DnssdServiceWatcherPtr * serviceWatcher);
+
     typedef void(__cdecl *DnssdFreeServiceWatcherFunc)(DnssdServiceWatcherPtr serviceWatcher);
     DNSSD_API void __cdecl dnssd_free_service_watcher(DnssdServiceWatcherPtr serviceWatcher);
 
-    // dnssd service create function
+    // dnssd service watcher snapshot functions. Safe to call from any thread without locking;
+    // a snapshot stays valid after the watcher changes or is freed, until it is released
+    typedef DnssdErrorType(__cdecl *DnssdWatcherAcquireSnapshotFunc)(DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceSnapshot** snapshot);
+    DNSSD_API DnssdErrorType __cdecl dnssd_watcher_acquire_snapshot(DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceSnapshot** snapshot);
+
+    typedef void(__cdecl *DnssdSnapshotReleaseFunc)(const DnssdServiceSnapshot* snapshot);
+    DNSSD_API void __cdecl dnssd_snapshot_release(const DnssdServiceSnapshot* snapshot);
+
+    // dnssd service info functions. info must come from a callback, drain or snapshot; the strings of info2 live as long as its strings
+    typedef DnssdErrorType(__cdecl *DnssdGetServiceInfo2Func)(const DnssdServiceInfo* info, DnssdServiceInfo2* info2);
+    DNSSD_API DnssdErrorType __cdecl dnssd_get_service_info2(const DnssdServiceInfo* info, DnssdServiceInfo2* info2);
+
+    // copies up to max addresses of the service and returns how many it has
+    typedef size_t(__cdecl *DnssdGetServiceAddressesFunc)(const DnssdServiceInfo* info, DnssdAddress* addresses, size_t max);
+    DNSSD_API size_t __cdecl dnssd_get_service_addresses(const DnssdServiceInfo* info, DnssdAddress* addresses, size_t max);
+
+    // dnssd TXT record functions. Values are not NUL terminated and may be binary; they point into the record.
+    // dnssd_txt_get looks up a key case-insensitively and returns 1 if it is present (a key without '=' has a null value)
+    typedef int(__cdecl *DnssdTxtGetFunc)(DnssdTxtRecordPtr txt, const char* key, const char** value, size_t* valueLength);
+    DNSSD_API int __cdecl dnssd_txt_get(DnssdTxtRecordPtr txt, const char* key, const char** value, size_t* valueLength);
+
+    // iterates over the entries in record order: start with *position = 0, returns 0 after the last entry
+    typedef int(__cdecl *DnssdTxtNextFunc)(DnssdTxtRecordPtr txt, size_t* position, const char** key, size_t* keyLength, const char** value, size_t* valueLength);
+    DNSSD_API int __cdecl dnssd_txt_next(DnssdTxtRecordPtr txt, size_t* position, const char** key, size_t* keyLength, const char** value, size_t* valueLength);
+
+    // dnssd service create function. Blocks until the service is registered, so it cannot be called from a callback:
+    // use dnssd_create_service_async there
     typedef  DnssdErrorType(__cdecl *DnssdCreateServiceFunc)(const char* serviceName, const char* port, DnssdServicePtr *service);
     DNSSD_API DnssdErrorType __cdecl dnssd_create_service(const char* serviceName, const char* port, DnssdServicePtr *service);
 
+    // dnssd service started callback: the outcome of dnssd_create_service_async. instanceName is the registered
+    // instance name, only valid during the callback. Free the service with dnssd_free_service whatever the outcome,
+    // but not from inside the callback
+    typedef void(*DnssdServiceStartedCallback) (const DnssdServicePtr service, DnssdServiceStartStatus status, DnssdErrorType error, const char* instanceName);
+
+    // dnssd service asynchronous create function. Returns without waiting for the service to be registered.
+    // If it returns DNSSD_NO_ERROR, callback is called exactly once, from the event loop, unless the service is freed first
+    typedef  DnssdErrorType(__cdecl *DnssdCreateServiceAsyncFunc)(const char* serviceName, const char* port, DnssdServiceStartedCallback callback, DnssdServicePtr *service);
+    DNSSD_API DnssdErrorType __cdecl dnssd_create_service_async(const char* serviceName, const char* port, DnssdServiceStartedCallback callback, DnssdServicePtr *service);
+
+    // registers count instances as one service, probed and announced together, and blocks until all of them are registered.
+    // A name conflict renames only the instance it concerns. Not from a callback. Free them all with dnssd_free_service
+    typedef  DnssdErrorType(__cdecl *DnssdRegisterServicesFunc)(const DnssdServiceRegistration* services, size_t count, DnssdServicePtr *service);
+    DNSSD_API DnssdErrorType __cdecl dnssd_register_services(const DnssdServiceRegistration* services, size_t count, DnssdServicePtr *service);
+
+    // dnssd_register_services restricted to interfaceCount network interfaces, by index. Each interface answers queries
+    // with its own address only. interfaceCount 0 registers where dnssd_register_services does
+    typedef  DnssdErrorType(__cdecl *DnssdRegisterServicesOnInterfacesFunc)(const DnssdServiceRegistration* services, size_t count, const uint32_t* interfaces, size_t interfaceCount, DnssdServicePtr *service);
+    DNSSD_API DnssdErrorType __cdecl dnssd_register_services_on_interfaces(const DnssdServiceRegistration* services, size_t count, const uint32_t* interfaces, size_t interfaceCount, DnssdServicePtr *service);
+
+    // the name instance index of a registered service ended up with, or nullptr. Valid until the service is freed
+    typedef const char*(__cdecl *DnssdServiceGetInstanceNameFunc)(DnssdServicePtr service, size_t index);
+    DNSSD_API const char* __cdecl dnssd_service_get_instance_name(DnssdServicePtr service, size_t index);
+
+    // changes the port or TXT data of registered instance index in place: no new probing, no goodbye, and only the changed
+    // records are announced, once. Watchers see ServiceUpdated. port nullptr keeps the port; txt nullptr keeps the TXT data,
+    // any other txt replaces it with txtCount entries (0 for none). The announcement goes out from a library thread
+    typedef  DnssdErrorType(__cdecl *DnssdServiceUpdateFunc)(DnssdServicePtr service, size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount);
+    DNSSD_API DnssdErrorType __cdecl dnssd_service_update(DnssdServicePtr service, size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount);
+
     typedef void(__cdecl *DnssdFreeServiceFunc)(DnssdServicePtr service);
     DNSSD_API void __cdecl dnssd_free_service(DnssdServicePtr service);
 
@@ -0,0 +1,355 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsAnswerIndex.h"
+#include "MdnsQuery.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    static void PutU16(uint8_t* out, uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value >> 8);
+        out[1] = static_cast<uint8_t>(value);
+    }
+
+    static void PutU32(uint8_t* out, uint32_t value)
+    {
+        PutU16(out, static_cast<uint16_t>(value >> 16));
+        PutU16(out + 2, static_cast<uint16_t>(value));
+    }
+
+    //
+    // MdnsAnswerIndex
+    //
+
+    const MdnsAnswerIndex::RecordId MdnsAnswerIndex::kNoRecord;
+    const uint32_t MdnsAnswerIndex::kNoName;
+
+    MdnsAnswerIndex::MdnsAnswerIndex()
+    {
+    }
+
+    uint32_t MdnsAnswerIndex::GroupHash(uint32_t nameHash, uint16_t type, uint16_t rclass)
+    {
+        return (nameHash ^ ((static_cast<uint32_t>(type) << 16) | rclass)) * 16777619u;
+    }
+
+    const MdnsAnswerIndex::Group* MdnsAnswerIndex::FindGroup(const MdnsNameView& name, uint32_t nameHash, uint16_t type, uint16_t rclass) const
+    {
+        auto range = mGroupsByHash.equal_range(GroupHash(nameHash, type, rclass));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const Group& group = mGroups[it->second];
+            if (group.type == type && group.rclass == rclass && name.Equals(group.name))
+            {
+                return &group;
+            }
+        }
+        return nullptr;
+    }
+
+    uint32_t MdnsAnswerIndex::AddName(const std::string& name, size_t offset)
+    {
+        if (offset >= name.size() || name[offset] == 0)
+        {
+            return kNoName;
+        }
+
+        std::string suffix = name.substr(offset);
+        auto found = mNamesByWire.find(suffix);
+        if (found != mNamesByWire.end())
+        {
+            return found->second;
+        }
+
+        size_t length = 1 + static_cast<uint8_t>(name[offset]);
+        NameNode node;
+        node.label = name.substr(offset, length);
+        node.parent = AddName(name, offset + length);
+
+        uint32_t id = static_cast<uint32_t>(mNames.size());
+        mNames.push_back(node);
+        mNamesByWire.emplace(suffix, id);
+        return id;
+    }
+
+    void MdnsAnswerIndex::Build(Entry& entry)
+    {
+        const MdnsRecord& record = entry.record;
+        entry.knownAnswerKey = MdnsKnownAnswerList::MakeKey(record);
+        entry.name = AddName(record.name, 0);
+
+        PutU16(entry.fixed, record.type);
+        PutU16(entry.fixed + 2, record.rclass | (record.cacheFlush ? MDNS_CACHE_FLUSH_BIT : 0));
+        PutU32(entry.fixed + 4, record.ttl);
+        PutU16(entry.fixed + 8, 0);
+
+        // names in PTR and SRV rdata are compressed like the owner name
+        size_t nameStart = record.type == MDNS_TYPE_PTR ? 0 : record.type == MDNS_TYPE_SRV && record.rdata.size() > 6 ? 6 : std::string::npos;
+        if (nameStart != std::string::npos)
+        {
+            entry.rdata = record.rdata.substr(0, nameStart);
+            entry.rdataName = AddName(record.rdata, nameStart);
+        }
+        else
+        {
+            entry.rdata = record.rdata;
+            entry.rdataName = kNoName;
+        }
+    }
+
+    MdnsAnswerIndex::RecordId MdnsAnswerIndex::Add(const MdnsRecord& record, uint32_t tag)
+    {
+        RecordId id;
+        if (!mFree.empty())
+        {
+            id = mFree.back();
+            mFree.pop_back();
+        }
+        else
+        {
+            id = static_cast<RecordId>(mRecords.size());
+            mRecords.emplace_back();
+        }
+
+        Entry& entry = mRecords[id];
+        entry.record = record;
+        entry.tag = tag;
+        entry.live = true;
+        Build(entry);
+
+        const MdnsNameView name(reinterpret_cast<const uint8_t*>(record.name.data()), record.name.size(), 0);
+        uint32_t nameHash = name.Hash();
+        Group* group = const_cast<Group*>(FindGroup(name, nameHash, record.type, record.rclass));
+        if (group == nullptr)
+        {
+            mGroupsByHash.emplace(GroupHash(nameHash, record.type, record.rclass), mGroups.size());
+            mGroups.push_back(Group{ record.name, record.type, record.rclass, std::vector<RecordId>() });
+            group = &mGroups.back();
+        }
+        group->records.push_back(id);
+
+        bool known = std::any_of(mTypes.begin(), mTypes.end(), [&](const TypeKey& key) { return key.type == record.type && key.rclass == record.rclass; });
+        if (!known)
+        {
+            mTypes.push_back(TypeKey{ record.type, record.rclass });
+        }
+        return id;
+    }
+
+    void MdnsAnswerIndex::Update(RecordId id, const MdnsRecord& record)
+    {
+        Entry& entry = mRecords[id];
+        entry.record.cacheFlush = record.cacheFlush;
+        entry.record.ttl = record.ttl;
+        entry.record.rdata = record.rdata;
+        Build(entry);
+    }
+
+    void MdnsAnswerIndex::Remove(RecordId id)
+    {
+        Entry& entry = mRecords[id];
+        if (!entry.live)
+        {
+            return;
+        }
+
+        // an emptied group stays, a record with its name, type and class may come back
+        const MdnsRecord& record = entry.record;
+        const MdnsNameView name(reinterpret_cast<const uint8_t*>(record.name.data()), record.name.size(), 0);
+        Group* group = const_cast<Group*>(FindGroup(name, name.Hash(), record.type, record.rclass));
+        if (group != nullptr)
+        {
+            group->records.erase(std::remove(group->records.begin(), group->records.end(), id), group->records.end());
+        }
+
+        entry.live = false;
+        mFree.push_back(id);
+    }
+
+    void MdnsAnswerIndex::Clear()
+    {
+        mRecords.clear();
+        mFree.clear();
+        mGroups.clear();
+        mGroupsByHash.clear();
+        mTypes.clear();
+        mNames.clear();
+        mNamesByWire.clear();
+    }
+
+    //
+    // MdnsResponseWriter
+    //
+
+    MdnsResponseWriter::MdnsResponseWriter(const MdnsAnswerIndex& index, uint8_t* buffer, size_t capacity)
+        : mIndex(index)
+        , mBuffer(buffer)
+        , mCapacity(capacity)
+    {
+        Reset(0, 0);
+    }
+
+    void MdnsResponseWriter::PatchU16(size_t offset, uint16_t value)
+    {
+        PutU16(mBuffer + offset, value);
+    }
+
+    void MdnsResponseWriter::Reset(uint16_t id, uint16_t flags)
+    {
+        mSize = 0;
+        mSection = MdnsQuestionSection;
+        memset(mCounts, 0, sizeof(mCounts));
+
+        for (uint32_t node : mWrittenNames)
+        {
+            mNameOffsets[node] = 0;
+        }
+        mWrittenNames.clear();
+        mNameOffsets.resize(mIndex.mNames.size(), 0);
+
+        if (mCapacity >= MDNS_HEADER_SIZE)
+        {
+            memset(mBuffer, 0, MDNS_HEADER_SIZE);
+            PatchU16(0, id);
+            PatchU16(2, flags);
+            mSize = MDNS_HEADER_SIZE;
+        }
+    }
+
+    bool MdnsResponseWriter::AddQuestion(const MdnsQuestionView& question)
+    {
+        if (mSection != MdnsQuestionSection || mSize < MDNS_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        size_t length = question.name.CopyTo(mBuffer + mSize, mCapacity - mSize);
+        if (length == 0 || mSize + length + 4 > mCapacity)
+        {
+            return false;
+        }
+        PatchU16(mSize + length, question.type);
+        PatchU16(mSize + length + 2, MDNS_CLASS_IN);
+
+        // answers can point back at the question, like MdnsMessageWriter does. Legacy queries are rare,
+        // so this looks up each suffix of the name rather than keep a case-insensitive table
+        const char* name = reinterpret_cast<const char*>(mBuffer + mSize);
+        for (size_t pos = 0; name[pos] != 0 && mSize + pos < 0x4000; pos += 1 + static_cast<uint8_t>(name[pos]))
+        {
+            auto node = mIndex.mNamesByWire.find(std::string(name + pos, length - pos));
+            if (node != mIndex.mNamesByWire.end() && mNameOffsets[node->second] == 0)
+            {
+                mNameOffsets[node->second] = static_cast<uint16_t>(mSize + pos);
+                mWrittenNames.push_back(node->second);
+            }
+        }
+        mSize += length + 4;
+        PatchU16(4, ++mCounts[MdnsQuestionSection]);
+        return true;
+    }
+
+    bool MdnsResponseWriter::WriteName(uint32_t node)
+    {
+        while (node != MdnsAnswerIndex::kNoName)
+        {
+            uint16_t offset = mNameOffsets[node];
+            if (offset != 0)
+            {
+                if (mSize + 2 > mCapacity)
+                {
+                    return false;
+                }
+                PatchU16(mSize, 0xc000 | offset);
+                mSize += 2;
+                return true;
+            }
+
+            const std::string& label = mIndex.mNames[node].label;
+            if (mSize + label.size() > mCapacity)
+            {
+                return false;
+            }
+            if (mSize < 0x4000)
+            {
+                mNameOffsets[node] = static_cast<uint16_t>(mSize);
+                mWrittenNames.push_back(node);
+            }
+            memcpy(mBuffer + mSize, label.data(), label.size());
+            mSize += label.size();
+            node = mIndex.mNames[node].parent;
+        }
+
+        if (mSize + 1 > mCapacity)
+        {
+            return false;
+        }
+        mBuffer[mSize++] = 0;
+        return true;
+    }
+
+    bool MdnsResponseWriter::WriteRecord(MdnsSection section, MdnsAnswerIndex::RecordId id, bool legacy, uint32_t maxTtl)
+    {
+        if (section < mSection || mSize < MDNS_HEADER_SIZE)
+        {
+            return false;
+        }
+        mSection = section;
+
+        const MdnsAnswerIndex::Entry& entry = mIndex.mRecords[id];
+        size_t start = mSize;
+        size_t written = mWrittenNames.size();
+        bool ok = WriteName(entry.name) && mSize + sizeof(entry.fixed) + entry.rdata.size() <= mCapacity;
+
+        size_t rdataStart = mSize + sizeof(entry.fixed);
+        if (ok)
+        {
+            memcpy(mBuffer + mSize, entry.fixed, sizeof(entry.fixed));
+            if (legacy)
+            {
+                PatchU16(mSize + 2, entry.record.rclass);
+                PutU32(mBuffer + mSize + 4, std::min(entry.record.ttl, maxTtl));
+            }
+            memcpy(mBuffer + rdataStart, entry.rdata.data(), entry.rdata.size());
+            mSize = rdataStart + entry.rdata.size();
+            ok = entry.rdataName == MdnsAnswerIndex::kNoName || WriteName(entry.rdataName);
+        }
+
+        if (!ok)
+        {
+            // forget the names this record wrote, they are not in the packet any more
+            for (size_t i = written; i < mWrittenNames.size(); ++i)
+            {
+                mNameOffsets[mWrittenNames[i]] = 0;
+            }
+            mWrittenNames.resize(written);
+            mSize = start;
+            return false;
+        }
+
+        PatchU16(rdataStart - 2, static_cast<uint16_t>(mSize - rdataStart));
+        PatchU16(4 + 2 * section, ++mCounts[section]);
+        return true;
+    }
+
+    bool MdnsResponseWriter::AddRecord(MdnsSection section, MdnsAnswerIndex::RecordId id)
+    {
+        return WriteRecord(section, id, false, 0);
+    }
+
+    bool MdnsResponseWriter::AddRecord(MdnsSection section, MdnsAnswerIndex::RecordId id, uint32_t maxTtl)
+    {
+        return WriteRecord(section, id, true, maxTtl);
+    }
+}
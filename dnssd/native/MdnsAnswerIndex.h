@@ -0,0 +1,180 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MdnsMessage.h"
+
+namespace dnssd_uwp
+{
+    // A responder's own records, indexed for answering questions.
+    // Records are found by (name, type, class) in a hash table, comparing the question name case-insensitively
+    // where it lies in the query packet. Each record is also kept ready to be copied into a response: its type,
+    // class, TTL and the rdata up to any name as prebuilt bytes, and its names as nodes of a name tree shared by
+    // all records ("_daap._tcp.local" is the parent of "Living Room._daap._tcp.local"). MdnsResponseWriter then
+    // compresses a name with one table lookup per label instead of searching the packet for suffixes.
+    // The wire form of a record is built by Add() and Update(), never while answering.
+    class MdnsAnswerIndex
+    {
+    public:
+        typedef uint32_t RecordId;
+        static const RecordId kNoRecord = 0xffffffff;
+
+        MdnsAnswerIndex();
+
+        // tag is for the owner, to tell what the record belongs to when a question finds it
+        RecordId Add(const MdnsRecord& record, uint32_t tag);
+
+        // a new TTL or rdata for a record. Name, type and class stay the same
+        void Update(RecordId id, const MdnsRecord& record);
+
+        void Remove(RecordId id);
+        void Clear();
+
+        const MdnsRecord& GetRecord(RecordId id) const {
+            return mRecords[id].record;
+        }
+
+        uint32_t GetTag(RecordId id) const {
+            return mRecords[id].tag;
+        }
+
+        // the record's MdnsKnownAnswerList key
+        const std::string& GetKnownAnswerKey(RecordId id) const {
+            return mRecords[id].knownAnswerKey;
+        }
+
+        // calls f(RecordId) for each record answering a question. MDNS_TYPE_ANY matches every type
+        // and MDNS_CLASS_ANY every class
+        template <typename F>
+        void Find(const MdnsNameView& name, uint16_t type, uint16_t qclass, F f) const
+        {
+            uint32_t hash = name.Hash();
+            for (const auto& key : mTypes)
+            {
+                if ((type == MDNS_TYPE_ANY || type == key.type) && (qclass == MDNS_CLASS_ANY || qclass == key.rclass))
+                {
+                    const Group* group = FindGroup(name, hash, key.type, key.rclass);
+                    if (group != nullptr)
+                    {
+                        for (RecordId id : group->records)
+                        {
+                            f(id);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        friend class MdnsResponseWriter;
+
+        static const uint32_t kNoName = 0xffffffff;
+
+        // one label of a name and the node of the rest of it
+        struct NameNode
+        {
+            std::string label;  // length byte and label
+            uint32_t parent;    // kNoName after the last label
+        };
+
+        struct Entry
+        {
+            MdnsRecord record;
+            std::string knownAnswerKey;
+            uint32_t tag;
+            uint32_t name;          // owner name node
+            uint8_t fixed[10];      // type, class with the cache-flush bit, TTL and an rdlength to patch
+            std::string rdata;      // the rdata, or the part of it before rdataName
+            uint32_t rdataName;     // PTR or SRV target node, kNoName for other types
+            bool live;
+        };
+
+        // the records sharing a name, type and class
+        struct Group
+        {
+            std::string name;
+            uint16_t type;
+            uint16_t rclass;
+            std::vector<RecordId> records;
+        };
+
+        struct TypeKey
+        {
+            uint16_t type;
+            uint16_t rclass;
+        };
+
+        static uint32_t GroupHash(uint32_t nameHash, uint16_t type, uint16_t rclass);
+        const Group* FindGroup(const MdnsNameView& name, uint32_t nameHash, uint16_t type, uint16_t rclass) const;
+        uint32_t AddName(const std::string& name, size_t offset);
+        void Build(Entry& entry);
+
+        std::vector<Entry> mRecords;                            // indexed by RecordId
+        std::vector<RecordId> mFree;                            // removed entries to reuse
+        std::vector<Group> mGroups;
+        std::unordered_multimap<uint32_t, size_t> mGroupsByHash;
+        std::vector<TypeKey> mTypes;                            // every type and class in the index: a handful
+        std::vector<NameNode> mNames;
+        std::unordered_map<std::string, uint32_t> mNamesByWire; // wire-format name to its node, kept until Clear()
+    };
+
+    // Builds a response packet out of MdnsAnswerIndex records, like MdnsMessageWriter does out of MdnsRecords:
+    // sections in order, and an Add call that does not fit leaves the packet unchanged and returns false.
+    // A writer can be reused across packets and queries; keep one per responder to avoid allocating per query.
+    class MdnsResponseWriter
+    {
+    public:
+        MdnsResponseWriter(const MdnsAnswerIndex& index, uint8_t* buffer, size_t capacity);
+
+        // start a new packet in the same buffer
+        void Reset(uint16_t id, uint16_t flags);
+
+        // echo a question of a legacy unicast query, uncompressed with class IN. Answers that follow are compressed against it
+        bool AddQuestion(const MdnsQuestionView& question);
+
+        bool AddRecord(MdnsSection section, MdnsAnswerIndex::RecordId id);
+
+        // for legacy unicast responses: no cache-flush bit and the TTL capped at maxTtl
+        bool AddRecord(MdnsSection section, MdnsAnswerIndex::RecordId id, uint32_t maxTtl);
+
+        uint16_t Count(MdnsSection section) const {
+            return mCounts[section];
+        }
+
+        size_t Size() const {
+            return mSize;
+        }
+
+        const uint8_t* Data() const {
+            return mBuffer;
+        }
+
+    private:
+        bool WriteRecord(MdnsSection section, MdnsAnswerIndex::RecordId id, bool legacy, uint32_t maxTtl);
+        bool WriteName(uint32_t node);
+        void PatchU16(size_t offset, uint16_t value);
+
+        const MdnsAnswerIndex& mIndex;
+        uint8_t* mBuffer;
+        size_t mCapacity;
+        size_t mSize;
+        MdnsSection mSection;
+        uint16_t mCounts[4];
+        std::vector<uint16_t> mNameOffsets;     // per name node, where this packet has it. 0 if nowhere yet
+        std::vector<uint32_t> mWrittenNames;    // nodes with an offset, to clear on Reset
+    };
+};
@@ -0,0 +1,254 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsCache.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    // RFC 6762 section 5.2: the first refresh query at 80% of the TTL, then every 5%, four in total
+    static const int kRefreshQueries = 4;
+    static const int kFirstRefreshPercent = 80;
+    static const int kRefreshStepPercent = 5;
+    static const int kRefreshJitterPerMille = 20;
+
+    // RFC 6762 section 10.2: records flushed by a newer owner are deleted one second later
+    static const std::chrono::seconds kFlushDelay(1);
+
+    MdnsCache::MdnsCache(MdnsTimerWheel& timers)
+        : mTimers(timers)
+        , mSize(0)
+        , mRandom(MdnsRandomSeed())
+    {
+    }
+
+    std::string MdnsCache::MakeKey(const std::string& name, uint16_t type)
+    {
+        std::string key = MdnsLowerCase(name);
+        key.push_back(static_cast<char>(type >> 8));
+        key.push_back(static_cast<char>(type & 0xff));
+        return key;
+    }
+
+    MdnsCache::InsertResult MdnsCache::Insert(const MdnsRecordView& record, uint32_t interfaceIndex, MdnsClock::time_point now)
+    {
+        MDNS_TRACE_SCOPE("cache", "insert");
+        uint8_t rdata[MDNS_MAX_PACKET_SIZE];
+        size_t rdlength = record.CopyCanonicalRdata(rdata, sizeof(rdata));
+        if (rdlength == 0 && record.rdlength != 0)
+        {
+            return CacheIgnored;
+        }
+
+        std::string name = record.name.ToName();
+        std::string key = MakeKey(name, record.type);
+        auto list = mEntries.find(key);
+
+        CachedRecord* match = nullptr;
+        if (list != mEntries.end())
+        {
+            for (auto& cached : list->second)
+            {
+                const std::string& data = cached->entry.rdata;
+                if (cached->entry.interfaceIndex == interfaceIndex && data.size() == rdlength && memcmp(data.data(), rdata, rdlength) == 0)
+                {
+                    match = cached.get();
+                    break;
+                }
+            }
+        }
+
+        if (record.ttl == 0)
+        {
+            if (match == nullptr)
+            {
+                return CacheIgnored;
+            }
+
+            // RFC 6762 section 10.1 keeps a goodbye record for one more second. A responder shutting down
+            // cleanly is the common case and failover should not wait for it, so the record goes now;
+            // an erroneous goodbye is corrected by the owner's next announcement
+            auto& entries = list->second;
+            entries.erase(std::find_if(entries.begin(), entries.end(), [match](const std::unique_ptr<CachedRecord>& cached) { return cached.get() == match; }));
+            if (entries.empty())
+            {
+                mEntries.erase(list);
+            }
+            mSize--;
+            MdnsCount(MdnsStatCacheEvictions);
+            return CacheGoodbye;
+        }
+
+        if (record.cacheFlush && list != mEntries.end())
+        {
+            // the sender owns this name and type on this interface, older records from the previous owner are stale
+            for (auto& cached : list->second)
+            {
+                MdnsCacheEntry& entry = cached->entry;
+                if (cached.get() != match && entry.interfaceIndex == interfaceIndex && entry.received + kFlushDelay < now && entry.expires > now + kFlushDelay)
+                {
+                    entry.expires = now + kFlushDelay;
+                    entry.refreshCount = kRefreshQueries;
+                    entry.nextRefresh = MdnsClock::time_point::max();
+                    ScheduleTimer(*cached);
+                }
+            }
+        }
+
+        InsertResult result = CacheRefreshed;
+        if (match == nullptr)
+        {
+            std::unique_ptr<CachedRecord> cached(new CachedRecord());
+            cached->entry.name = name;
+            cached->entry.type = record.type;
+            cached->entry.rdata.assign(reinterpret_cast<const char*>(rdata), rdlength);
+            cached->entry.interfaceIndex = interfaceIndex;
+            cached->key = key;
+            CachedRecord* pointer = cached.get();
+            cached->timer.SetCallback([this, pointer] { OnTimer(pointer); });
+            mEntries[key].push_back(std::move(cached));
+            match = pointer;
+            mSize++;
+            result = CacheAdded;
+        }
+        MdnsCount(result == CacheAdded ? MdnsStatCacheMisses : MdnsStatCacheHits);
+
+        MdnsCacheEntry& entry = match->entry;
+        entry.ttl = record.ttl;
+        entry.received = now;
+        entry.expires = now + std::chrono::seconds(record.ttl);
+        entry.refreshCount = 0;
+        ScheduleRefresh(entry);
+        ScheduleTimer(*match);
+        return result;
+    }
+
+    const MdnsCacheEntry* MdnsCache::Find(const std::string& name, uint16_t type) const
+    {
+        auto list = mEntries.find(MakeKey(name, type));
+        if (list == mEntries.end())
+        {
+            return nullptr;
+        }
+
+        const MdnsCacheEntry* latest = nullptr;
+        for (const auto& cached : list->second)
+        {
+            if (latest == nullptr || cached->entry.received > latest->received)
+            {
+                latest = &cached->entry;
+            }
+        }
+        return latest;
+    }
+
+    void MdnsCache::Remove(const std::string& name, uint16_t type)
+    {
+        auto list = mEntries.find(MakeKey(name, type));
+        if (list != mEntries.end())
+        {
+            mSize -= list->second.size();
+            MdnsCount(MdnsStatCacheEvictions, list->second.size());
+            mEntries.erase(list);
+        }
+    }
+
+    void MdnsCache::TakeEvents(std::vector<MdnsCacheEntry>& expired, std::vector<MdnsRefreshQuestion>& refresh)
+    {
+        for (auto& entry : mExpired)
+        {
+            expired.push_back(std::move(entry));
+        }
+        for (auto& question : mRefresh)
+        {
+            refresh.push_back(std::move(question));
+        }
+        mExpired.clear();
+        mRefresh.clear();
+        mRetired.clear();
+    }
+
+    void MdnsCache::OnTimer(CachedRecord* record)
+    {
+        MdnsCacheEntry& entry = record->entry;
+        MdnsClock::time_point now = record->timer.Expires();
+
+        if (entry.expires <= now)
+        {
+            auto list = mEntries.find(record->key);
+            auto& entries = list->second;
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                if (it->get() == record)
+                {
+                    // the timer callback is still running, free the record in TakeEvents()
+                    mRetired.push_back(std::move(*it));
+                    entries.erase(it);
+                    break;
+                }
+            }
+            if (entries.empty())
+            {
+                mEntries.erase(list);
+            }
+            mSize--;
+            MdnsCount(MdnsStatCacheEvictions);
+            mExpired.push_back(std::move(entry));
+            return;
+        }
+
+        // one question covers every record with this name and type on the interface
+        bool asked = false;
+        for (const auto& question : mRefresh)
+        {
+            if (question.type == entry.type && question.interfaceIndex == entry.interfaceIndex && MdnsNameEquals(question.name, entry.name))
+            {
+                asked = true;
+                break;
+            }
+        }
+        if (!asked)
+        {
+            MdnsRefreshQuestion question;
+            question.name = entry.name;
+            question.type = entry.type;
+            question.interfaceIndex = entry.interfaceIndex;
+            mRefresh.push_back(question);
+        }
+
+        entry.refreshCount++;
+        ScheduleRefresh(entry);
+        ScheduleTimer(*record);
+    }
+
+    void MdnsCache::ScheduleRefresh(MdnsCacheEntry& entry)
+    {
+        if (entry.refreshCount >= kRefreshQueries)
+        {
+            entry.nextRefresh = MdnsClock::time_point::max();
+            return;
+        }
+
+        // spread the refresh queries of many hosts caching the same record
+        std::uniform_int_distribution<int> jitter(0, kRefreshJitterPerMille);
+        int perMille = (kFirstRefreshPercent + kRefreshStepPercent * entry.refreshCount) * 10 + jitter(mRandom);
+        entry.nextRefresh = entry.received + std::chrono::milliseconds(static_cast<int64_t>(entry.ttl) * perMille);
+    }
+
+    void MdnsCache::ScheduleTimer(CachedRecord& record)
+    {
+        mTimers.Schedule(record.timer, std::min(record.entry.nextRefresh, record.entry.expires));
+    }
+}
@@ -0,0 +1,140 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MdnsMessage.h"
+#include "MdnsTimerWheel.h"
+
+namespace dnssd_uwp
+{
+    // A record received from the network, kept until its TTL runs out
+    struct MdnsCacheEntry
+    {
+        std::string name;       // wire format as received
+        uint16_t type;
+        std::string rdata;      // rdata with any compressed names expanded
+        uint32_t interfaceIndex;    // where it was received: the same record on two interfaces is two entries
+        uint32_t ttl;
+        MdnsClock::time_point received;
+        MdnsClock::time_point expires;
+        MdnsClock::time_point nextRefresh;  // time_point::max() once all refresh queries have been sent
+        int refreshCount;                   // refresh queries sent since the record was last received
+    };
+
+    // question to re-ask because a cached record reached one of its refresh points
+    struct MdnsRefreshQuestion
+    {
+        std::string name;
+        uint16_t type;
+        uint32_t interfaceIndex;    // asked on this interface only
+    };
+
+    // Record cache for continuous querying (RFC 6762 section 5.2).
+    // Records expire when their TTL runs out rather than when a scan misses them. At 80%, 85%, 90% and 95%
+    // of the TTL (plus up to 2% random variation) a refresh question is queued for the record,
+    // so a live record is re-received before it expires and a dead one is removed on time.
+    // Each record has one timer in the owner's MdnsTimerWheel for whichever of the two comes first;
+    // the owner advances the wheel and then collects the results with TakeEvents().
+    // Records are kept per interface (RFC 6762 section 10.2: a cache-flush record only flushes what was received
+    // on its own interface), and refreshed and expired on each interface separately.
+    class MdnsCache
+    {
+    public:
+        enum InsertResult
+        {
+            CacheIgnored,   // goodbye for a record we don't have
+            CacheAdded,     // new record
+            CacheRefreshed, // same record received again, TTL restarted
+            CacheGoodbye    // TTL 0 received, the record was removed
+        };
+
+        explicit MdnsCache(MdnsTimerWheel& timers);
+
+        InsertResult Insert(const MdnsRecordView& record, uint32_t interfaceIndex, MdnsClock::time_point now);
+
+        // most recently received record with this name and type, or nullptr
+        const MdnsCacheEntry* Find(const std::string& name, uint16_t type) const;
+
+        // true if predicate returns true for any record with this name and type
+        template <typename Predicate>
+        bool Any(const std::string& name, uint16_t type, Predicate predicate) const
+        {
+            auto list = mEntries.find(MakeKey(name, type));
+            if (list != mEntries.end())
+            {
+                for (const auto& record : list->second)
+                {
+                    if (predicate(record->entry))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // call function for every record with this name and type, on any interface
+        template <typename Function>
+        void ForEach(const std::string& name, uint16_t type, Function function) const
+        {
+            auto list = mEntries.find(MakeKey(name, type));
+            if (list != mEntries.end())
+            {
+                for (const auto& record : list->second)
+                {
+                    function(record->entry);
+                }
+            }
+        }
+
+        void Remove(const std::string& name, uint16_t type);
+
+        // Moves the records that expired since the last call into expired and the questions for records
+        // that reached a refresh point into refresh (one question per name, type and interface)
+        void TakeEvents(std::vector<MdnsCacheEntry>& expired, std::vector<MdnsRefreshQuestion>& refresh);
+
+        size_t Size() const {
+            return mSize;
+        }
+
+    private:
+        struct CachedRecord
+        {
+            MdnsCacheEntry entry;
+            std::string key;
+            MdnsTimer timer;
+        };
+
+        static std::string MakeKey(const std::string& name, uint16_t type);
+        void OnTimer(CachedRecord* record);
+        void ScheduleRefresh(MdnsCacheEntry& entry);
+        void ScheduleTimer(CachedRecord& record);
+
+        MdnsTimerWheel& mTimers;
+
+        // keyed by lower case wire-format name followed by the two type bytes
+        std::unordered_map<std::string, std::vector<std::unique_ptr<CachedRecord>>> mEntries;
+        size_t mSize;
+        std::minstd_rand mRandom;
+
+        std::vector<MdnsCacheEntry> mExpired;
+        std::vector<MdnsRefreshQuestion> mRefresh;
+        std::vector<std::unique_ptr<CachedRecord>> mRetired;   // expired from inside their own timer callback
+    };
+};
@@ -0,0 +1,842 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsMessage.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    static inline uint8_t ToLower(uint8_t c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+    }
+
+    static inline uint16_t GetU16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static inline uint32_t GetU32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    static bool LabelEquals(const uint8_t* a, const uint8_t* b, uint8_t length)
+    {
+        for (uint8_t i = 0; i < length; ++i)
+        {
+            if (ToLower(a[i]) != ToLower(b[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Checks the name at offset and returns the offset just past its in-place part in end.
+    // Every compression pointer must point before the start of the labels that contain it, which
+    // rules out loops, and the expanded name must fit in MDNS_MAX_NAME_LENGTH.
+    static bool ValidateName(const uint8_t* packet, size_t size, size_t offset, size_t& end)
+    {
+        size_t pos = offset;
+        size_t segmentStart = offset;
+        size_t length = 1;
+        bool jumped = false;
+
+        while (true)
+        {
+            if (pos >= size)
+            {
+                return false;
+            }
+
+            uint8_t len = packet[pos];
+            if ((len & 0xc0) == 0xc0)
+            {
+                if (pos + 1 >= size)
+                {
+                    return false;
+                }
+                size_t target = static_cast<size_t>((len & 0x3f) << 8) | packet[pos + 1];
+                if (target >= segmentStart)
+                {
+                    return false;
+                }
+                if (!jumped)
+                {
+                    end = pos + 2;
+                    jumped = true;
+                }
+                pos = segmentStart = target;
+                continue;
+            }
+            else if ((len & 0xc0) != 0)
+            {
+                return false;
+            }
+
+            if (len == 0)
+            {
+                if (!jumped)
+                {
+                    end = pos + 1;
+                }
+                return true;
+            }
+
+            length += len + 1;
+            if (length > MDNS_MAX_NAME_LENGTH || pos + 1 + len > size)
+            {
+                return false;
+            }
+            pos += 1 + len;
+        }
+    }
+
+    //
+    // wire-format name helpers
+    //
+
+    std::string MdnsMakeName(const std::string& dotted)
+    {
+        std::string name;
+        std::string label;
+        for (size_t i = 0; i <= dotted.size(); ++i)
+        {
+            if (i == dotted.size() || dotted[i] == '.')
+            {
+                if (label.size() > MDNS_MAX_LABEL_LENGTH)
+                {
+                    // its length byte would read as a compression pointer or an extended label type
+                    return std::string();
+                }
+                if (!label.empty())
+                {
+                    name += static_cast<char>(label.size());
+                    name += label;
+                    label.clear();
+                }
+            }
+            else if (dotted[i] == '\\' && i + 1 < dotted.size())
+            {
+                label += dotted[++i];
+            }
+            else
+            {
+                label += dotted[i];
+            }
+        }
+        name += '\0';
+        if (name.size() > MDNS_MAX_NAME_LENGTH)
+        {
+            return std::string();
+        }
+        return name;
+    }
+
+    std::string MdnsMakeName(const std::string& label, const std::string& parent)
+    {
+        if (label.empty() || label.size() > MDNS_MAX_LABEL_LENGTH || 1 + label.size() + parent.size() > MDNS_MAX_NAME_LENGTH)
+        {
+            return std::string();
+        }
+        std::string name;
+        name += static_cast<char>(label.size());
+        name += label;
+        name += parent;
+        return name;
+    }
+
+    std::string MdnsNameToString(const std::string& name)
+    {
+        std::string dotted;
+        size_t pos = 0;
+        while (pos < name.size() && name[pos] != 0)
+        {
+            size_t end = std::min(name.size(), pos + 1 + static_cast<uint8_t>(name[pos]));
+            if (!dotted.empty())
+            {
+                dotted += '.';
+            }
+            for (size_t i = pos + 1; i < end; ++i)
+            {
+                if (name[i] == '.' || name[i] == '\\')
+                {
+                    dotted += '\\';
+                }
+                dotted += name[i];
+            }
+            pos = end;
+        }
+        return dotted;
+    }
+
+    std::string MdnsFirstLabel(const std::string& name)
+    {
+        if (name.empty())
+        {
+            return std::string();
+        }
+        return name.substr(1, static_cast<uint8_t>(name[0]));
+    }
+
+    bool MdnsNameEquals(const std::string& a, const std::string& b)
+    {
+        return a.size() == b.size() &&
+            std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return ToLower(x) == ToLower(y); });
+    }
+
+    std::string MdnsLowerCase(const std::string& name)
+    {
+        std::string lower(name);
+        for (auto& c : lower)
+        {
+            c = static_cast<char>(ToLower(static_cast<uint8_t>(c)));
+        }
+        return lower;
+    }
+
+    std::string MdnsAddressToString(in_addr_t address)
+    {
+        char buffer[INET_ADDRSTRLEN];
+        in_addr addr;
+        addr.s_addr = address;
+        inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+        return std::string(buffer);
+    }
+
+    //
+    // MdnsNameView
+    //
+
+    bool MdnsNameView::NextLabel(size_t& pos, const uint8_t*& label, uint8_t& length) const
+    {
+        while (pos + 1 < mSize && (mPacket[pos] & 0xc0) == 0xc0)
+        {
+            pos = static_cast<size_t>((mPacket[pos] & 0x3f) << 8) | mPacket[pos + 1];
+        }
+        if (pos >= mSize || mPacket[pos] == 0)
+        {
+            return false;
+        }
+        length = mPacket[pos];
+        label = mPacket + pos + 1;
+        pos += 1 + length;
+        return true;
+    }
+
+    bool MdnsNameView::Equals(const MdnsNameView& other) const
+    {
+        if (mPacket == other.mPacket && mOffset == other.mOffset)
+        {
+            return true;
+        }
+
+        size_t a = mOffset;
+        size_t b = other.mOffset;
+        const uint8_t* labelA = nullptr;
+        const uint8_t* labelB = nullptr;
+        uint8_t lengthA = 0;
+        uint8_t lengthB = 0;
+
+        while (true)
+        {
+            bool moreA = NextLabel(a, labelA, lengthA);
+            bool moreB = other.NextLabel(b, labelB, lengthB);
+            if (moreA != moreB)
+            {
+                return false;
+            }
+            if (!moreA)
+            {
+                return true;
+            }
+            if (lengthA != lengthB || !LabelEquals(labelA, labelB, lengthA))
+            {
+                return false;
+            }
+        }
+    }
+
+    bool MdnsNameView::Equals(const uint8_t* name) const
+    {
+        size_t pos = mOffset;
+        const uint8_t* label;
+        uint8_t length;
+
+        while (NextLabel(pos, label, length))
+        {
+            if (*name != length || !LabelEquals(label, name + 1, length))
+            {
+                return false;
+            }
+            name += 1 + length;
+        }
+        return *name == 0;
+    }
+
+    uint32_t MdnsNameView::Hash() const
+    {
+        // FNV-1a over the lower cased labels and their lengths
+        uint32_t hash = 2166136261u;
+        size_t pos = mOffset;
+        const uint8_t* label;
+        uint8_t length;
+
+        while (NextLabel(pos, label, length))
+        {
+            hash = (hash ^ length) * 16777619u;
+            for (uint8_t i = 0; i < length; ++i)
+            {
+                hash = (hash ^ ToLower(label[i])) * 16777619u;
+            }
+        }
+        return hash;
+    }
+
+    size_t MdnsNameView::CopyTo(uint8_t* out, size_t size) const
+    {
+        size_t pos = mOffset;
+        size_t written = 0;
+        const uint8_t* label;
+        uint8_t length;
+
+        while (NextLabel(pos, label, length))
+        {
+            if (written + 1 + length >= size)
+            {
+                return 0;
+            }
+            out[written++] = length;
+            memcpy(out + written, label, length);
+            written += length;
+        }
+        if (written >= size)
+        {
+            return 0;
+        }
+        out[written++] = 0;
+        return written;
+    }
+
+    std::string MdnsNameView::ToName() const
+    {
+        uint8_t buffer[MDNS_MAX_NAME_LENGTH + 1];
+        size_t length = CopyTo(buffer, sizeof(buffer));
+        return std::string(reinterpret_cast<const char*>(buffer), length);
+    }
+
+    std::string MdnsNameView::ToString() const
+    {
+        return MdnsNameToString(ToName());
+    }
+
+    //
+    // MdnsRecordView
+    //
+
+    bool MdnsRecordView::GetPtr(MdnsNameView& target) const
+    {
+        size_t end;
+        if (type != MDNS_TYPE_PTR || !ValidateName(packet, packetSize, rdataOffset, end) || end > rdataOffset + rdlength)
+        {
+            return false;
+        }
+        target = MdnsNameView(packet, packetSize, rdataOffset);
+        return true;
+    }
+
+    bool MdnsRecordView::GetSrv(uint16_t& priority, uint16_t& weight, uint16_t& port, MdnsNameView& target) const
+    {
+        size_t end;
+        if (type != MDNS_TYPE_SRV || rdlength < 7 || !ValidateName(packet, packetSize, rdataOffset + 6, end) || end > rdataOffset + rdlength)
+        {
+            return false;
+        }
+        const uint8_t* rdata = Rdata();
+        priority = GetU16(rdata);
+        weight = GetU16(rdata + 2);
+        port = GetU16(rdata + 4);
+        target = MdnsNameView(packet, packetSize, rdataOffset + 6);
+        return true;
+    }
+
+    bool MdnsRecordView::GetA(in_addr_t& address) const
+    {
+        if (type != MDNS_TYPE_A || rdlength != 4)
+        {
+            return false;
+        }
+        memcpy(&address, Rdata(), 4);
+        return true;
+    }
+
+    bool MdnsRecordView::GetAaaa(in6_addr& address) const
+    {
+        if (type != MDNS_TYPE_AAAA || rdlength != 16)
+        {
+            return false;
+        }
+        memcpy(&address, Rdata(), 16);
+        return true;
+    }
+
+    size_t MdnsRecordView::CopyCanonicalRdata(uint8_t* out, size_t size) const
+    {
+        MdnsNameView target;
+        uint16_t priority, weight, port;
+
+        if (type == MDNS_TYPE_PTR)
+        {
+            return GetPtr(target) ? target.CopyTo(out, size) : 0;
+        }
+        else if (type == MDNS_TYPE_SRV)
+        {
+            if (size < 6 || !GetSrv(priority, weight, port, target))
+            {
+                return 0;
+            }
+            memcpy(out, Rdata(), 6);
+            size_t length = target.CopyTo(out + 6, size - 6);
+            return length ? length + 6 : 0;
+        }
+
+        if (rdlength > size)
+        {
+            return 0;
+        }
+        memcpy(out, Rdata(), rdlength);
+        return rdlength;
+    }
+
+    //
+    // MdnsMessageReader
+    //
+
+    MdnsMessageReader::MdnsMessageReader(const uint8_t* data, size_t size)
+        : mData(data)
+        , mSize(size)
+    {
+        Rewind();
+    }
+
+    void MdnsMessageReader::Rewind()
+    {
+        mOffset = MDNS_HEADER_SIZE;
+        mQuestionsRead = 0;
+        mRecordsRead = 0;
+        mFailed = mSize < MDNS_HEADER_SIZE;
+    }
+
+    uint16_t MdnsMessageReader::Id() const
+    {
+        return IsValid() ? GetU16(mData) : 0;
+    }
+
+    uint16_t MdnsMessageReader::Flags() const
+    {
+        return IsValid() ? GetU16(mData + 2) : 0;
+    }
+
+    uint16_t MdnsMessageReader::Count(MdnsSection section) const
+    {
+        return IsValid() ? GetU16(mData + 4 + 2 * section) : 0;
+    }
+
+    bool MdnsMessageReader::ReadName(MdnsNameView& name)
+    {
+        size_t end;
+        if (!ValidateName(mData, mSize, mOffset, end))
+        {
+            mFailed = true;
+            return false;
+        }
+        name = MdnsNameView(mData, mSize, mOffset);
+        mOffset = end;
+        return true;
+    }
+
+    bool MdnsMessageReader::NextQuestion(MdnsQuestionView& question)
+    {
+        if (mFailed || mQuestionsRead >= Count(MdnsQuestionSection))
+        {
+            return false;
+        }
+
+        if (!ReadName(question.name))
+        {
+            return false;
+        }
+        if (mOffset + 4 > mSize)
+        {
+            mFailed = true;
+            return false;
+        }
+
+        uint16_t qclass = GetU16(mData + mOffset + 2);
+        question.type = GetU16(mData + mOffset);
+        question.qclass = qclass & MDNS_CLASS_MASK;
+        question.unicastResponse = (qclass & MDNS_UNICAST_RESPONSE_BIT) != 0;
+        mOffset += 4;
+        mQuestionsRead++;
+        return true;
+    }
+
+    bool MdnsMessageReader::NextRecord(MdnsRecordView& record)
+    {
+        MdnsQuestionView question;
+        while (NextQuestion(question))
+        {
+        }
+
+        if (mFailed)
+        {
+            return false;
+        }
+
+        uint32_t answers = Count(MdnsAnswerSection);
+        uint32_t authorities = Count(MdnsAuthoritySection);
+        uint32_t additionals = Count(MdnsAdditionalSection);
+        if (mRecordsRead >= answers + authorities + additionals)
+        {
+            return false;
+        }
+
+        if (!ReadName(record.name))
+        {
+            return false;
+        }
+        if (mOffset + 10 > mSize)
+        {
+            mFailed = true;
+            return false;
+        }
+
+        const uint8_t* p = mData + mOffset;
+        uint16_t rclass = GetU16(p + 2);
+        record.type = GetU16(p);
+        record.rclass = rclass & MDNS_CLASS_MASK;
+        record.cacheFlush = (rclass & MDNS_CACHE_FLUSH_BIT) != 0;
+        record.ttl = GetU32(p + 4);
+        record.rdlength = GetU16(p + 8);
+        record.packet = mData;
+        record.packetSize = mSize;
+        record.rdataOffset = mOffset + 10;
+
+        if (record.rdataOffset + record.rdlength > mSize)
+        {
+            mFailed = true;
+            return false;
+        }
+
+        if (mRecordsRead < answers)
+        {
+            record.section = MdnsAnswerSection;
+        }
+        else if (mRecordsRead < answers + authorities)
+        {
+            record.section = MdnsAuthoritySection;
+        }
+        else
+        {
+            record.section = MdnsAdditionalSection;
+        }
+
+        mOffset = record.rdataOffset + record.rdlength;
+        mRecordsRead++;
+        return true;
+    }
+
+    //
+    // MdnsRecord
+    //
+
+    bool MdnsRecord::RdataEquals(const MdnsRecordView& view) const
+    {
+        MdnsNameView target;
+        uint16_t priority, weight, port;
+
+        if (view.type != type)
+        {
+            return false;
+        }
+
+        const uint8_t* ours = reinterpret_cast<const uint8_t*>(rdata.data());
+        switch (type)
+        {
+        case MDNS_TYPE_PTR:
+            return view.GetPtr(target) && target.Equals(ours);
+
+        case MDNS_TYPE_SRV:
+            return rdata.size() > 6 && view.GetSrv(priority, weight, port, target) &&
+                memcmp(view.Rdata(), ours, 6) == 0 && target.Equals(ours + 6);
+
+        default:
+            return view.rdlength == rdata.size() && memcmp(view.Rdata(), ours, rdata.size()) == 0;
+        }
+    }
+
+    static void AppendU16(std::string& out, uint16_t value)
+    {
+        out += static_cast<char>(value >> 8);
+        out += static_cast<char>(value & 0xff);
+    }
+
+    MdnsRecord MdnsRecord::MakePtr(const std::string& name, const std::string& target, uint32_t ttl)
+    {
+        // shared record, no cache flush bit
+        return MdnsRecord{ name, MDNS_TYPE_PTR, MDNS_CLASS_IN, false, ttl, target };
+    }
+
+    MdnsRecord MdnsRecord::MakeSrv(const std::string& name, const std::string& target, uint16_t port, uint32_t ttl)
+    {
+        std::string rdata;
+        AppendU16(rdata, 0);    // priority
+        AppendU16(rdata, 0);    // weight
+        AppendU16(rdata, port);
+        rdata += target;
+        return MdnsRecord{ name, MDNS_TYPE_SRV, MDNS_CLASS_IN, true, ttl, rdata };
+    }
+
+    MdnsRecord MdnsRecord::MakeTxt(const std::string& name, uint32_t ttl)
+    {
+        // an empty TXT record holds a single zero length string (RFC 6763 section 6.1)
+        return MdnsRecord{ name, MDNS_TYPE_TXT, MDNS_CLASS_IN, true, ttl, std::string(1, '\0') };
+    }
+
+    MdnsRecord MdnsRecord::MakeTxt(const std::string& name, const std::string& rdata, uint32_t ttl)
+    {
+        return rdata.empty() ? MakeTxt(name, ttl) : MdnsRecord{ name, MDNS_TYPE_TXT, MDNS_CLASS_IN, true, ttl, rdata };
+    }
+
+    MdnsRecord MdnsRecord::MakeA(const std::string& name, in_addr_t address, uint32_t ttl)
+    {
+        std::string rdata(reinterpret_cast<const char*>(&address), 4);
+        return MdnsRecord{ name, MDNS_TYPE_A, MDNS_CLASS_IN, true, ttl, rdata };
+    }
+
+    //
+    // MdnsMessageWriter
+    //
+
+    MdnsMessageWriter::MdnsMessageWriter(uint8_t* buffer, size_t capacity, uint16_t id, uint16_t flags)
+        : mBuffer(buffer)
+        , mCapacity(capacity)
+    {
+        Reset(id, flags);
+    }
+
+    void MdnsMessageWriter::Reset(uint16_t id, uint16_t flags)
+    {
+        mSize = 0;
+        mSection = MdnsQuestionSection;
+        mCompressionCount = 0;
+        memset(mCounts, 0, sizeof(mCounts));
+
+        if (mCapacity >= MDNS_HEADER_SIZE)
+        {
+            memset(mBuffer, 0, MDNS_HEADER_SIZE);
+            PatchU16(0, id);
+            PatchU16(2, flags);
+            mSize = MDNS_HEADER_SIZE;
+        }
+    }
+
+    void MdnsMessageWriter::SetFlags(uint16_t flags)
+    {
+        PatchU16(2, flags);
+    }
+
+    MdnsMessageWriter::Mark MdnsMessageWriter::Save() const
+    {
+        return Mark{ mSize, mCompressionCount };
+    }
+
+    void MdnsMessageWriter::Restore(const Mark& mark)
+    {
+        mSize = mark.size;
+        mCompressionCount = mark.compressionCount;
+    }
+
+    void MdnsMessageWriter::PatchU16(size_t offset, uint16_t value)
+    {
+        mBuffer[offset] = static_cast<uint8_t>(value >> 8);
+        mBuffer[offset + 1] = static_cast<uint8_t>(value);
+    }
+
+    bool MdnsMessageWriter::BeginSection(MdnsSection section)
+    {
+        if (section < mSection || mSize < MDNS_HEADER_SIZE)
+        {
+            return false;
+        }
+        mSection = section;
+        return true;
+    }
+
+    bool MdnsMessageWriter::WriteBytes(const uint8_t* data, size_t size)
+    {
+        if (mSize + size > mCapacity)
+        {
+            return false;
+        }
+        memcpy(mBuffer + mSize, data, size);
+        mSize += size;
+        return true;
+    }
+
+    bool MdnsMessageWriter::WriteU16(uint16_t value)
+    {
+        uint8_t bytes[2] = { static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+        return WriteBytes(bytes, 2);
+    }
+
+    bool MdnsMessageWriter::WriteU32(uint32_t value)
+    {
+        return WriteU16(static_cast<uint16_t>(value >> 16)) && WriteU16(static_cast<uint16_t>(value));
+    }
+
+    bool MdnsMessageWriter::WriteName(const uint8_t* name, size_t length)
+    {
+        // find the longest suffix of name that has already been written
+        size_t pos = 0;
+        while (pos < length && name[pos] != 0)
+        {
+            for (size_t i = 0; i < mCompressionCount; ++i)
+            {
+                MdnsNameView previous(mBuffer, mSize, mCompression[i]);
+                if (previous.Equals(name + pos))
+                {
+                    uint8_t pointer[2] = { static_cast<uint8_t>(0xc0 | (mCompression[i] >> 8)), static_cast<uint8_t>(mCompression[i]) };
+                    return WriteBytes(name, pos) && WriteBytes(pointer, 2);
+                }
+            }
+            pos += 1 + name[pos];
+        }
+
+        // no match. Remember where each label starts so later names can point at it
+        size_t start = mSize;
+        if (pos >= length || !WriteBytes(name, pos + 1))
+        {
+            return false;
+        }
+        for (size_t label = 0; label < pos && mCompressionCount < kMaxCompressionEntries; label += 1 + name[label])
+        {
+            if (start + label < 0x4000)
+            {
+                mCompression[mCompressionCount++] = static_cast<uint16_t>(start + label);
+            }
+        }
+        return true;
+    }
+
+    bool MdnsMessageWriter::WriteRecord(MdnsSection section, const uint8_t* name, size_t nameLength, uint16_t type, uint16_t rclass, uint32_t ttl,
+        const uint8_t* rdata, size_t rdlength)
+    {
+        if (!BeginSection(section))
+        {
+            return false;
+        }
+
+        Mark mark = Save();
+        bool ok = WriteName(name, nameLength) && WriteU16(type) && WriteU16(rclass) && WriteU32(ttl) && WriteU16(0);
+        size_t rdataStart = mSize;
+
+        if (ok)
+        {
+            switch (type)
+            {
+            case MDNS_TYPE_PTR:
+                ok = WriteName(rdata, rdlength);
+                break;
+
+            case MDNS_TYPE_SRV:
+                ok = rdlength > 6 && WriteBytes(rdata, 6) && WriteName(rdata + 6, rdlength - 6);
+                break;
+
+            default:
+                ok = WriteBytes(rdata, rdlength);
+                break;
+            }
+        }
+
+        if (!ok)
+        {
+            Restore(mark);
+            return false;
+        }
+
+        PatchU16(rdataStart - 2, static_cast<uint16_t>(mSize - rdataStart));
+        PatchU16(4 + 2 * section, ++mCounts[section]);
+        return true;
+    }
+
+    bool MdnsMessageWriter::AddQuestion(const std::string& name, uint16_t type, bool unicastResponse)
+    {
+        if (!BeginSection(MdnsQuestionSection))
+        {
+            return false;
+        }
+
+        Mark mark = Save();
+        uint16_t qclass = MDNS_CLASS_IN | (unicastResponse ? MDNS_UNICAST_RESPONSE_BIT : 0);
+        if (!WriteName(reinterpret_cast<const uint8_t*>(name.data()), name.size()) || !WriteU16(type) || !WriteU16(qclass))
+        {
+            Restore(mark);
+            return false;
+        }
+
+        PatchU16(4, ++mCounts[MdnsQuestionSection]);
+        return true;
+    }
+
+    bool MdnsMessageWriter::AddRecord(MdnsSection section, const MdnsRecord& record)
+    {
+        return AddRecord(section, record, record.ttl);
+    }
+
+    bool MdnsMessageWriter::AddRecord(MdnsSection section, const MdnsRecord& record, uint32_t ttl)
+    {
+        uint16_t rclass = record.rclass | (record.cacheFlush ? MDNS_CACHE_FLUSH_BIT : 0);
+        return WriteRecord(section, reinterpret_cast<const uint8_t*>(record.name.data()), record.name.size(), record.type, rclass, ttl,
+            reinterpret_cast<const uint8_t*>(record.rdata.data()), record.rdata.size());
+    }
+
+    bool MdnsMessageWriter::AddRecord(MdnsSection section, const MdnsRecordView& record)
+    {
+        // expand the names of a record from another packet, they get compressed again against this packet
+        uint8_t name[MDNS_MAX_NAME_LENGTH + 1];
+        uint8_t rdata[MDNS_MAX_NAME_LENGTH + 1 + 6];
+        const uint8_t* rdataPointer = rdata;
+        size_t nameLength = record.name.CopyTo(name, sizeof(name));
+        size_t rdlength;
+
+        if (record.type == MDNS_TYPE_PTR || record.type == MDNS_TYPE_SRV)
+        {
+            rdlength = record.CopyCanonicalRdata(rdata, sizeof(rdata));
+            if (rdlength == 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            rdataPointer = record.Rdata();
+            rdlength = record.rdlength;
+        }
+
+        uint16_t rclass = record.rclass | (record.cacheFlush ? MDNS_CACHE_FLUSH_BIT : 0);
+        return nameLength != 0 && WriteRecord(section, name, nameLength, record.type, rclass, record.ttl, rdataPointer, rdlength);
+    }
+}
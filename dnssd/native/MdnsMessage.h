@@ -0,0 +1,313 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <netinet/in.h>
+
+namespace dnssd_uwp
+{
+    // DNS resource record types used by DNS-SD
+    enum MdnsRecordType : uint16_t
+    {
+        MDNS_TYPE_A = 1,
+        MDNS_TYPE_PTR = 12,
+        MDNS_TYPE_TXT = 16,
+        MDNS_TYPE_AAAA = 28,
+        MDNS_TYPE_SRV = 33,
+        MDNS_TYPE_NSEC = 47,
+        MDNS_TYPE_ANY = 255
+    };
+
+    enum MdnsSection
+    {
+        MdnsQuestionSection,
+        MdnsAnswerSection,
+        MdnsAuthoritySection,
+        MdnsAdditionalSection
+    };
+
+    const uint16_t MDNS_CLASS_IN = 1;
+    const uint16_t MDNS_CLASS_ANY = 255;
+    const uint16_t MDNS_CLASS_MASK = 0x7fff;
+    const uint16_t MDNS_CACHE_FLUSH_BIT = 0x8000;   // top bit of the rrclass in a response
+    const uint16_t MDNS_UNICAST_RESPONSE_BIT = 0x8000;  // top bit of the qclass in a question
+
+    const uint16_t MDNS_FLAG_RESPONSE = 0x8000;
+    const uint16_t MDNS_FLAG_AUTHORITATIVE = 0x0400;
+    const uint16_t MDNS_FLAG_TRUNCATED = 0x0200;
+
+    const uint16_t MDNS_PORT = 5353;
+    const char* const MDNS_MULTICAST_ADDRESS = "224.0.0.251";
+
+    const size_t MDNS_HEADER_SIZE = 12;
+    const size_t MDNS_MAX_NAME_LENGTH = 255;    // uncompressed wire-format length including the root label
+    const size_t MDNS_MAX_LABEL_LENGTH = 63;
+    const size_t MDNS_MAX_PACKET_SIZE = 9000;  // RFC 6762 section 17
+    const size_t MDNS_ETHERNET_PAYLOAD_SIZE = 1472;    // 1500 byte MTU less the IPv4 and UDP headers
+
+    // RFC 6762 section 10: 120 seconds for records containing a host name, 75 minutes for everything else
+    const uint32_t MDNS_HOST_RECORD_TTL = 120;
+    const uint32_t MDNS_OTHER_RECORD_TTL = 4500;
+
+    // Owned names are kept in uncompressed wire format: length-prefixed labels ending with a zero byte.
+    // That keeps labels containing dots unambiguous and lets the writer copy them without re-encoding.
+
+    // encode a dotted name ("dnssd._daap._tcp.local", '\' escapes a literal dot) to wire format. Empty if a label
+    // is longer than MDNS_MAX_LABEL_LENGTH or the name longer than MDNS_MAX_NAME_LENGTH
+    std::string MdnsMakeName(const std::string& dotted);
+
+    // prepend a single unescaped label, e.g. an instance name, to a wire-format name. Empty if the label is empty or
+    // longer than MDNS_MAX_LABEL_LENGTH, or the name would be longer than MDNS_MAX_NAME_LENGTH: nothing is cut short
+    std::string MdnsMakeName(const std::string& label, const std::string& parent);
+
+    // dotted presentation form of a wire-format name
+    std::string MdnsNameToString(const std::string& name);
+
+    // first label of a wire-format name, i.e. the instance part of "instance._type._tcp.local"
+    std::string MdnsFirstLabel(const std::string& name);
+
+    // DNS names compare case-insensitively (ASCII only, RFC 6762 section 16)
+    bool MdnsNameEquals(const std::string& a, const std::string& b);
+
+    // ASCII lower case copy of a name, for use as a map key
+    std::string MdnsLowerCase(const std::string& name);
+
+    std::string MdnsAddressToString(in_addr_t address);
+
+    // A name inside a received packet. Holds only the packet pointer and the offset of the first label,
+    // compression pointers are followed on access. Names are validated by MdnsMessageReader
+    // before a view is handed out, so accessors can assume a well formed name.
+    class MdnsNameView
+    {
+    public:
+        MdnsNameView()
+            : mPacket(nullptr)
+            , mSize(0)
+            , mOffset(0)
+        {
+        }
+
+        MdnsNameView(const uint8_t* packet, size_t size, size_t offset)
+            : mPacket(packet)
+            , mSize(size)
+            , mOffset(offset)
+        {
+        }
+
+        size_t Offset() const {
+            return mOffset;
+        }
+
+        bool Equals(const MdnsNameView& other) const;
+        bool Equals(const uint8_t* name) const;
+        bool Equals(const std::string& name) const {
+            return Equals(reinterpret_cast<const uint8_t*>(name.data()));
+        }
+
+        // case-insensitive hash, equal for names that compare equal
+        uint32_t Hash() const;
+
+        // copy the uncompressed wire-format name into out. Returns the length or 0 if out is too small
+        size_t CopyTo(uint8_t* out, size_t size) const;
+
+        // these allocate and are meant for the edges of the library (callbacks, cache keys)
+        std::string ToName() const;
+        std::string ToString() const;
+
+        // walk the name one label at a time. pos starts at Offset(). Returns false at the root label
+        bool NextLabel(size_t& pos, const uint8_t*& label, uint8_t& length) const;
+
+    private:
+        const uint8_t* mPacket;
+        size_t mSize;
+        size_t mOffset;
+    };
+
+    struct MdnsQuestionView
+    {
+        MdnsNameView name;
+        uint16_t type;
+        uint16_t qclass;
+        bool unicastResponse;
+    };
+
+    // A resource record inside a received packet. rdata points into the packet and is never copied
+    struct MdnsRecordView
+    {
+        MdnsNameView name;
+        MdnsSection section;
+        uint16_t type;
+        uint16_t rclass;
+        bool cacheFlush;
+        uint32_t ttl;
+
+        const uint8_t* packet;
+        size_t packetSize;
+        size_t rdataOffset;
+        uint16_t rdlength;
+
+        const uint8_t* Rdata() const {
+            return packet + rdataOffset;
+        }
+
+        // typed rdata accessors. They return false if the rdata does not match the record type
+        bool GetPtr(MdnsNameView& target) const;
+        bool GetSrv(uint16_t& priority, uint16_t& weight, uint16_t& port, MdnsNameView& target) const;
+        bool GetA(in_addr_t& address) const;
+        bool GetAaaa(in6_addr& address) const;
+
+        // copy the rdata with any compressed names expanded (the form used for comparisons in RFC 6762 section 8.2).
+        // Returns the length or 0 if out is too small
+        size_t CopyCanonicalRdata(uint8_t* out, size_t size) const;
+    };
+
+    // Walks a received packet in place without copying or allocating.
+    //
+    //     MdnsMessageReader reader(data, size);
+    //     MdnsQuestionView question;
+    //     while (reader.NextQuestion(question)) { ... }
+    //     MdnsRecordView record;
+    //     while (reader.NextRecord(record)) { ... }
+    //     if (reader.Failed()) { malformed packet }
+    class MdnsMessageReader
+    {
+    public:
+        MdnsMessageReader(const uint8_t* data, size_t size);
+
+        // false if the packet is too short to hold a header
+        bool IsValid() const {
+            return mSize >= MDNS_HEADER_SIZE;
+        }
+
+        bool Failed() const {
+            return mFailed;
+        }
+
+        uint16_t Id() const;
+        uint16_t Flags() const;
+        uint16_t Count(MdnsSection section) const;
+
+        bool IsResponse() const {
+            return (Flags() & MDNS_FLAG_RESPONSE) != 0;
+        }
+
+        bool IsTruncated() const {
+            return (Flags() & MDNS_FLAG_TRUNCATED) != 0;
+        }
+
+        bool NextQuestion(MdnsQuestionView& question);
+
+        // skips any unread questions. Records are returned in packet order with their section set
+        bool NextRecord(MdnsRecordView& record);
+
+        // start again from the first question
+        void Rewind();
+
+    private:
+        bool ReadName(MdnsNameView& name);
+
+        const uint8_t* mData;
+        size_t mSize;
+        size_t mOffset;
+        uint32_t mQuestionsRead;
+        uint32_t mRecordsRead;
+        bool mFailed;
+    };
+
+    // A record owned by the caller, e.g. one of a service's own records. Names inside rdata
+    // are stored uncompressed, MdnsMessageWriter compresses them when the record is written.
+    struct MdnsRecord
+    {
+        std::string name;
+        uint16_t type;
+        uint16_t rclass;
+        bool cacheFlush;
+        uint32_t ttl;
+        std::string rdata;
+
+        bool RdataEquals(const MdnsRecordView& view) const;
+
+        static MdnsRecord MakePtr(const std::string& name, const std::string& target, uint32_t ttl);
+        static MdnsRecord MakeSrv(const std::string& name, const std::string& target, uint16_t port, uint32_t ttl);
+        static MdnsRecord MakeTxt(const std::string& name, uint32_t ttl);
+        static MdnsRecord MakeTxt(const std::string& name, const std::string& rdata, uint32_t ttl);
+        static MdnsRecord MakeA(const std::string& name, in_addr_t address, uint32_t ttl);
+    };
+
+    // Builds a packet into a caller supplied buffer with name compression.
+    // Questions and sections must be added in order. An Add call that does not fit
+    // leaves the packet unchanged and returns false, so the caller can send what it has and continue in a new packet.
+    class MdnsMessageWriter
+    {
+    public:
+        MdnsMessageWriter(uint8_t* buffer, size_t capacity, uint16_t id = 0, uint16_t flags = 0);
+
+        bool AddQuestion(const std::string& name, uint16_t type, bool unicastResponse = false);
+        bool AddRecord(MdnsSection section, const MdnsRecord& record);
+        bool AddRecord(MdnsSection section, const MdnsRecord& record, uint32_t ttl);
+        bool AddRecord(MdnsSection section, const MdnsRecordView& record);
+
+        void SetFlags(uint16_t flags);
+
+        uint16_t Count(MdnsSection section) const {
+            return mCounts[section];
+        }
+
+        bool IsEmpty() const {
+            return mSize == MDNS_HEADER_SIZE;
+        }
+
+        size_t Size() const {
+            return mSize;
+        }
+
+        const uint8_t* Data() const {
+            return mBuffer;
+        }
+
+        // start a new packet in the same buffer
+        void Reset(uint16_t id = 0, uint16_t flags = 0);
+
+    private:
+        struct Mark
+        {
+            size_t size;
+            size_t compressionCount;
+        };
+
+        Mark Save() const;
+        void Restore(const Mark& mark);
+        bool BeginSection(MdnsSection section);
+        bool WriteU16(uint16_t value);
+        bool WriteU32(uint32_t value);
+        bool WriteBytes(const uint8_t* data, size_t size);
+        bool WriteName(const uint8_t* name, size_t length);
+        bool WriteRecord(MdnsSection section, const uint8_t* name, size_t nameLength, uint16_t type, uint16_t rclass, uint32_t ttl,
+            const uint8_t* rdata, size_t rdlength);
+        void PatchU16(size_t offset, uint16_t value);
+
+        // previously written name suffixes that later names can point at
+        static const size_t kMaxCompressionEntries = 128;
+
+        uint8_t* mBuffer;
+        size_t mCapacity;
+        size_t mSize;
+        MdnsSection mSection;
+        uint16_t mCounts[4];
+        uint16_t mCompression[kMaxCompressionEntries];
+        size_t mCompressionCount;
+    };
+};
@@ -0,0 +1,155 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsQuery.h"
+
+namespace dnssd_uwp
+{
+    //
+    // MdnsQueryBuilder
+    //
+
+    MdnsQueryBuilder::MdnsQueryBuilder(size_t packetSize)
+        : mPacketSize(packetSize < MDNS_MAX_PACKET_SIZE ? packetSize : MDNS_MAX_PACKET_SIZE)
+    {
+    }
+
+    void MdnsQueryBuilder::AddQuestion(const std::string& name, uint16_t type, bool unicastResponse)
+    {
+        mQuestions.push_back(Question{ name, type, unicastResponse });
+    }
+
+    void MdnsQueryBuilder::AddKnownAnswer(const MdnsRecord& record)
+    {
+        mKnownAnswers.push_back(record);
+
+        // the cache flush bit has no meaning in a query
+        mKnownAnswers.back().cacheFlush = false;
+    }
+
+    size_t MdnsQueryBuilder::Build(const std::function<void(const uint8_t* data, size_t size, bool truncated)>& send) const
+    {
+        uint8_t packet[MDNS_MAX_PACKET_SIZE];
+        MdnsMessageWriter writer(packet, mPacketSize);
+        size_t packets = 0;
+
+        for (const auto& question : mQuestions)
+        {
+            if (!writer.AddQuestion(question.name, question.type, question.unicastResponse))
+            {
+                // too many questions for one packet: send them as separate queries
+                send(writer.Data(), writer.Size(), false);
+                packets++;
+                writer.Reset();
+                writer.AddQuestion(question.name, question.type, question.unicastResponse);
+            }
+        }
+
+        for (const auto& answer : mKnownAnswers)
+        {
+            if (writer.AddRecord(MdnsAnswerSection, answer))
+            {
+                continue;
+            }
+
+            // more known answers follow in the next packet
+            writer.SetFlags(MDNS_FLAG_TRUNCATED);
+            send(writer.Data(), writer.Size(), true);
+            packets++;
+            writer.Reset();
+            writer.AddRecord(MdnsAnswerSection, answer);
+        }
+
+        if (!writer.IsEmpty())
+        {
+            send(writer.Data(), writer.Size(), false);
+            packets++;
+        }
+        return packets;
+    }
+
+    void MdnsQueryBuilder::Clear()
+    {
+        mQuestions.clear();
+        mKnownAnswers.clear();
+    }
+
+    //
+    // MdnsKnownAnswerList
+    //
+
+    std::string MdnsKnownAnswerList::MakeKey(const std::string& name, uint16_t type, const uint8_t* rdata, size_t rdlength)
+    {
+        std::string key = MdnsLowerCase(name);
+        key.push_back(static_cast<char>(type >> 8));
+        key.push_back(static_cast<char>(type & 0xff));
+
+        // names inside rdata compare case-insensitively too
+        size_t nameStart = type == MDNS_TYPE_PTR ? 0 : type == MDNS_TYPE_SRV ? 6 : rdlength;
+        size_t start = key.size();
+        key.append(reinterpret_cast<const char*>(rdata), rdlength);
+        for (size_t i = start + nameStart; i < key.size(); ++i)
+        {
+            if (key[i] >= 'A' && key[i] <= 'Z')
+            {
+                key[i] = static_cast<char>(key[i] - 'A' + 'a');
+            }
+        }
+        return key;
+    }
+
+    void MdnsKnownAnswerList::Add(MdnsMessageReader& query)
+    {
+        MdnsRecordView record;
+        while (query.NextRecord(record))
+        {
+            if (record.section != MdnsAnswerSection)
+            {
+                continue;
+            }
+
+            uint8_t rdata[MDNS_MAX_PACKET_SIZE];
+            size_t rdlength = record.CopyCanonicalRdata(rdata, sizeof(rdata));
+            if (rdlength == 0 && record.rdlength != 0)
+            {
+                continue;
+            }
+
+            uint32_t& ttl = mAnswers[MakeKey(record.name.ToName(), record.type, rdata, rdlength)];
+            if (record.ttl > ttl)
+            {
+                ttl = record.ttl;
+            }
+        }
+    }
+
+    std::string MdnsKnownAnswerList::MakeKey(const MdnsRecord& record)
+    {
+        return MakeKey(record.name, record.type, reinterpret_cast<const uint8_t*>(record.rdata.data()), record.rdata.size());
+    }
+
+    bool MdnsKnownAnswerList::Suppresses(const MdnsRecord& record) const
+    {
+        return !mAnswers.empty() && Suppresses(MakeKey(record), record.ttl);
+    }
+
+    bool MdnsKnownAnswerList::Suppresses(const std::string& key, uint32_t ttl) const
+    {
+        if (mAnswers.empty())
+        {
+            return false;
+        }
+
+        auto it = mAnswers.find(key);
+        return it != mAnswers.end() && it->second >= ttl / 2;
+    }
+}
@@ -0,0 +1,146 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MdnsMessage.h"
+
+namespace dnssd_uwp
+{
+    // Builds the packets of one query: the questions followed by the answers the querier already has
+    // (RFC 6762 section 7.1). When the known answers don't fit in one packet the rest follow in
+    // answer-only packets and every packet but the last has the TC bit set (section 7.2).
+    class MdnsQueryBuilder
+    {
+    public:
+        explicit MdnsQueryBuilder(size_t packetSize = MDNS_ETHERNET_PAYLOAD_SIZE);
+
+        void AddQuestion(const std::string& name, uint16_t type, bool unicastResponse = false);
+
+        // record.ttl is the remaining TTL. Callers only pass records with more than half their TTL left
+        void AddKnownAnswer(const MdnsRecord& record);
+
+        bool IsEmpty() const {
+            return mQuestions.empty();
+        }
+
+        size_t KnownAnswerCount() const {
+            return mKnownAnswers.size();
+        }
+
+        // writes the query and calls send once per packet. Returns the number of packets
+        size_t Build(const std::function<void(const uint8_t* data, size_t size, bool truncated)>& send) const;
+
+        void Clear();
+
+    private:
+        struct Question
+        {
+            std::string name;
+            uint16_t type;
+            bool unicastResponse;
+        };
+
+        size_t mPacketSize;
+        std::vector<Question> mQuestions;
+        std::vector<MdnsRecord> mKnownAnswers;
+    };
+
+    // The known answers of a query, possibly gathered from several TC packets.
+    // A responder leaves out any answer listed here with at least half its real TTL remaining.
+    class MdnsKnownAnswerList
+    {
+    public:
+        // collect the answer section of a query packet
+        void Add(MdnsMessageReader& query);
+
+        bool Suppresses(const MdnsRecord& record) const;
+
+        // the same with a key made beforehand by MakeKey(record), for records answered over and over
+        bool Suppresses(const std::string& key, uint32_t ttl) const;
+        static std::string MakeKey(const MdnsRecord& record);
+
+        bool IsEmpty() const {
+            return mAnswers.empty();
+        }
+
+        void Clear() {
+            mAnswers.clear();
+        }
+
+    private:
+        static std::string MakeKey(const std::string& name, uint16_t type, const uint8_t* rdata, size_t rdlength);
+
+        std::unordered_map<std::string, uint32_t> mAnswers;    // name, type and rdata to the TTL the querier has left
+    };
+
+    // How much traffic known-answer suppression, response aggregation and the multicast rate limit saved a responder
+    struct MdnsResponderCounters
+    {
+        MdnsResponderCounters()
+            : queriesReceived(0)
+            , responsesSent(0)
+            , responsesSuppressed(0)
+            , answersSent(0)
+            , answersSuppressed(0)
+            , bytesSent(0)
+            , queriesAggregated(0)
+            , answersDeduplicated(0)
+            , duplicateAnswersSuppressed(0)
+            , answersRateLimited(0)
+            , recordsUpdated(0)
+        {
+        }
+
+        std::atomic<uint64_t> queriesReceived;
+        std::atomic<uint64_t> responsesSent;
+        std::atomic<uint64_t> responsesSuppressed;  // queries we had answers for, all of them already known
+        std::atomic<uint64_t> answersSent;
+        std::atomic<uint64_t> answersSuppressed;    // answers left out because the querier listed them
+        std::atomic<uint64_t> bytesSent;
+        std::atomic<uint64_t> queriesAggregated;    // queries answered by a response already waiting for other queries
+        std::atomic<uint64_t> answersDeduplicated;  // answers asked for again while waiting to be sent, sent once
+        std::atomic<uint64_t> duplicateAnswersSuppressed;   // waiting answers another responder multicast first (section 7.4)
+        std::atomic<uint64_t> answersRateLimited;   // answers and additional records multicast less than a second before
+        std::atomic<uint64_t> recordsUpdated;       // changed SRV and TXT records announced after Update()
+    };
+
+    // Query side of the same: what the known-answer lists cost
+    struct MdnsQuerierCounters
+    {
+        MdnsQuerierCounters()
+            : queriesSent(0)
+            , packetsSent(0)
+            , truncatedPackets(0)
+            , knownAnswersSent(0)
+            , bytesSent(0)
+            , packetsReceived(0)
+            , questionsSuppressed(0)
+        {
+        }
+
+        std::atomic<uint64_t> queriesSent;
+        std::atomic<uint64_t> packetsSent;
+        std::atomic<uint64_t> truncatedPackets;     // packets with the TC bit, followed by more known answers
+        std::atomic<uint64_t> knownAnswersSent;
+        std::atomic<uint64_t> bytesSent;
+        std::atomic<uint64_t> packetsReceived;      // responses read and parsed, ours or not
+        std::atomic<uint64_t> questionsSuppressed;  // browse questions not sent, another host asked first (section 7.3)
+    };
+};
@@ -0,0 +1,945 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsQueryEngine.h"
+#include "MdnsServiceWatcher.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    // RFC 6762 section 5.2: the interval between browse queries starts at one second and doubles up to one hour
+    static const std::chrono::seconds kFirstQueryInterval(1);
+    static const std::chrono::seconds kMaxQueryInterval(3600);
+
+    // the first query of a type waits the low end of the 20-120 ms the same section allows,
+    // so types subscribed together (an application starting its watchers) share one packet
+    static const std::chrono::milliseconds kFirstQueryDelay(20);
+
+    // RFC 6762 section 7.3: a browse query due within this long is skipped when another host asks the same question first
+    static const std::chrono::milliseconds kDuplicateQuestionWindow(1000);
+
+    // query packets we remember sending: a multi-packet query with known answers takes a few
+    static const size_t kSentQueryHistory = 16;
+
+    static uint32_t PacketHash(const uint8_t* data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // order in which the records of a response are applied: instances, then their SRV and TXT records, then the addresses of the SRV targets
+    static int RecordPass(uint16_t type)
+    {
+        switch (type)
+        {
+        case MDNS_TYPE_PTR:
+            return 0;
+        case MDNS_TYPE_SRV:
+        case MDNS_TYPE_TXT:
+            return 1;
+        case MDNS_TYPE_A:
+        case MDNS_TYPE_AAAA:
+            return 2;
+        default:
+            return -1;
+        }
+    }
+
+    static bool ParseSrv(const MdnsCacheEntry& entry, uint16_t& port, std::string& target)
+    {
+        // priority, weight, port, then the target name, expanded by the cache
+        if (entry.rdata.size() < 7)
+        {
+            return false;
+        }
+        const uint8_t* rdata = reinterpret_cast<const uint8_t*>(entry.rdata.data());
+        port = static_cast<uint16_t>((rdata[4] << 8) | rdata[5]);
+        target.assign(entry.rdata, 6, std::string::npos);
+        return true;
+    }
+
+    static std::vector<uint32_t> SortInterfaces(std::vector<uint32_t> interfaces)
+    {
+        std::sort(interfaces.begin(), interfaces.end());
+        interfaces.erase(std::unique(interfaces.begin(), interfaces.end()), interfaces.end());
+        return interfaces;
+    }
+
+    static std::mutex sSharedLock;
+    static std::map<std::vector<uint32_t>, std::weak_ptr<MdnsQueryEngine>> sShared;   // by sorted interface set
+
+    std::shared_ptr<MdnsQueryEngine> MdnsQueryEngine::GetShared(const std::vector<uint32_t>& interfaces)
+    {
+        std::lock_guard<std::mutex> guard(sSharedLock);
+
+        std::vector<uint32_t> key = SortInterfaces(interfaces);
+        std::shared_ptr<MdnsQueryEngine> engine = sShared[key].lock();
+        if (engine)
+        {
+            return engine;
+        }
+
+        engine = std::make_shared<MdnsQueryEngine>(key);
+        if (engine->Start() != DNSSD_NO_ERROR)
+        {
+            sShared.erase(key);
+            return nullptr;
+        }
+        sShared[key] = engine;
+        return engine;
+    }
+
+    MdnsQueryEngine::MdnsQueryEngine(const std::vector<uint32_t>& interfaces)
+        : mInterfaces(SortInterfaces(interfaces))
+        , mWatchingWritable(false)
+        , mUnsubscribed(false)
+        , mCache(mTimers)
+        , mFirstQuery(MdnsClock::time_point::min())
+        , mSentQueries(kSentQueryHistory, 0)
+        , mNextSentQuery(0)
+        , mPacketReceived(0)
+    {
+    }
+
+    MdnsQueryEngine::~MdnsQueryEngine()
+    {
+        if (mReactor)
+        {
+            mReactor->Remove(this);
+        }
+    }
+
+    DnssdErrorType MdnsQueryEngine::Start()
+    {
+        std::vector<MdnsInterface> interfaces;
+        if (!MdnsSelectInterfaces(mInterfaces, interfaces))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        std::vector<int> fds;
+        for (const MdnsInterface& networkInterface : interfaces)
+        {
+            std::unique_ptr<MdnsSocket> socket(new MdnsSocket());
+            if (socket->Open(networkInterface) != DNSSD_NO_ERROR)
+            {
+                mSockets.clear();
+                return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+            }
+            fds.push_back(socket->GetFd());
+            mSockets.push_back(std::move(socket));
+        }
+
+        std::shared_ptr<MdnsReactor> reactor = MdnsReactor::GetShared();
+        if (!reactor || reactor->Add(this, fds) != DNSSD_NO_ERROR)
+        {
+            mSockets.clear();
+            return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+        }
+        mReactor = reactor;
+        return DNSSD_NO_ERROR;
+    }
+
+    DnssdErrorType MdnsQueryEngine::Subscribe(MdnsServiceWatcher* watcher, const std::string& serviceName)
+    {
+        std::string queryName = MdnsMakeName(serviceName + ".local");
+        if (queryName.empty())
+        {
+            return DNSSD_INVALID_SERVICE_NAME_ERROR;
+        }
+
+        {
+            std::lock_guard<std::recursive_mutex> guard(mLock);
+            mPending.push_back(Subscription{ watcher, queryName });
+        }
+        Wake();
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsQueryEngine::Unsubscribe(MdnsServiceWatcher* watcher)
+    {
+        {
+            std::lock_guard<std::recursive_mutex> guard(mLock);
+
+            mPending.erase(std::remove_if(mPending.begin(), mPending.end(),
+                [&](const Subscription& s) { return s.watcher == watcher; }), mPending.end());
+
+            // cleared rather than erased: the engine thread may be walking this list in a callback
+            for (auto& browse : mBrowses)
+            {
+                std::replace(browse->mSubscribers.begin(), browse->mSubscribers.end(), watcher, static_cast<MdnsServiceWatcher*>(nullptr));
+            }
+            mUnsubscribed = true;
+        }
+        Wake();
+    }
+
+    std::shared_ptr<void> MdnsQueryEngine::Hold()
+    {
+        return weak_from_this().lock();
+    }
+
+    bool MdnsQueryEngine::IsReleased() const
+    {
+        // in a reactor call: the reactor's hold is the only reference left once a callback freed the last watcher
+        return weak_from_this().use_count() <= 1;
+    }
+
+    void MdnsQueryEngine::Wake()
+    {
+        if (mReactor)
+        {
+            mReactor->Wake(this);
+        }
+    }
+
+    void MdnsQueryEngine::OnReadable(int fd)
+    {
+        std::lock_guard<std::recursive_mutex> guard(mLock);
+
+        // a batch of packets per system call, parsed where they were received
+        MdnsReceiveRing& ring = mReactor->GetReceiveRing();
+        for (auto& socket : mSockets)
+        {
+            if (socket->GetFd() != fd)
+            {
+                continue;
+            }
+
+            while (socket->ReceiveBatch(ring) > 0)
+            {
+                for (size_t i = 0; i < ring.GetCount(); ++i)
+                {
+                    MdnsReceivedPacket packet = ring.Get(i);
+                    mCounters.packetsReceived++;
+                    mPacketReceived = packet.received;
+                    MDNS_TRACE_SINCE_RECEIVED("engine", "packet waiting", packet.received);
+                    OnPacketReceived(packet.data, packet.size, socket->GetInterfaceIndex());
+                }
+
+                // a short batch emptied the socket: no need to ask again
+                if (!ring.IsFull())
+                {
+                    break;
+                }
+            }
+        }
+        mPacketReceived = 0;
+    }
+
+    MdnsClock::time_point MdnsQueryEngine::OnDue(MdnsClock::time_point now)
+    {
+        std::lock_guard<std::recursive_mutex> guard(mLock);
+
+        UpdateSubscriptions(now);
+        OnTimers(now);
+        WatchBlockedSockets();
+        return mTimers.NextDeadline();
+    }
+
+    void MdnsQueryEngine::OnWritable(int fd)
+    {
+        std::lock_guard<std::recursive_mutex> guard(mLock);
+        for (auto& socket : mSockets)
+        {
+            if (socket->GetFd() == fd)
+            {
+                socket->Flush();
+            }
+        }
+    }
+
+    void MdnsQueryEngine::WatchBlockedSockets()
+    {
+        // a query with many known answers can fill a send buffer: the rest of it goes once the socket drains
+        bool blocked = std::any_of(mSockets.begin(), mSockets.end(), [](const std::unique_ptr<MdnsSocket>& socket) { return socket->IsBlocked(); });
+        if (blocked || mWatchingWritable)
+        {
+            for (auto& socket : mSockets)
+            {
+                mReactor->WatchWritable(this, socket->GetFd(), socket->IsBlocked());
+            }
+            mWatchingWritable = blocked;
+        }
+    }
+
+    void MdnsQueryEngine::UpdateSubscriptions(MdnsClock::time_point now)
+    {
+        if (mUnsubscribed)
+        {
+            mUnsubscribed = false;
+            for (size_t i = mBrowses.size(); i-- > 0;)
+            {
+                auto& subscribers = mBrowses[i]->mSubscribers;
+                subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), nullptr), subscribers.end());
+                if (subscribers.empty())
+                {
+                    DropBrowse(i);
+                }
+            }
+        }
+
+        // one at a time: a callback may subscribe or unsubscribe other watchers
+        while (!mPending.empty())
+        {
+            Subscription subscription = mPending.front();
+            mPending.erase(mPending.begin());
+
+            MdnsBrowse* browse = FindBrowse(subscription.queryName);
+            if (browse == nullptr)
+            {
+                std::unique_ptr<MdnsBrowse> added(new MdnsBrowse());
+                added->mQueryName = subscription.queryName;
+                added->mQueryInterval = kFirstQueryInterval;
+                added->mBrowseDue = false;
+                browse = added.get();
+                browse->mQueryTimer.SetCallback([this, browse] { OnQueryTimer(*browse); });
+
+                if (mFirstQuery <= now)
+                {
+                    mFirstQuery = now + kFirstQueryDelay;
+                }
+                mTimers.Schedule(browse->mQueryTimer, mFirstQuery);
+                mBrowses.push_back(std::move(added));
+            }
+            browse->mSubscribers.push_back(subscription.watcher);
+            subscription.watcher->OnSubscribed();
+
+            // a new subscriber of a known type starts from what the cache already has
+            for (auto& it : browse->mServices)
+            {
+                if (it.second.mReported)
+                {
+                    it.second.mType = DnssdServiceUpdateType::ServiceAdded;
+                    subscription.watcher->OnDnssdServiceUpdated(it.second);
+                }
+            }
+            subscription.watcher->OnUpdatePassEnd(*browse);
+        }
+    }
+
+    void MdnsQueryEngine::DropBrowse(size_t index)
+    {
+        std::unique_ptr<MdnsBrowse> browse = std::move(mBrowses[index]);
+        mBrowses.erase(mBrowses.begin() + index);
+
+        // nobody watches the type any more: forget its records
+        std::vector<std::string> targets;
+        for (const auto& it : browse->mServices)
+        {
+            mCache.Remove(it.second.mName, MDNS_TYPE_SRV);
+            mCache.Remove(it.second.mName, MDNS_TYPE_TXT);
+            if (!it.second.mTarget.empty())
+            {
+                targets.push_back(it.second.mTarget);
+            }
+        }
+        mCache.Remove(browse->mQueryName, MDNS_TYPE_PTR);
+
+        for (const auto& target : targets)
+        {
+            if (!IsTarget(target))
+            {
+                mCache.Remove(target, MDNS_TYPE_A);
+                mCache.Remove(target, MDNS_TYPE_AAAA);
+            }
+        }
+    }
+
+    MdnsBrowse* MdnsQueryEngine::FindBrowse(const std::string& queryName) const
+    {
+        for (const auto& browse : mBrowses)
+        {
+            if (MdnsNameEquals(browse->mQueryName, queryName))
+            {
+                return browse.get();
+            }
+        }
+        return nullptr;
+    }
+
+    void MdnsQueryEngine::OnTimers(MdnsClock::time_point now)
+    {
+        if (mTimers.Advance(now) == 0)
+        {
+            return;
+        }
+
+        std::vector<MdnsCacheEntry> expired;
+        std::vector<MdnsRefreshQuestion> refresh;
+        mCache.TakeEvents(expired, refresh);
+
+        for (const auto& entry : expired)
+        {
+            OnRecordExpired(entry);
+        }
+
+        // browse queries and refresh questions due in the same tick share the packet
+        SendQuery(refresh, now);
+
+        UpdateChangedServices();
+    }
+
+    void MdnsQueryEngine::OnQueryTimer(MdnsBrowse& browse)
+    {
+        browse.mBrowseDue = true;
+        mTimers.Schedule(browse.mQueryTimer, browse.mQueryTimer.Expires() + browse.mQueryInterval);
+        browse.mQueryInterval = std::min(browse.mQueryInterval * 2, kMaxQueryInterval);
+    }
+
+    void MdnsQueryEngine::SendQuery(const std::vector<MdnsRefreshQuestion>& refresh, MdnsClock::time_point now)
+    {
+        // browses are asked on every interface, a refresh question where its record came from
+        for (auto& socket : mSockets)
+        {
+            SendQuery(*socket, refresh, now);
+        }
+
+        for (auto& browse : mBrowses)
+        {
+            browse->mBrowseDue = false;
+        }
+    }
+
+    void MdnsQueryEngine::SendQuery(MdnsSocket& socket, const std::vector<MdnsRefreshQuestion>& refresh, MdnsClock::time_point now)
+    {
+        MDNS_TRACE_SCOPE("engine", "send query");
+        MdnsQueryBuilder query;
+        uint32_t interfaceIndex = socket.GetInterfaceIndex();
+
+        for (auto& browse : mBrowses)
+        {
+            if (browse->mBrowseDue)
+            {
+                query.AddQuestion(browse->mQueryName, MDNS_TYPE_PTR);
+                AddKnownAnswers(query, browse->mQueryName, MDNS_TYPE_PTR, interfaceIndex, now);
+            }
+        }
+
+        for (const auto& question : refresh)
+        {
+            MdnsBrowse* browse = question.type == MDNS_TYPE_PTR ? FindBrowse(question.name) : nullptr;
+            if (question.interfaceIndex != interfaceIndex || (browse != nullptr && browse->mBrowseDue))
+            {
+                // another interface's, or asked above
+                continue;
+            }
+            query.AddQuestion(question.name, question.type);
+            AddKnownAnswers(query, question.name, question.type, interfaceIndex, now);
+        }
+
+        if (query.IsEmpty())
+        {
+            return;
+        }
+
+        // a query truncated into several packets goes out in one system call
+        size_t packets = 0;
+        size_t truncatedPackets = 0;
+        size_t bytes = 0;
+        query.Build([&](const uint8_t* data, size_t size, bool truncated)
+        {
+            mSentQueries[mNextSentQuery] = PacketHash(data, size);
+            mNextSentQuery = (mNextSentQuery + 1) % mSentQueries.size();
+            socket.Queue(data, size);
+            packets++;
+            truncatedPackets += truncated ? 1 : 0;
+            bytes += size;
+        });
+        size_t sent = socket.Flush();
+        mCounters.packetsSent += sent;
+        if (sent == packets)
+        {
+            mCounters.truncatedPackets += truncatedPackets;
+            mCounters.bytesSent += bytes;
+        }
+        mCounters.queriesSent++;
+        MdnsCount(MdnsStatQueriesSent);
+        mCounters.knownAnswersSent += query.KnownAnswerCount();
+    }
+
+    void MdnsQueryEngine::AddKnownAnswers(MdnsQueryBuilder& query, const std::string& name, uint16_t type, uint32_t interfaceIndex, MdnsClock::time_point now) const
+    {
+        // RFC 6762 section 7.1: list what we have cached with more than half its TTL left so responders stay quiet.
+        // A record at a refresh point has less than 20% left and is never listed. Only what this interface's
+        // responders sent: one elsewhere must still answer
+        mCache.ForEach(name, type, [&](const MdnsCacheEntry& entry)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::seconds>(entry.expires - now).count();
+            if (entry.interfaceIndex == interfaceIndex && remaining * 2 > static_cast<int64_t>(entry.ttl))
+            {
+                query.AddKnownAnswer(MdnsRecord{ entry.name, entry.type, MDNS_CLASS_IN, false, static_cast<uint32_t>(remaining), entry.rdata });
+            }
+        });
+    }
+
+    void MdnsQueryEngine::OnPacketReceived(const uint8_t* data, size_t size, uint32_t interfaceIndex)
+    {
+        MDNS_TRACE_SCOPE("engine", "packet");
+        MdnsMessageReader reader(data, size);
+        if (!reader.IsValid())
+        {
+            return;
+        }
+
+        auto now = MdnsClock::now();
+        if (!reader.IsResponse())
+        {
+            OnQueryReceived(reader, data, size, interfaceIndex, now);
+            return;
+        }
+
+        MdnsRecordView record;
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            MDNS_TRACE_SCOPE("engine", "parse");
+            reader.Rewind();
+            while (reader.NextRecord(record))
+            {
+                if (record.section != MdnsAuthoritySection && RecordPass(record.type) == pass)
+                {
+                    OnRecord(record, interfaceIndex, now);
+                }
+            }
+        }
+
+        UpdateChangedServices();
+    }
+
+    void MdnsQueryEngine::OnQueryReceived(MdnsMessageReader& query, const uint8_t* data, size_t size, uint32_t interfaceIndex, MdnsClock::time_point now)
+    {
+        // RFC 6762 section 7.3: another host asks a browse question we are about to ask, listing no known answer we
+        // would not list ourselves. The responses to its query tell us all ours would, so ours counts as sent.
+        // A truncated query lists more known answers in packets to come and is not comparable. A browse query
+        // goes out on every interface at once: one host's question only stands for ours when there is one interface
+        if (mSockets.size() != 1 || query.IsTruncated() || std::find(mSentQueries.begin(), mSentQueries.end(), PacketHash(data, size)) != mSentQueries.end())
+        {
+            return;
+        }
+
+        std::vector<MdnsBrowse*> asked;
+        MdnsQuestionView question;
+        while (query.NextQuestion(question))
+        {
+            if (question.type != MDNS_TYPE_PTR || question.unicastResponse)
+            {
+                continue;
+            }
+            for (auto& browse : mBrowses)
+            {
+                if (browse->mQueryTimer.IsScheduled() && browse->mQueryTimer.Expires() <= now + kDuplicateQuestionWindow &&
+                    question.name.Equals(browse->mQueryName))
+                {
+                    asked.push_back(browse.get());
+                }
+            }
+        }
+        if (asked.empty())
+        {
+            return;
+        }
+
+        // responders stay quiet about the instances the other host knows: we must know them as well
+        MdnsRecordView record;
+        MdnsNameView target;
+        while (query.NextRecord(record))
+        {
+            if (record.section != MdnsAnswerSection || record.type != MDNS_TYPE_PTR || !record.GetPtr(target))
+            {
+                continue;
+            }
+            for (auto& browse : asked)
+            {
+                if (browse == nullptr || !record.name.Equals(browse->mQueryName))
+                {
+                    continue;
+                }
+                bool known = mCache.Any(browse->mQueryName, MDNS_TYPE_PTR, [&](const MdnsCacheEntry& entry)
+                {
+                    auto remaining = std::chrono::duration_cast<std::chrono::seconds>(entry.expires - now).count();
+                    return entry.interfaceIndex == interfaceIndex && remaining * 2 > static_cast<int64_t>(entry.ttl) && target.Equals(entry.rdata);
+                });
+                if (!known)
+                {
+                    browse = nullptr;
+                }
+            }
+        }
+
+        for (MdnsBrowse* browse : asked)
+        {
+            if (browse != nullptr)
+            {
+                mTimers.Schedule(browse->mQueryTimer, now + browse->mQueryInterval);
+                browse->mQueryInterval = std::min(browse->mQueryInterval * 2, kMaxQueryInterval);
+                mCounters.questionsSuppressed++;
+            }
+        }
+    }
+
+    void MdnsQueryEngine::OnRecord(const MdnsRecordView& record, uint32_t interfaceIndex, MdnsClock::time_point now)
+    {
+        MdnsNameView target;
+        MdnsCount(MdnsStatRecordsParsed);
+
+        switch (record.type)
+        {
+        case MDNS_TYPE_PTR:
+            for (auto& browse : mBrowses)
+            {
+                if (record.name.Equals(browse->mQueryName) && record.GetPtr(target))
+                {
+                    MdnsCache::InsertResult result = mCache.Insert(record, interfaceIndex, now);
+                    if (result == MdnsCache::CacheGoodbye)
+                    {
+                        // removed before this packet's pass ends, not when a query goes unanswered
+                        MdnsServiceInstance* service = FindService(MdnsLowerCase(target.ToName()));
+                        if (service != nullptr)
+                        {
+                            service->mChanged = true;
+                        }
+                    }
+                    else if (result == MdnsCache::CacheAdded)
+                    {
+                        std::string name = target.ToName();
+                        std::string key = MdnsLowerCase(name);
+                        auto it = browse->mServices.find(key);
+                        if (it == browse->mServices.end())
+                        {
+                            MdnsServiceInstance info;
+                            info.mFields.Set(DnssdServiceFields::Id, MdnsNameToString(name));
+                            info.mFields.Set(DnssdServiceFields::InstanceName, MdnsFirstLabel(name));
+                            info.mName = name;
+                            it = browse->mServices.emplace(key, info).first;
+                        }
+                        it->second.mChanged = true;
+                    }
+                    break;
+                }
+            }
+            break;
+
+        case MDNS_TYPE_SRV:
+            {
+                // only the services we browse for are cached
+                MdnsServiceInstance* service = FindService(MdnsLowerCase(record.name.ToName()));
+                MdnsCache::InsertResult result = service != nullptr ? mCache.Insert(record, interfaceIndex, now) : MdnsCache::CacheIgnored;
+                if (result == MdnsCache::CacheGoodbye)
+                {
+                    service->mChanged = true;
+                }
+                else if (result == MdnsCache::CacheAdded)
+                {
+                    // remember the target now so its address record in the same packet is recognized
+                    uint16_t port;
+                    const MdnsCacheEntry* srv = mCache.Find(service->mName, MDNS_TYPE_SRV);
+                    if (srv != nullptr)
+                    {
+                        ParseSrv(*srv, port, service->mTarget);
+                    }
+                    service->mChanged = true;
+                }
+            }
+            break;
+
+        case MDNS_TYPE_TXT:
+            {
+                // a new TXT record flushes the old one (cache-flush bit); the raw bytes are compared when reporting
+                MdnsServiceInstance* service = FindService(MdnsLowerCase(record.name.ToName()));
+                MdnsCache::InsertResult result = service != nullptr ? mCache.Insert(record, interfaceIndex, now) : MdnsCache::CacheIgnored;
+                if (result == MdnsCache::CacheAdded || result == MdnsCache::CacheGoodbye)
+                {
+                    service->mChanged = true;
+                }
+            }
+            break;
+
+        case MDNS_TYPE_A:
+        case MDNS_TYPE_AAAA:
+            {
+                std::string name = record.name.ToName();
+                MdnsCache::InsertResult result = IsTarget(name) ? mCache.Insert(record, interfaceIndex, now) : MdnsCache::CacheIgnored;
+                if (result == MdnsCache::CacheAdded || result == MdnsCache::CacheGoodbye)
+                {
+                    MarkTargetChanged(name);
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void MdnsQueryEngine::OnRecordExpired(const MdnsCacheEntry& entry)
+    {
+        switch (entry.type)
+        {
+        case MDNS_TYPE_PTR:
+            {
+                MdnsServiceInstance* service = FindService(MdnsLowerCase(entry.rdata));
+                if (service != nullptr)
+                {
+                    service->mChanged = true;
+                }
+            }
+            break;
+
+        case MDNS_TYPE_SRV:
+        case MDNS_TYPE_TXT:
+            {
+                MdnsServiceInstance* service = FindService(MdnsLowerCase(entry.name));
+                if (service != nullptr)
+                {
+                    service->mChanged = true;
+                }
+            }
+            break;
+
+        case MDNS_TYPE_A:
+        case MDNS_TYPE_AAAA:
+            MarkTargetChanged(entry.name);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void MdnsQueryEngine::MarkTargetChanged(const std::string& target)
+    {
+        for (auto& browse : mBrowses)
+        {
+            for (auto& it : browse->mServices)
+            {
+                if (MdnsNameEquals(it.second.mTarget, target))
+                {
+                    it.second.mChanged = true;
+                }
+            }
+        }
+    }
+
+    MdnsServiceInstance* MdnsQueryEngine::FindService(const std::string& key)
+    {
+        // an instance name ends with its type, so at most one browse has it
+        for (auto& browse : mBrowses)
+        {
+            auto it = browse->mServices.find(key);
+            if (it != browse->mServices.end())
+            {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    bool MdnsQueryEngine::IsBrowsed(const MdnsBrowse& browse, const std::string& name) const
+    {
+        return mCache.Any(browse.mQueryName, MDNS_TYPE_PTR, [&](const MdnsCacheEntry& ptr) { return MdnsNameEquals(ptr.rdata, name); });
+    }
+
+    bool MdnsQueryEngine::IsTarget(const std::string& target) const
+    {
+        for (const auto& browse : mBrowses)
+        {
+            for (const auto& it : browse->mServices)
+            {
+                if (MdnsNameEquals(it.second.mTarget, target))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void MdnsQueryEngine::UpdateChangedServices()
+    {
+        MDNS_TRACE_SCOPE("engine", "update services");
+        for (auto& browse : mBrowses)
+        {
+            auto& services = browse->mServices;
+            for (auto it = services.begin(); it != services.end();)
+            {
+                auto& service = it->second;
+                if (!service.mChanged)
+                {
+                    ++it;
+                    continue;
+                }
+
+                UpdateDnssdService(*browse, service);
+                if (IsReleased())
+                {
+                    // a callback freed the last watcher: nobody is left to tell, the engine goes after this call
+                    return;
+                }
+                if (IsBrowsed(*browse, service.mName))
+                {
+                    ++it;
+                    continue;
+                }
+
+                // the instance's PTR record is gone, drop what was cached for it
+                std::string target = service.mTarget;
+                mCache.Remove(service.mName, MDNS_TYPE_SRV);
+                mCache.Remove(service.mName, MDNS_TYPE_TXT);
+                it = services.erase(it);
+                if (!target.empty() && !IsTarget(target))
+                {
+                    mCache.Remove(target, MDNS_TYPE_A);
+                    mCache.Remove(target, MDNS_TYPE_AAAA);
+                }
+            }
+
+            // one batched callback and at most one new snapshot per watcher and pass.
+            // Indexed: a callback may unsubscribe a watcher, which only clears its entry
+            for (size_t i = 0; i < browse->mSubscribers.size(); ++i)
+            {
+                if (browse->mSubscribers[i] != nullptr)
+                {
+                    browse->mSubscribers[i]->OnUpdatePassEnd(*browse);
+                }
+            }
+            if (IsReleased())
+            {
+                return;
+            }
+        }
+    }
+
+    size_t MdnsQueryEngine::CollectAddresses(const std::string& target, uint16_t port)
+    {
+        mAddresses.clear();
+
+        // an address received on several interfaces is cached once per interface and reported once
+        DnssdAddress address;
+        auto known = [&]()
+        {
+            return std::any_of(mAddresses.begin(), mAddresses.end(), [&](const DnssdAddress& a) { return memcmp(&a, &address, sizeof(address)) == 0; });
+        };
+        mCache.ForEach(target, MDNS_TYPE_A, [&](const MdnsCacheEntry& entry)
+        {
+            if (entry.rdata.size() == sizeof(address.v4.address))
+            {
+                memset(&address, 0, sizeof(address));
+                address.v4.family = AF_INET;
+                address.v4.port = htons(port);
+                memcpy(address.v4.address, entry.rdata.data(), sizeof(address.v4.address));
+                if (!known())
+                {
+                    mAddresses.push_back(address);
+                }
+            }
+        });
+        mCache.ForEach(target, MDNS_TYPE_AAAA, [&](const MdnsCacheEntry& entry)
+        {
+            if (entry.rdata.size() == sizeof(address.v6.address))
+            {
+                memset(&address, 0, sizeof(address));
+                address.v6.family = AF_INET6;
+                address.v6.port = htons(port);
+                memcpy(address.v6.address, entry.rdata.data(), sizeof(address.v6.address));
+                if (!known())
+                {
+                    mAddresses.push_back(address);
+                }
+            }
+        });
+        return mAddresses.size();
+    }
+
+    void MdnsQueryEngine::UpdateDnssdService(MdnsBrowse& browse, MdnsServiceInstance& info)
+    {
+        info.mChanged = false;
+
+        size_t addressCount = 0;
+        uint16_t port = 0;
+        const MdnsCacheEntry* srv = mCache.Find(info.mName, MDNS_TYPE_SRV);
+        if (srv != nullptr && ParseSrv(*srv, port, info.mTarget))
+        {
+            addressCount = CollectAddresses(info.mTarget, port);
+        }
+
+        bool report = false;
+        if (addressCount == 0 || !IsBrowsed(browse, info.mName))
+        {
+            // not resolved yet, or one of its records expired
+            if (info.mReported)
+            {
+                info.mType = DnssdServiceUpdateType::ServiceRemoved;
+                info.mReported = false;
+                report = true;
+            }
+        }
+        else
+        {
+            // compared in binary: the strings are only formatted again when the addresses or the port changed
+            bool addressesChanged = info.mFields.SetAddresses(mAddresses.data(), addressCount);
+            bool portChanged = info.mFields.SetPortNumber(port);
+            if (addressesChanged)
+            {
+                // the host string is the first address, IPv4 if there is one
+                const DnssdAddress& first = mAddresses[0];
+                char host[INET6_ADDRSTRLEN];
+                inet_ntop(first.family, first.family == AF_INET ? static_cast<const void*>(first.v4.address) : first.v6.address, host, sizeof(host));
+                info.mFields.Set(DnssdServiceFields::Host, host, strlen(host));
+            }
+            if (portChanged)
+            {
+                char portString[8];
+                int portLength = snprintf(portString, sizeof(portString), "%u", static_cast<unsigned>(port));
+                info.mFields.Set(DnssdServiceFields::Port, portString, static_cast<size_t>(portLength));
+            }
+
+            // TXT is compared byte for byte, as received
+            const MdnsCacheEntry* txt = mCache.Find(info.mName, MDNS_TYPE_TXT);
+            bool changed = addressesChanged || portChanged;
+            changed |= txt != nullptr ? info.mFields.Set(DnssdServiceFields::Txt, txt->rdata) : info.mFields.Set(DnssdServiceFields::Txt, "", 0);
+
+            if (!info.mReported)
+            {
+                // the new service
+                info.mType = DnssdServiceUpdateType::ServiceAdded;
+                info.mReported = true;
+                report = true;
+            }
+            else
+            {
+                // service was previously found. Report the change if necessary
+                info.mType = DnssdServiceUpdateType::ServiceUpdated;
+                report = changed;
+            }
+        }
+
+        if (report)
+        {
+            for (size_t i = 0; i < browse.mSubscribers.size(); ++i)
+            {
+                if (browse.mSubscribers[i] != nullptr)
+                {
+                    browse.mSubscribers[i]->OnDnssdServiceUpdated(info, mPacketReceived);
+                }
+            }
+        }
+    }
+}
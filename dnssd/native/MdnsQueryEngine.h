@@ -0,0 +1,154 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dnssd.h"
+#include "DnssdServiceFields.h"
+#include "MdnsCache.h"
+#include "MdnsMessage.h"
+#include "MdnsQuery.h"
+#include "MdnsReactor.h"
+#include "MdnsSocket.h"
+
+namespace dnssd_uwp
+{
+    class MdnsServiceWatcher;
+
+    class MdnsServiceInstance
+    {
+    public:
+        MdnsServiceInstance()
+            : mType(DnssdServiceUpdateType::ServiceAdded)
+            , mChanged(false)
+            , mReported(false)
+        {
+        }
+
+        DnssdServiceFields mFields; // full instance name (e.g. "dnssd._daap._tcp.local"), its first label, the first
+                                    // address of mTarget, the port, TXT and the address set, as reported to the client
+        std::string mName;          // full instance name in wire format
+        std::string mTarget;        // SRV target host name in wire format
+        DnssdServiceUpdateType mType;
+        bool mChanged;
+        bool mReported;
+    };
+
+    // One browsed service type and the watchers subscribed to it
+    struct MdnsBrowse
+    {
+        std::string mQueryName;                                 // "_daap._tcp.local" in wire format
+        std::map<std::string, MdnsServiceInstance> mServices;   // keyed by lower case wire-format instance name
+        std::vector<MdnsServiceWatcher*> mSubscribers;          // nullptr once unsubscribed, until the engine thread compacts
+        MdnsTimer mQueryTimer;
+        std::chrono::seconds mQueryInterval;
+        bool mBrowseDue;
+    };
+
+    // Browses for DNS-SD service types with RFC 6762 section 5.2 continuous queries, on behalf of every
+    // MdnsServiceWatcher in the process. One socket, one MdnsTimerWheel and one MdnsCache serve all types:
+    // watchers of the same type are subscribers of one MdnsBrowse, and the questions due at the same time
+    // (browse queries of different types, refresh questions) go out in one multi-question query.
+    // Types subscribed within kFirstQueryDelay of each other share their first query and so stay in step.
+    // An engine runs on a set of interfaces, one socket each: queries go out on every interface with that interface's
+    // known answers, and records are cached per interface. It has no thread of its own: its sockets and timers are
+    // served by the process MdnsReactor, with the engine locked. "The engine thread" is the thread running the reactor.
+    // Callbacks run on it with the engine locked. A watcher may be freed from its own callback, the last one included:
+    // the reactor holds the engine until its call returns. Engines are owned by a std::shared_ptr.
+    class MdnsQueryEngine : private MdnsReactorClient, public std::enable_shared_from_this<MdnsQueryEngine>
+    {
+    public:
+        // interfaces by index, none for the default (see MdnsSelectInterfaces)
+        explicit MdnsQueryEngine(const std::vector<uint32_t>& interfaces = std::vector<uint32_t>());
+        ~MdnsQueryEngine();
+
+        // the process-wide engine for a set of interfaces, started by the first watcher and stopped with the last one.
+        // Watchers on the same interfaces share it. nullptr on error
+        static std::shared_ptr<MdnsQueryEngine> GetShared(const std::vector<uint32_t>& interfaces = std::vector<uint32_t>());
+
+        DnssdErrorType Start();
+
+        // from any thread. The watcher hears about the services already found, then about every change,
+        // on the engine thread. Once Unsubscribe returns it is not called any more.
+        // DNSSD_INVALID_SERVICE_NAME_ERROR for a name that does not fit in a DNS name
+        DnssdErrorType Subscribe(MdnsServiceWatcher* watcher, const std::string& serviceName);
+        void Unsubscribe(MdnsServiceWatcher* watcher);
+
+        const MdnsQuerierCounters& GetCounters() const {
+            return mCounters;
+        }
+
+    private:
+        MdnsQueryEngine(const MdnsQueryEngine&) = delete;
+        MdnsQueryEngine& operator=(const MdnsQueryEngine&) = delete;
+
+        struct Subscription
+        {
+            MdnsServiceWatcher* watcher;
+            std::string queryName;
+        };
+
+        void OnReadable(int fd) override;
+        void OnWritable(int fd) override;
+        MdnsClock::time_point OnDue(MdnsClock::time_point now) override;
+        std::shared_ptr<void> Hold() override;
+        void WatchBlockedSockets();
+        bool IsReleased() const;
+        void Wake();
+        void UpdateSubscriptions(MdnsClock::time_point now);
+        void DropBrowse(size_t index);
+        MdnsBrowse* FindBrowse(const std::string& queryName) const;
+        void OnTimers(MdnsClock::time_point now);
+        void OnQueryTimer(MdnsBrowse& browse);
+        void SendQuery(const std::vector<MdnsRefreshQuestion>& refresh, MdnsClock::time_point now);
+        void SendQuery(MdnsSocket& socket, const std::vector<MdnsRefreshQuestion>& refresh, MdnsClock::time_point now);
+        void AddKnownAnswers(MdnsQueryBuilder& query, const std::string& name, uint16_t type, uint32_t interfaceIndex, MdnsClock::time_point now) const;
+        void OnPacketReceived(const uint8_t* data, size_t size, uint32_t interfaceIndex);
+        void OnQueryReceived(MdnsMessageReader& query, const uint8_t* data, size_t size, uint32_t interfaceIndex, MdnsClock::time_point now);
+        void OnRecord(const MdnsRecordView& record, uint32_t interfaceIndex, MdnsClock::time_point now);
+        void OnRecordExpired(const MdnsCacheEntry& entry);
+        void MarkTargetChanged(const std::string& target);
+        MdnsServiceInstance* FindService(const std::string& key);
+        bool IsBrowsed(const MdnsBrowse& browse, const std::string& name) const;
+        bool IsTarget(const std::string& target) const;
+        size_t CollectAddresses(const std::string& target, uint16_t port);
+        void UpdateChangedServices();
+        void UpdateDnssdService(MdnsBrowse& browse, MdnsServiceInstance& info);
+
+        std::vector<uint32_t> mInterfaces;                      // as asked for, sorted
+        std::vector<std::unique_ptr<MdnsSocket>> mSockets;      // one per interface
+        std::shared_ptr<MdnsReactor> mReactor;                  // serving the sockets and timers once started
+        bool mWatchingWritable;                                 // some socket is watched for a full send buffer draining
+
+        std::recursive_mutex mLock;                             // held by the engine thread while it works, callbacks included
+        std::vector<Subscription> mPending;                     // subscribed, not yet seen by the engine thread
+        bool mUnsubscribed;                                     // some mSubscribers entry was cleared
+
+        MdnsTimerWheel mTimers;                                 // record refresh and expiry, browse queries
+        MdnsCache mCache;                                       // PTR, SRV, TXT, A and AAAA records of every browsed type
+        std::vector<std::unique_ptr<MdnsBrowse>> mBrowses;      // a handful of types: searched linearly. After mTimers,
+                                                                // their query timers are cancelled before it goes away
+        MdnsClock::time_point mFirstQuery;                      // first query of the types subscribed recently
+        MdnsQuerierCounters mCounters;
+        std::vector<uint32_t> mSentQueries;                     // hashes of the last packets we sent, to know them when they loop back
+        size_t mNextSentQuery;
+        uint64_t mPacketReceived;                               // receive time of the packet being read, 0 between packets
+        std::vector<DnssdAddress> mAddresses;                   // addresses of the service being updated, reused
+    };
+};
@@ -0,0 +1,463 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsReactor.h"
+#include "MdnsSimulatedNetwork.h"
+#include "MdnsMessage.h"
+#include "MdnsTrace.h"
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace dnssd_uwp
+{
+    static const int kMaxEvents = 64;
+
+    // the fd of a call for a client's deadline or wake-up rather than a readable socket. Simulated endpoints
+    // (MdnsSimulatedNetwork) have descriptors below it
+    static const int kNoFd = -1;
+
+    static std::mutex sSharedLock;
+    static bool sCallerThread = false;
+
+    // Never destroyed, so never released last: an engine released on the loop thread after its call would otherwise
+    // destroy the reactor from its own thread once the application's references are gone, at exit for one.
+    // The loop thread runs until the process ends
+    static std::shared_ptr<MdnsReactor>* sShared = new std::shared_ptr<MdnsReactor>();
+
+    std::shared_ptr<MdnsReactor> MdnsReactor::GetShared()
+    {
+        std::lock_guard<std::mutex> guard(sSharedLock);
+        if (!*sShared)
+        {
+            std::shared_ptr<MdnsReactor> reactor = std::make_shared<MdnsReactor>(sCallerThread);
+            if (reactor->Start() != DNSSD_NO_ERROR)
+            {
+                return nullptr;
+            }
+            *sShared = reactor;
+        }
+        return *sShared;
+    }
+
+    DnssdErrorType MdnsReactor::SetCallerThreadMode()
+    {
+        std::lock_guard<std::mutex> guard(sSharedLock);
+        if (*sShared && !(*sShared)->mCallerThread)
+        {
+            return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
+        }
+        sCallerThread = true;
+        return DNSSD_NO_ERROR;
+    }
+
+    MdnsReactor::MdnsReactor(bool callerThread)
+        : mCallerThread(callerThread)
+        , mEpollFd(-1)
+        , mWakeFd(-1)
+        , mTimerFd(-1)
+        , mRunning(false)
+        , mCalling(nullptr)
+        , mNextOrder(0)
+    {
+    }
+
+    MdnsReactor::~MdnsReactor()
+    {
+        if (mThread.joinable())
+        {
+            mRunning = false;
+            uint64_t one = 1;
+            (void)write(mWakeFd, &one, sizeof(one));
+            mThread.join();
+        }
+
+        for (int fd : { mEpollFd, mWakeFd, mTimerFd })
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    DnssdErrorType MdnsReactor::Start()
+    {
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (mEpollFd < 0 || mWakeFd < 0 || mTimerFd < 0)
+        {
+            return DNSSD_UNSPECIFIED_ERROR;
+        }
+
+        for (int fd : { mWakeFd, mTimerFd })
+        {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+            {
+                return DNSSD_UNSPECIFIED_ERROR;
+            }
+        }
+
+        if (!mCallerThread)
+        {
+            mRunning = true;
+            mThread = std::thread(&MdnsReactor::Run, this);
+        }
+        return DNSSD_NO_ERROR;
+    }
+
+    DnssdErrorType MdnsReactor::Add(MdnsReactorClient* client, const std::vector<int>& fds)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            if (mClients.find(client) != mClients.end())
+            {
+                return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
+            }
+
+            std::unique_ptr<Client> added(new Client());
+            added->client = client;
+            added->order = mNextOrder++;
+            added->timer.SetCallback([this, client] { mDue.push_back(client); });
+            for (int fd : fds)
+            {
+                if (fd < kNoFd)
+                {
+                    // served from MdnsSimulatedNetwork::TakeReady()
+                    added->fds.push_back(fd);
+                    mFds[fd] = client;
+                    continue;
+                }
+
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.fd = fd;
+                if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+                {
+                    for (int done : added->fds)
+                    {
+                        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, done, nullptr);
+                        mFds.erase(done);
+                    }
+                    return DNSSD_UNSPECIFIED_ERROR;
+                }
+                added->fds.push_back(fd);
+                mFds[fd] = client;
+            }
+            mClients[client] = std::move(added);
+
+            // its first call sets up its timers
+            mDue.push_back(client);
+        }
+        uint64_t one = 1;
+        (void)write(mWakeFd, &one, sizeof(one));
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsReactor::Remove(MdnsReactorClient* client)
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+
+        // on the loop thread this is some other client's call; any other thread waits for the client's call to end
+        if (mRunner != std::this_thread::get_id())
+        {
+            mCallDone.wait(lock, [&] { return mCalling != client; });
+        }
+
+        auto it = mClients.find(client);
+        if (it == mClients.end())
+        {
+            return;
+        }
+        for (int fd : it->second->fds)
+        {
+            if (fd > kNoFd)
+            {
+                epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+            }
+            mFds.erase(fd);
+            mWritable.erase(fd);
+        }
+        mDue.erase(std::remove(mDue.begin(), mDue.end(), client), mDue.end());
+        mClients.erase(it);
+    }
+
+    void MdnsReactor::Wake(MdnsReactorClient* client)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            if (mClients.find(client) == mClients.end())
+            {
+                return;
+            }
+            mDue.push_back(client);
+        }
+        uint64_t one = 1;
+        (void)write(mWakeFd, &one, sizeof(one));
+    }
+
+    void MdnsReactor::WatchWritable(MdnsReactorClient* client, int fd, bool watch)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        auto it = mFds.find(fd);
+        if (fd <= kNoFd || it == mFds.end() || it->second != client || (mWritable.count(fd) != 0) == watch)
+        {
+            return;
+        }
+
+        epoll_event event = {};
+        event.events = watch ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &event) == 0)
+        {
+            if (watch)
+            {
+                mWritable.insert(fd);
+            }
+            else
+            {
+                mWritable.erase(fd);
+            }
+        }
+    }
+
+    bool MdnsReactor::IsLoopThread()
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        return mRunner == std::this_thread::get_id();
+    }
+
+    size_t MdnsReactor::GetClientCount()
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        return mClients.size();
+    }
+
+    void MdnsReactor::Run()
+    {
+        while (mRunning)
+        {
+            RunOnce(-1);
+        }
+    }
+
+    size_t MdnsReactor::RunOnce(int timeoutMs)
+    {
+        std::lock_guard<std::mutex> run(mRunLock);
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            mRunner = std::this_thread::get_id();
+        }
+
+        // on a simulated network nothing happens while the loop waits: with nothing to do now, time moves on to
+        // the next thing there is to do instead
+        MdnsSimulatedNetwork* network = MdnsSimulatedNetwork::GetInstalled();
+        size_t calls = Serve(network != nullptr ? 0 : timeoutMs);
+        if (network != nullptr && calls == 0 && Skip(network, timeoutMs))
+        {
+            calls = Serve(0);
+        }
+
+        std::lock_guard<std::mutex> guard(mLock);
+        if (network == nullptr)
+        {
+            ArmTimer();
+        }
+        mRunner = std::thread::id();
+        return calls;
+    }
+
+    size_t MdnsReactor::Serve(int timeoutMs)
+    {
+        size_t calls = Dispatch(timeoutMs);
+
+        // the clients past their deadline, just added or woken, once each, in the order they were added
+        std::vector<std::pair<uint64_t, MdnsReactorClient*>> due;
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            mTimers.Advance(MdnsClock::now());
+            for (MdnsReactorClient* client : mDue)
+            {
+                auto it = mClients.find(client);
+                if (it != mClients.end())
+                {
+                    due.push_back(std::make_pair(it->second->order, client));
+                }
+            }
+            mDue.clear();
+        }
+        std::sort(due.begin(), due.end());
+        due.erase(std::unique(due.begin(), due.end()), due.end());
+        for (size_t i = 0; i < due.size(); ++i)
+        {
+            Call(due[i].second, kNoFd);
+            calls++;
+
+            // the next client reads what this one sent before it sends its own, as it would with a thread
+            // of its own: a question already asked is not asked again (RFC 6762 section 7.3)
+            if (i + 1 < due.size())
+            {
+                calls += Dispatch(0);
+            }
+        }
+        return calls;
+    }
+
+    bool MdnsReactor::Skip(MdnsSimulatedNetwork* network, int timeoutMs)
+    {
+        MdnsClock::time_point now = MdnsClock::now();
+        MdnsClock::time_point next = network->NextDelivery();
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            next = std::min(next, mTimers.NextDeadline());
+        }
+        if (timeoutMs >= 0)
+        {
+            next = std::min(next, now + std::chrono::milliseconds(timeoutMs));
+        }
+        if (next == MdnsClock::time_point::max())
+        {
+            // nothing will ever happen
+            return false;
+        }
+
+        MdnsClock::Advance(next);
+        network->Deliver(MdnsClock::now());
+        return true;
+    }
+
+    size_t MdnsReactor::Dispatch(int timeoutMs)
+    {
+        epoll_event events[kMaxEvents];
+        int count = epoll_wait(mEpollFd, events, kMaxEvents, timeoutMs);
+        size_t calls = 0;
+        mReady.clear();
+        mWritableReady.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == mWakeFd || fd == mTimerFd)
+            {
+                uint64_t value;
+                (void)read(fd, &value, sizeof(value));
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) != 0)
+            {
+                mWritableReady.push_back(fd);
+            }
+            if ((events[i].events & ~EPOLLOUT) != 0)
+            {
+                mReady.push_back(fd);
+            }
+        }
+
+        // and the simulated endpoints with packets waiting
+        MdnsSimulatedNetwork* network = MdnsSimulatedNetwork::GetInstalled();
+        if (network != nullptr)
+        {
+            network->TakeReady(mSimulatedReady);
+            mReady.insert(mReady.end(), mSimulatedReady.begin(), mSimulatedReady.end());
+        }
+
+        // what was waiting for a full send buffer goes out before the answers to what was just received
+        auto serve = [&](const std::vector<int>& ready, bool writable)
+        {
+            for (int fd : ready)
+            {
+                MdnsReactorClient* client = nullptr;
+                {
+                    std::lock_guard<std::mutex> guard(mLock);
+                    auto it = mFds.find(fd);
+                    if (it != mFds.end())
+                    {
+                        client = it->second;
+                    }
+                }
+                if (client != nullptr)
+                {
+                    Call(client, fd, writable);
+                    calls++;
+                }
+            }
+        };
+        serve(mWritableReady, true);
+        serve(mReady, false);
+        return calls;
+    }
+
+    void MdnsReactor::Call(MdnsReactorClient* client, int fd, bool writable)
+    {
+        // declared first, so dropped last: a client released by its own call goes once mLock is free again
+        std::shared_ptr<void> hold;
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            if (mClients.find(client) == mClients.end())
+            {
+                // removed since its event came in
+                return;
+            }
+            mCalling = client;
+            hold = client->Hold();
+        }
+
+        MDNS_TRACE_SCOPE("reactor", writable ? "client writable" : fd != kNoFd ? "client readable" : "client due");
+        if (writable)
+        {
+            client->OnWritable(fd);
+        }
+        else if (fd != kNoFd)
+        {
+            client->OnReadable(fd);
+        }
+        MdnsClock::time_point deadline = client->OnDue(MdnsClock::now());
+
+        {
+            std::lock_guard<std::mutex> guard(mLock);
+            mCalling = nullptr;
+            auto it = mClients.find(client);
+            if (it != mClients.end())
+            {
+                if (deadline == MdnsClock::time_point::max())
+                {
+                    mTimers.Cancel(it->second->timer);
+                }
+                else
+                {
+                    mTimers.Schedule(it->second->timer, deadline);
+                }
+            }
+        }
+        mCallDone.notify_all();
+    }
+
+    void MdnsReactor::ArmTimer()
+    {
+        // one shot at the wheel's next deadline, CLOCK_MONOTONIC being the steady clock's. A deadline in the past
+        // fires at once; none disarms it
+        itimerspec spec = {};
+        MdnsClock::time_point deadline = mTimers.NextDeadline();
+        if (deadline != MdnsClock::time_point::max())
+        {
+            int64_t ns = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count(), 1);
+            spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+            spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        }
+        timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+};
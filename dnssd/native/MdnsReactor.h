@@ -0,0 +1,159 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dnssd.h"
+#include "MdnsSocket.h"
+#include "MdnsTimerWheel.h"
+
+namespace dnssd_uwp
+{
+    class MdnsSimulatedNetwork;
+
+    // What MdnsReactor drives: an MdnsQueryEngine or an MdnsService, with its sockets and its own timers.
+    // Called on the thread running the reactor, one call at a time for all clients
+    class MdnsReactorClient
+    {
+    public:
+        virtual ~MdnsReactorClient() {}
+
+        // fd, one of the client's sockets, is readable
+        virtual void OnReadable(int fd) = 0;
+
+        // fd, watched with MdnsReactor::WatchWritable(), can be written again
+        virtual void OnWritable(int fd) {
+        }
+
+        // run whatever is due at now: timers, and the work the client was woken for. Returns when it is due next,
+        // time_point::max() for never. Called once the client is added, after every OnReadable and after Wake()
+        virtual MdnsClock::time_point OnDue(MdnsClock::time_point now) = 0;
+
+        // a reference held for the length of each call, for a client that its own callbacks may release: the last
+        // release then happens after the call, on the thread running the loop. nullptr for none
+        virtual std::shared_ptr<void> Hold() {
+            return nullptr;
+        }
+    };
+
+    // The process-wide event loop: one epoll set over the sockets of every watcher engine and service, a timer wheel
+    // with the next deadline of each client behind a timerfd, and an eventfd to wake it. Clients are handles in its
+    // tables, not threads, so the thread count stays the same however many watchers and services there are.
+    // The loop runs on a library thread started with the reactor, or, in caller thread mode, on the application's
+    // threads: RunOnce() waits for work and does it, and GetFd() is readable while there is work, for an
+    // application that polls it from its own event loop.
+    // On an MdnsSimulatedNetwork it serves the simulated endpoints too, and never waits: RunOnce() moves virtual
+    // time to the next deadline or delivery when there is nothing to do now.
+    class MdnsReactor
+    {
+    public:
+        // the reactor of the process, created on first use and never destroyed: its thread runs until the process
+        // ends. nullptr if it cannot be started
+        static std::shared_ptr<MdnsReactor> GetShared();
+
+        // make the process reactor run on the caller's threads. Only before the first GetShared()
+        static DnssdErrorType SetCallerThreadMode();
+
+        explicit MdnsReactor(bool callerThread = false);
+        ~MdnsReactor();
+
+        DnssdErrorType Start();
+
+        // from any thread. The client is called until Remove() returns
+        DnssdErrorType Add(MdnsReactorClient* client, const std::vector<int>& fds);
+
+        // from any thread but not from the client's own calls. Waits for a call in progress on another thread
+        void Remove(MdnsReactorClient* client);
+
+        // have the client's OnDue called soon, from any thread
+        void Wake(MdnsReactorClient* client);
+
+        // from the client's own calls: have its OnWritable called for fd, one of its sockets, once the socket can be
+        // written, until it is unwatched. For a socket whose send buffer filled up
+        void WatchWritable(MdnsReactorClient* client, int fd, bool watch);
+
+        // wait up to timeoutMs (-1 for ever) for work and do it; one thread at a time. Returns the number of client calls
+        size_t RunOnce(int timeoutMs);
+
+        bool IsCallerThreadMode() const {
+            return mCallerThread;
+        }
+
+        // the calling thread is running the loop: a client call or RunOnce() is up the stack
+        bool IsLoopThread();
+
+        // readable while clients have work waiting
+        int GetFd() const {
+            return mEpollFd;
+        }
+
+        // for the clients to receive packets into with MdnsSocket::ReceiveBatch: on the thread running the loop only,
+        // one client runs at a time
+        MdnsReceiveRing& GetReceiveRing() {
+            return mReceiveRing;
+        }
+
+        size_t GetClientCount();
+
+    private:
+        MdnsReactor(const MdnsReactor&) = delete;
+        MdnsReactor& operator=(const MdnsReactor&) = delete;
+
+        struct Client
+        {
+            MdnsReactorClient* client;
+            uint64_t order;             // clients due together are called in the order they were added
+            std::vector<int> fds;
+            MdnsTimer timer;            // in mTimers at the client's next deadline
+        };
+
+        void Run();
+        size_t Serve(int timeoutMs);
+        bool Skip(MdnsSimulatedNetwork* network, int timeoutMs);
+        size_t Dispatch(int timeoutMs);
+        void Call(MdnsReactorClient* client, int fd, bool writable = false);
+        void ArmTimer();
+
+        const bool mCallerThread;
+        int mEpollFd;
+        int mWakeFd;
+        int mTimerFd;
+        std::thread mThread;
+        std::atomic<bool> mRunning;
+
+        std::mutex mRunLock;            // held by the thread running the loop
+
+        std::mutex mLock;               // the tables, the wheel and mRunner
+        std::thread::id mRunner;        // the thread running the loop, while it does
+        std::condition_variable mCallDone;
+        MdnsTimerWheel mTimers;                     // before mClients, whose timers unlink from it when they go
+        std::unordered_map<MdnsReactorClient*, std::unique_ptr<Client>> mClients;
+        std::unordered_map<int, MdnsReactorClient*> mFds;
+        std::vector<MdnsReactorClient*> mDue;       // added, woken or past their deadline
+        MdnsReactorClient* mCalling;                // client being called, nullptr between calls
+        uint64_t mNextOrder;
+        MdnsReceiveRing mReceiveRing;
+        std::unordered_set<int> mWritable;          // descriptors watched for EPOLLOUT
+        std::vector<int> mReady;                    // descriptors to serve, reused by Dispatch()
+        std::vector<int> mWritableReady;
+        std::vector<int> mSimulatedReady;
+    };
+};
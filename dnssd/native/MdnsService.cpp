@@ -0,0 +1,1352 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsService.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+namespace dnssd_uwp
+{
+    // RFC 6762 section 8.1: three probes 250ms apart
+    static const int kProbeCount = 3;
+    static const std::chrono::milliseconds kProbeInterval(250);
+
+    // RFC 6762 section 8.3: at least two announcements one second apart
+    static const int kAnnounceCount = 2;
+    static const std::chrono::milliseconds kAnnounceInterval(1000);
+
+    // RFC 6762 section 6.7: TTL used in unicast replies to legacy resolvers
+    static const uint32_t kLegacyUnicastTtl = 10;
+
+    // RFC 6762 section 6: answers holding shared records wait 20-120ms, other responders may answer too
+    static const int kResponseDelayMin = 20;
+    static const int kResponseDelayMax = 120;
+
+    // RFC 6762 section 6.2: a record is multicast at most once a second, or every 250ms to defend a name against a probe
+    static const std::chrono::milliseconds kMulticastInterval(1000);
+    static const std::chrono::milliseconds kProbeDefenseInterval(250);
+
+    // RFC 6762 section 7.2: wait 400-500ms for the rest of a truncated query's known answers
+    static const int kTruncatedQueryDelayMin = 400;
+    static const int kTruncatedQueryDelayMax = 500;
+
+    static const std::string kServicesName = MdnsMakeName("_services._dns-sd._udp.local");
+
+    // what an indexed record is, in the low bits of its MdnsAnswerIndex tag. The instance index is above them
+    enum RecordKind { RecordPtr, RecordSrv, RecordTxt, RecordAddress, RecordServiceType };
+    static const int kRecordKindBits = 3;
+
+    static uint32_t MakeTag(size_t instance, RecordKind kind)
+    {
+        return static_cast<uint32_t>(instance << kRecordKindBits) | kind;
+    }
+
+    static bool ParsePort(const std::string& port, uint16_t& value)
+    {
+        if (port.empty() || port.size() > 5 || !std::all_of(port.begin(), port.end(), ::isdigit))
+        {
+            return false;
+        }
+        long n = strtol(port.c_str(), nullptr, 10);
+        if (n > 65535)
+        {
+            return false;
+        }
+        value = static_cast<uint16_t>(n);
+        return true;
+    }
+
+    // service types look like "_name._tcp" or "_name._udp", and must fit in a DNS name
+    static bool IsValidServiceName(const std::string& name)
+    {
+        if (name.size() < 7 || name[0] != '_')
+        {
+            return false;
+        }
+        std::string protocol = MdnsLowerCase(name.substr(name.size() - 5));
+        return (protocol == "._tcp" || protocol == "._udp") && !MdnsMakeName(name + ".local").empty();
+    }
+
+    // one DNS label of UTF-8 text (RFC 6763 section 4.1.1)
+    static bool IsValidInstanceName(const std::string& name)
+    {
+        return !name.empty() && name.size() <= MDNS_MAX_LABEL_LENGTH;
+    }
+
+    // the longest start of UTF-8 text that fits in size bytes without splitting a character
+    static std::string TrimUtf8(const std::string& text, size_t size)
+    {
+        if (text.size() <= size)
+        {
+            return text;
+        }
+        // continuation bytes are 10xxxxxx: back up to the first byte of the character that would be cut
+        while (size > 0 && (static_cast<uint8_t>(text[size]) & 0xC0) == 0x80)
+        {
+            size--;
+        }
+        return text.substr(0, size);
+    }
+
+    static std::string LocalHostName()
+    {
+        char buffer[256] = { 0 };
+        if (gethostname(buffer, sizeof(buffer) - 1) != 0 || buffer[0] == 0)
+        {
+            return "localhost.local";
+        }
+        std::string name(buffer);
+        size_t dot = name.find('.');
+        if (dot != std::string::npos)
+        {
+            name.resize(dot);
+        }
+        if (name.size() > MDNS_MAX_LABEL_LENGTH)
+        {
+            name.resize(MDNS_MAX_LABEL_LENGTH);
+        }
+        return name + ".local";
+    }
+
+    MdnsService::MdnsService(const std::string& name, const std::string& port)
+        : MdnsService(std::vector<MdnsServiceRegistration>{ MdnsServiceRegistration{ name, "dnssd", port } })
+    {
+    }
+
+    MdnsService::MdnsService(const std::vector<MdnsServiceRegistration>& registrations)
+        : mResponseBuffer(MDNS_MAX_PACKET_SIZE)
+        , mResponse(mIndex, mResponseBuffer.data(), MDNS_ETHERNET_PAYLOAD_SIZE)
+        , mRunning(false)
+        , mProbing(false)
+        , mWatchingWritable(false)
+        , mRandom(MdnsRandomSeed())
+        , mStartedCallback(nullptr)
+    {
+        mStateTimer.SetCallback([this] { OnStateTimer(); });
+        mHostName = MdnsMakeName(LocalHostName());
+
+        mInstances.resize(registrations.size());
+        for (size_t i = 0; i < registrations.size(); ++i)
+        {
+            Instance& instance = mInstances[i];
+            instance.serviceName = registrations[i].serviceName;
+            instance.port = registrations[i].port;
+            instance.portNumber = 0;
+            instance.baseInstanceName = registrations[i].instanceName;
+            instance.instanceName = instance.baseInstanceName;
+            instance.renameCount = 1;
+            instance.state = Probing;
+            instance.probesSent = 0;
+            instance.announcementsSent = 0;
+            instance.ptrId = MdnsAnswerIndex::kNoRecord;
+            instance.srvId = MdnsAnswerIndex::kNoRecord;
+            instance.txtId = MdnsAnswerIndex::kNoRecord;
+        }
+    }
+
+    MdnsService::~MdnsService()
+    {
+        MdnsService::Stop();
+    }
+
+    DnssdErrorType MdnsService::Start()
+    {
+        if (mRunning)
+        {
+            return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
+        }
+
+        // the loop cannot wait for work it has to do itself: from a callback, StartAsync() is the way
+        std::shared_ptr<MdnsReactor> reactor = MdnsReactor::GetShared();
+        if (reactor && reactor->IsLoopThread())
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+
+        mStarted = std::promise<DnssdErrorType>();
+        auto started = mStarted.get_future();
+        DnssdErrorType result = StartResponder();
+        if (result != DNSSD_NO_ERROR)
+        {
+            return result;
+        }
+
+        // wait for dnssd service to be probed and announced. Nobody else may be running a reactor on the
+        // application's threads: run it meanwhile
+        if (mReactor->IsCallerThreadMode())
+        {
+            while (started.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                mReactor->RunOnce(10);
+            }
+        }
+        result = started.get();
+        if (result != DNSSD_NO_ERROR)
+        {
+            Stop();
+        }
+        return result;
+    }
+
+    DnssdErrorType MdnsService::StartAsync(DnssdServiceStartedCallback callback)
+    {
+        if (callback == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        mStartedCallback = callback;
+        return StartResponder();
+    }
+
+    DnssdErrorType MdnsService::StartResponder()
+    {
+        if (mRunning)
+        {
+            return DNSSD_SERVICE_ALREADY_EXISTS_ERROR;
+        }
+
+        if (mInstances.empty())
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        for (auto& instance : mInstances)
+        {
+            if (!IsValidServiceName(instance.serviceName))
+            {
+                return DNSSD_INVALID_SERVICE_NAME_ERROR;
+            }
+
+            if (!ParsePort(instance.port, instance.portNumber) || !IsValidInstanceName(instance.baseInstanceName))
+            {
+                return DNSSD_INVALID_PARAMETER_ERROR;
+            }
+            instance.serviceType = MdnsMakeName(instance.serviceName + ".local");
+
+            // room for any instance label, renamed ones included
+            if (instance.serviceType.size() + 1 + MDNS_MAX_LABEL_LENGTH > MDNS_MAX_NAME_LENGTH)
+            {
+                return DNSSD_INVALID_SERVICE_NAME_ERROR;
+            }
+        }
+
+        std::vector<MdnsInterface> interfaces;
+        if (!MdnsSelectInterfaces(mInterfaces, interfaces))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        std::shared_ptr<MdnsReactor> reactor = MdnsReactor::GetShared();
+        if (!reactor)
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+
+        // the host has an address on every interface; each interface's answers carry its own
+        mIndex.Clear();
+        mServiceTypes.clear();
+        mLinks.clear();
+        std::vector<int> fds;
+        for (const MdnsInterface& networkInterface : interfaces)
+        {
+            std::unique_ptr<Link> link(new Link());
+            if (link->socket.Open(networkInterface) != DNSSD_NO_ERROR)
+            {
+                mLinks.clear();
+                return DNSSD_SERVICE_INITIALIZATION_ERROR;
+            }
+            link->addressRecord = MdnsRecord::MakeA(mHostName, networkInterface.address, MDNS_HOST_RECORD_TTL);
+            link->addressId = mIndex.Add(link->addressRecord, MakeTag(mLinks.size(), RecordAddress));
+            Link* pointer = link.get();
+            link->responseTimer.SetCallback([this, pointer] { OnResponseTimer(*pointer); });
+            fds.push_back(link->socket.GetFd());
+            mLinks.push_back(std::move(link));
+        }
+        mInstancesByName.clear();
+        for (auto& instance : mInstances)
+        {
+            // instances of the same group asking for the same name are told apart like any other conflict
+            instance.instanceName = instance.baseInstanceName;
+            instance.renameCount = 1;
+            if (!BuildRecords(instance))
+            {
+                Rename(instance);
+            }
+            instance.state = Probing;
+            instance.probesSent = 0;
+            instance.announcementsSent = 0;
+            instance.ptrId = MdnsAnswerIndex::kNoRecord;
+            instance.srvId = MdnsAnswerIndex::kNoRecord;
+            instance.txtId = MdnsAnswerIndex::kNoRecord;
+        }
+
+        // the first probes go out on the reactor thread once it has the responder
+        mProbing = true;
+        mTimers.Schedule(mStateTimer, MdnsClock::now());
+        mRunning = true;
+        mReactor = reactor;
+        if (mReactor->Add(this, fds) != DNSSD_NO_ERROR)
+        {
+            mRunning = false;
+            mTimers.Cancel(mStateTimer);
+            mLinks.clear();
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsService::Stop()
+    {
+        if (mRunning)
+        {
+            // once removed the reactor no longer calls in: what is left is done on this thread
+            mReactor->Remove(this);
+            mRunning = false;
+
+            // send goodbye packets so watchers drop the announced instances immediately
+            std::vector<Instance*> announced;
+            for (auto& instance : mInstances)
+            {
+                if (instance.state != Probing)
+                {
+                    announced.push_back(&instance);
+                }
+            }
+            SendAnnouncements(announced, true);
+
+            if (mProbing)
+            {
+                // stopped before every name was ours. An asynchronous start is not reported: the service is being freed
+                mStarted.set_value(DNSSD_SERVICE_INITIALIZATION_ERROR);
+            }
+        }
+
+        mTimers.Cancel(mStateTimer);
+        mPendingQueries.clear();
+        mRetiredQueries.clear();
+        mLinks.clear();
+    }
+
+    bool MdnsService::BuildRecords(Instance& instance)
+    {
+        size_t index = static_cast<size_t>(&instance - mInstances.data());
+        auto previous = mInstancesByName.find(MdnsLowerCase(instance.fullName));
+        if (previous != mInstancesByName.end() && previous->second == index)
+        {
+            mInstancesByName.erase(previous);
+        }
+
+        instance.fullName = MdnsMakeName(instance.instanceName, instance.serviceType);
+        instance.ptrRecord = MdnsRecord::MakePtr(instance.serviceType, instance.fullName, MDNS_OTHER_RECORD_TTL);
+        instance.srvRecord = MdnsRecord::MakeSrv(instance.fullName, mHostName, instance.portNumber, MDNS_HOST_RECORD_TTL);
+        instance.txtRecord = MdnsRecord::MakeTxt(instance.fullName, instance.txt, MDNS_OTHER_RECORD_TTL);
+        return mInstancesByName.emplace(MdnsLowerCase(instance.fullName), index).second;
+    }
+
+    void MdnsService::IndexRecords(Instance& instance)
+    {
+        // only a name that is ours is answered for: records go into the index once probing is over, and are
+        // not rebuilt until they change
+        size_t index = static_cast<size_t>(&instance - mInstances.data());
+        instance.ptrId = mIndex.Add(instance.ptrRecord, MakeTag(index, RecordPtr));
+        instance.srvId = mIndex.Add(instance.srvRecord, MakeTag(index, RecordSrv));
+        instance.txtId = mIndex.Add(instance.txtRecord, MakeTag(index, RecordTxt));
+
+        std::string type = MdnsLowerCase(instance.serviceType);
+        if (mServiceTypes.find(type) == mServiceTypes.end())
+        {
+            MdnsRecord ptr = MdnsRecord::MakePtr(kServicesName, instance.serviceType, MDNS_OTHER_RECORD_TTL);
+            mServiceTypes[type] = mIndex.Add(ptr, MakeTag(index, RecordServiceType));
+        }
+    }
+
+    MdnsService::Instance* MdnsService::FindInstance(const MdnsNameView& name)
+    {
+        auto it = mInstancesByName.find(MdnsLowerCase(name.ToName()));
+        return it != mInstancesByName.end() ? &mInstances[it->second] : nullptr;
+    }
+
+    void MdnsService::OnReadable(int fd)
+    {
+        MdnsReceiveRing& ring = mReactor->GetReceiveRing();
+        for (auto& link : mLinks)
+        {
+            if (link->socket.GetFd() != fd)
+            {
+                continue;
+            }
+
+            while (link->socket.ReceiveBatch(ring) > 0)
+            {
+                for (size_t i = 0; i < ring.GetCount(); ++i)
+                {
+                    MdnsReceivedPacket packet = ring.Get(i);
+                    OnPacketReceived(*link, packet.data, packet.size, *packet.from);
+                }
+
+                if (!ring.IsFull())
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    MdnsClock::time_point MdnsService::OnDue(MdnsClock::time_point now)
+    {
+        bool updated;
+        {
+            std::lock_guard<std::mutex> lock(mUpdateLock);
+            updated = !mUpdates.empty();
+        }
+        if (updated)
+        {
+            ApplyUpdates();
+        }
+
+        mTimers.Advance(now);
+        mRetiredQueries.clear();
+        WatchBlockedSockets();
+        return mTimers.NextDeadline();
+    }
+
+    void MdnsService::OnWritable(int fd)
+    {
+        for (auto& link : mLinks)
+        {
+            if (link->socket.GetFd() == fd)
+            {
+                link->socket.Flush();
+            }
+        }
+    }
+
+    void MdnsService::WatchBlockedSockets()
+    {
+        // an announcement burst can fill a send buffer: the rest of it goes once the socket drains
+        bool blocked = std::any_of(mLinks.begin(), mLinks.end(), [](const std::unique_ptr<Link>& link) { return link->socket.IsBlocked(); });
+        if (blocked || mWatchingWritable)
+        {
+            for (auto& link : mLinks)
+            {
+                mReactor->WatchWritable(this, link->socket.GetFd(), link->socket.IsBlocked());
+            }
+            mWatchingWritable = blocked;
+        }
+    }
+
+    void MdnsService::OnStarted(DnssdErrorType result)
+    {
+        mStarted.set_value(result);
+
+        if (mStartedCallback != nullptr)
+        {
+            DnssdServiceStartStatus status = ServiceStarted;
+            for (const auto& instance : mInstances)
+            {
+                if (instance.instanceName != instance.baseInstanceName)
+                {
+                    status = ServiceStartedRenamed;
+                }
+            }
+            mStartedCallback((DnssdServicePtr)this, status, result, mInstances[0].instanceName.c_str());
+        }
+    }
+
+    void MdnsService::OnStateTimer()
+    {
+        auto now = mStateTimer.Expires();
+        auto next = MdnsClock::time_point::max();
+        bool probing = false;
+        std::vector<Instance*> probes;
+        std::vector<Instance*> announcements;
+
+        // every instance moves through probing and announcing on the same 250ms ticks, so their packets can be shared
+        for (auto& instance : mInstances)
+        {
+            if (instance.state == Probing)
+            {
+                if (instance.probesSent < kProbeCount)
+                {
+                    probes.push_back(&instance);
+                    instance.probesSent++;
+                    probing = true;
+                    continue;
+                }
+
+                // nobody objected. The name is ours, with any port or TXT data Update() set meanwhile
+                BuildRecords(instance);
+                IndexRecords(instance);
+                instance.state = Announcing;
+                instance.announcementsSent = 0;
+                instance.nextAnnouncement = now;
+            }
+
+            if (instance.state == Announcing && instance.nextAnnouncement <= now)
+            {
+                announcements.push_back(&instance);
+                if (++instance.announcementsSent >= kAnnounceCount)
+                {
+                    instance.state = Running;
+                }
+                else
+                {
+                    instance.nextAnnouncement = now + kAnnounceInterval;
+                }
+            }
+
+            if (instance.state == Announcing)
+            {
+                next = std::min(next, instance.nextAnnouncement);
+            }
+        }
+
+        SendProbes(probes);
+        SendAnnouncements(announcements, false);
+
+        if (probing)
+        {
+            next = now + kProbeInterval;
+        }
+        if (next != MdnsClock::time_point::max())
+        {
+            mTimers.Schedule(mStateTimer, next);
+        }
+
+        if (mProbing && !probing)
+        {
+            mProbing = false;
+            OnStarted(DNSSD_NO_ERROR);
+        }
+    }
+
+    // the size of a record written without name compression, which is at least what the writer needs for it
+    static size_t RecordSize(const MdnsRecord& record)
+    {
+        return record.name.size() + 10 + record.rdata.size();
+    }
+
+    void MdnsService::SendProbes(const std::vector<Instance*>& instances)
+    {
+        MDNS_TRACE_SCOPE("responder", "send probes");
+        uint8_t packet[MDNS_MAX_PACKET_SIZE];
+
+        // RFC 6762 section 8.1: one probe packet may ask about several names. Each question is followed, in the
+        // authority section, by the records it proposes; as many instances as fit go in each packet
+        size_t first = 0;
+        while (first < instances.size())
+        {
+            size_t last = first;
+            size_t size = MDNS_HEADER_SIZE;
+            while (last < instances.size())
+            {
+                const Instance& instance = *instances[last];
+                size_t needed = instance.fullName.size() + 4 + RecordSize(instance.srvRecord) + RecordSize(instance.txtRecord);
+                if (last > first && size + needed > MDNS_ETHERNET_PAYLOAD_SIZE)
+                {
+                    break;
+                }
+                size += needed;
+                last++;
+            }
+
+            MdnsMessageWriter probe(packet, sizeof(packet));
+            for (size_t i = first; i < last; ++i)
+            {
+                probe.AddQuestion(instances[i]->fullName, MDNS_TYPE_ANY, true);
+            }
+
+            // proposed records go in the authority section for simultaneous probe tie-breaking
+            for (size_t i = first; i < last; ++i)
+            {
+                probe.AddRecord(MdnsAuthoritySection, instances[i]->srvRecord);
+                probe.AddRecord(MdnsAuthoritySection, instances[i]->txtRecord);
+            }
+            for (auto& link : mLinks)
+            {
+                link->socket.Queue(probe.Data(), probe.Size());
+            }
+            first = last;
+        }
+
+        // every probe packet of the round in one system call per interface
+        for (auto& link : mLinks)
+        {
+            link->socket.Flush();
+        }
+    }
+
+    void MdnsService::SendAnnouncements(const std::vector<Instance*>& instances, bool goodbye)
+    {
+        MDNS_TRACE_SCOPE("responder", "send announcements");
+        uint8_t packet[MDNS_MAX_PACKET_SIZE];
+        const uint16_t flags = MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE;
+        MdnsMessageWriter announcement(packet, MDNS_ETHERNET_PAYLOAD_SIZE, 0, flags);
+        size_t records = 0;
+        auto now = MdnsClock::now();
+
+        // the same records on every interface, next to that interface's address
+        for (auto& link : mLinks)
+        {
+            // the host address may still be in use by other services: a goodbye only withdraws the service records.
+            // An announcement repeats it in every packet, next to the SRV records that point at it
+            auto begin = [&]
+            {
+                announcement.Reset(0, flags);
+                records = 0;
+                if (!goodbye)
+                {
+                    announcement.AddRecord(MdnsAnswerSection, link->addressRecord);
+                }
+            };
+            auto add = [&](const MdnsRecord& record)
+            {
+                bool added = goodbye ? announcement.AddRecord(MdnsAnswerSection, record, 0) : announcement.AddRecord(MdnsAnswerSection, record);
+                if (!added && records > 0)
+                {
+                    // full: queue what we have and carry on in a new packet
+                    link->socket.Queue(announcement.Data(), announcement.Size());
+                    begin();
+                    added = goodbye ? announcement.AddRecord(MdnsAnswerSection, record, 0) : announcement.AddRecord(MdnsAnswerSection, record);
+                }
+                records += added ? 1 : 0;
+            };
+
+            begin();
+            for (Instance* instance : instances)
+            {
+                add(instance->ptrRecord);
+                add(instance->srvRecord);
+                add(instance->txtRecord);
+            }
+
+            if (!goodbye)
+            {
+                // an announcement counts against the one second limit on answering with the same records
+                Stamp(*link, link->addressId, now);
+                for (Instance* instance : instances)
+                {
+                    for (MdnsAnswerIndex::RecordId id : { instance->ptrId, instance->srvId, instance->txtId })
+                    {
+                        Stamp(*link, id, now);
+                    }
+                }
+            }
+            if (records > 0)
+            {
+                link->socket.Queue(announcement.Data(), announcement.Size());
+            }
+            link->socket.Flush();
+        }
+    }
+
+    void MdnsService::OnPacketReceived(Link& link, const uint8_t* data, size_t size, const sockaddr_in& from)
+    {
+        MDNS_TRACE_SCOPE("responder", "packet");
+        MdnsMessageReader reader(data, size);
+        if (!reader.IsValid())
+        {
+            return;
+        }
+
+        if (mProbing)
+        {
+            CheckConflicts(reader);
+            reader.Rewind();
+        }
+
+        if (!reader.IsResponse())
+        {
+            OnQueryReceived(link, reader, data, size, from);
+        }
+        else if (link.responseTimer.IsScheduled())
+        {
+            SuppressDuplicateAnswers(link, reader);
+        }
+    }
+
+    void MdnsService::OnQueryReceived(Link& link, MdnsMessageReader& query, const uint8_t* data, size_t size, const sockaddr_in& from)
+    {
+        uint64_t source = (static_cast<uint64_t>(from.sin_addr.s_addr) << 16) | from.sin_port;
+        auto pending = mPendingQueries.find(source);
+
+        if (query.Count(MdnsQuestionSection) == 0)
+        {
+            // more known answers for a truncated query from the same host
+            if (pending != mPendingQueries.end())
+            {
+                pending->second->knownAnswers.Add(query);
+                if (query.IsTruncated())
+                {
+                    std::uniform_int_distribution<int> delay(kTruncatedQueryDelayMin, kTruncatedQueryDelayMax);
+                    mTimers.Schedule(pending->second->timer, MdnsClock::now() + std::chrono::milliseconds(delay(mRandom)));
+                }
+            }
+            return;
+        }
+
+        mCounters.queriesReceived++;
+
+        if (pending != mPendingQueries.end())
+        {
+            // a new query replaces one whose known answers never finished arriving
+            OnPendingQueryTimer(source);
+        }
+
+        if (query.IsTruncated() && from.sin_port == htons(MDNS_PORT))
+        {
+            std::unique_ptr<PendingQuery> deferred(new PendingQuery());
+            deferred->packet.assign(data, data + size);
+            deferred->from = from;
+            deferred->link = &link;
+            deferred->knownAnswers.Add(query);
+            deferred->timer.SetCallback([this, source] { OnPendingQueryTimer(source); });
+
+            std::uniform_int_distribution<int> delay(kTruncatedQueryDelayMin, kTruncatedQueryDelayMax);
+            mTimers.Schedule(deferred->timer, MdnsClock::now() + std::chrono::milliseconds(delay(mRandom)));
+            mPendingQueries[source] = std::move(deferred);
+            return;
+        }
+
+        // most queries on a busy link are for other hosts: their known answers are not worth collecting
+        if (!AsksForOurs(query))
+        {
+            return;
+        }
+        query.Rewind();
+
+        MdnsKnownAnswerList knownAnswers;
+        knownAnswers.Add(query);
+        query.Rewind();
+        AnswerQuery(link, query, from, knownAnswers);
+    }
+
+    bool MdnsService::AsksForOurs(MdnsMessageReader& query) const
+    {
+        bool found = false;
+        MdnsQuestionView question;
+        while (!found && query.NextQuestion(question))
+        {
+            mIndex.Find(question.name, question.type, question.qclass, [&](MdnsAnswerIndex::RecordId)
+            {
+                found = true;
+            });
+        }
+        return found;
+    }
+
+    void MdnsService::OnPendingQueryTimer(uint64_t source)
+    {
+        auto pending = mPendingQueries.find(source);
+        if (pending == mPendingQueries.end())
+        {
+            return;
+        }
+
+        // keep the query alive until the wheel is done with its timer
+        mRetiredQueries.push_back(std::move(pending->second));
+        mPendingQueries.erase(pending);
+
+        PendingQuery& deferred = *mRetiredQueries.back();
+        mTimers.Cancel(deferred.timer);
+        MdnsMessageReader query(deferred.packet.data(), deferred.packet.size());
+        AnswerQuery(*deferred.link, query, deferred.from, deferred.knownAnswers);
+    }
+
+    void MdnsService::CheckConflicts(MdnsMessageReader& message)
+    {
+        bool response = message.IsResponse();
+        MdnsRecordView record;
+        while (message.NextRecord(record))
+        {
+            // a response claims names in its answers; a probe proposes records in its authority section
+            bool claim = response ? record.section != MdnsAuthoritySection && record.ttl != 0 && (record.type == MDNS_TYPE_SRV || record.type == MDNS_TYPE_TXT)
+                                  : record.section == MdnsAuthoritySection && record.type == MDNS_TYPE_SRV;
+            if (!claim)
+            {
+                continue;
+            }
+
+            Instance* instance = FindInstance(record.name);
+            if (instance == nullptr || instance->state != Probing)
+            {
+                continue;
+            }
+
+            bool conflict;
+            if (response)
+            {
+                // somebody already owns the name with different data
+                const MdnsRecord& ours = record.type == MDNS_TYPE_SRV ? instance->srvRecord : instance->txtRecord;
+                conflict = !ours.RdataEquals(record);
+            }
+            else
+            {
+                // simultaneous probe tie-break (RFC 6762 section 8.2): the lexicographically later data wins.
+                // Our own probes are looped back to us and carry identical data, which is not a conflict
+                uint8_t theirs[MDNS_MAX_NAME_LENGTH + 7];
+                size_t length = record.CopyCanonicalRdata(theirs, sizeof(theirs));
+                const uint8_t* ours = reinterpret_cast<const uint8_t*>(instance->srvRecord.rdata.data());
+                conflict = std::lexicographical_compare(ours, ours + instance->srvRecord.rdata.size(), theirs, theirs + length);
+            }
+
+            if (conflict)
+            {
+                // only this instance starts probing again, under its new name
+                Rename(*instance);
+            }
+        }
+    }
+
+    void MdnsService::Rename(Instance& instance)
+    {
+        // "Name (2)": a long name is cut short at a character boundary so that the suffix still fits in the label
+        do
+        {
+            std::string suffix = " (" + std::to_string(++instance.renameCount) + ")";
+            instance.instanceName = TrimUtf8(instance.baseInstanceName, MDNS_MAX_LABEL_LENGTH - suffix.size()) + suffix;
+        } while (!BuildRecords(instance));
+        instance.probesSent = 0;
+    }
+
+    DnssdErrorType MdnsService::Update(size_t index, const char* port, const std::string* txt)
+    {
+        if (index >= mInstances.size())
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        RecordUpdate update;
+        update.instance = index;
+        update.setPort = port != nullptr;
+        update.portNumber = 0;
+        if (port != nullptr)
+        {
+            update.port = port;
+            if (!ParsePort(update.port, update.portNumber))
+            {
+                return DNSSD_INVALID_PARAMETER_ERROR;
+            }
+        }
+        update.setTxt = txt != nullptr;
+        if (txt != nullptr)
+        {
+            update.txt = *txt;
+        }
+
+        if (!mRunning)
+        {
+            // not registered yet: the records are built from the new values when it is
+            ChangeRecords(mInstances[index], update, nullptr);
+            return DNSSD_NO_ERROR;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mUpdateLock);
+            mUpdates.push_back(std::move(update));
+        }
+        mReactor->Wake(this);
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsService::ApplyUpdates()
+    {
+        std::vector<RecordUpdate> updates;
+        {
+            std::lock_guard<std::mutex> lock(mUpdateLock);
+            updates.swap(mUpdates);
+        }
+
+        // the updates that arrived together go out in one announcement
+        std::vector<MdnsAnswerIndex::RecordId> changed;
+        for (const RecordUpdate& update : updates)
+        {
+            ChangeRecords(mInstances[update.instance], update, &changed);
+        }
+        AnnounceRecords(changed);
+    }
+
+    void MdnsService::ChangeRecords(Instance& instance, const RecordUpdate& update, std::vector<MdnsAnswerIndex::RecordId>* changed)
+    {
+        bool portChanged = update.setPort && update.port != instance.port;
+        bool txtChanged = update.setTxt && update.txt != instance.txt;
+        if (portChanged)
+        {
+            instance.port = update.port;
+            instance.portNumber = update.portNumber;
+        }
+        if (txtChanged)
+        {
+            instance.txt = update.txt;
+        }
+
+        // the probes proposed the old records and must carry on with them: the new ones are built once the name is ours
+        if (changed == nullptr || instance.state == Probing)
+        {
+            return;
+        }
+
+        if (portChanged)
+        {
+            instance.srvRecord = MdnsRecord::MakeSrv(instance.fullName, mHostName, instance.portNumber, MDNS_HOST_RECORD_TTL);
+            mIndex.Update(instance.srvId, instance.srvRecord);
+            if (std::find(changed->begin(), changed->end(), instance.srvId) == changed->end())
+            {
+                changed->push_back(instance.srvId);
+            }
+        }
+        if (txtChanged)
+        {
+            instance.txtRecord = MdnsRecord::MakeTxt(instance.fullName, instance.txt, MDNS_OTHER_RECORD_TTL);
+            mIndex.Update(instance.txtId, instance.txtRecord);
+            if (std::find(changed->begin(), changed->end(), instance.txtId) == changed->end())
+            {
+                changed->push_back(instance.txtId);
+            }
+        }
+    }
+
+    void MdnsService::AnnounceRecords(const std::vector<MdnsAnswerIndex::RecordId>& ids)
+    {
+        MDNS_TRACE_SCOPE("responder", "send announcements");
+        // RFC 6762 section 8.4: only the records that changed, with the cache-flush bit so the old data is replaced.
+        // The name stays ours, nothing is probed or withdrawn
+        const uint16_t flags = MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE;
+        auto now = MdnsClock::now();
+        for (auto& link : mLinks)
+        {
+            mResponse.Reset(0, flags);
+            for (MdnsAnswerIndex::RecordId id : ids)
+            {
+                if (!mResponse.AddRecord(MdnsAnswerSection, id) && mResponse.Count(MdnsAnswerSection) > 0)
+                {
+                    link->socket.Queue(mResponse.Data(), mResponse.Size());
+                    mResponse.Reset(0, flags);
+                    mResponse.AddRecord(MdnsAnswerSection, id);
+                }
+                Stamp(*link, id, now);
+            }
+            if (mResponse.Count(MdnsAnswerSection) > 0)
+            {
+                link->socket.Queue(mResponse.Data(), mResponse.Size());
+            }
+            link->socket.Flush();
+        }
+        mCounters.recordsUpdated += ids.size();
+    }
+
+    // Response flags, one bit per kind of instance record
+    enum { AnswerPtr = 1 << RecordPtr, AnswerSrv = 1 << RecordSrv, AnswerTxt = 1 << RecordTxt };
+
+    void MdnsService::AnswerQuery(Link& link, MdnsMessageReader& query, const sockaddr_in& from, const MdnsKnownAnswerList& knownAnswers)
+    {
+        bool legacy = from.sin_port != htons(MDNS_PORT);
+        if (legacy)
+        {
+            // legacy unicast query (RFC 6762 section 6.7): answered at once, to the querier alone
+            AnswerCount count = CollectAnswers(link, query, knownAnswers, mLegacyResponse);
+            if (count.added != 0)
+            {
+                SendResponse(link, mLegacyResponse, &query, from);
+            }
+            else if (count.known != 0)
+            {
+                mCounters.responsesSuppressed++;
+            }
+            return;
+        }
+
+        // each interface answers with its own address, after its own delay
+        Response& pending = link.pendingResponse;
+        bool waiting = link.responseTimer.IsScheduled();
+        AnswerCount count = CollectAnswers(link, query, knownAnswers, pending);
+        if (count.added == 0)
+        {
+            if (count.duplicate != 0)
+            {
+                // the same question from another querier (RFC 6762 section 7.3 seen from the responder): one answer serves both
+                mCounters.queriesAggregated++;
+            }
+            else if (count.known != 0)
+            {
+                // every answer was a known answer
+                mCounters.responsesSuppressed++;
+            }
+            return;
+        }
+
+        if (query.Count(MdnsAuthoritySection) != 0)
+        {
+            // somebody probes for a name of ours: defend it now, with whatever else is waiting
+            pending.probeDefense = true;
+            mTimers.Cancel(link.responseTimer);
+            SendResponse(link, pending, nullptr, from);
+        }
+        else if (waiting)
+        {
+            mCounters.queriesAggregated++;
+        }
+        else if (pending.shared)
+        {
+            // RFC 6762 section 6: several responders may answer with shared records, each waits 20-120 ms.
+            // The queries arriving meanwhile are answered by the same packets
+            std::uniform_int_distribution<int> delay(kResponseDelayMin, kResponseDelayMax);
+            mTimers.Schedule(link.responseTimer, MdnsClock::now() + std::chrono::milliseconds(delay(mRandom)));
+        }
+        else
+        {
+            // only unique records of ours: nobody else answers, no reason to wait
+            SendResponse(link, pending, nullptr, from);
+        }
+    }
+
+    MdnsService::AnswerCount MdnsService::CollectAnswers(Link& link, MdnsMessageReader& query, const MdnsKnownAnswerList& knownAnswers, Response& response)
+    {
+        AnswerCount count = { 0, 0, 0 };
+        response.flags.resize(mInstances.size());
+
+        // every question is one index lookup per type it asks for; the records found say which instance they belong to
+        MdnsQuestionView question;
+        while (query.NextQuestion(question))
+        {
+            mIndex.Find(question.name, question.type, question.qclass, [&](MdnsAnswerIndex::RecordId id)
+            {
+                // the host name has an address per interface: the querier is told the one it can reach
+                if (IsOtherAddress(link, id))
+                {
+                    return;
+                }
+
+                // RFC 6762 section 7.1: leave out what the querier already knows
+                if (knownAnswers.Suppresses(mIndex.GetKnownAnswerKey(id), mIndex.GetRecord(id).ttl))
+                {
+                    mCounters.answersSuppressed++;
+                    MdnsCount(MdnsStatAnswersSuppressed);
+                    count.known++;
+                    return;
+                }
+
+                uint32_t tag = mIndex.GetTag(id);
+                size_t index = tag >> kRecordKindBits;
+                uint8_t flags = 0;
+                bool added = false;
+                switch (tag & ((1 << kRecordKindBits) - 1))
+                {
+                case RecordPtr:
+                    flags = AnswerPtr;
+                    break;
+                case RecordSrv:
+                    flags = AnswerSrv;
+                    break;
+                case RecordTxt:
+                    flags = AnswerTxt;
+                    break;
+                case RecordAddress:
+                    added = !response.address;
+                    response.address = true;
+                    break;
+                case RecordServiceType:
+                    added = std::find(response.serviceTypes.begin(), response.serviceTypes.end(), id) == response.serviceTypes.end();
+                    if (added)
+                    {
+                        response.serviceTypes.push_back(id);
+                        response.shared = true;
+                    }
+                    break;
+                }
+
+                if (flags != 0)
+                {
+                    uint8_t& answered = response.flags[index];
+                    if (answered == 0)
+                    {
+                        response.instances.push_back(index);
+                    }
+                    added = (answered & flags) == 0;
+                    answered |= flags;
+                    response.shared |= flags == AnswerPtr;
+                }
+
+                if (added)
+                {
+                    count.added++;
+                }
+                else
+                {
+                    mCounters.answersDeduplicated++;
+                    count.duplicate++;
+                }
+            });
+        }
+        return count;
+    }
+
+    void MdnsService::SuppressDuplicateAnswers(Link& link, MdnsMessageReader& message)
+    {
+        // RFC 6762 section 7.4: another responder multicast an answer we were about to send, with at least half our TTL
+        MdnsRecordView record;
+        while (message.NextRecord(record))
+        {
+            if (record.section != MdnsAnswerSection || record.ttl == 0)
+            {
+                continue;
+            }
+
+            mIndex.Find(record.name, record.type, record.rclass, [&](MdnsAnswerIndex::RecordId id)
+            {
+                const MdnsRecord& ours = mIndex.GetRecord(id);
+                if (IsOtherAddress(link, id) || record.ttl * 2 < ours.ttl || !ours.RdataEquals(record))
+                {
+                    return;
+                }
+
+                uint32_t tag = mIndex.GetTag(id);
+                size_t index = tag >> kRecordKindBits;
+                bool removed = false;
+                switch (tag & ((1 << kRecordKindBits) - 1))
+                {
+                case RecordPtr:
+                case RecordSrv:
+                case RecordTxt:
+                {
+                    // an instance left without answers stays listed with no flags and is skipped
+                    uint8_t flag = static_cast<uint8_t>(1 << (tag & ((1 << kRecordKindBits) - 1)));  // AnswerPtr, AnswerSrv or AnswerTxt
+                    removed = index < link.pendingResponse.flags.size() && (link.pendingResponse.flags[index] & flag) != 0;
+                    if (removed)
+                    {
+                        link.pendingResponse.flags[index] &= ~flag;
+                    }
+                    break;
+                }
+                case RecordAddress:
+                    removed = link.pendingResponse.address;
+                    link.pendingResponse.address = false;
+                    break;
+                case RecordServiceType:
+                {
+                    auto& types = link.pendingResponse.serviceTypes;
+                    auto found = std::find(types.begin(), types.end(), id);
+                    removed = found != types.end();
+                    if (removed)
+                    {
+                        types.erase(found);
+                    }
+                    break;
+                }
+                }
+                mCounters.duplicateAnswersSuppressed += removed ? 1 : 0;
+            });
+        }
+    }
+
+    void MdnsService::OnResponseTimer(Link& link)
+    {
+        sockaddr_in group;
+        memset(&group, 0, sizeof(group));
+        SendResponse(link, link.pendingResponse, nullptr, group);
+    }
+
+    bool MdnsService::IsOtherAddress(const Link& link, MdnsAnswerIndex::RecordId id) const
+    {
+        return (mIndex.GetTag(id) & ((1 << kRecordKindBits) - 1)) == RecordAddress && id != link.addressId;
+    }
+
+    bool MdnsService::MayMulticast(Link& link, MdnsAnswerIndex::RecordId id, MdnsClock::time_point now, MdnsClock::duration interval)
+    {
+        // RFC 6762 section 6.2: a record is multicast at most once a second on each interface,
+        // the querier that missed it asks again
+        if (id >= link.lastMulticast.size())
+        {
+            link.lastMulticast.resize(id + 1);
+        }
+        if (now - link.lastMulticast[id] < interval)
+        {
+            mCounters.answersRateLimited++;
+            return false;
+        }
+        link.lastMulticast[id] = now;
+        return true;
+    }
+
+    void MdnsService::Stamp(Link& link, MdnsAnswerIndex::RecordId id, MdnsClock::time_point now)
+    {
+        if (id >= link.lastMulticast.size())
+        {
+            link.lastMulticast.resize(id + 1);
+        }
+        link.lastMulticast[id] = now;
+    }
+
+    void MdnsService::SendResponse(Link& link, Response& pending, MdnsMessageReader* legacyQuery, const sockaddr_in& from)
+    {
+        MDNS_TRACE_SCOPE("responder", "send response");
+        bool legacy = legacyQuery != nullptr;
+        auto now = MdnsClock::now();
+        auto interval = pending.probeDefense ? kProbeDefenseInterval : kMulticastInterval;
+
+        const uint16_t flags = MDNS_FLAG_RESPONSE | MDNS_FLAG_AUTHORITATIVE;
+        MdnsResponseWriter& response = mResponse;
+
+        size_t packetAnswers = 0;
+        auto add = [&](MdnsSection section, MdnsAnswerIndex::RecordId id)
+        {
+            if (!legacy && !MayMulticast(link, id, now, interval))
+            {
+                return;
+            }
+
+            bool added = legacy ? response.AddRecord(section, id, kLegacyUnicastTtl) : response.AddRecord(section, id);
+            packetAnswers += added && section == MdnsAnswerSection ? 1 : 0;
+        };
+
+        // the answers of many instances may need several packets. Each packet carries whole instances:
+        // their answers and, RFC 6763 section 12, the records the querier will need next. They are queued and
+        // sent together
+        size_t packets = 0;
+        size_t answers = 0;
+        size_t bytes = 0;
+        size_t next = 0;
+        for (bool first = true; first || next < pending.instances.size(); first = false)
+        {
+            response.Reset(legacy ? legacyQuery->Id() : 0, flags);
+            if (legacy)
+            {
+                // echo the id and questions, short TTLs, no cache flush bit
+                MdnsQuestionView question;
+                legacyQuery->Rewind();
+                while (legacyQuery->NextQuestion(question))
+                {
+                    response.AddQuestion(question);
+                }
+            }
+
+            size_t size = response.Size() + RecordSize(link.addressRecord);
+            if (first)
+            {
+                for (MdnsAnswerIndex::RecordId id : pending.serviceTypes)
+                {
+                    size += RecordSize(mIndex.GetRecord(id));
+                }
+            }
+
+            size_t last = next;
+            while (last < pending.instances.size())
+            {
+                const Instance& instance = mInstances[pending.instances[last]];
+                uint8_t answered = pending.flags[pending.instances[last]];
+                size_t needed = (answered & AnswerPtr) ? RecordSize(instance.ptrRecord) + RecordSize(instance.srvRecord) + RecordSize(instance.txtRecord)
+                    : ((answered & AnswerSrv) ? RecordSize(instance.srvRecord) : 0) + ((answered & AnswerTxt) ? RecordSize(instance.txtRecord) : 0);
+                if (last > next && size + needed > MDNS_ETHERNET_PAYLOAD_SIZE)
+                {
+                    break;
+                }
+                size += needed;
+                last++;
+            }
+
+            packetAnswers = 0;
+            if (first)
+            {
+                for (MdnsAnswerIndex::RecordId id : pending.serviceTypes)
+                {
+                    add(MdnsAnswerSection, id);
+                }
+                if (pending.address)
+                {
+                    add(MdnsAnswerSection, link.addressId);
+                }
+            }
+
+            bool needAddress = false;
+            for (size_t i = next; i < last; ++i)
+            {
+                const Instance& instance = mInstances[pending.instances[i]];
+                uint8_t answered = pending.flags[pending.instances[i]];
+                if (answered & AnswerPtr)
+                {
+                    add(MdnsAnswerSection, instance.ptrId);
+                }
+                if (answered & AnswerSrv)
+                {
+                    add(MdnsAnswerSection, instance.srvId);
+                }
+                if (answered & AnswerTxt)
+                {
+                    add(MdnsAnswerSection, instance.txtId);
+                }
+                needAddress |= (answered & (AnswerPtr | AnswerSrv)) != 0;
+            }
+
+            for (size_t i = next; i < last; ++i)
+            {
+                const Instance& instance = mInstances[pending.instances[i]];
+                uint8_t answered = pending.flags[pending.instances[i]];
+                if ((answered & AnswerPtr) && !(answered & AnswerSrv))
+                {
+                    add(MdnsAdditionalSection, instance.srvId);
+                }
+                if ((answered & AnswerPtr) && !(answered & AnswerTxt))
+                {
+                    add(MdnsAdditionalSection, instance.txtId);
+                }
+            }
+            if (needAddress && !(first && pending.address))
+            {
+                add(MdnsAdditionalSection, link.addressId);
+            }
+            next = last;
+
+            if (packetAnswers == 0)
+            {
+                continue;
+            }
+
+            if (legacy)
+            {
+                link.socket.QueueTo(response.Data(), response.Size(), from);
+            }
+            else
+            {
+                link.socket.Queue(response.Data(), response.Size());
+            }
+            packets++;
+            answers += packetAnswers;
+            bytes += response.Size();
+        }
+
+        // answers and bytes only count when the whole response went out
+        size_t sent = link.socket.Flush();
+        mCounters.responsesSent += sent;
+        if (sent == packets)
+        {
+            mCounters.answersSent += answers;
+            mCounters.bytesSent += bytes;
+        }
+
+        for (size_t index : pending.instances)
+        {
+            pending.flags[index] = 0;
+        }
+        pending.instances.clear();
+        pending.serviceTypes.clear();
+        pending.address = false;
+        pending.shared = false;
+        pending.probeDefense = false;
+    }
+}
@@ -0,0 +1,237 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dnssd.h"
+#include "MdnsAnswerIndex.h"
+#include "MdnsMessage.h"
+#include "MdnsQuery.h"
+#include "MdnsReactor.h"
+#include "MdnsSocket.h"
+#include "MdnsTimerWheel.h"
+
+namespace dnssd_uwp
+{
+    // one instance to register: "Living Room" of "_daap._tcp" on port "3689"
+    struct MdnsServiceRegistration
+    {
+        std::string serviceName;
+        std::string instanceName;
+        std::string port;
+    };
+
+    // Registers DNS-SD service instances and answers mDNS queries for them.
+    // Start() probes for unique instance names (RFC 6762 section 8), renaming on conflict,
+    // and blocks until every instance has been announced, like the WinRT DnssdService.
+    // StartAsync() returns once the responder is running and reports the outcome to its callback instead.
+    // The responder has no thread of its own: its sockets and timers are served by the process MdnsReactor, and
+    // "the responder thread" is the thread running the reactor.
+    // All instances are probed together: the probes and announcements of many instances share packets
+    // of up to MDNS_ETHERNET_PAYLOAD_SIZE bytes, and a conflict only renames and re-probes the instance it hit.
+    // The instances are registered on a set of interfaces, one socket each: every interface is probed and announced
+    // on, and a query is answered on the interface it arrived on, with that interface's address only.
+    class MdnsService : private MdnsReactorClient
+    {
+    public:
+        // one instance named "dnssd"
+        MdnsService(const std::string& name, const std::string& port);
+        explicit MdnsService(const std::vector<MdnsServiceRegistration>& registrations);
+        ~MdnsService();
+
+        DnssdErrorType Start();
+        DnssdErrorType StartAsync(DnssdServiceStartedCallback callback);
+        void Stop();
+
+        // register on these interfaces, by index, instead of the default one. Call before Start()
+        void SetInterfaces(const std::vector<uint32_t>& interfaces) {
+            mInterfaces = interfaces;
+        }
+
+        size_t GetInstanceCount() const {
+            return mInstances.size();
+        }
+
+        // the name an instance was registered under, valid once started
+        const std::string& GetInstanceName(size_t index) const {
+            return mInstances[index].instanceName;
+        }
+
+        // a new port or TXT rdata for an instance, nullptr to keep it, from any thread. Before Start() it is what the
+        // instance registers with. Once running the responder thread swaps the records in the index and announces
+        // the changed ones once (RFC 6762 section 8.4); an instance still probing changes when its name is ours
+        DnssdErrorType Update(size_t index, const char* port, const std::string* txt);
+
+        const MdnsResponderCounters& GetCounters() const {
+            return mCounters;
+        }
+
+    private:
+        enum State { Probing, Announcing, Running };
+
+        struct Instance
+        {
+            std::string serviceName;        // e.g. "_daap._tcp"
+            std::string port;
+            uint16_t portNumber;
+            std::string txt;                // TXT rdata, empty for none
+            std::string baseInstanceName;   // instance name before any conflict renaming
+            std::string instanceName;       // e.g. "dnssd"
+            std::string serviceType;        // "_daap._tcp.local" in wire format
+            std::string fullName;           // "dnssd._daap._tcp.local" in wire format
+            int renameCount;
+            State state;
+            int probesSent;
+            int announcementsSent;
+            MdnsClock::time_point nextAnnouncement;
+
+            MdnsRecord ptrRecord;
+            MdnsRecord srvRecord;
+            MdnsRecord txtRecord;
+            MdnsAnswerIndex::RecordId ptrId;    // the records in mIndex once probed, kNoRecord before
+            MdnsAnswerIndex::RecordId srvId;
+            MdnsAnswerIndex::RecordId txtId;
+        };
+
+        // the answers to one or more queries, sent together
+        struct Response
+        {
+            Response()
+                : address(false)
+                , shared(false)
+                , probeDefense(false)
+            {
+            }
+
+            std::vector<uint8_t> flags;     // per instance, AnswerPtr, AnswerSrv and AnswerTxt. All zero between responses
+            std::vector<size_t> instances;  // instances with flags set
+            std::vector<MdnsAnswerIndex::RecordId> serviceTypes;
+            bool address;
+            bool shared;                    // holds shared records, which wait 20-120 ms before they are sent
+            bool probeDefense;              // answers another host's probe for one of our names
+
+            bool IsEmpty() const {
+                return instances.empty() && serviceTypes.empty() && !address;
+            }
+        };
+
+        // what a query added to a response
+        struct AnswerCount
+        {
+            size_t added;       // new answers
+            size_t known;       // left out, the querier listed them as known answers
+            size_t duplicate;   // already in the response for an earlier query
+        };
+
+        // a change asked for by Update(), applied on the responder thread
+        struct RecordUpdate
+        {
+            size_t instance;
+            bool setPort;
+            std::string port;
+            uint16_t portNumber;
+            bool setTxt;
+            std::string txt;
+        };
+
+        // one interface the instances are registered on: its socket, the host's address record there, and the
+        // multicast answers waiting to go out on it
+        struct Link
+        {
+            MdnsSocket socket;
+            MdnsRecord addressRecord;
+            MdnsAnswerIndex::RecordId addressId;
+            Response pendingResponse;   // multicast answers waiting for responseTimer, shared by the queries meanwhile
+            MdnsTimer responseTimer;
+            std::vector<MdnsClock::time_point> lastMulticast;  // per MdnsAnswerIndex record, for the one second limit
+        };
+
+        // a query with the TC bit set, waiting for the rest of its known answers (RFC 6762 section 7.2)
+        struct PendingQuery
+        {
+            Link* link;
+            std::vector<uint8_t> packet;
+            sockaddr_in from;
+            MdnsKnownAnswerList knownAnswers;
+            MdnsTimer timer;
+        };
+
+        DnssdErrorType StartResponder();
+        void OnReadable(int fd) override;
+        void OnWritable(int fd) override;
+        MdnsClock::time_point OnDue(MdnsClock::time_point now) override;
+        void WatchBlockedSockets();
+        void OnStateTimer();
+        void OnStarted(DnssdErrorType result);
+        bool BuildRecords(Instance& instance);
+        Instance* FindInstance(const MdnsNameView& name);
+        void SendProbes(const std::vector<Instance*>& instances);
+        void SendAnnouncements(const std::vector<Instance*>& instances, bool goodbye);
+        void OnPacketReceived(Link& link, const uint8_t* data, size_t size, const sockaddr_in& from);
+        void CheckConflicts(MdnsMessageReader& message);
+        void Rename(Instance& instance);
+        void ApplyUpdates();
+        void ChangeRecords(Instance& instance, const RecordUpdate& update, std::vector<MdnsAnswerIndex::RecordId>* changed);
+        void AnnounceRecords(const std::vector<MdnsAnswerIndex::RecordId>& ids);
+        void IndexRecords(Instance& instance);
+        void OnQueryReceived(Link& link, MdnsMessageReader& query, const uint8_t* data, size_t size, const sockaddr_in& from);
+        void OnPendingQueryTimer(uint64_t source);
+        void AnswerQuery(Link& link, MdnsMessageReader& query, const sockaddr_in& from, const MdnsKnownAnswerList& knownAnswers);
+        bool AsksForOurs(MdnsMessageReader& query) const;
+        AnswerCount CollectAnswers(Link& link, MdnsMessageReader& query, const MdnsKnownAnswerList& knownAnswers, Response& response);
+        void SuppressDuplicateAnswers(Link& link, MdnsMessageReader& message);
+        void OnResponseTimer(Link& link);
+        bool IsOtherAddress(const Link& link, MdnsAnswerIndex::RecordId id) const;   // the address record of another interface
+        void SendResponse(Link& link, Response& response, MdnsMessageReader* legacyQuery, const sockaddr_in& from);
+        bool MayMulticast(Link& link, MdnsAnswerIndex::RecordId id, MdnsClock::time_point now, MdnsClock::duration interval);
+        void Stamp(Link& link, MdnsAnswerIndex::RecordId id, MdnsClock::time_point now);
+
+        std::vector<Instance> mInstances;
+        std::unordered_map<std::string, size_t> mInstancesByName;  // lower case wire-format full name to index
+        Response mLegacyResponse;       // answers to a legacy unicast query, sent at once
+        std::string mHostName;          // "myhost.local" in wire format
+
+        // what queries are answered from: the records of every probed instance, the address record of every
+        // interface and one _services._dns-sd._udp.local PTR per service type, each indexed by name, type and class
+        MdnsAnswerIndex mIndex;
+        std::unordered_map<std::string, MdnsAnswerIndex::RecordId> mServiceTypes;  // lower case wire-format type to its PTR
+        std::vector<uint8_t> mResponseBuffer;
+        MdnsResponseWriter mResponse;
+
+        std::vector<uint32_t> mInterfaces;                  // as asked for, empty for the default
+        std::vector<std::unique_ptr<Link>> mLinks;          // one per interface, while started
+        std::shared_ptr<MdnsReactor> mReactor;
+        std::atomic<bool> mRunning;     // the reactor serves the responder
+        bool mProbing;          // some instance has not finished probing yet
+        bool mWatchingWritable; // some link's socket is watched for a full send buffer draining
+        MdnsTimerWheel mTimers;
+        MdnsTimer mStateTimer;  // next probes or announcements, for every instance
+        std::unordered_map<uint64_t, std::unique_ptr<PendingQuery>> mPendingQueries;  // keyed by source address and port
+        std::vector<std::unique_ptr<PendingQuery>> mRetiredQueries;                     // answered from inside their own timer callback
+        std::minstd_rand mRandom;
+        MdnsResponderCounters mCounters;
+        std::mutex mUpdateLock;
+        std::vector<RecordUpdate> mUpdates;             // from Update(), waiting for the responder thread
+        std::promise<DnssdErrorType> mStarted;
+        DnssdServiceStartedCallback mStartedCallback;   // StartAsync() only
+    };
+};
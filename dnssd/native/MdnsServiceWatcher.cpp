@@ -0,0 +1,139 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsServiceWatcher.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <new>
+
+namespace dnssd_uwp
+{
+    MdnsServiceWatcher::MdnsServiceWatcher(const char* serviceName, DnssdServiceChangedCallback callback)
+        : mDnssdServiceChangedCallback(callback)
+        , mDnssdServiceChangesCallback(nullptr)
+        , mStartedCallback(nullptr)
+        , mSnapshotChanged(false)
+    {
+        mServiceName = serviceName ? serviceName : "";
+        PublishSnapshot(nullptr);
+    }
+
+    MdnsServiceWatcher::~MdnsServiceWatcher()
+    {
+        if (mEngine)
+        {
+            mEngine->Unsubscribe(this);
+        }
+    }
+
+    DnssdErrorType MdnsServiceWatcher::Initialize(std::shared_ptr<MdnsQueryEngine> engine)
+    {
+        if (mServiceName.empty())
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        mEngine = engine ? engine : MdnsQueryEngine::GetShared(mInterfaces);
+        if (!mEngine)
+        {
+            return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+        }
+
+        // start watching for dnssd services
+        DnssdErrorType result = mEngine->Subscribe(this, mServiceName);
+        if (result != DNSSD_NO_ERROR)
+        {
+            mEngine.reset();
+        }
+        return result;
+    }
+
+    DnssdErrorType MdnsServiceWatcher::EnableEventQueue(size_t capacity)
+    {
+        mEventQueue.reset(new (std::nothrow) DnssdEventQueue(capacity));
+        if (!mEventQueue || !mEventQueue->IsValid())
+        {
+            mEventQueue.reset();
+            return DNSSD_SERVICEWATCHER_INITIALIZATION_ERROR;
+        }
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsServiceWatcher::OnSubscribed()
+    {
+        DnssdServiceWatcherStartedCallback callback = mStartedCallback;
+        mStartedCallback = nullptr;
+        if (callback != nullptr)
+        {
+            callback((DnssdServiceWatcherPtr)this, DNSSD_NO_ERROR);
+        }
+    }
+
+    void MdnsServiceWatcher::OnDnssdServiceUpdated(const MdnsServiceInstance& info, uint64_t receivedNs)
+    {
+        MDNS_TRACE_SCOPE("watcher", "report change");
+        mSnapshotChanged = true;
+        MdnsCountCallback(receivedNs);
+
+        if (mEventQueue)
+        {
+            mEventQueue->Push(info.mType, info.mFields);
+            return;
+        }
+
+        if (mDnssdServiceChangesCallback != nullptr)
+        {
+            mChanges.Add(info.mType, info.mFields);
+            return;
+        }
+
+        DnssdServiceInfo serviceInfo;
+        info.mFields.Fill(serviceInfo);
+
+        DnssdServiceChangedCallback callback = mDnssdServiceChangedCallback;
+        if (callback != nullptr)
+        {
+            callback(this, info.mType, &serviceInfo);
+        }
+    }
+
+    void MdnsServiceWatcher::OnUpdatePassEnd(const MdnsBrowse& browse)
+    {
+        // at most one new snapshot and one batched callback per pass. The callback comes last:
+        // it may free the watcher
+        MDNS_TRACE_SCOPE("watcher", "pass end");
+        if (mSnapshotChanged)
+        {
+            PublishSnapshot(&browse);
+        }
+        mChanges.Deliver(this, mDnssdServiceChangesCallback);
+    }
+
+    void MdnsServiceWatcher::PublishSnapshot(const MdnsBrowse* browse)
+    {
+        mSnapshotChanged = false;
+
+        DnssdSnapshot* snapshot = new DnssdSnapshot();
+        if (browse != nullptr)
+        {
+            for (const auto& it : browse->mServices)
+            {
+                if (it.second.mReported)
+                {
+                    snapshot->Add(it.second.mFields);
+                }
+            }
+        }
+        snapshot->Seal();
+        mSnapshots.Publish(snapshot);
+    }
+}
@@ -0,0 +1,102 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dnssd.h"
+#include "DnssdEventQueue.h"
+#include "DnssdServiceChanges.h"
+#include "DnssdServiceFields.h"
+#include "DnssdServiceSnapshot.h"
+#include "MdnsQueryEngine.h"
+
+namespace dnssd_uwp
+{
+    // Watches one DNS-SD service type. The browsing itself (continuous querying, the record cache,
+    // working out which services were Added, Updated or Removed) is done by an MdnsQueryEngine shared with
+    // every other watcher in the process; the watcher subscribes to its type and reports what the engine finds
+    // through its callback, batched callback or event queue, and keeps the snapshot of the services it reported.
+    class MdnsServiceWatcher
+    {
+    public:
+        MdnsServiceWatcher(const char* serviceType, DnssdServiceChangedCallback callback = nullptr);
+        ~MdnsServiceWatcher();
+
+        // subscribes to engine, or to the process-wide engine when engine is nullptr
+        DnssdErrorType Initialize(std::shared_ptr<MdnsQueryEngine> engine = nullptr);
+
+        void RemoveDnssdServiceChangedCallback() {
+            mDnssdServiceChangedCallback = nullptr;
+        };
+
+        void SetDnssdServiceChangedCallback(const DnssdServiceChangedCallback callback) {
+            mDnssdServiceChangedCallback = callback;
+        };
+
+        // report the changes of each update pass in one call instead of one call per service
+        void SetDnssdServiceChangesCallback(const DnssdServiceChangesCallback callback) {
+            mDnssdServiceChangesCallback = callback;
+        };
+
+        // report when the engine starts browsing for the watcher, so Initialize() need not be waited for.
+        // Call before Initialize()
+        void SetStartedCallback(const DnssdServiceWatcherStartedCallback callback) {
+            mStartedCallback = callback;
+        }
+
+        // browse on these interfaces, by index, instead of the default one. Call before Initialize()
+        void SetInterfaces(const std::vector<uint32_t>& interfaces) {
+            mInterfaces = interfaces;
+        }
+
+        // queue changes for dnssd_watcher_drain instead of calling back. Call before Initialize()
+        DnssdErrorType EnableEventQueue(size_t capacity);
+
+        DnssdEventQueue* GetEventQueue() {
+            return mEventQueue.get();
+        }
+
+        // the services reported so far, from any thread
+        const DnssdServiceSnapshot* AcquireSnapshot() {
+            return mSnapshots.Acquire();
+        }
+
+    private:
+        friend class MdnsQueryEngine;
+
+        // called by the engine, on its thread
+        void OnSubscribed();
+        // receivedNs: CLOCK_REALTIME receive time of the packet that brought the change, 0 for none
+        void OnDnssdServiceUpdated(const MdnsServiceInstance& info, uint64_t receivedNs = 0);
+        void OnUpdatePassEnd(const MdnsBrowse& browse);
+
+        void PublishSnapshot(const MdnsBrowse* browse);
+
+        std::shared_ptr<MdnsQueryEngine> mEngine;
+
+        std::atomic<DnssdServiceChangedCallback> mDnssdServiceChangedCallback;
+        std::atomic<DnssdServiceChangesCallback> mDnssdServiceChangesCallback;
+        DnssdServiceWatcherStartedCallback mStartedCallback;    // called once, from the first OnSubscribed()
+        DnssdServiceChanges mChanges;                           // changes of the current update pass for the batched callback
+        std::unique_ptr<DnssdEventQueue> mEventQueue;           // changes for dnssd_watcher_drain, nullptr when calling back
+        DnssdSnapshotPublisher mSnapshots;                      // reported services for dnssd_watcher_acquire_snapshot
+        bool mSnapshotChanged;
+
+        std::string mServiceName;                               // e.g. "_daap._tcp"
+        std::vector<uint32_t> mInterfaces;                      // empty for the default interface
+    };
+};
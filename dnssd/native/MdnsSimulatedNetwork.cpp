@@ -0,0 +1,270 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsSimulatedNetwork.h"
+#include "MdnsReactor.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+
+namespace dnssd_uwp
+{
+    // where virtual time starts: far enough from the epoch that "long ago" stays representable
+    static const MdnsClock::time_point kVirtualStart = MdnsClock::time_point(std::chrono::hours(24));
+
+    static std::mutex sInstalledLock;
+    static std::unique_ptr<MdnsSimulatedNetwork> sInstalled;
+    static std::atomic<MdnsSimulatedNetwork*> sNetwork(nullptr);
+
+    DnssdErrorType MdnsSimulatedNetwork::Install(const MdnsSimulationConfig& config)
+    {
+        std::lock_guard<std::mutex> guard(sInstalledLock);
+        if (sInstalled || config.interfaces == 0)
+        {
+            return sInstalled ? DNSSD_SERVICE_ALREADY_EXISTS_ERROR : DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        // the loop must not run on a thread of its own, in real time
+        DnssdErrorType result = MdnsReactor::SetCallerThreadMode();
+        if (result != DNSSD_NO_ERROR)
+        {
+            return result;
+        }
+
+        MdnsClock::SetVirtual(kVirtualStart);
+        MdnsSetRandomSeed(config.seed);
+        sInstalled.reset(new MdnsSimulatedNetwork(config));
+        sNetwork = sInstalled.get();
+        return DNSSD_NO_ERROR;
+    }
+
+    MdnsSimulatedNetwork* MdnsSimulatedNetwork::GetInstalled()
+    {
+        return sNetwork.load(std::memory_order_acquire);
+    }
+
+    MdnsSimulatedNetwork::MdnsSimulatedNetwork(const MdnsSimulationConfig& config)
+        : mConfig(config)
+        , mRandom(config.seed)
+        , mMembers(config.interfaces + 1)
+        , mSequence(0)
+        , mCounters()
+    {
+        // the first interface stands in for loopback, the default of every watcher and service
+        for (size_t i = 0; i < config.interfaces; ++i)
+        {
+            in_addr_t address = i == 0 ? htonl(INADDR_LOOPBACK) : htonl(0x0a000001 | static_cast<in_addr_t>(i << 16));
+            mInterfaces.push_back(MdnsInterface{ static_cast<uint32_t>(i + 1), "sim" + std::to_string(i), address });
+        }
+    }
+
+    std::vector<MdnsInterface> MdnsSimulatedNetwork::GetInterfaces() const
+    {
+        return mInterfaces;
+    }
+
+    int MdnsSimulatedNetwork::Open(uint32_t interfaceIndex)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        if (interfaceIndex == 0 || interfaceIndex > mInterfaces.size())
+        {
+            return 0;
+        }
+
+        // every endpoint is a host of its own, 10.255.0.0/16 and up, so that its packets can be told apart
+        size_t index = mEndpoints.size();
+        Endpoint endpoint;
+        endpoint.interfaceIndex = interfaceIndex;
+        memset(&endpoint.address, 0, sizeof(endpoint.address));
+        endpoint.address.sin_family = AF_INET;
+        endpoint.address.sin_port = htons(MDNS_PORT);
+        endpoint.address.sin_addr.s_addr = htonl(0x0aff0000 + static_cast<in_addr_t>(index) + 1);
+        endpoint.open = true;
+        endpoint.ready = false;
+        mEndpoints.push_back(endpoint);
+        mMembers[interfaceIndex].push_back(index);
+        mByAddress[endpoint.address.sin_addr.s_addr] = index;
+        return ToFd(index);
+    }
+
+    void MdnsSimulatedNetwork::Close(int fd)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        Endpoint* endpoint = Find(fd);
+        if (endpoint == nullptr || !endpoint->open)
+        {
+            return;
+        }
+
+        size_t index = static_cast<size_t>(-2 - fd);
+        std::vector<size_t>& members = mMembers[endpoint->interfaceIndex];
+        members.erase(std::remove(members.begin(), members.end(), index), members.end());
+        mByAddress.erase(endpoint->address.sin_addr.s_addr);
+        endpoint->inbox.clear();
+        endpoint->open = false;
+    }
+
+    int MdnsSimulatedNetwork::Receive(int fd, uint8_t* buffer, size_t size, sockaddr_in* from)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        Endpoint* endpoint = Find(fd);
+        if (endpoint == nullptr || !endpoint->open)
+        {
+            return -1;
+        }
+        if (endpoint->inbox.empty())
+        {
+            return 0;
+        }
+
+        // a datagram too big for the buffer is cut, as recvfrom would cut it
+        const Packet& packet = endpoint->inbox.front();
+        size_t n = std::min(size, packet.data->size());
+        memcpy(buffer, packet.data->data(), n);
+        *from = packet.from;
+        endpoint->inbox.pop_front();
+        return static_cast<int>(n);
+    }
+
+    bool MdnsSimulatedNetwork::Send(int fd, const uint8_t* data, size_t size, const sockaddr_in& to)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        Endpoint* endpoint = Find(fd);
+        if (endpoint == nullptr || !endpoint->open)
+        {
+            return false;
+        }
+
+        Delivery delivery;
+        delivery.at = MdnsClock::now() + mConfig.latency;
+        if (mConfig.jitter.count() > 0)
+        {
+            delivery.at += MdnsClock::duration(std::uniform_int_distribution<MdnsClock::rep>(0, mConfig.jitter.count())(mRandom));
+        }
+        if (mConfig.reorder > 0 && std::uniform_real_distribution<double>(0, 1)(mRandom) < mConfig.reorder)
+        {
+            delivery.at += mConfig.reorderDelay;
+            mCounters.packetsReordered++;
+        }
+        delivery.sequence = mSequence++;
+        delivery.packet.data = std::make_shared<const std::vector<uint8_t>>(data, data + size);
+        delivery.packet.from = endpoint->address;
+        delivery.interfaceIndex = endpoint->interfaceIndex;
+        delivery.sender = static_cast<size_t>(-2 - fd);
+        delivery.to = kMulticast;
+        if (!IN_MULTICAST(ntohl(to.sin_addr.s_addr)))
+        {
+            auto it = mByAddress.find(to.sin_addr.s_addr);
+            if (it == mByAddress.end())
+            {
+                mCounters.packetsSent++;
+                mCounters.bytesSent += size;
+                mCounters.packetsLost++;
+                return true;
+            }
+            delivery.to = it->second;
+        }
+
+        mDeliveries.push(delivery);
+        mCounters.packetsSent++;
+        mCounters.bytesSent += size;
+        return true;
+    }
+
+    void MdnsSimulatedNetwork::TakeReady(std::vector<int>& fds)
+    {
+        // level triggered, like epoll: an endpoint stays ready until it has been read empty
+        std::lock_guard<std::mutex> guard(mLock);
+        fds.clear();
+        size_t kept = 0;
+        for (int fd : mReady)
+        {
+            Endpoint& endpoint = mEndpoints[static_cast<size_t>(-2 - fd)];
+            if (endpoint.open && !endpoint.inbox.empty())
+            {
+                fds.push_back(fd);
+                mReady[kept++] = fd;
+            }
+            else
+            {
+                endpoint.ready = false;
+            }
+        }
+        mReady.resize(kept);
+    }
+
+    MdnsClock::time_point MdnsSimulatedNetwork::NextDelivery()
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        return mDeliveries.empty() ? MdnsClock::time_point::max() : mDeliveries.top().at;
+    }
+
+    void MdnsSimulatedNetwork::Deliver(MdnsClock::time_point now)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        std::uniform_real_distribution<double> chance(0, 1);
+        while (!mDeliveries.empty() && mDeliveries.top().at <= now)
+        {
+            Delivery delivery = mDeliveries.top();
+            mDeliveries.pop();
+            if (delivery.to != kMulticast)
+            {
+                Push(delivery.to, delivery.packet);
+                continue;
+            }
+
+            // the sender hears its own packets back, always, as with IP_MULTICAST_LOOP
+            for (size_t member : mMembers[delivery.interfaceIndex])
+            {
+                if (member != delivery.sender && mConfig.loss > 0 && chance(mRandom) < mConfig.loss)
+                {
+                    mCounters.packetsLost++;
+                    continue;
+                }
+                Push(member, delivery.packet);
+            }
+        }
+    }
+
+    MdnsSimulationCounters MdnsSimulatedNetwork::GetCounters()
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        return mCounters;
+    }
+
+    MdnsSimulatedNetwork::Endpoint* MdnsSimulatedNetwork::Find(int fd)
+    {
+        if (fd > -2 || static_cast<size_t>(-2 - fd) >= mEndpoints.size())
+        {
+            return nullptr;
+        }
+        return &mEndpoints[static_cast<size_t>(-2 - fd)];
+    }
+
+    void MdnsSimulatedNetwork::Push(size_t index, const Packet& packet)
+    {
+        Endpoint& endpoint = mEndpoints[index];
+        if (!endpoint.open)
+        {
+            return;
+        }
+
+        endpoint.inbox.push_back(packet);
+        mCounters.packetsDelivered++;
+        if (!endpoint.ready)
+        {
+            endpoint.ready = true;
+            mReady.push_back(ToFd(index));
+        }
+    }
+}
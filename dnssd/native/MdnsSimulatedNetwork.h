@@ -0,0 +1,154 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "dnssd.h"
+#include "MdnsSocket.h"
+#include "MdnsTimerWheel.h"
+
+namespace dnssd_uwp
+{
+    // latency, loss and reordering of an MdnsSimulatedNetwork
+    struct MdnsSimulationConfig
+    {
+        MdnsSimulationConfig()
+            : seed(1)
+            , interfaces(1)
+            , latency(std::chrono::milliseconds(1))
+            , jitter(0)
+            , loss(0)
+            , reorder(0)
+            , reorderDelay(std::chrono::milliseconds(20))
+        {
+        }
+
+        uint64_t seed;                      // of the network's draws and of every random protocol delay
+        size_t interfaces;                  // links, by index from 1. Index 1 is the default one watchers and services use
+        MdnsClock::duration latency;        // of every packet
+        MdnsClock::duration jitter;         // up to this much more, drawn per packet
+        double loss;                        // chance that a receiver misses a packet, drawn per receiver
+        double reorder;                     // chance that a packet is held back by reorderDelay, behind later ones
+        MdnsClock::duration reorderDelay;
+    };
+
+    struct MdnsSimulationCounters
+    {
+        uint64_t packetsSent;
+        uint64_t bytesSent;
+        uint64_t packetsDelivered;          // one per receiver
+        uint64_t packetsLost;               // one per receiver, or per unicast packet nobody has the address of
+        uint64_t packetsReordered;
+    };
+
+    // An in-memory multicast network on virtual time, in place of the sockets of every watcher and service in the
+    // process: thousands of responders and queriers run in one process, and a run with the same seed and the same
+    // calls repeats packet for packet. MdnsSocket opens an endpoint on the network instead of a socket; a packet
+    // multicast on an interface reaches every endpoint on it, the sender's included, after the configured latency.
+    // The event loop runs on the caller's thread (dnssd_run_events) and, when it has nothing left to do at the
+    // current instant, moves MdnsClock straight to its next deadline or the next packet delivery.
+    // Endpoints have negative descriptors below -1, which the MdnsReactor serves from TakeReady() instead of epoll.
+    class MdnsSimulatedNetwork
+    {
+    public:
+        // before the first watcher or service, once per process. Puts the event loop in caller thread mode and
+        // MdnsClock in virtual time
+        static DnssdErrorType Install(const MdnsSimulationConfig& config);
+
+        // nullptr unless installed
+        static MdnsSimulatedNetwork* GetInstalled();
+
+        std::vector<MdnsInterface> GetInterfaces() const;
+
+        // what MdnsSocket does with an endpoint. Open returns its descriptor, 0 if there is no such interface
+        int Open(uint32_t interfaceIndex);
+        void Close(int fd);
+        int Receive(int fd, uint8_t* buffer, size_t size, sockaddr_in* from);
+        bool Send(int fd, const uint8_t* data, size_t size, const sockaddr_in& to);
+
+        // what the reactor does: the endpoints that got packets since the last call, the time of the next delivery
+        // (time_point::max() for none), and the packets due by now into the endpoints
+        void TakeReady(std::vector<int>& fds);
+        MdnsClock::time_point NextDelivery();
+        void Deliver(MdnsClock::time_point now);
+
+        MdnsSimulationCounters GetCounters();
+
+    private:
+        explicit MdnsSimulatedNetwork(const MdnsSimulationConfig& config);
+        MdnsSimulatedNetwork(const MdnsSimulatedNetwork&) = delete;
+        MdnsSimulatedNetwork& operator=(const MdnsSimulatedNetwork&) = delete;
+
+        struct Packet
+        {
+            std::shared_ptr<const std::vector<uint8_t>> data;
+            sockaddr_in from;
+        };
+
+        struct Endpoint
+        {
+            uint32_t interfaceIndex;
+            sockaddr_in address;
+            std::deque<Packet> inbox;
+            bool open;
+            bool ready;                     // in mReady
+        };
+
+        struct Delivery
+        {
+            MdnsClock::time_point at;
+            uint64_t sequence;              // sent order, among packets due at the same time
+            Packet packet;
+            uint32_t interfaceIndex;
+            size_t sender;
+            size_t to;                      // an endpoint, or kMulticast
+        };
+
+        struct Later
+        {
+            bool operator()(const Delivery& a, const Delivery& b) const {
+                return a.at != b.at ? a.at > b.at : a.sequence > b.sequence;
+            }
+        };
+
+        static const size_t kMulticast = SIZE_MAX;
+
+        static int ToFd(size_t endpoint) {
+            return -2 - static_cast<int>(endpoint);
+        }
+
+        Endpoint* Find(int fd);
+        void Push(size_t endpoint, const Packet& packet);
+
+        const MdnsSimulationConfig mConfig;
+        std::mutex mLock;
+        std::mt19937_64 mRandom;
+        std::vector<MdnsInterface> mInterfaces;
+        std::vector<Endpoint> mEndpoints;                       // by descriptor: endpoint i is ToFd(i). Never shrinks
+        std::vector<std::vector<size_t>> mMembers;              // open endpoints of each interface, in opening order
+        std::unordered_map<in_addr_t, size_t> mByAddress;       // for unicast
+        std::priority_queue<Delivery, std::vector<Delivery>, Later> mDeliveries;
+        uint64_t mSequence;
+        std::vector<int> mReady;                                // endpoints that may have packets waiting
+        MdnsSimulationCounters mCounters;
+    };
+};
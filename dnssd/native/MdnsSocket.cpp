@@ -0,0 +1,512 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsSocket.h"
+#include "MdnsMessage.h"
+#include "MdnsSimulatedNetwork.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace dnssd_uwp
+{
+    // packets queued before Queue() flushes by itself
+    static const size_t kMaxQueuedPackets = 64;
+
+    // room for one SCM_TIMESTAMPNS control message
+    static const size_t kControlSize = CMSG_SPACE(sizeof(timespec));
+
+    std::vector<MdnsInterface> MdnsGetInterfaces()
+    {
+        MdnsSimulatedNetwork* network = MdnsSimulatedNetwork::GetInstalled();
+        if (network != nullptr)
+        {
+            return network->GetInterfaces();
+        }
+
+        std::vector<MdnsInterface> interfaces;
+        ifaddrs* list = nullptr;
+        if (getifaddrs(&list) != 0)
+        {
+            return interfaces;
+        }
+
+        for (ifaddrs* entry = list; entry != nullptr; entry = entry->ifa_next)
+        {
+            if (entry->ifa_addr == nullptr || entry->ifa_addr->sa_family != AF_INET || !(entry->ifa_flags & IFF_UP) ||
+                !(entry->ifa_flags & (IFF_MULTICAST | IFF_LOOPBACK)))
+            {
+                continue;
+            }
+
+            uint32_t index = if_nametoindex(entry->ifa_name);
+            bool known = std::any_of(interfaces.begin(), interfaces.end(), [index](const MdnsInterface& i) { return i.index == index; });
+            if (index != 0 && !known)
+            {
+                in_addr_t address = reinterpret_cast<const sockaddr_in*>(entry->ifa_addr)->sin_addr.s_addr;
+                interfaces.push_back(MdnsInterface{ index, entry->ifa_name, address });
+            }
+        }
+        freeifaddrs(list);
+
+        std::sort(interfaces.begin(), interfaces.end(), [](const MdnsInterface& a, const MdnsInterface& b) { return a.index < b.index; });
+        return interfaces;
+    }
+
+    bool MdnsSelectInterfaces(const std::vector<uint32_t>& indexes, std::vector<MdnsInterface>& selected)
+    {
+        selected.clear();
+        std::vector<MdnsInterface> interfaces = MdnsGetInterfaces();
+        if (indexes.empty())
+        {
+            in_addr_t loopback = htonl(INADDR_LOOPBACK);
+            auto found = std::find_if(interfaces.begin(), interfaces.end(), [loopback](const MdnsInterface& i) { return i.address == loopback; });
+            selected.push_back(found != interfaces.end() ? *found : MdnsInterface{ 0, "lo", loopback });
+            return true;
+        }
+
+        for (uint32_t index : indexes)
+        {
+            auto found = std::find_if(interfaces.begin(), interfaces.end(), [index](const MdnsInterface& i) { return i.index == index; });
+            if (found == interfaces.end())
+            {
+                selected.clear();
+                return false;
+            }
+            bool duplicate = std::any_of(selected.begin(), selected.end(), [index](const MdnsInterface& i) { return i.index == index; });
+            if (!duplicate)
+            {
+                selected.push_back(*found);
+            }
+        }
+        return true;
+    }
+
+    MdnsReceiveRing::MdnsReceiveRing(size_t slots, size_t batch, size_t slotSize)
+        : mSlotSize(slotSize)
+        , mBatch(std::max<size_t>(1, std::min(batch, slots)))
+        , mBuffers(slots * slotSize)
+        , mVectors(slots)
+        , mFrom(slots)
+        , mControl(slots * kControlSize)
+        , mReceived(slots)
+        , mHeaders(slots)
+        , mHead(0)
+        , mFirst(0)
+        , mOffered(0)
+        , mCount(0)
+    {
+        for (size_t i = 0; i < slots; ++i)
+        {
+            mVectors[i].iov_base = &mBuffers[i * slotSize];
+            mVectors[i].iov_len = slotSize;
+            memset(&mHeaders[i], 0, sizeof(mmsghdr));
+            mHeaders[i].msg_hdr.msg_name = &mFrom[i];
+            mHeaders[i].msg_hdr.msg_iov = &mVectors[i];
+            mHeaders[i].msg_hdr.msg_iovlen = 1;
+            mHeaders[i].msg_hdr.msg_control = &mControl[i * kControlSize];
+        }
+    }
+
+    MdnsReceivedPacket MdnsReceiveRing::Get(size_t i) const
+    {
+        size_t slot = mFirst + i;
+        return MdnsReceivedPacket{ &mBuffers[slot * mSlotSize], mHeaders[slot].msg_len, &mFrom[slot], mReceived[slot] };
+    }
+
+    MdnsSocket::MdnsSocket()
+        : mFd(-1)
+        , mInterfaceAddress(0)
+        , mInterfaceIndex(0)
+        , mNetwork(nullptr)
+        , mBlocked(false)
+    {
+        memset(&mGroup, 0, sizeof(mGroup));
+    }
+
+    MdnsSocket::~MdnsSocket()
+    {
+        Close();
+    }
+
+    DnssdErrorType MdnsSocket::Open(const MdnsInterface& networkInterface)
+    {
+        return Open(networkInterface.address, networkInterface.index);
+    }
+
+    DnssdErrorType MdnsSocket::Open(in_addr_t interfaceAddress, uint32_t interfaceIndex)
+    {
+        if (mFd != -1)
+        {
+            return DNSSD_NO_ERROR;
+        }
+
+        if (interfaceIndex == 0)
+        {
+            for (const MdnsInterface& networkInterface : MdnsGetInterfaces())
+            {
+                if (networkInterface.address == interfaceAddress)
+                {
+                    interfaceIndex = networkInterface.index;
+                    break;
+                }
+            }
+        }
+
+        mGroup.sin_family = AF_INET;
+        mGroup.sin_port = htons(MDNS_PORT);
+        inet_pton(AF_INET, MDNS_MULTICAST_ADDRESS, &mGroup.sin_addr);
+
+        // an endpoint on the simulated network instead, if there is one
+        MdnsSimulatedNetwork* network = MdnsSimulatedNetwork::GetInstalled();
+        if (network != nullptr)
+        {
+            int fd = network->Open(interfaceIndex);
+            if (fd == 0)
+            {
+                MdnsCount(MdnsStatSocketErrors);
+                return DNSSD_UNSPECIFIED_ERROR;
+            }
+            mFd = fd;
+            mNetwork = network;
+            mInterfaceAddress = interfaceAddress;
+            mInterfaceIndex = interfaceIndex;
+            return DNSSD_NO_ERROR;
+        }
+
+        mFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (mFd < 0)
+        {
+            MdnsCount(MdnsStatSocketErrors);
+            return DNSSD_UNSPECIFIED_ERROR;
+        }
+
+        // every watcher and service in the process shares port 5353
+        int on = 1;
+        setsockopt(mFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(mFd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+        // a group of services probes and announces in bursts of full packets: room for a few hundred of them.
+        // The kernel caps this at net.core.rmem_max
+        int receiveBuffer = 1024 * 1024;
+        setsockopt(mFd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+        // the time each packet arrived, for dnssd_get_stats: what it waited in the socket counts too
+        setsockopt(mFd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+        sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(MDNS_PORT);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(mFd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+        {
+            MdnsCount(MdnsStatSocketErrors);
+            Close();
+            return DNSSD_UNSPECIFIED_ERROR;
+        }
+
+        ip_mreqn mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_multiaddr = mGroup.sin_addr;
+        mreq.imr_address.s_addr = interfaceAddress;
+        mreq.imr_ifindex = static_cast<int>(interfaceIndex);
+        if (setsockopt(mFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+        {
+            MdnsCount(MdnsStatSocketErrors);
+            Close();
+            return DNSSD_UNSPECIFIED_ERROR;
+        }
+
+        // only the group packets arriving on this interface, not those of every group joined by any socket on the host
+        int all = 0;
+        setsockopt(mFd, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+
+        in_addr iface;
+        iface.s_addr = interfaceAddress;
+        setsockopt(mFd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+
+        // RFC 6762 section 11: multicast responses are sent with IP TTL 255
+        unsigned char ttl = 255;
+        setsockopt(mFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+        // other watchers and services on this host must see our packets
+        unsigned char loop = 1;
+        setsockopt(mFd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+        mInterfaceAddress = interfaceAddress;
+        mInterfaceIndex = interfaceIndex;
+        return DNSSD_NO_ERROR;
+    }
+
+    void MdnsSocket::Close()
+    {
+        if (mNetwork != nullptr)
+        {
+            mNetwork->Close(mFd);
+            mNetwork = nullptr;
+            mFd = -1;
+        }
+        else if (mFd >= 0)
+        {
+            close(mFd);
+            mFd = -1;
+        }
+        mQueue.clear();
+        mQueueData.clear();
+    }
+
+    int MdnsSocket::Receive(uint8_t* buffer, size_t size, sockaddr_in* from)
+    {
+        socklen_t fromLength = sizeof(sockaddr_in);
+        ssize_t n = mNetwork != nullptr ? mNetwork->Receive(mFd, buffer, size, from)
+            : recvfrom(mFd, buffer, size, 0, reinterpret_cast<sockaddr*>(from), &fromLength);
+        mCounters.receiveCalls++;
+        if (n == 0 && mNetwork != nullptr)
+        {
+            return 0;
+        }
+        if (n < 0)
+        {
+            if (mNetwork == nullptr && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                return 0;
+            }
+            MdnsCount(MdnsStatSocketErrors);
+            return -1;
+        }
+        mCounters.packetsReceived++;
+        MdnsCount(MdnsStatPacketsReceived);
+        return static_cast<int>(n);
+    }
+
+    int MdnsSocket::ReceiveBatch(MdnsReceiveRing& ring)
+    {
+        MDNS_TRACE_SCOPE("socket", "receive batch");
+        // a run of slots in one piece: the last batch before the ring wraps may be shorter
+        size_t slots = ring.mHeaders.size();
+        size_t offered = std::min(ring.mBatch, slots - ring.mHead);
+        for (size_t i = ring.mHead; i < ring.mHead + offered; ++i)
+        {
+            ring.mHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            ring.mHeaders[i].msg_hdr.msg_controllen = kControlSize;
+        }
+
+        ring.mFirst = ring.mHead;
+        ring.mOffered = offered;
+        ring.mCount = 0;
+        int n;
+        if (mNetwork != nullptr)
+        {
+            // simulated: copied out of the network, slot by slot
+            n = 0;
+            for (size_t i = ring.mHead; i < ring.mHead + offered; ++i)
+            {
+                int size = mNetwork->Receive(mFd, static_cast<uint8_t*>(ring.mVectors[i].iov_base), ring.mSlotSize, &ring.mFrom[i]);
+                if (size <= 0)
+                {
+                    n = n == 0 ? size : n;
+                    break;
+                }
+                ring.mHeaders[i].msg_len = static_cast<unsigned int>(size);
+                n++;
+            }
+        }
+        else
+        {
+            n = recvmmsg(mFd, &ring.mHeaders[ring.mHead], static_cast<unsigned int>(offered), MSG_DONTWAIT, nullptr);
+        }
+        mCounters.receiveCalls++;
+        if (n < 0)
+        {
+            if (mNetwork == nullptr && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                return 0;
+            }
+            MdnsCount(MdnsStatSocketErrors);
+            return -1;
+        }
+
+        // when each packet arrived: the kernel says so if it timestamps packets, otherwise it is about now
+        uint64_t readAt = 0;
+        size_t timestamped = 0;
+        for (size_t i = ring.mHead; i < ring.mHead + static_cast<size_t>(n); ++i)
+        {
+            msghdr& header = ring.mHeaders[i].msg_hdr;
+            uint64_t received = 0;
+            for (cmsghdr* control = mNetwork == nullptr ? CMSG_FIRSTHDR(&header) : nullptr; control != nullptr; control = CMSG_NXTHDR(&header, control))
+            {
+                if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    timespec stamp;
+                    memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+                    received = static_cast<uint64_t>(stamp.tv_sec) * 1000000000 + static_cast<uint64_t>(stamp.tv_nsec);
+                }
+            }
+            if (received != 0)
+            {
+                timestamped++;
+            }
+            else
+            {
+                readAt = readAt != 0 ? readAt : MdnsRealTimeNs();
+                received = readAt;
+            }
+            ring.mReceived[i] = received;
+        }
+
+        ring.mCount = static_cast<size_t>(n);
+        ring.mHead = (ring.mHead + ring.mCount) % slots;
+        mCounters.packetsReceived += ring.mCount;
+        MdnsCount(MdnsStatPacketsReceived, ring.mCount);
+        MdnsCount(MdnsStatPacketsTimestamped, timestamped);
+        return n;
+    }
+
+    bool MdnsSocket::Send(const uint8_t* data, size_t size)
+    {
+        return SendTo(data, size, mGroup);
+    }
+
+    bool MdnsSocket::SendTo(const uint8_t* data, size_t size, const sockaddr_in& to)
+    {
+        MDNS_TRACE_SCOPE("socket", "send");
+        if (!mQueue.empty())
+        {
+            Flush();
+        }
+
+        ssize_t n = mNetwork != nullptr ? (mNetwork->Send(mFd, data, size, to) ? static_cast<ssize_t>(size) : -1)
+            : sendto(mFd, data, size, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+        mCounters.sendCalls++;
+        if (n != static_cast<ssize_t>(size))
+        {
+            MdnsCount(MdnsStatSocketErrors);
+            return false;
+        }
+        mCounters.packetsSent++;
+        MdnsCount(MdnsStatPacketsSent);
+        return true;
+    }
+
+    void MdnsSocket::Queue(const uint8_t* data, size_t size)
+    {
+        QueueTo(data, size, mGroup);
+    }
+
+    void MdnsSocket::QueueTo(const uint8_t* data, size_t size, const sockaddr_in& to)
+    {
+        if (mQueue.size() >= kMaxQueuedPackets)
+        {
+            Flush();
+        }
+        if (mQueue.size() >= kMaxQueuedPackets)
+        {
+            // the send buffer and the queue are both full: this one is dropped, as sendto would drop it
+            MdnsCount(MdnsStatSocketErrors);
+            return;
+        }
+
+        mQueue.push_back(QueuedPacket{ mQueueData.size(), size, to });
+        mQueueData.insert(mQueueData.end(), data, data + size);
+    }
+
+    size_t MdnsSocket::Flush()
+    {
+        MDNS_TRACE_SCOPE("socket", "send batch");
+        if (mNetwork != nullptr)
+        {
+            size_t sent = 0;
+            for (const QueuedPacket& packet : mQueue)
+            {
+                sent += mNetwork->Send(mFd, &mQueueData[packet.offset], packet.size, packet.to) ? 1 : 0;
+            }
+            mCounters.sendCalls += mQueue.empty() ? 0 : 1;
+            mCounters.packetsSent += sent;
+            MdnsCount(MdnsStatPacketsSent, sent);
+            MdnsCount(MdnsStatSocketErrors, mQueue.size() - sent);
+            mQueue.clear();
+            mQueueData.clear();
+            return sent;
+        }
+
+        // the packets are only laid out now that mQueueData has stopped moving
+        mSendVectors.resize(mQueue.size());
+        mSendHeaders.resize(mQueue.size());
+        for (size_t i = 0; i < mQueue.size(); ++i)
+        {
+            mSendVectors[i].iov_base = &mQueueData[mQueue[i].offset];
+            mSendVectors[i].iov_len = mQueue[i].size;
+            memset(&mSendHeaders[i], 0, sizeof(mmsghdr));
+            mSendHeaders[i].msg_hdr.msg_name = &mQueue[i].to;
+            mSendHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            mSendHeaders[i].msg_hdr.msg_iov = &mSendVectors[i];
+            mSendHeaders[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // sendmmsg stops at the first packet it cannot send. A full send buffer stops the flush, any other error
+        // drops that one packet, as sendto would drop it
+        size_t sent = 0;
+        size_t dropped = 0;
+        size_t next = 0;
+        mBlocked = false;
+        while (next < mQueue.size())
+        {
+            int n = sendmmsg(mFd, &mSendHeaders[next], static_cast<unsigned int>(mQueue.size() - next), 0);
+            mCounters.sendCalls++;
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                mBlocked = true;
+                break;
+            }
+            if (n <= 0)
+            {
+                next++;
+                dropped++;
+                continue;
+            }
+            sent += static_cast<size_t>(n);
+            next += static_cast<size_t>(n);
+        }
+
+        mCounters.packetsSent += sent;
+        MdnsCount(MdnsStatPacketsSent, sent);
+        MdnsCount(MdnsStatSocketErrors, dropped);
+        if (next < mQueue.size())
+        {
+            // what is left moves to the front of the queue
+            size_t start = mQueue[next].offset;
+            mQueueData.erase(mQueueData.begin(), mQueueData.begin() + start);
+            mQueue.erase(mQueue.begin(), mQueue.begin() + next);
+            for (QueuedPacket& packet : mQueue)
+            {
+                packet.offset -= start;
+            }
+            return sent;
+        }
+        mQueue.clear();
+        mQueueData.clear();
+        return sent;
+    }
+}
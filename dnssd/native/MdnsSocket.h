@@ -0,0 +1,198 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+#include "dnssd.h"
+#include "MdnsMessage.h"
+
+namespace dnssd_uwp
+{
+    // an IPv4 network interface mDNS can run on
+    struct MdnsInterface
+    {
+        uint32_t index;         // as if_nametoindex() gives it
+        std::string name;       // e.g. "eth0"
+        in_addr_t address;      // its first IPv4 address
+    };
+
+    // the interfaces that are up and can multicast, loopback included, by index
+    std::vector<MdnsInterface> MdnsGetInterfaces();
+
+    // the interfaces with these indexes. No indexes selects the loopback interface, the default of every watcher
+    // and service. Returns false if an index is not an interface mDNS can run on
+    bool MdnsSelectInterfaces(const std::vector<uint32_t>& indexes, std::vector<MdnsInterface>& selected);
+
+    class MdnsSimulatedNetwork;
+
+    // system calls made and packets moved by an MdnsSocket
+    struct MdnsSocketCounters
+    {
+        MdnsSocketCounters()
+            : receiveCalls(0)
+            , packetsReceived(0)
+            , sendCalls(0)
+            , packetsSent(0)
+        {
+        }
+
+        std::atomic<uint64_t> receiveCalls;     // recvfrom and recvmmsg, those that found nothing included
+        std::atomic<uint64_t> packetsReceived;
+        std::atomic<uint64_t> sendCalls;        // sendto and sendmmsg
+        std::atomic<uint64_t> packetsSent;
+    };
+
+    // a packet received by MdnsSocket::ReceiveBatch, in place in its MdnsReceiveRing slot
+    struct MdnsReceivedPacket
+    {
+        const uint8_t* data;
+        size_t size;
+        const sockaddr_in* from;
+        uint64_t received;          // CLOCK_REALTIME nanoseconds: the kernel's receive timestamp, or when it was read
+    };
+
+    // Preallocated receive buffers for recvmmsg: slots of slotSize bytes, each with its iovec, sender address,
+    // room for the kernel's receive timestamp and message header set up once. Every MdnsSocket::ReceiveBatch fills the next run of up to batch slots, going round,
+    // so a packet stays in place, untouched, for at least the following slots / batch - 1 batches.
+    // Not thread-safe: one ring per thread reading sockets
+    class MdnsReceiveRing
+    {
+    public:
+        static const size_t kDefaultSlots = 64;
+        static const size_t kDefaultBatch = 16;
+
+        explicit MdnsReceiveRing(size_t slots = kDefaultSlots, size_t batch = kDefaultBatch, size_t slotSize = MDNS_MAX_PACKET_SIZE);
+
+        // the packets of the last batch
+        size_t GetCount() const {
+            return mCount;
+        }
+
+        MdnsReceivedPacket Get(size_t i) const;
+
+        // the last batch took every slot offered: more packets may be waiting
+        bool IsFull() const {
+            return mCount != 0 && mCount == mOffered;
+        }
+
+    private:
+        MdnsReceiveRing(const MdnsReceiveRing&) = delete;
+        MdnsReceiveRing& operator=(const MdnsReceiveRing&) = delete;
+
+        friend class MdnsSocket;
+
+        const size_t mSlotSize;
+        const size_t mBatch;
+        std::vector<uint8_t> mBuffers;
+        std::vector<iovec> mVectors;
+        std::vector<sockaddr_in> mFrom;
+        std::vector<uint8_t> mControl;          // SCM_TIMESTAMPNS control messages
+        std::vector<uint64_t> mReceived;
+        std::vector<mmsghdr> mHeaders;
+        size_t mHead;               // slot the next batch starts at
+        size_t mFirst;              // slot of the last batch's first packet
+        size_t mOffered;            // slots offered to the last recvmmsg
+        size_t mCount;              // packets it returned
+    };
+
+    // UDP socket bound to port 5353 and joined to the mDNS multicast group on a single interface.
+    // By default the loopback interface is used so watchers and services in the same process
+    // (or on the same machine) can discover each other without a real network.
+    // A socket only receives the multicast packets that arrive on its own interface: a host on several
+    // networks opens one socket per interface and knows where each packet came from.
+    // Once an MdnsSimulatedNetwork is installed, Open() makes an endpoint on it instead of a socket.
+    class MdnsSocket
+    {
+    public:
+        MdnsSocket();
+        ~MdnsSocket();
+
+        // interfaceIndex 0 looks the interface up by its address
+        DnssdErrorType Open(in_addr_t interfaceAddress = htonl(INADDR_LOOPBACK), uint32_t interfaceIndex = 0);
+        DnssdErrorType Open(const MdnsInterface& networkInterface);
+        void Close();
+
+        // a simulated endpoint's is below -1: only the reactor knows what to do with it
+        int GetFd() const {
+            return mFd;
+        }
+
+        in_addr_t GetInterfaceAddress() const {
+            return mInterfaceAddress;
+        }
+
+        uint32_t GetInterfaceIndex() const {
+            return mInterfaceIndex;
+        }
+
+        // returns the number of bytes received, 0 if no packet is pending or -1 on error
+        int Receive(uint8_t* buffer, size_t size, sockaddr_in* from);
+
+        // receives up to a batch of pending packets into the next slots of ring with one recvmmsg call.
+        // Returns how many (see ring.GetCount() and ring.Get()), 0 if none is pending or -1 on error
+        int ReceiveBatch(MdnsReceiveRing& ring);
+
+        // multicast a packet to 224.0.0.251:5353, after the queued packets
+        bool Send(const uint8_t* data, size_t size);
+        bool SendTo(const uint8_t* data, size_t size, const sockaddr_in& to);
+
+        // queue a copy of a packet, for the multicast group or for to. Flush() sends the queued packets together,
+        // in one sendmmsg call; a full queue is flushed first
+        void Queue(const uint8_t* data, size_t size);
+        void QueueTo(const uint8_t* data, size_t size, const sockaddr_in& to);
+
+        // returns the number of queued packets sent. A packet the socket refuses is dropped; once the send buffer
+        // is full the rest stay queued, in order, for the next Flush()
+        size_t Flush();
+
+        // the last Flush() stopped at a full send buffer: flush again once the socket is writable
+        bool IsBlocked() const {
+            return !mQueue.empty() && mBlocked;
+        }
+
+        const MdnsSocketCounters& GetCounters() const {
+            return mCounters;
+        }
+
+    private:
+        MdnsSocket(const MdnsSocket&) = delete;
+        MdnsSocket& operator=(const MdnsSocket&) = delete;
+
+        struct QueuedPacket
+        {
+            size_t offset;          // in mQueueData
+            size_t size;
+            sockaddr_in to;
+        };
+
+        int mFd;
+        in_addr_t mInterfaceAddress;
+        uint32_t mInterfaceIndex;
+        sockaddr_in mGroup;
+        MdnsSocketCounters mCounters;
+        MdnsSimulatedNetwork* mNetwork;             // the network of a simulated endpoint, nullptr for a real socket
+
+        std::vector<uint8_t> mQueueData;            // the queued packets back to back. Keeps its capacity
+        std::vector<QueuedPacket> mQueue;
+        bool mBlocked;
+        std::vector<iovec> mSendVectors;            // for sendmmsg, reused
+        std::vector<mmsghdr> mSendHeaders;
+    };
+};
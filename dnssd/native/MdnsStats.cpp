@@ -0,0 +1,264 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsStats.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dnssd_uwp
+{
+    namespace
+    {
+        // the counters of the threads running, and the sum of those that have exited. Never destroyed: threads
+        // may still count while the process exits
+        struct Registry
+        {
+            std::mutex lock;
+            std::vector<MdnsThreadStats*> threads;
+            MdnsThreadStats retired;
+        };
+
+        Registry& GetRegistry()
+        {
+            static Registry* registry = new Registry();
+            return *registry;
+        }
+
+        void Add(std::atomic<uint64_t>& to, uint64_t n)
+        {
+            to.store(to.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    // owns a thread's counters and folds them into the registry's retired sum when the thread exits
+    struct MdnsThreadStatsOwner
+    {
+        std::unique_ptr<MdnsThreadStats> stats;
+
+        ~MdnsThreadStatsOwner();
+    };
+
+    static thread_local MdnsThreadStatsOwner tOwner;
+
+    thread_local MdnsThreadStats* MdnsThreadStats::sCurrent = nullptr;
+
+    MdnsHistogram::MdnsHistogram()
+        : mMin(UINT64_MAX)
+        , mMax(0)
+    {
+        for (auto& count : mCounts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t MdnsHistogram::BucketOf(uint64_t value)
+    {
+        if (value < kSubBuckets)
+        {
+            return static_cast<size_t>(value);
+        }
+        value = std::min<uint64_t>(value, UINT32_MAX);
+
+        // the top kSubBucketBits + 1 bits of the value: its power of two, then its sub-bucket in that power
+        int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+        return static_cast<size_t>(shift + 1) * kSubBuckets + static_cast<size_t>((value >> shift) - kSubBuckets);
+    }
+
+    uint64_t MdnsHistogram::HighestIn(size_t bucket)
+    {
+        if (bucket < kSubBuckets)
+        {
+            return bucket;
+        }
+        int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+        uint64_t sub = kSubBuckets + bucket % kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void MdnsHistogram::Record(uint64_t value)
+    {
+        Add(mCounts[BucketOf(value)], 1);
+        if (value < mMin.load(std::memory_order_relaxed))
+        {
+            mMin.store(value, std::memory_order_relaxed);
+        }
+        if (value > mMax.load(std::memory_order_relaxed))
+        {
+            mMax.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void MdnsHistogram::Merge(const MdnsHistogram& other)
+    {
+        for (size_t i = 0; i < kBuckets; ++i)
+        {
+            uint64_t count = other.mCounts[i].load(std::memory_order_relaxed);
+            if (count != 0)
+            {
+                Add(mCounts[i], count);
+            }
+        }
+        mMin.store(std::min(mMin.load(std::memory_order_relaxed), other.mMin.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        mMax.store(std::max(mMax.load(std::memory_order_relaxed), other.mMax.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    }
+
+    uint64_t MdnsHistogram::GetCount() const
+    {
+        uint64_t total = 0;
+        for (const auto& count : mCounts)
+        {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    uint64_t MdnsHistogram::GetMin() const
+    {
+        uint64_t min = mMin.load(std::memory_order_relaxed);
+        return min == UINT64_MAX ? 0 : min;
+    }
+
+    uint64_t MdnsHistogram::GetMax() const
+    {
+        return mMax.load(std::memory_order_relaxed);
+    }
+
+    uint64_t MdnsHistogram::GetValueAtPercentile(double percentile) const
+    {
+        uint64_t total = GetCount();
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100 * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += mCounts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return std::min(HighestIn(i), GetMax());
+            }
+        }
+        return GetMax();
+    }
+
+    MdnsThreadStats::MdnsThreadStats()
+    {
+        for (auto& counter : counters)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    MdnsThreadStats& MdnsThreadStats::Register()
+    {
+        tOwner.stats.reset(new MdnsThreadStats());
+        sCurrent = tOwner.stats.get();
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        registry.threads.push_back(sCurrent);
+        return *sCurrent;
+    }
+
+    MdnsThreadStatsOwner::~MdnsThreadStatsOwner()
+    {
+        if (!stats)
+        {
+            return;
+        }
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        for (size_t i = 0; i < MdnsStatCount; ++i)
+        {
+            Add(registry.retired.counters[i], stats->counters[i].load(std::memory_order_relaxed));
+        }
+        registry.retired.receiveToCallback.Merge(stats->receiveToCallback);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), stats.get()));
+
+        // the little the thread may count while its other thread-locals go, it counts straight into the sum
+        MdnsThreadStats::sCurrent = &registry.retired;
+    }
+
+    uint64_t MdnsRealTimeNs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+    }
+
+    void MdnsCountCallback(uint64_t receivedNs)
+    {
+        MdnsThreadStats& stats = MdnsThreadStats::Get();
+        Add(stats.counters[MdnsStatCallbacksDelivered], 1);
+        if (receivedNs != 0)
+        {
+            // the wall clock may step back under a packet: that one counts as instant
+            uint64_t now = MdnsRealTimeNs();
+            stats.receiveToCallback.Record(now > receivedNs ? (now - receivedNs) / 1000 : 0);
+        }
+    }
+
+    void MdnsGetStats(DnssdStats& stats)
+    {
+        uint64_t counters[MdnsStatCount] = {};
+        std::unique_ptr<MdnsHistogram> latency(new MdnsHistogram());
+
+        auto add = [&](const MdnsThreadStats& thread)
+        {
+            for (size_t i = 0; i < MdnsStatCount; ++i)
+            {
+                counters[i] += thread.counters[i].load(std::memory_order_relaxed);
+            }
+            latency->Merge(thread.receiveToCallback);
+        };
+
+        Registry& registry = GetRegistry();
+        {
+            std::lock_guard<std::mutex> guard(registry.lock);
+            for (const MdnsThreadStats* thread : registry.threads)
+            {
+                add(*thread);
+            }
+            add(registry.retired);
+        }
+
+        stats.packetsReceived = counters[MdnsStatPacketsReceived];
+        stats.packetsSent = counters[MdnsStatPacketsSent];
+        stats.packetsTimestamped = counters[MdnsStatPacketsTimestamped];
+        stats.socketErrors = counters[MdnsStatSocketErrors];
+        stats.recordsParsed = counters[MdnsStatRecordsParsed];
+        stats.cacheHits = counters[MdnsStatCacheHits];
+        stats.cacheMisses = counters[MdnsStatCacheMisses];
+        stats.cacheEvictions = counters[MdnsStatCacheEvictions];
+        stats.queriesSent = counters[MdnsStatQueriesSent];
+        stats.answersSuppressed = counters[MdnsStatAnswersSuppressed];
+        stats.callbacksDelivered = counters[MdnsStatCallbacksDelivered];
+
+        DnssdLatencyStats& receiveToCallback = stats.receiveToCallback;
+        receiveToCallback.count = latency->GetCount();
+        receiveToCallback.min = latency->GetMin();
+        receiveToCallback.p50 = latency->GetValueAtPercentile(50);
+        receiveToCallback.p90 = latency->GetValueAtPercentile(90);
+        receiveToCallback.p99 = latency->GetValueAtPercentile(99);
+        receiveToCallback.p999 = latency->GetValueAtPercentile(99.9);
+        receiveToCallback.max = latency->GetMax();
+    }
+}
@@ -0,0 +1,115 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "dnssd.h"
+
+namespace dnssd_uwp
+{
+    // what dnssd_get_stats counts, for the whole process
+    enum MdnsStat
+    {
+        MdnsStatPacketsReceived,
+        MdnsStatPacketsSent,
+        MdnsStatPacketsTimestamped,     // received packets the kernel gave the receive time of
+        MdnsStatSocketErrors,           // sockets that could not be opened, packets that could not be sent or received
+        MdnsStatRecordsParsed,          // response records read by the query engines
+        MdnsStatCacheHits,              // records received again while cached
+        MdnsStatCacheMisses,            // records received for the first time
+        MdnsStatCacheEvictions,         // records that left the cache: expired, said goodbye, flushed or no longer needed
+        MdnsStatQueriesSent,
+        MdnsStatAnswersSuppressed,      // answers a responder left out because the querier knew them
+        MdnsStatCallbacksDelivered,     // changes reported to the application: callbacks, batched changes and queued events
+        MdnsStatCount
+    };
+
+    // HDR-style histogram: 32 linear sub-buckets per power of two, so that a value is known to within 1/32 of itself
+    // (1 exactly below 32) anywhere from 1 to 2^32 - 1, in a fixed 7 KB of counts. Larger values count as 2^32 - 1.
+    // One thread records, any thread may read
+    class MdnsHistogram
+    {
+    public:
+        static const int kSubBucketBits = 5;
+        static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+        static const size_t kBuckets = (32 - kSubBucketBits + 1) * kSubBuckets;
+
+        MdnsHistogram();
+
+        void Record(uint64_t value);
+
+        // add the counts of other. Not while this one is recorded into
+        void Merge(const MdnsHistogram& other);
+
+        uint64_t GetCount() const;
+        uint64_t GetMin() const;
+        uint64_t GetMax() const;
+
+        // the highest value recorded into the bucket holding the percentile, 0 if nothing was recorded
+        uint64_t GetValueAtPercentile(double percentile) const;
+
+    private:
+        MdnsHistogram(const MdnsHistogram&) = delete;
+        MdnsHistogram& operator=(const MdnsHistogram&) = delete;
+
+        static size_t BucketOf(uint64_t value);
+        static uint64_t HighestIn(size_t bucket);
+
+        std::atomic<uint64_t> mCounts[kBuckets];
+        std::atomic<uint64_t> mMin;
+        std::atomic<uint64_t> mMax;
+    };
+
+    struct MdnsThreadStatsOwner;
+
+    // The counters of one thread, written by that thread only: counting is a thread-local lookup and a plain
+    // add, with no shared cache line and no locked instruction, cheap enough to be always on.
+    // dnssd_get_stats adds up those of every thread, and those of the threads that have exited
+    struct MdnsThreadStats
+    {
+        MdnsThreadStats();
+
+        std::atomic<uint64_t> counters[MdnsStatCount];
+        MdnsHistogram receiveToCallback;    // microseconds
+
+        static MdnsThreadStats& Get() {
+            MdnsThreadStats* stats = sCurrent;
+            return stats != nullptr ? *stats : Register();
+        }
+
+    private:
+        friend struct MdnsThreadStatsOwner;
+
+        static MdnsThreadStats& Register();
+
+        static thread_local MdnsThreadStats* sCurrent;
+    };
+
+    inline void MdnsCount(MdnsStat stat, uint64_t n = 1)
+    {
+        std::atomic<uint64_t>& counter = MdnsThreadStats::Get().counters[stat];
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // CLOCK_REALTIME in nanoseconds: the clock of the kernel's receive timestamps
+    uint64_t MdnsRealTimeNs();
+
+    // a change reported to the application, brought by a packet received at receivedNs, or by none when 0
+    void MdnsCountCallback(uint64_t receivedNs);
+
+    // everything counted so far, in every thread
+    void MdnsGetStats(DnssdStats& stats);
+};
@@ -0,0 +1,399 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsTimerWheel.h"
+#include "MdnsTrace.h"
+#include <atomic>
+#include <mutex>
+#include <random>
+
+namespace dnssd_uwp
+{
+    static std::atomic<bool> sVirtual(false);
+    static std::atomic<MdnsClock::rep> sVirtualNow(0);
+
+    static std::mutex sSeedLock;
+    static bool sSeeded = false;
+    static std::mt19937_64 sSeeds;
+
+    MdnsClock::time_point MdnsClock::now()
+    {
+        if (sVirtual.load(std::memory_order_relaxed))
+        {
+            return time_point(duration(sVirtualNow.load(std::memory_order_relaxed)));
+        }
+        return time_point(std::chrono::steady_clock::now().time_since_epoch());
+    }
+
+    void MdnsClock::SetVirtual(time_point start)
+    {
+        sVirtualNow = start.time_since_epoch().count();
+        sVirtual = true;
+    }
+
+    bool MdnsClock::IsVirtual()
+    {
+        return sVirtual;
+    }
+
+    void MdnsClock::Advance(time_point when)
+    {
+        rep at = when.time_since_epoch().count();
+        rep current = sVirtualNow.load();
+        while (at > current && !sVirtualNow.compare_exchange_weak(current, at))
+        {
+        }
+    }
+
+    uint32_t MdnsRandomSeed()
+    {
+        std::lock_guard<std::mutex> guard(sSeedLock);
+        if (!sSeeded)
+        {
+            return std::random_device()();
+        }
+        return static_cast<uint32_t>(sSeeds());
+    }
+
+    void MdnsSetRandomSeed(uint64_t seed)
+    {
+        std::lock_guard<std::mutex> guard(sSeedLock);
+        sSeeds.seed(seed);
+        sSeeded = true;
+    }
+
+    static void ListInit(MdnsTimerLink& head)
+    {
+        head.mNext = &head;
+        head.mPrev = &head;
+    }
+
+    static bool ListEmpty(const MdnsTimerLink& head)
+    {
+        return head.mNext == &head;
+    }
+
+    static void ListInsert(MdnsTimerLink& head, MdnsTimerLink* link)
+    {
+        link->mNext = &head;
+        link->mPrev = head.mPrev;
+        head.mPrev->mNext = link;
+        head.mPrev = link;
+    }
+
+    static void ListRemove(MdnsTimerLink* link)
+    {
+        link->mPrev->mNext = link->mNext;
+        link->mNext->mPrev = link->mPrev;
+        link->mNext = nullptr;
+        link->mPrev = nullptr;
+    }
+
+    // move every element of from to the empty list to
+    static void ListTake(MdnsTimerLink& from, MdnsTimerLink& to)
+    {
+        if (ListEmpty(from))
+        {
+            ListInit(to);
+            return;
+        }
+        to.mNext = from.mNext;
+        to.mPrev = from.mPrev;
+        to.mNext->mPrev = &to;
+        to.mPrev->mNext = &to;
+        ListInit(from);
+    }
+
+    // index of the first set bit at or after position start, wrapping around; -1 if none
+    static int NextSetBit(uint64_t bits, int start)
+    {
+        if (bits == 0)
+        {
+            return -1;
+        }
+        uint64_t rotated = (bits >> start) | (start ? bits << (64 - start) : 0);
+        return (start + __builtin_ctzll(rotated)) & 63;
+    }
+
+    MdnsTimer::MdnsTimer()
+        : mTick(0)
+        , mWheel(nullptr)
+        , mLevel(0)
+        , mSlot(0)
+    {
+        mNext = nullptr;
+        mPrev = nullptr;
+    }
+
+    MdnsTimer::MdnsTimer(Callback callback)
+        : MdnsTimer()
+    {
+        mCallback = std::move(callback);
+    }
+
+    MdnsTimer::~MdnsTimer()
+    {
+        if (mWheel != nullptr)
+        {
+            mWheel->Cancel(*this);
+        }
+    }
+
+    MdnsTimerWheel::MdnsTimerWheel(MdnsClock::time_point start)
+        : mStart(start)
+        , mCurrent(0)
+        , mNextTick(UINT64_MAX)
+        , mSize(0)
+    {
+        for (int level = 0; level < kLevels; ++level)
+        {
+            mOccupied[level] = 0;
+            for (int slot = 0; slot < kSlots; ++slot)
+            {
+                ListInit(mSlots[level][slot]);
+            }
+        }
+    }
+
+    MdnsTimerWheel::~MdnsTimerWheel()
+    {
+        // detach the timers that are still scheduled so their destructors don't touch the wheel
+        for (int level = 0; level < kLevels; ++level)
+        {
+            for (int slot = 0; slot < kSlots; ++slot)
+            {
+                MdnsTimerLink& head = mSlots[level][slot];
+                while (!ListEmpty(head))
+                {
+                    MdnsTimer* timer = static_cast<MdnsTimer*>(head.mNext);
+                    ListRemove(timer);
+                    timer->mWheel = nullptr;
+                }
+            }
+        }
+    }
+
+    uint64_t MdnsTimerWheel::ToTick(MdnsClock::time_point when) const
+    {
+        if (when <= mStart)
+        {
+            return 0;
+        }
+        // round up so a timer never fires before its time
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(when - mStart).count();
+        return static_cast<uint64_t>((elapsed + 999999) / 1000000);
+    }
+
+    MdnsClock::time_point MdnsTimerWheel::ToTime(uint64_t tick) const
+    {
+        return mStart + std::chrono::milliseconds(tick);
+    }
+
+    void MdnsTimerWheel::Schedule(MdnsTimer& timer, MdnsClock::time_point when)
+    {
+        if (timer.mWheel != nullptr)
+        {
+            timer.mWheel->Cancel(timer);
+        }
+
+        uint64_t tick = when == MdnsClock::time_point::max() ? UINT64_MAX : ToTick(when);
+        timer.mExpires = when;
+        timer.mTick = tick > mCurrent ? tick : mCurrent + 1;
+        timer.mWheel = this;
+        Place(timer);
+        mSize++;
+    }
+
+    void MdnsTimerWheel::Cancel(MdnsTimer& timer)
+    {
+        if (timer.mWheel != this)
+        {
+            return;
+        }
+        Unlink(timer);
+        timer.mWheel = nullptr;
+        mSize--;
+    }
+
+    void MdnsTimerWheel::Place(MdnsTimer& timer)
+    {
+        uint64_t delta = timer.mTick - mCurrent;
+        int level = 0;
+        while (level < kLevels - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1))))
+        {
+            level++;
+        }
+
+        // beyond the range of the top level: park in the farthest top level slot, it is placed again when cascaded
+        uint64_t tick = timer.mTick;
+        uint64_t range = uint64_t(1) << (kSlotBits * kLevels);
+        if (delta >= range)
+        {
+            tick = mCurrent + range - 1;
+        }
+
+        int slot = static_cast<int>((tick >> (kSlotBits * level)) & kSlotMask);
+        timer.mLevel = static_cast<uint8_t>(level);
+        timer.mSlot = static_cast<uint8_t>(slot);
+        ListInsert(mSlots[level][slot], &timer);
+        mOccupied[level] |= uint64_t(1) << slot;
+
+        // the slot runs (level 0) or is cascaded (higher levels) when mCurrent reaches the start of its range
+        uint64_t event = (tick >> (kSlotBits * level)) << (kSlotBits * level);
+        if (event < mNextTick)
+        {
+            mNextTick = event;
+        }
+    }
+
+    void MdnsTimerWheel::Unlink(MdnsTimer& timer)
+    {
+        ListRemove(&timer);
+        MdnsTimerLink& head = mSlots[timer.mLevel][timer.mSlot];
+        if (ListEmpty(head))
+        {
+            mOccupied[timer.mLevel] &= ~(uint64_t(1) << timer.mSlot);
+        }
+    }
+
+    void MdnsTimerWheel::Cascade(int level)
+    {
+        int slot = static_cast<int>((mCurrent >> (kSlotBits * level)) & kSlotMask);
+        if ((mOccupied[level] & (uint64_t(1) << slot)) == 0)
+        {
+            return;
+        }
+
+        MdnsTimerLink pending;
+        ListTake(mSlots[level][slot], pending);
+        mOccupied[level] &= ~(uint64_t(1) << slot);
+
+        while (!ListEmpty(pending))
+        {
+            MdnsTimer* timer = static_cast<MdnsTimer*>(pending.mNext);
+            ListRemove(timer);
+            Place(*timer);
+        }
+    }
+
+    size_t MdnsTimerWheel::RunSlot(int slot)
+    {
+        if ((mOccupied[0] & (uint64_t(1) << slot)) == 0)
+        {
+            return 0;
+        }
+
+        // detach the slot first: callbacks may schedule new timers into it or cancel timers still pending here
+        MdnsTimerLink pending;
+        ListTake(mSlots[0][slot], pending);
+        mOccupied[0] &= ~(uint64_t(1) << slot);
+
+        size_t fired = 0;
+        while (!ListEmpty(pending))
+        {
+            MdnsTimer* timer = static_cast<MdnsTimer*>(pending.mNext);
+            ListRemove(timer);
+            timer->mWheel = nullptr;
+            mSize--;
+            fired++;
+            if (timer->mCallback)
+            {
+                MDNS_TRACE_SCOPE("timer", "fire");
+                timer->mCallback();
+            }
+        }
+        return fired;
+    }
+
+    size_t MdnsTimerWheel::Advance(MdnsClock::time_point now)
+    {
+        if (now <= mStart)
+        {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - mStart).count());
+
+        size_t fired = 0;
+        while (mNextTick <= target)
+        {
+            // jump straight to the next tick with a slot to run or cascade, skipping empty stretches
+            uint64_t next = NextTick();
+            mNextTick = next;
+            if (next > target)
+            {
+                break;
+            }
+            mCurrent = next;
+
+            if ((mCurrent & kSlotMask) == 0)
+            {
+                for (int level = 1; level < kLevels; ++level)
+                {
+                    Cascade(level);
+                    if (((mCurrent >> (kSlotBits * level)) & kSlotMask) != 0)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            fired += RunSlot(static_cast<int>(mCurrent & kSlotMask));
+            mNextTick = mCurrent;
+        }
+
+        if (mCurrent < target)
+        {
+            // nothing is due before target
+            mCurrent = target;
+        }
+        return fired;
+    }
+
+    MdnsClock::time_point MdnsTimerWheel::NextDeadline() const
+    {
+        return mNextTick == UINT64_MAX ? MdnsClock::time_point::max() : ToTime(mNextTick);
+    }
+
+    uint64_t MdnsTimerWheel::NextTick() const
+    {
+        uint64_t best = UINT64_MAX;
+
+        // level 0: the next occupied slot after the current one fires at its own tick
+        int index = static_cast<int>(mCurrent & kSlotMask);
+        int slot = NextSetBit(mOccupied[0], (index + 1) & kSlotMask);
+        if (slot >= 0)
+        {
+            uint64_t distance = (static_cast<uint64_t>(slot) - index) & kSlotMask;
+            best = mCurrent + (distance == 0 ? kSlots : distance);
+        }
+
+        // higher levels: the tick at which the next occupied slot is cascaded down
+        for (int level = 1; level < kLevels; ++level)
+        {
+            int shift = kSlotBits * level;
+            int current = static_cast<int>((mCurrent >> shift) & kSlotMask);
+            slot = NextSetBit(mOccupied[level], (current + 1) & kSlotMask);
+            if (slot < 0)
+            {
+                continue;
+            }
+            uint64_t distance = (static_cast<uint64_t>(slot) - current) & kSlotMask;
+            uint64_t tick = ((mCurrent >> shift) + (distance == 0 ? kSlots : distance)) << shift;
+            if (tick < best)
+            {
+                best = tick;
+            }
+        }
+
+        return best;
+    }
+}
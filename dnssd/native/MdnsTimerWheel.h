@@ -0,0 +1,144 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace dnssd_uwp
+{
+    // The clock of the protocol: steady_clock, or virtual time once a simulation has taken time over with SetVirtual().
+    // Virtual time only moves when the simulation moves it, so a simulated run does not depend on how fast it runs
+    class MdnsClock
+    {
+    public:
+        typedef std::chrono::steady_clock::duration duration;
+        typedef duration::rep rep;
+        typedef duration::period period;
+        typedef std::chrono::time_point<MdnsClock> time_point;
+        static const bool is_steady = true;
+
+        static time_point now();
+
+        // switch to virtual time, starting at start. For good: a process runs on one clock or the other
+        static void SetVirtual(time_point start);
+        static bool IsVirtual();
+
+        // move virtual time forward to when; never backwards
+        static void Advance(time_point when);
+    };
+
+    // a seed for the generators of random protocol delays: from std::random_device, or the next of a sequence
+    // once MdnsSetRandomSeed() has been called, so that a simulated run draws the same delays every time
+    uint32_t MdnsRandomSeed();
+    void MdnsSetRandomSeed(uint64_t seed);
+
+    class MdnsTimerWheel;
+
+    // links of the intrusive circular lists that make up the wheel slots
+    struct MdnsTimerLink
+    {
+        MdnsTimerLink* mNext;
+        MdnsTimerLink* mPrev;
+    };
+
+    // A deadline owned by the object it belongs to (a cache record, a probe schedule...).
+    // Scheduling links the timer into an MdnsTimerWheel without allocating. The callback runs on
+    // the thread calling MdnsTimerWheel::Advance and may reschedule or cancel any timer, including this one.
+    class MdnsTimer : private MdnsTimerLink
+    {
+    public:
+        typedef std::function<void()> Callback;
+
+        MdnsTimer();
+        explicit MdnsTimer(Callback callback);
+        ~MdnsTimer();
+
+        void SetCallback(Callback callback) {
+            mCallback = std::move(callback);
+        }
+
+        bool IsScheduled() const {
+            return mWheel != nullptr;
+        }
+
+        MdnsClock::time_point Expires() const {
+            return mExpires;
+        }
+
+    private:
+        MdnsTimer(const MdnsTimer&) = delete;
+        MdnsTimer& operator=(const MdnsTimer&) = delete;
+
+        friend class MdnsTimerWheel;
+
+        Callback mCallback;
+        MdnsClock::time_point mExpires;
+        uint64_t mTick;             // wheel tick the timer fires at
+        MdnsTimerWheel* mWheel;     // wheel the timer is linked into, nullptr when not scheduled
+        uint8_t mLevel;
+        uint8_t mSlot;
+    };
+
+    // Hierarchical timer wheel with 1 ms ticks.
+    // Five levels of 64 slots cover about 12 days; a timer lands in the level whose slot width matches how far away
+    // it is and moves down a level each time the level below wraps around. Schedule and Cancel are O(1),
+    // Advance costs O(1) per expired timer plus one cascade per level wrap, and NextDeadline() only reads the
+    // per-level occupancy bitmaps. Timers fire in tick order, up to one tick late.
+    class MdnsTimerWheel
+    {
+    public:
+        explicit MdnsTimerWheel(MdnsClock::time_point start = MdnsClock::now());
+        ~MdnsTimerWheel();
+
+        // (re)schedule a timer. A time in the past fires on the next tick
+        void Schedule(MdnsTimer& timer, MdnsClock::time_point when);
+        void Cancel(MdnsTimer& timer);
+
+        // run the callbacks of every timer due at or before now. Returns the number of timers fired
+        size_t Advance(MdnsClock::time_point now);
+
+        // no timer fires before this time, time_point::max() when nothing is scheduled.
+        // May be earlier than the first timer when a higher level has to be cascaded first
+        MdnsClock::time_point NextDeadline() const;
+
+        size_t Size() const {
+            return mSize;
+        }
+
+    private:
+        MdnsTimerWheel(const MdnsTimerWheel&) = delete;
+        MdnsTimerWheel& operator=(const MdnsTimerWheel&) = delete;
+
+        static const int kLevels = 5;
+        static const int kSlotBits = 6;
+        static const int kSlots = 1 << kSlotBits;
+        static const uint64_t kSlotMask = kSlots - 1;
+
+        uint64_t ToTick(MdnsClock::time_point when) const;
+        MdnsClock::time_point ToTime(uint64_t tick) const;
+        uint64_t NextTick() const;
+        void Place(MdnsTimer& timer);
+        void Unlink(MdnsTimer& timer);
+        void Cascade(int level);
+        size_t RunSlot(int slot);
+
+        MdnsClock::time_point mStart;
+        uint64_t mCurrent;          // last tick processed
+        uint64_t mNextTick;         // no slot needs attention before this tick. Cancel may leave it early
+        size_t mSize;
+        uint64_t mOccupied[kLevels];
+        MdnsTimerLink mSlots[kLevels][kSlots];
+    };
+};
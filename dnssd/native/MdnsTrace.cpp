@@ -0,0 +1,228 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#include "MdnsTrace.h"
+
+#ifdef DNSSD_TRACING
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace dnssd_uwp
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            const char* category;
+            const char* name;
+            uint64_t start;         // CLOCK_MONOTONIC ns
+            uint64_t duration;
+        };
+
+        // One thread's spans, in a ring only that thread writes: a span is written into its slot, then published
+        // by moving mEnd on with a release store. The newest kCapacity spans are kept. A reader copies the slots
+        // and then drops those the thread may have been overwriting meanwhile
+        struct TraceBuffer
+        {
+            static const uint64_t kCapacity = 1 << 16;
+
+            TraceBuffer()
+                : events(kCapacity)
+                , end(0)
+                , tid(0)
+            {
+                threadName[0] = '\0';
+            }
+
+            std::vector<TraceEvent> events;
+            std::atomic<uint64_t> end;      // spans written since the thread started
+            long tid;
+            char threadName[16];
+        };
+
+        // Every thread's buffer, kept after the thread exits so that its spans can still be written.
+        // Never destroyed: threads may still trace while the process exits
+        struct TraceRegistry
+        {
+            std::mutex lock;
+            std::vector<TraceBuffer*> buffers;
+        };
+
+        TraceRegistry& GetTraceRegistry()
+        {
+            static TraceRegistry* registry = new TraceRegistry();
+            return *registry;
+        }
+
+        thread_local TraceBuffer* tBuffer = nullptr;
+
+        TraceBuffer& GetTraceBuffer()
+        {
+            if (tBuffer == nullptr)
+            {
+                TraceBuffer* buffer = new TraceBuffer();
+                buffer->tid = syscall(SYS_gettid);
+                pthread_getname_np(pthread_self(), buffer->threadName, sizeof(buffer->threadName));
+
+                TraceRegistry& registry = GetTraceRegistry();
+                std::lock_guard<std::mutex> guard(registry.lock);
+                registry.buffers.push_back(buffer);
+                tBuffer = buffer;
+            }
+            return *tBuffer;
+        }
+
+        uint64_t ClockNs(clockid_t clock)
+        {
+            timespec now;
+            clock_gettime(clock, &now);
+            return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+        }
+
+        // the spans of a buffer still in place once copied
+        void CopyEvents(const TraceBuffer& buffer, std::vector<TraceEvent>& events)
+        {
+            const uint64_t capacity = TraceBuffer::kCapacity;
+            uint64_t end = buffer.end.load(std::memory_order_acquire);
+            uint64_t first = end > capacity ? end - capacity : 0;
+            std::vector<TraceEvent> copied;
+            for (uint64_t i = first; i < end; ++i)
+            {
+                copied.push_back(buffer.events[i % capacity]);
+            }
+
+            // the slot of span end is being written before end moves on: what was at or behind it is gone
+            uint64_t after = buffer.end.load(std::memory_order_acquire);
+            uint64_t valid = after + 1 > capacity ? after + 1 - capacity : 0;
+            for (uint64_t i = std::max(first, valid); i < end; ++i)
+            {
+                events.push_back(copied[i - first]);
+            }
+        }
+
+        // names are string literals of ours, but a thread name may hold anything
+        void WriteString(FILE* file, const char* s)
+        {
+            fputc('"', file);
+            for (; *s != '\0'; ++s)
+            {
+                unsigned char c = static_cast<unsigned char>(*s);
+                if (c == '"' || c == '\\')
+                {
+                    fprintf(file, "\\%c", c);
+                }
+                else if (c < 0x20)
+                {
+                    fprintf(file, "\\u%04x", c);
+                }
+                else
+                {
+                    fputc(c, file);
+                }
+            }
+            fputc('"', file);
+        }
+    }
+
+    uint64_t MdnsTraceNow()
+    {
+        return ClockNs(CLOCK_MONOTONIC);
+    }
+
+    void MdnsTraceSpan(const char* category, const char* name, uint64_t startNs, uint64_t endNs)
+    {
+        TraceBuffer& buffer = GetTraceBuffer();
+        uint64_t end = buffer.end.load(std::memory_order_relaxed);
+        buffer.events[end % TraceBuffer::kCapacity] = TraceEvent{ category, name, startNs, endNs > startNs ? endNs - startNs : 0 };
+        buffer.end.store(end + 1, std::memory_order_release);
+    }
+
+    void MdnsTraceSinceReceived(const char* category, const char* name, uint64_t receivedNs)
+    {
+        // moved onto the monotonic clock by the distance between the two clocks now
+        uint64_t now = MdnsTraceNow();
+        uint64_t realNow = ClockNs(CLOCK_REALTIME);
+        uint64_t waited = realNow > receivedNs ? realNow - receivedNs : 0;
+        MdnsTraceSpan(category, name, now > waited ? now - waited : 0, now);
+    }
+
+    bool MdnsTraceWrite(const char* path)
+    {
+        FILE* file = fopen(path, "w");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::vector<TraceBuffer*> buffers;
+        {
+            TraceRegistry& registry = GetTraceRegistry();
+            std::lock_guard<std::mutex> guard(registry.lock);
+            buffers = registry.buffers;
+        }
+
+        // timestamps in microseconds from the first span, as the format wants them
+        std::vector<std::vector<TraceEvent>> events(buffers.size());
+        uint64_t origin = UINT64_MAX;
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            CopyEvents(*buffers[b], events[b]);
+            for (const TraceEvent& event : events[b])
+            {
+                origin = std::min(origin, event.start);
+            }
+        }
+
+        long pid = static_cast<long>(getpid());
+        fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+        const char* separator = "\n";
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            fprintf(file, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": %ld, \"tid\": %ld, \"args\": {\"name\": ", separator, pid, buffers[b]->tid);
+            WriteString(file, buffers[b]->threadName[0] != '\0' ? buffers[b]->threadName : "thread");
+            fprintf(file, "}}");
+            separator = ",\n";
+
+            for (const TraceEvent& event : events[b])
+            {
+                fprintf(file, ",\n{\"ph\": \"X\", \"cat\": ");
+                WriteString(file, event.category);
+                fprintf(file, ", \"name\": ");
+                WriteString(file, event.name);
+                fprintf(file, ", \"pid\": %ld, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f}", pid, buffers[b]->tid,
+                    (event.start - origin) / 1000.0, event.duration / 1000.0);
+            }
+        }
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+}
+
+#else
+
+namespace dnssd_uwp
+{
+    bool MdnsTraceWrite(const char* path)
+    {
+        return false;
+    }
+}
+
+#endif
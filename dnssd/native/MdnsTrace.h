@@ -0,0 +1,76 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Trace points on the way from a packet to the callback it brings: socket reads and writes, parsing, cache
+// updates, timers, queries and responses sent, callbacks. Built with DNSSD_TRACING (cmake -DDNSSD_TRACING=ON),
+// each one records a span into a buffer of the thread, without a lock; otherwise they compile to nothing.
+// dnssd_write_trace writes what was recorded as Chrome trace event JSON, for chrome://tracing or ui.perfetto.dev.
+// Categories and names must be string literals: only their addresses are recorded.
+#ifdef DNSSD_TRACING
+
+#define MDNS_TRACE_CONCAT_(a, b) a##b
+#define MDNS_TRACE_CONCAT(a, b) MDNS_TRACE_CONCAT_(a, b)
+
+// a span from here to the end of the scope
+#define MDNS_TRACE_SCOPE(category, name) dnssd_uwp::MdnsTraceScope MDNS_TRACE_CONCAT(mdnsTraceScope, __LINE__)(category, name)
+
+// a span from receivedNs, a CLOCK_REALTIME time such as a packet's kernel receive timestamp, to now
+#define MDNS_TRACE_SINCE_RECEIVED(category, name, receivedNs) dnssd_uwp::MdnsTraceSinceReceived(category, name, receivedNs)
+
+#else
+
+#define MDNS_TRACE_SCOPE(category, name) static_cast<void>(0)
+#define MDNS_TRACE_SINCE_RECEIVED(category, name, receivedNs) static_cast<void>(0)
+
+#endif
+
+namespace dnssd_uwp
+{
+    // writes every thread's recorded spans to path. false if tracing is not built in or path cannot be written
+    bool MdnsTraceWrite(const char* path);
+
+#ifdef DNSSD_TRACING
+    // CLOCK_MONOTONIC in nanoseconds
+    uint64_t MdnsTraceNow();
+
+    void MdnsTraceSpan(const char* category, const char* name, uint64_t startNs, uint64_t endNs);
+    void MdnsTraceSinceReceived(const char* category, const char* name, uint64_t receivedNs);
+
+    class MdnsTraceScope
+    {
+    public:
+        MdnsTraceScope(const char* category, const char* name)
+            : mCategory(category)
+            , mName(name)
+            , mStart(MdnsTraceNow())
+        {
+        }
+
+        ~MdnsTraceScope()
+        {
+            MdnsTraceSpan(mCategory, mName, mStart, MdnsTraceNow());
+        }
+
+    private:
+        MdnsTraceScope(const MdnsTraceScope&) = delete;
+        MdnsTraceScope& operator=(const MdnsTraceScope&) = delete;
+
+        const char* mCategory;
+        const char* mName;
+        uint64_t mStart;
+    };
+#endif
+};
@@ -0,0 +1,510 @@
+// ******************************************************************
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THE CODE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE CODE OR THE USE OR OTHER DEALINGS IN THE CODE.
+// ******************************************************************
+
+// Native mDNS implementation of the dnssd.h exports. Used on platforms without the
+// Windows Runtime Windows::Networking::ServiceDiscovery::Dnssd API (see CMakeLists.txt).
+
+#include "dnssd.h"
+#include "DnssdTxtRecord.h"
+#include "MdnsReactor.h"
+#include "MdnsService.h"
+#include "MdnsServiceWatcher.h"
+#include "MdnsSocket.h"
+#include "MdnsStats.h"
+#include "MdnsTrace.h"
+#include <new>
+#include <vector>
+
+namespace dnssd_uwp
+{
+    static bool mInitialized = false;
+
+    DNSSD_API DnssdErrorType dnssd_initialize()
+    {
+        // nothing to initialize. Watchers share a query engine started with the first one; services open their own
+        // sockets. Both are served by the process MdnsReactor, started with the first of them
+        mInitialized = true;
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_use_caller_thread()
+    {
+        return MdnsReactor::SetCallerThreadMode();
+    }
+
+    DNSSD_API DnssdErrorType dnssd_get_events_wait_handle(DnssdWaitHandle *handle)
+    {
+        if (handle == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        std::shared_ptr<MdnsReactor> reactor = MdnsReactor::GetShared();
+        if (!reactor)
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+        if (!reactor->IsCallerThreadMode())
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *handle = reactor->GetFd();
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_run_events(int timeoutMs)
+    {
+        std::shared_ptr<MdnsReactor> reactor = MdnsReactor::GetShared();
+        if (!reactor)
+        {
+            return DNSSD_SERVICE_INITIALIZATION_ERROR;
+        }
+        if (!reactor->IsCallerThreadMode() || reactor->IsLoopThread())
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        reactor->RunOnce(timeoutMs);
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_get_stats(DnssdStats *stats)
+    {
+        if (stats == nullptr || stats->size < sizeof(DnssdStats))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        MdnsGetStats(*stats);
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_write_trace(const char* path)
+    {
+        if (path == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        return MdnsTraceWrite(path) ? DNSSD_NO_ERROR : DNSSD_UNSPECIFIED_ERROR;
+    }
+
+    // interface indexes from the caller, checked against the interfaces there are
+    static bool GetInterfaces(const uint32_t* interfaces, size_t interfaceCount, std::vector<uint32_t>& indexes)
+    {
+        if (interfaces == nullptr && interfaceCount != 0)
+        {
+            return false;
+        }
+
+        indexes.assign(interfaces, interfaces + interfaceCount);
+        std::vector<MdnsInterface> selected;
+        return MdnsSelectInterfaces(indexes, selected);
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        return dnssd_create_service_watcher_on_interfaces(serviceName, callback, nullptr, 0, serviceWatcher);
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_on_interfaces(const char* serviceName, DnssdServiceChangedCallback callback, const uint32_t* interfaces, size_t interfaceCount, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+        std::vector<uint32_t> indexes;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr || !GetInterfaces(interfaces, interfaceCount, indexes))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = new (std::nothrow) MdnsServiceWatcher(serviceName, callback);
+        if (watcher == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        watcher->SetInterfaces(indexes);
+        result = watcher->Initialize();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete watcher;
+        }
+        else
+        {
+            *serviceWatcher = (DnssdServiceWatcherPtr)watcher;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_batched(const char* serviceName, DnssdServiceChangesCallback callback, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = new (std::nothrow) MdnsServiceWatcher(serviceName);
+        if (watcher == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        watcher->SetDnssdServiceChangesCallback(callback);
+        result = watcher->Initialize();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete watcher;
+        }
+        else
+        {
+            *serviceWatcher = (DnssdServiceWatcherPtr)watcher;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_async(const char* serviceName, DnssdServiceChangedCallback callback, DnssdServiceWatcherStartedCallback startedCallback, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr || startedCallback == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = new (std::nothrow) MdnsServiceWatcher(serviceName, callback);
+        if (watcher == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        // Initialize() only queues the subscription; the event loop calls back once the engine browses for the type
+        watcher->SetStartedCallback(startedCallback);
+        result = watcher->Initialize();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete watcher;
+        }
+        else
+        {
+            *serviceWatcher = (DnssdServiceWatcherPtr)watcher;
+        }
+
+        return result;
+    }
+
+    DNSSD_API void dnssd_free_service_watcher(DnssdServiceWatcherPtr serviceWatcher)
+    {
+        if (serviceWatcher)
+        {
+            MdnsServiceWatcher* watcher = (MdnsServiceWatcher*)serviceWatcher;
+            delete watcher;
+        }
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_watcher_queued(const char* serviceName, size_t capacity, DnssdServiceWatcherPtr *serviceWatcher)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (serviceWatcher == nullptr || serviceName == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *serviceWatcher = nullptr;
+
+        auto watcher = new (std::nothrow) MdnsServiceWatcher(serviceName);
+        if (watcher == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        result = watcher->EnableEventQueue(capacity);
+        if (result == DNSSD_NO_ERROR)
+        {
+            result = watcher->Initialize();
+        }
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete watcher;
+        }
+        else
+        {
+            *serviceWatcher = (DnssdServiceWatcherPtr)watcher;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_watcher_get_wait_handle(DnssdServiceWatcherPtr serviceWatcher, DnssdWaitHandle *handle)
+    {
+        if (serviceWatcher == nullptr || handle == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        DnssdEventQueue* queue = ((MdnsServiceWatcher*)serviceWatcher)->GetEventQueue();
+        if (queue == nullptr)
+        {
+            // not created with dnssd_create_service_watcher_queued
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *handle = queue->GetWaitHandle();
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API size_t dnssd_watcher_drain(DnssdServiceWatcherPtr serviceWatcher, DnssdServiceChange* events, size_t max)
+    {
+        if (serviceWatcher == nullptr || events == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdEventQueue* queue = ((MdnsServiceWatcher*)serviceWatcher)->GetEventQueue();
+        return queue != nullptr ? queue->Drain(events, max) : 0;
+    }
+
+    DNSSD_API size_t dnssd_watcher_dropped_events(DnssdServiceWatcherPtr serviceWatcher)
+    {
+        if (serviceWatcher == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdEventQueue* queue = ((MdnsServiceWatcher*)serviceWatcher)->GetEventQueue();
+        return queue != nullptr ? static_cast<size_t>(queue->Dropped()) : 0;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_watcher_acquire_snapshot(DnssdServiceWatcherPtr serviceWatcher, const DnssdServiceSnapshot** snapshot)
+    {
+        if (serviceWatcher == nullptr || snapshot == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        MdnsServiceWatcher* watcher = (MdnsServiceWatcher*)serviceWatcher;
+        *snapshot = watcher->AcquireSnapshot();
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API void dnssd_snapshot_release(const DnssdServiceSnapshot* snapshot)
+    {
+        DnssdSnapshotPublisher::Release(snapshot);
+    }
+
+    DNSSD_API DnssdErrorType dnssd_get_service_info2(const DnssdServiceInfo* info, DnssdServiceInfo2* info2)
+    {
+        if (info == nullptr || info->id == nullptr || info2 == nullptr || info2->size < sizeof(DnssdServiceInfo2))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        DnssdServiceFields::Fill2(*info, *info2);
+        return DNSSD_NO_ERROR;
+    }
+
+    DNSSD_API size_t dnssd_get_service_addresses(const DnssdServiceInfo* info, DnssdAddress* addresses, size_t max)
+    {
+        if (info == nullptr || info->id == nullptr || (addresses == nullptr && max != 0))
+        {
+            return 0;
+        }
+
+        return DnssdServiceFields::GetAddresses(*info, addresses, max);
+    }
+
+    DNSSD_API int dnssd_txt_get(DnssdTxtRecordPtr txt, const char* key, const char** value, size_t* valueLength)
+    {
+        if (key == nullptr || value == nullptr || valueLength == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdTxtRecordReader reader(txt);
+        return reader.Find(key, *value, *valueLength) ? 1 : 0;
+    }
+
+    DNSSD_API int dnssd_txt_next(DnssdTxtRecordPtr txt, size_t* position, const char** key, size_t* keyLength, const char** value, size_t* valueLength)
+    {
+        if (position == nullptr || key == nullptr || keyLength == nullptr || value == nullptr || valueLength == nullptr)
+        {
+            return 0;
+        }
+
+        DnssdTxtRecordReader reader(txt);
+        return reader.Next(*position, *key, *keyLength, *value, *valueLength) ? 1 : 0;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service(const char* serviceName, const char* port, DnssdServicePtr *service)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (service == nullptr || serviceName == nullptr || port == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        auto s = new (std::nothrow) MdnsService(serviceName, port);
+        if (s == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        result = s->Start();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete s;
+        }
+        else
+        {
+            *service = (DnssdServicePtr)s;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_create_service_async(const char* serviceName, const char* port, DnssdServiceStartedCallback callback, DnssdServicePtr *service)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+
+        if (service == nullptr || serviceName == nullptr || port == nullptr || callback == nullptr)
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        auto s = new (std::nothrow) MdnsService(serviceName, port);
+        if (s == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        // probing and the first announcement happen on the event loop, which reports to callback
+        result = s->StartAsync(callback);
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete s;
+        }
+        else
+        {
+            *service = (DnssdServicePtr)s;
+        }
+
+        return result;
+    }
+
+    DNSSD_API DnssdErrorType dnssd_register_services(const DnssdServiceRegistration* services, size_t count, DnssdServicePtr *service)
+    {
+        return dnssd_register_services_on_interfaces(services, count, nullptr, 0, service);
+    }
+
+    DNSSD_API DnssdErrorType dnssd_register_services_on_interfaces(const DnssdServiceRegistration* services, size_t count, const uint32_t* interfaces, size_t interfaceCount, DnssdServicePtr *service)
+    {
+        DnssdErrorType result = DNSSD_NO_ERROR;
+        std::vector<uint32_t> indexes;
+
+        if (service == nullptr || services == nullptr || count == 0 || !GetInterfaces(interfaces, interfaceCount, indexes))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        *service = nullptr;
+
+        std::vector<MdnsServiceRegistration> registrations(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (services[i].serviceName == nullptr || services[i].instanceName == nullptr || services[i].port == nullptr)
+            {
+                return DNSSD_INVALID_PARAMETER_ERROR;
+            }
+            registrations[i].serviceName = services[i].serviceName;
+            registrations[i].instanceName = services[i].instanceName;
+            registrations[i].port = services[i].port;
+        }
+
+        // one responder for all of them: one socket per interface, shared probe and announcement packets
+        auto s = new (std::nothrow) MdnsService(registrations);
+        if (s == nullptr)
+        {
+            return DNSSD_MEMORY_ERROR;
+        }
+
+        s->SetInterfaces(indexes);
+        result = s->Start();
+
+        if (result != DNSSD_NO_ERROR)
+        {
+            delete s;
+        }
+        else
+        {
+            *service = (DnssdServicePtr)s;
+        }
+
+        return result;
+    }
+
+    DNSSD_API const char* dnssd_service_get_instance_name(DnssdServicePtr service, size_t index)
+    {
+        MdnsService* s = (MdnsService*)service;
+        if (s == nullptr || index >= s->GetInstanceCount())
+        {
+            return nullptr;
+        }
+        return s->GetInstanceName(index).c_str();
+    }
+
+    DNSSD_API DnssdErrorType dnssd_service_update(DnssdServicePtr service, size_t index, const char* port, const DnssdTxtEntry* txt, size_t txtCount)
+    {
+        MdnsService* s = (MdnsService*)service;
+        if (s == nullptr || (txt == nullptr && txtCount != 0))
+        {
+            return DNSSD_INVALID_PARAMETER_ERROR;
+        }
+
+        std::string rdata;
+        if (txt != nullptr)
+        {
+            rdata = DnssdTxtRecordReader::MakeRdata(txt, txtCount);
+        }
+        return s->Update(index, port, txt != nullptr ? &rdata : nullptr);
+    }
+
+    DNSSD_API void dnssd_free_service(DnssdServicePtr service)
+    {
+        if (service)
+        {
+            MdnsService* s = (MdnsService*)service;
+            delete s;
+        }
+    }
+}